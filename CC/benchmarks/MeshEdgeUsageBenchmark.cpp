@@ -0,0 +1,289 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//##########################################################################
+
+//Compares MeshSamplingTools::buildMeshEdgeUsageTable with the former
+//std::map based edge counting on a shuffled grid mesh with holes.
+//
+//Usage: MeshEdgeUsageBenchmark [grid size (default: 1000)]
+//Returns 0 if the edge counts and the boundary loops are identical.
+
+#include <MeshSamplingTools.h>
+#include <PointCloud.h>
+#include <SimpleMesh.h>
+
+//system
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace CCLib;
+
+//! Gives access to the (protected) edge usage table
+class EdgeUsageTableAccess : public MeshSamplingTools
+{
+public:
+	using MeshSamplingTools::EdgeUsageTable;
+	using MeshSamplingTools::ComputeEdgeKey;
+	using MeshSamplingTools::buildMeshEdgeUsageTable;
+};
+
+//! Reference edge counting (former MeshSamplingTools implementation)
+using EdgeUsageMap = std::map<unsigned long long, unsigned>;
+
+static void BuildEdgeUsageMap(GenericIndexedMesh* mesh, EdgeUsageMap& edgeMap)
+{
+	edgeMap.clear();
+
+	mesh->placeIteratorAtBeginning();
+	for (unsigned n = 0; n < mesh->size(); ++n)
+	{
+		VerticesIndexes* tri = mesh->getNextTriangleVertIndexes();
+		for (unsigned j = 0; j < 3; ++j)
+		{
+			++edgeMap[EdgeUsageTableAccess::ComputeEdgeKey(tri->i[j], tri->i[(j + 1) % 3])];
+		}
+	}
+}
+
+//! Grid hole (cells [x0,x1[ x [y0,y1[ are not triangulated)
+struct Hole
+{
+	unsigned x0, y0, x1, y1;
+
+	bool contains(unsigned x, unsigned y) const { return x >= x0 && x < x1 && y >= y0 && y < y1; }
+};
+
+//! Builds a grid mesh with holes (shuffled vertices and triangles)
+static SimpleMesh* BuildGridMesh(unsigned gridSize, const std::vector<Hole>& holes, PointCloud& vertices)
+{
+	const unsigned vertCount = gridSize * gridSize;
+
+	//shuffle the vertex indexes so that the edge keys are not sorted
+	std::mt19937 gen(1234);
+	std::vector<unsigned> vertIndexes(vertCount);
+	std::iota(vertIndexes.begin(), vertIndexes.end(), 0);
+	std::shuffle(vertIndexes.begin(), vertIndexes.end(), gen);
+
+	std::vector<unsigned> gridIndexes(vertCount);
+	for (unsigned i = 0; i < vertCount; ++i)
+		gridIndexes[vertIndexes[i]] = i;
+
+	if (!vertices.reserve(vertCount))
+		return nullptr;
+	for (unsigned i = 0; i < vertCount; ++i)
+		vertices.addPoint(CCVector3(static_cast<PointCoordinateType>(gridIndexes[i] % gridSize), static_cast<PointCoordinateType>(gridIndexes[i] / gridSize), 0));
+
+	std::vector<VerticesIndexes> triangles;
+	triangles.reserve(2 * static_cast<size_t>(gridSize - 1) * (gridSize - 1));
+	for (unsigned y = 0; y + 1 < gridSize; ++y)
+	{
+		for (unsigned x = 0; x + 1 < gridSize; ++x)
+		{
+			if (std::any_of(holes.begin(), holes.end(), [&](const Hole& h) { return h.contains(x, y); }))
+				continue;
+
+			unsigned i00 = vertIndexes[y * gridSize + x];
+			unsigned i10 = vertIndexes[y * gridSize + x + 1];
+			unsigned i01 = vertIndexes[(y + 1) * gridSize + x];
+			unsigned i11 = vertIndexes[(y + 1) * gridSize + x + 1];
+			triangles.emplace_back(i00, i10, i11);
+			triangles.emplace_back(i00, i11, i01);
+		}
+	}
+	std::shuffle(triangles.begin(), triangles.end(), gen);
+
+	SimpleMesh* mesh = new SimpleMesh(&vertices);
+	if (!mesh->reserve(static_cast<unsigned>(triangles.size())))
+	{
+		delete mesh;
+		return nullptr;
+	}
+	for (const VerticesIndexes& tri : triangles)
+		mesh->addTriangle(tri.i1, tri.i2, tri.i3);
+
+	return mesh;
+}
+
+//! Counts the border edge cycles (connected components of the border vertices)
+static size_t CountBorderCycles(const EdgeUsageMap& edgeMap, unsigned vertCount)
+{
+	std::vector<unsigned> parent(vertCount);
+	std::iota(parent.begin(), parent.end(), 0);
+	auto find = [&](unsigned i)
+	{
+		while (parent[i] != i)
+			i = parent[i] = parent[parent[i]];
+		return i;
+	};
+
+	std::vector<bool> isBorder(vertCount, false);
+	for (const auto& edge : edgeMap)
+	{
+		if (edge.second != 1)
+			continue;
+		unsigned i1 = static_cast<unsigned>(edge.first & 0xFFFFFFFF);
+		unsigned i2 = static_cast<unsigned>(edge.first >> 32);
+		isBorder[i1] = isBorder[i2] = true;
+		parent[find(i1)] = find(i2);
+	}
+
+	size_t cycles = 0;
+	for (unsigned i = 0; i < vertCount; ++i)
+		if (isBorder[i] && find(i) == i)
+			++cycles;
+
+	return cycles;
+}
+
+static double Elapsed(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned gridSize = (argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 1000);
+	if (gridSize < 20)
+	{
+		std::fprintf(stderr, "Grid size must be >= 20\n");
+		return EXIT_FAILURE;
+	}
+
+	//three separated holes (+ the outer border)
+	const unsigned q = gridSize / 8;
+	std::vector<Hole> holes{ { q, q, 2 * q, 2 * q }, { 4 * q, q, 6 * q, 3 * q }, { 2 * q, 5 * q, 3 * q, 7 * q } };
+	const size_t expectedLoops = holes.size() + 1;
+
+	PointCloud vertices;
+	SimpleMesh* mesh = BuildGridMesh(gridSize, holes, vertices);
+	if (!mesh)
+	{
+		std::fprintf(stderr, "Not enough memory\n");
+		return EXIT_FAILURE;
+	}
+	std::printf("Grid mesh: %u vertices, %u triangles, %zu holes\n", vertices.size(), mesh->size(), holes.size());
+
+	bool success = true;
+
+	//reference
+	EdgeUsageMap edgeMap;
+	auto start = std::chrono::steady_clock::now();
+	BuildEdgeUsageMap(mesh, edgeMap);
+	double mapTime = Elapsed(start);
+
+	//edge usage table
+	EdgeUsageTableAccess::EdgeUsageTable edgeTable;
+	start = std::chrono::steady_clock::now();
+	if (!EdgeUsageTableAccess::buildMeshEdgeUsageTable(mesh, edgeTable))
+	{
+		std::fprintf(stderr, "buildMeshEdgeUsageTable failed\n");
+		delete mesh;
+		return EXIT_FAILURE;
+	}
+	double tableTime = Elapsed(start);
+
+	std::printf("Edges: std::map %zu (%.3f s) / table %zu (%.3f s)\n", edgeMap.size(), mapTime, edgeTable.size(), tableTime);
+
+	//same edges, same order, same counts
+	if (edgeTable.size() != edgeMap.size())
+	{
+		std::fprintf(stderr, "Edge count mismatch\n");
+		success = false;
+	}
+	else
+	{
+		size_t index = 0;
+		for (const auto& edge : edgeMap)
+		{
+			const auto& usage = edgeTable[index++];
+			if (EdgeUsageTableAccess::ComputeEdgeKey(usage.i1, usage.i2) != edge.first || usage.count != edge.second)
+			{
+				std::fprintf(stderr, "Edge usage mismatch at #%zu\n", index - 1);
+				success = false;
+				break;
+			}
+		}
+	}
+
+	//connectivity stats
+	MeshSamplingTools::EdgeConnectivityStats stats;
+	if (!MeshSamplingTools::computeMeshEdgesConnectivity(mesh, stats))
+	{
+		std::fprintf(stderr, "computeMeshEdgesConnectivity failed\n");
+		success = false;
+	}
+	else
+	{
+		unsigned notShared = 0, sharedByTwo = 0, sharedByMore = 0;
+		for (const auto& edge : edgeMap)
+		{
+			if (edge.second == 1)
+				++notShared;
+			else if (edge.second == 2)
+				++sharedByTwo;
+			else
+				++sharedByMore;
+		}
+		std::printf("Border edges: %u, shared by two: %u, shared by more: %u\n", stats.edgesNotShared, stats.edgesSharedByTwo, stats.edgesSharedByMore);
+		if (	stats.edgesCount != edgeMap.size()
+			||	stats.edgesNotShared != notShared
+			||	stats.edgesSharedByTwo != sharedByTwo
+			||	stats.edgesSharedByMore != sharedByMore)
+		{
+			std::fprintf(stderr, "Edge connectivity stats mismatch\n");
+			success = false;
+		}
+	}
+
+	//boundary loops
+	std::vector< std::vector<unsigned> > loops;
+	start = std::chrono::steady_clock::now();
+	if (!MeshSamplingTools::extractBoundaryLoops(mesh, loops))
+	{
+		std::fprintf(stderr, "extractBoundaryLoops failed\n");
+		success = false;
+	}
+	else
+	{
+		double loopsTime = Elapsed(start);
+		size_t referenceLoops = CountBorderCycles(edgeMap, vertices.size());
+		size_t loopEdges = 0;
+		for (const std::vector<unsigned>& loop : loops)
+			loopEdges += loop.size();
+
+		std::printf("Boundary loops: %zu (%.3f s) / reference %zu / expected %zu\n", loops.size(), loopsTime, referenceLoops, expectedLoops);
+		if (loops.size() != referenceLoops || loops.size() != expectedLoops)
+		{
+			std::fprintf(stderr, "Boundary loop count mismatch\n");
+			success = false;
+		}
+		if (loopEdges != stats.edgesNotShared)
+		{
+			std::fprintf(stderr, "Boundary loops don't cover all the border edges (%zu / %u)\n", loopEdges, stats.edgesNotShared);
+			success = false;
+		}
+	}
+
+	delete mesh;
+
+	std::printf(success ? "OK\n" : "FAILED\n");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
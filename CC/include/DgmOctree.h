@@ -461,6 +461,15 @@ public:
 				const CCVector3* pointsMaxFilter = nullptr,
 				GenericProgressCallback* progressCb = nullptr);
 
+	//! Copies the structure of another octree
+	/** Avoids rebuilding the octree of a cloud that is an exact copy of
+		another (already structured) cloud. The associated cloud is unchanged.
+		\warning the associated cloud must have the same points (in the same order) as the other octree's cloud
+		\param octree the octree to copy
+		\return success
+	**/
+	bool copyStructure(const DgmOctree& octree);
+
 	/**** GETTERS ****/
 
 	//! Returns the number of points projected into the octree
@@ -28,6 +28,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <vector>
 
 namespace CCLib
@@ -72,6 +73,10 @@ const int c_FastMarchingNeighbourPosShift[] = {	//6  common faces
 /** Implementation of the Fast Marching algorithm [Sethian 1996].
 	Inspired from the "vtkFastMarching" class of the "Slicer"
 	project (http://www.slicer.org).
+
+	The (non empty) cells are stored contiguously (see instantiateCellsTpl)
+	and the TRIAL cells are kept in an indexed binary heap (ordered by front
+	arrival time), so that the propagation is in O(n.log(n)).
 **/
 class CC_CORE_LIB_API FastMarching
 {
@@ -116,6 +121,9 @@ public:
 	**/
 	virtual void setExtendedConnectivity(bool state) { m_numberOfNeighbours = state ? 26 : 6; }
 
+	//! Returns the (approximate) memory used by the structure (in bytes)
+	virtual std::size_t memoryUsage() const;
+
 protected:
 
 	// Macro: cell position [i,j,k] to table (3D grid) index
@@ -144,6 +152,7 @@ protected:
 		Cell()
 			: state(FAR_CELL)
 			, T(T_INF())
+			, trialPos(0)
 		{}
 
 		//! Virtual destructor
@@ -154,6 +163,31 @@ protected:
 
 		//! Front arrival time
 		float T;
+
+		//! Position in the TRIAL cells heap (only valid for TRIAL cells)
+		unsigned trialPos;
+	};
+
+	//! Contiguous storage of the grid cells (see instantiateCellsTpl)
+	class CellStorage
+	{
+	public:
+		//! Virtual destructor
+		virtual ~CellStorage() = default;
+
+		//! Returns the memory used by the cells (in bytes)
+		virtual std::size_t memoryUsage() const = 0;
+	};
+
+	//! Contiguous storage of the grid cells (templated version)
+	template <class T> class CellStorageTpl : public CellStorage
+	{
+	public:
+		//inherited from CellStorage
+		std::size_t memoryUsage() const override { return cells.capacity() * sizeof(T); }
+
+		//! Cells
+		std::vector<T> cells;
 	};
 
 	//! Intializes the grid as a snapshot of an octree structure at a given subdivision level
@@ -220,11 +254,44 @@ protected:
 		return true;
 	}
 
+	//! Allocates the (non empty) cells of the grid in one contiguous block
+	/** The cells are then referenced in the grid by their address
+		(instead of being allocated one by one).
+		\param count number of cells
+		\return the first cell (or nullptr if not enough memory)
+	**/
+	template <class T> T* instantiateCellsTpl(unsigned count)
+	{
+		std::unique_ptr< CellStorageTpl<T> > storage(new CellStorageTpl<T>);
+		try
+		{
+			storage->cells.resize(count);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			return nullptr;
+		}
+
+		T* cells = storage->cells.data();
+		m_cellStorage = std::move(storage);
+
+		return cells;
+	}
+
 	//! Add a cell to the TRIAL cells list
-	/** \param index index of the cell
+	/** Its front arrival time must already be set.
+		\param index index of the cell
 	**/
 	virtual void addTrialCell(unsigned index);
 
+	//! Updates the front arrival time of a TRIAL cell
+	/** The time is only updated if it's earlier than the current one.
+		\param index index of the cell
+		\param T new front arrival time
+	**/
+	void updateTrialCell(unsigned index, float T);
+
 	//! Add a cell to the ACTIVE cells list
 	/** \param index index of the cell
 	**/
@@ -236,10 +303,24 @@ protected:
 	virtual void addIgnoredCell(unsigned index);
 
 	//! Returns the TRIAL cell with the smallest front arrival time
-	/** \return the index of the "earliest" TRIAL cell (or 0 in case of error)
+	/** The cell is removed from the TRIAL cells list.
+		\return the index of the "earliest" TRIAL cell (or 0 in case of error)
 	**/
 	virtual unsigned getNearestTrialCell();
 
+	//! Returns whether a cell is 'earlier' than another one (ties are broken by index)
+	inline bool isEarlier(unsigned indexA, unsigned indexB) const
+	{
+		float TA = m_theGrid[indexA]->T;
+		float TB = m_theGrid[indexB]->T;
+		return TA < TB || (TA == TB && indexA < indexB);
+	}
+
+	//! Moves a TRIAL cell up in the heap (once its time has decreased)
+	void siftTrialCellUp(std::size_t pos);
+	//! Moves a TRIAL cell down in the heap
+	void siftTrialCellDown(std::size_t pos);
+
 	//! Resets the state of cells in a given list
 	/** Warning: the list will be cleared!
 	**/
@@ -247,7 +328,7 @@ protected:
 
 	//! ACTIVE cells list
 	std::vector<unsigned> m_activeCells;
-	//! TRIAL cells list
+	//! TRIAL cells list (binary min-heap on the front arrival time)
 	std::vector<unsigned> m_trialCells;
 	//! IGNORED cells lits
 	std::vector<unsigned> m_ignoredCells;
@@ -270,6 +351,8 @@ protected:
 	unsigned m_gridSize;
 	//! Grid used to process Fast Marching
 	Cell** m_theGrid;
+	//! Storage of the grid cells (if allocated with instantiateCellsTpl)
+	std::unique_ptr<CellStorage> m_cellStorage;
 
 	//! Associated octree
 	DgmOctree* m_octree;
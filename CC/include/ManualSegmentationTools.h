@@ -72,7 +72,8 @@ public:
 
 
 	//! Tests if a point is inside a polygon (2D)
-	/** \param P a 2D point
+	/** All the polygon edges are tested: use PreparedPolygon to test many points.
+		\param P a 2D point
 		\param polyVertices polygon vertices (considered as ordered 2D poyline vertices)
 		\return true if P is inside poly
 	**/
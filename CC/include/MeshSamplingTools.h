@@ -23,7 +23,6 @@
 #include "CCToolbox.h"
 
 //system
-#include <map>
 #include <vector>
 
 namespace CCLib
@@ -101,6 +100,36 @@ public:
 	**/
 	static bool flagMeshVerticesByType(GenericIndexedMesh* mesh, ScalarField* flags, EdgeConnectivityStats* stats = nullptr);
 
+	//! Extracts the boundary loops of a mesh (i.e. the borders of its holes)
+	/** The border edges (used by only one triangle) are chained following the
+		orientation of their triangle. Each loop is the ordered list of its vertices
+		(the last vertex is connected to the first one). If the triangles are not
+		consistently oriented, or around non-manifold vertices, a loop may be open.
+		\param[in] mesh triangular mesh
+		\param[out] loops vertex indexes of each loop
+		\return false if an error occurred (invalid input or not enough memory)
+	**/
+	static bool extractBoundaryLoops(GenericIndexedMesh* mesh, std::vector< std::vector<unsigned> >& loops);
+
+	//! Mesh sampling parameters
+	struct SamplingParameters
+	{
+		SamplingParameters()
+			: seed(0)
+			, stratified(false)
+		{}
+
+		//! Seed of the random generators (0 = random seed)
+		/** With the same (non-zero) seed, the sampling is reproducible (whatever the number of threads).
+		**/
+		unsigned seed;
+		//! Whether the points are stratified on each triangle
+		/** The points of a triangle are spread with a Latin hypercube sampling of
+			its (area preserving) parametrization, instead of being purely random.
+		**/
+		bool stratified;
+	};
+
 	//! Samples points on a mesh
 	/** The points are sampled on each triangle randomly, by generating
 		two numbers between 0 and 1 (a and b). If a+b > 1, then a = 1-a and
@@ -113,16 +142,21 @@ public:
 		handled by generating another random number between 0 and 1.
 		If this number is less than Nf, then Ni = Ni+1. The number of points
 		sampled on the triangle will simply be Ni.
+		The triangles are processed by chunks (in parallel). The number of points
+		of each chunk is computed first, so that each chunk directly writes its
+		points at the right position in the output cloud.
 		\param mesh the mesh to be sampled
 		\param samplingDensity the sampling surface density
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param[out] triIndices triangle index for each samples point (output only - optional)
+		\param params sampling parameters (seed, stratification)
 		\return the sampled points
 	**/
 	static PointCloud* samplePointsOnMesh(	GenericMesh* mesh,
 											double samplingDensity,
 											GenericProgressCallback* progressCb = nullptr,
-											std::vector<unsigned>* triIndices = nullptr);
+											std::vector<unsigned>* triIndices = nullptr,
+											const SamplingParameters& params = SamplingParameters());
 
 	//! Samples points on a mesh
 	/** See the other version of this method. Instead of specifying a
@@ -132,12 +166,14 @@ public:
 		\param numberOfPoints the desired number of points on the whole mesh
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param[out] triIndices triangle index for each samples point (output only - optional)
+		\param params sampling parameters (seed, stratification)
 		\return the sampled points
 	**/
 	static PointCloud* samplePointsOnMesh(	GenericMesh* mesh,
 											unsigned numberOfPoints,
 											GenericProgressCallback* progressCb = nullptr,
-											std::vector<unsigned>* triIndices = nullptr);
+											std::vector<unsigned>* triIndices = nullptr,
+											const SamplingParameters& params = SamplingParameters());
 
 protected:
 
@@ -148,26 +184,41 @@ protected:
 		\param theoreticNumberOfPoints the approximated number of points that will be sampled
 		\param progressCb the client application can get some notification of the process progress through this callback mechanism (see GenericProgressCallback)
 		\param[out] triIndices triangle index for each samples point (output only - optional)
+		\param params sampling parameters (seed, stratification)
 		\return the sampled points
 	**/
 	static PointCloud* samplePointsOnMesh(	GenericMesh* mesh,
 											double samplingDensity,
 											unsigned theoreticNumberOfPoints,
 											GenericProgressCallback* progressCb = nullptr,
-											std::vector<unsigned>* triIndices = nullptr);
+											std::vector<unsigned>* triIndices = nullptr,
+											const SamplingParameters& params = SamplingParameters());
+
+	//! Number of triangles using an edge
+	struct EdgeUsage
+	{
+		//! First vertex index (the smallest)
+		unsigned i1;
+		//! Second vertex index
+		unsigned i2;
+		//! Number of triangles using the edge
+		unsigned count;
+	};
 
-	//! Map used to count the number of triangles using each edge
-	/** Edges are represented by two 32 bits indexes merged as a 64 integer
+	//! Table used to count the number of triangles using each edge
+	/** Sorted by edge key (see ComputeEdgeKey)
 	**/
-	using EdgeUsageMap = std::map<unsigned long long, unsigned>;
+	using EdgeUsageTable = std::vector<EdgeUsage>;
 
 	//! Computes the unique key corresponding to an edge
 	static unsigned long long ComputeEdgeKey(unsigned i1, unsigned i2);
 	//! Computes the edge vertex indexes from its unique key
 	static void DecodeEdgeKey(unsigned long long key, unsigned& i1, unsigned& i2);
 
-	//! Creates a map to count the number of triangles using each edge
-	static bool buildMeshEdgeUsageMap(GenericIndexedMesh* mesh, EdgeUsageMap& edgeMap);
+	//! Creates a table to count the number of triangles using each edge
+	/** The triangle edges are gathered and sorted (radix sort) in parallel.
+	**/
+	static bool buildMeshEdgeUsageTable(GenericIndexedMesh* mesh, EdgeUsageTable& edgeTable);
 };
 
 }
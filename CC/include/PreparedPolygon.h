@@ -0,0 +1,120 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_PREPARED_POLYGON_HEADER
+#define CC_PREPARED_POLYGON_HEADER
+
+//Local
+#include "CCGeom.h"
+
+//system
+#include <vector>
+
+namespace CCLib
+{
+
+class GenericIndexedCloud;
+
+//! 2D polygon prepared for fast point-in-polygon tests
+/** The polygon edges are dispatched in horizontal bands (a uniform grid along Y).
+	A query only tests the edges of the band it falls in, instead of all the edges.
+	The results are exactly the same as ManualSegmentationTools::isPointInsidePoly
+	(same edges, same arithmetic).
+
+	Build the structure once (see init) and then query it as many times as necessary
+	(the queries are thread-safe).
+**/
+class CC_CORE_LIB_API PreparedPolygon
+{
+public:
+
+	//! Default constructor
+	PreparedPolygon();
+
+	//! Prepares a polygon
+	/** \param polyVertices polygon vertices (considered as ordered 2D polyline vertices - only X and Y are used)
+		\return false if not enough memory
+	**/
+	bool init(const GenericIndexedCloud* polyVertices);
+
+	//! Prepares a polygon
+	/** \param polyVertices polygon vertices (considered as ordered 2D polyline vertices)
+		\return false if not enough memory
+	**/
+	bool init(const std::vector<CCVector2>& polyVertices);
+
+	//! Clears the structure
+	void clear();
+
+	//! Tests if a point is inside the polygon
+	/** Same result as ManualSegmentationTools::isPointInsidePoly
+		\param P a 2D point
+		\return true if P is inside the polygon
+	**/
+	bool isInside(const CCVector2& P) const;
+
+	//! Tests a set of points (in parallel if possible)
+	/** \param points 2D points
+		\param count number of points
+		\param insideFlags output flags (must have room for 'count' values: 1 = inside, 0 = outside)
+	**/
+	void areInside(const CCVector2* points, unsigned count, unsigned char* insideFlags) const;
+
+	//! Returns the number of polygon vertices
+	inline unsigned vertexCount() const { return m_vertexCount; }
+
+protected:
+
+	//! Prepares the polygon from its vertices (X and Y arrays)
+	bool init(const std::vector<PointCoordinateType>& xs, const std::vector<PointCoordinateType>& ys);
+
+	//! Returns the band of a given Y value (must be in [m_minY, m_maxY[)
+	inline unsigned band(PointCoordinateType y) const
+	{
+		unsigned b = static_cast<unsigned>((static_cast<double>(y) - m_minY) * m_invBandHeight);
+		return (b < m_bandCount ? b : m_bandCount - 1);
+	}
+
+	//! Polygon edge (same vertices order as ManualSegmentationTools::isPointInsidePoly)
+	struct Edge
+	{
+		//! Previous vertex
+		CCVector2 A;
+		//! Next vertex
+		CCVector2 B;
+	};
+
+	//! Number of polygon vertices
+	unsigned m_vertexCount;
+	//! Min Y of the (non horizontal) edges
+	PointCoordinateType m_minY;
+	//! Max Y of the (non horizontal) edges
+	PointCoordinateType m_maxY;
+	//! Number of bands
+	unsigned m_bandCount;
+	//! Inverse of the bands height
+	double m_invBandHeight;
+	//! Index of the first edge of each band in m_bandEdges (+ the total number of edges)
+	std::vector<unsigned> m_bandStart;
+	//! Edges of each band (contiguous)
+	std::vector<Edge> m_bandEdges;
+};
+
+}
+
+#endif //CC_PREPARED_POLYGON_HEADER
@@ -19,9 +19,9 @@
 #include <Delaunay2dMesh.h>
 
 //local
-#include <ManualSegmentationTools.h>
 #include <PointCloud.h>
 #include <Polyline.h>
+#include <PreparedPolygon.h>
 
 #if defined(USE_CGAL_LIB)
 //CGAL Lib
@@ -243,6 +243,11 @@ bool Delaunay2dMesh::removeOuterTriangles(	const std::vector<CCVector2>& vertice
 
 	unsigned lastValidIndex = 0;
 
+	//the polygon edges are indexed once
+	PreparedPolygon preparedPolygon;
+	if (!preparedPolygon.init(polygon2D))
+		return false;
+
 	//test each triangle center
 	{
 		const int* _triIndexes = m_triIndexes;
@@ -255,7 +260,7 @@ bool Delaunay2dMesh::removeOuterTriangles(	const std::vector<CCVector2>& vertice
 			CCVector2 G = (A + B + C) / 3.0;
 
 			//if G is inside the 'polygon'
-			bool isInside = CCLib::ManualSegmentationTools::isPointInsidePoly(G, polygon2D);
+			bool isInside = preparedPolygon.isInside(G);
 			if ((removeOutside && isInside) || (!removeOutside && !isInside))
 			{
 				//we keep the corresponding triangle
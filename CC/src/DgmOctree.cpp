@@ -236,6 +236,47 @@ int DgmOctree::build(	const CCVector3& octreeMin,
 	return genericBuild(progressCb);
 }
 
+bool DgmOctree::copyStructure(const DgmOctree& octree)
+{
+	if (&octree == this)
+	{
+		return true;
+	}
+
+	if (!m_theAssociatedCloud || !octree.m_theAssociatedCloud || m_theAssociatedCloud->size() != octree.m_theAssociatedCloud->size())
+	{
+		//the clouds must be identical
+		return false;
+	}
+
+	try
+	{
+		m_thePointsAndTheirCellCodes = octree.m_thePointsAndTheirCellCodes;
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		clear();
+		return false;
+	}
+
+	m_numberOfProjectedPoints = octree.m_numberOfProjectedPoints;
+	m_nearestPow2 = octree.m_nearestPow2;
+	m_dimMin = octree.m_dimMin;
+	m_dimMax = octree.m_dimMax;
+	m_pointsMin = octree.m_pointsMin;
+	m_pointsMax = octree.m_pointsMax;
+
+	memcpy(m_cellSize, octree.m_cellSize, sizeof(PointCoordinateType)*(MAX_OCTREE_LEVEL + 2));
+	memcpy(m_fillIndexes, octree.m_fillIndexes, sizeof(int)*(MAX_OCTREE_LEVEL + 1) * 6);
+	memcpy(m_cellCount, octree.m_cellCount, sizeof(unsigned)*(MAX_OCTREE_LEVEL + 1));
+	memcpy(m_maxCellPopulation, octree.m_maxCellPopulation, sizeof(unsigned)*(MAX_OCTREE_LEVEL + 1));
+	memcpy(m_averageCellPopulation, octree.m_averageCellPopulation, sizeof(double)*(MAX_OCTREE_LEVEL + 1));
+	memcpy(m_stdDevCellPopulation, octree.m_stdDevCellPopulation, sizeof(double)*(MAX_OCTREE_LEVEL + 1));
+
+	return true;
+}
+
 int DgmOctree::genericBuild(GenericProgressCallback* progressCb)
 {
 	unsigned pointCount = (m_theAssociatedCloud ? m_theAssociatedCloud->size() : 0);
@@ -48,11 +48,15 @@ FastMarching::~FastMarching()
 {
 	if (m_theGrid)
 	{
-		for (unsigned i = 0; i < m_gridSize; ++i)
+		//the cells are only allocated one by one if they are not stored contiguously
+		if (!m_cellStorage)
 		{
-			if (m_theGrid[i])
+			for (unsigned i = 0; i < m_gridSize; ++i)
 			{
-				delete m_theGrid[i];
+				if (m_theGrid[i])
+				{
+					delete m_theGrid[i];
+				}
 			}
 		}
 
@@ -61,6 +65,20 @@ FastMarching::~FastMarching()
 	}
 }
 
+std::size_t FastMarching::memoryUsage() const
+{
+	std::size_t usage = static_cast<std::size_t>(m_theGrid ? m_gridSize : 0) * sizeof(Cell*);
+
+	if (m_cellStorage)
+	{
+		usage += m_cellStorage->memoryUsage();
+	}
+
+	usage += (m_activeCells.capacity() + m_trialCells.capacity() + m_ignoredCells.capacity()) * sizeof(unsigned);
+
+	return usage;
+}
+
 float FastMarching::getTime(Tuple3i& pos, bool absoluteCoordinates) const
 {
 	unsigned index = 0;
@@ -217,8 +235,84 @@ void FastMarching::initTrialCells()
 
 void FastMarching::addTrialCell(unsigned index)
 {
-	m_theGrid[index]->state = Cell::TRIAL_CELL;
+	Cell* cell = m_theGrid[index];
+	cell->state = Cell::TRIAL_CELL;
+	cell->trialPos = static_cast<unsigned>(m_trialCells.size());
 	m_trialCells.push_back(index);
+
+	siftTrialCellUp(cell->trialPos);
+}
+
+void FastMarching::updateTrialCell(unsigned index, float T)
+{
+	Cell* cell = m_theGrid[index];
+	assert(cell && cell->state == Cell::TRIAL_CELL);
+
+	if (T < cell->T)
+	{
+		cell->T = T;
+		//the cell can only move up
+		siftTrialCellUp(cell->trialPos);
+	}
+}
+
+void FastMarching::siftTrialCellUp(std::size_t pos)
+{
+	assert(pos < m_trialCells.size());
+	unsigned index = m_trialCells[pos];
+
+	while (pos != 0)
+	{
+		std::size_t parentPos = (pos - 1) / 2;
+		unsigned parentIndex = m_trialCells[parentPos];
+		if (!isEarlier(index, parentIndex))
+		{
+			break;
+		}
+
+		//move the parent down
+		m_trialCells[pos] = parentIndex;
+		m_theGrid[parentIndex]->trialPos = static_cast<unsigned>(pos);
+		pos = parentPos;
+	}
+
+	m_trialCells[pos] = index;
+	m_theGrid[index]->trialPos = static_cast<unsigned>(pos);
+}
+
+void FastMarching::siftTrialCellDown(std::size_t pos)
+{
+	std::size_t count = m_trialCells.size();
+	assert(pos < count);
+	unsigned index = m_trialCells[pos];
+
+	while (true)
+	{
+		std::size_t childPos = 2 * pos + 1;
+		if (childPos >= count)
+		{
+			break;
+		}
+
+		//take the earliest child
+		if (childPos + 1 < count && isEarlier(m_trialCells[childPos + 1], m_trialCells[childPos]))
+		{
+			++childPos;
+		}
+		unsigned childIndex = m_trialCells[childPos];
+		if (!isEarlier(childIndex, index))
+		{
+			break;
+		}
+
+		//move the child up
+		m_trialCells[pos] = childIndex;
+		m_theGrid[childIndex]->trialPos = static_cast<unsigned>(pos);
+		pos = childPos;
+	}
+
+	m_trialCells[pos] = index;
+	m_theGrid[index]->trialPos = static_cast<unsigned>(pos);
 }
 
 void FastMarching::addActiveCell(unsigned index)
@@ -238,29 +332,17 @@ unsigned FastMarching::getNearestTrialCell()
 	if (m_trialCells.empty())
 		return 0; //0 = error
 
-	//we look for the "TRIAL" cell with the minimum time (T)
-	std::size_t minTCellIndexPos = 0;
-	unsigned minTCellIndex = m_trialCells[minTCellIndexPos];
-	CCLib::FastMarching::Cell* minTCell = m_theGrid[minTCellIndex];
-	assert(minTCell != nullptr);
-
-	for (std::size_t i=1; i<m_trialCells.size(); ++i)
-	{
-		unsigned cellIndex = m_trialCells[i];
-		CCLib::FastMarching::Cell* cell = m_theGrid[cellIndex];
-		assert(cell != nullptr);
-		
-		if (cell->T < minTCell->T)
-		{
-			minTCellIndexPos = i;
-			minTCellIndex = cellIndex;
-			minTCell = cell;
-		}
-	}
+	//the "TRIAL" cell with the minimum time (T) is the root of the heap
+	unsigned minTCellIndex = m_trialCells.front();
+	assert(m_theGrid[minTCellIndex] != nullptr);
 
 	//we remove this cell from the TRIAL set
-	m_trialCells[minTCellIndexPos] = m_trialCells.back();
+	m_trialCells.front() = m_trialCells.back();
 	m_trialCells.pop_back();
+	if (!m_trialCells.empty())
+	{
+		siftTrialCellDown(0);
+	}
 
 	return minTCellIndex;
 }
@@ -48,6 +48,14 @@ int FastMarchingForPropagation::init(	GenericCloud* theCloud,
 	DgmOctree::cellCodesContainer cellCodes;
 	theOctree->getCellCodes(level,cellCodes,true);
 
+	//the cells are allocated at once
+	PropagationCell* cells = instantiateCellsTpl<PropagationCell>(static_cast<unsigned>(cellCodes.size()));
+	if (!cells)
+	{
+		//not enough memory
+		return -1;
+	}
+
 	ReferenceCloud Yk(theOctree->associatedCloud());
 
 	while (!cellCodes.empty())
@@ -65,7 +73,7 @@ int FastMarchingForPropagation::init(	GenericCloud* theCloud,
 		//on renseigne la grille
 		unsigned gridPos = pos2index(cellPos);
 
-		PropagationCell* aCell = new PropagationCell;
+		PropagationCell* aCell = cells++;
 		aCell->cellCode = cellCodes.back();
 		aCell->f = (constantAcceleration ? 1.0f : static_cast<float>(ScalarFieldTools::computeMeanScalarValue(&Yk)));
 
@@ -130,11 +138,7 @@ int FastMarchingForPropagation::step()
 				else if (nCell->state == Cell::TRIAL_CELL)
 				//otherwise we must update it's arrival time
 				{
-					float t_old = nCell->T;
-					float t_new = computeT(nIndex);
-
-					if (t_new < t_old)
-						nCell->T = t_new;
+					updateTrialCell(nIndex, computeT(nIndex));
 				}
 			}
 		}
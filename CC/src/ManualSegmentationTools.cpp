@@ -22,6 +22,7 @@
 #include <GenericProgressCallback.h>
 #include <PointCloud.h>
 #include <Polyline.h>
+#include <PreparedPolygon.h>
 #include <SimpleMesh.h>
 
 //system
@@ -39,6 +40,16 @@ ReferenceCloud* ManualSegmentationTools::segment(GenericIndexedCloudPersist* aCl
 
 	ReferenceCloud* Y = new ReferenceCloud(aCloud);
 
+	//the polygon edges are indexed once (instead of testing all of them for each point)
+	PreparedPolygon preparedPoly;
+	if (!preparedPoly.init(poly))
+	{
+		//not enough memory
+		delete Y;
+		delete trans;
+		return nullptr;
+	}
+
 	//we check for each point if it falls inside the polyline
 	unsigned count = aCloud->size();
 	for (unsigned i = 0; i < count; ++i)
@@ -52,7 +63,7 @@ ReferenceCloud* ManualSegmentationTools::segment(GenericIndexedCloudPersist* aCl
 			P = (*trans) * P;
 		}
 
-		bool pointInside = isPointInsidePoly(CCVector2(P.x, P.y), poly);
+		bool pointInside = preparedPoly.isInside(CCVector2(P.x, P.y));
 		if ((keepInside && pointInside) || (!keepInside && !pointInside))
 		{
 			if (!Y->addPointIndex(i))
@@ -26,10 +26,18 @@
 #include <ScalarField.h>
 
 //system
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <random>
 
 using namespace CCLib;
 
+//! Max number of chunks of triangles processed in parallel
+static const unsigned c_maxChunkCount = 64;
+//! Min number of triangles per chunk
+static const unsigned c_minChunkSize = 65536;
+
 double MeshSamplingTools::computeMeshArea(GenericMesh* mesh)
 {
 	if (!mesh)
@@ -113,35 +121,196 @@ void MeshSamplingTools::DecodeEdgeKey(unsigned long long key, unsigned& i1, unsi
 	i2 = static_cast<unsigned>( (key >> 32) & 0x00000000FFFFFFFF );
 }
 
-bool MeshSamplingTools::buildMeshEdgeUsageMap(GenericIndexedMesh* mesh, EdgeUsageMap& edgeMap)
+//! Number of bits of the radix sort digits
+static const unsigned c_radixBits = 11;
+//! Number of buckets of the radix sort
+static const unsigned c_radixBuckets = (1 << c_radixBits);
+
+//! Sorts keys with a (parallel) LSD radix sort
+/** \param keys keys to sort
+	\param buffer temporary buffer (same size as keys)
+	\param keyBits number of significant bits of the keys
+	\param chunkCount number of chunks processed in parallel
+	\return false if not enough memory
+**/
+static bool RadixSort(std::vector<unsigned long long>& keys, std::vector<unsigned long long>& buffer, unsigned keyBits, int chunkCount)
+{
+	const std::size_t count = keys.size();
+	const std::size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+	std::vector<std::size_t> offsets;
+	try
+	{
+		offsets.resize(static_cast<std::size_t>(chunkCount) * c_radixBuckets);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	for (unsigned shift = 0; shift < keyBits; shift += c_radixBits)
+	{
+		const unsigned long long* in = keys.data();
+		unsigned long long* out = buffer.data();
+
+		//count the digits of each chunk
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int c = 0; c < chunkCount; ++c)
+		{
+			std::size_t* histo = offsets.data() + static_cast<std::size_t>(c) * c_radixBuckets;
+			std::fill(histo, histo + c_radixBuckets, 0);
+
+			std::size_t start = std::min(count, c * chunkSize);
+			std::size_t stop = std::min(count, start + chunkSize);
+			for (std::size_t i = start; i < stop; ++i)
+			{
+				++histo[(in[i] >> shift) & (c_radixBuckets - 1)];
+			}
+		}
+
+		//convert them to output positions (digit by digit, then chunk by chunk: the sort is stable)
+		std::size_t pos = 0;
+		for (unsigned d = 0; d < c_radixBuckets; ++d)
+		{
+			for (int c = 0; c < chunkCount; ++c)
+			{
+				std::size_t& offset = offsets[static_cast<std::size_t>(c) * c_radixBuckets + d];
+				std::size_t n = offset;
+				offset = pos;
+				pos += n;
+			}
+		}
+
+		//scatter the keys
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int c = 0; c < chunkCount; ++c)
+		{
+			std::size_t* offset = offsets.data() + static_cast<std::size_t>(c) * c_radixBuckets;
+
+			std::size_t start = std::min(count, c * chunkSize);
+			std::size_t stop = std::min(count, start + chunkSize);
+			for (std::size_t i = start; i < stop; ++i)
+			{
+				out[offset[(in[i] >> shift) & (c_radixBuckets - 1)]++] = in[i];
+			}
+		}
+
+		keys.swap(buffer);
+	}
+
+	return true;
+}
+
+bool MeshSamplingTools::buildMeshEdgeUsageTable(GenericIndexedMesh* mesh, EdgeUsageTable& edgeTable)
 {
-	edgeMap.clear();
+	edgeTable.clear();
 
 	if (!mesh)
 		return false;
 
+	const unsigned triCount = mesh->size();
+	if (triCount == 0)
+		return true;
+
+	//the triangles are processed by chunks (in parallel)
+	const int chunkCount = static_cast<int>(std::min<unsigned>(c_maxChunkCount, (triCount + c_minChunkSize - 1) / c_minChunkSize));
+	const unsigned trianglesPerChunk = (triCount + chunkCount - 1) / chunkCount;
+
+	//max vertex index (to only sort the significant bits)
+	std::vector<unsigned> chunkMaxIndexes(chunkCount, 0);
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int c = 0; c < chunkCount; ++c)
+	{
+		unsigned start = std::min(triCount, c * trianglesPerChunk);
+		unsigned stop = std::min(triCount, start + trianglesPerChunk);
+		unsigned maxIndex = 0;
+		for (unsigned n = start; n < stop; ++n)
+		{
+			const VerticesIndexes* tri = mesh->getTriangleVertIndexes(n);
+			maxIndex = std::max(maxIndex, std::max(tri->i1, std::max(tri->i2, tri->i3)));
+		}
+		chunkMaxIndexes[c] = maxIndex;
+	}
+	unsigned maxIndex = *std::max_element(chunkMaxIndexes.begin(), chunkMaxIndexes.end());
+
+	//number of bits per vertex index
+	unsigned indexBits = 1;
+	while (indexBits < 32 && (maxIndex >> indexBits) != 0)
+	{
+		++indexBits;
+	}
+
 	try
 	{
-		mesh->placeIteratorAtBeginning();
-		//for all triangles
-		for (unsigned n=0; n<mesh->size(); ++n)
+		//compact edge keys (i2 << indexBits | i1): same order as ComputeEdgeKey
+		std::vector<unsigned long long> keys(3 * static_cast<std::size_t>(triCount));
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int c = 0; c < chunkCount; ++c)
+		{
+			unsigned start = std::min(triCount, c * trianglesPerChunk);
+			unsigned stop = std::min(triCount, start + trianglesPerChunk);
+			for (unsigned n = start; n < stop; ++n)
+			{
+				const VerticesIndexes* tri = mesh->getTriangleVertIndexes(n);
+				for (unsigned j = 0; j < 3; ++j)
+				{
+					unsigned i1 = tri->i[j];
+					unsigned i2 = tri->i[(j + 1) % 3];
+					if (i1 > i2)
+						std::swap(i1, i2);
+					keys[3 * static_cast<std::size_t>(n) + j] = ((static_cast<unsigned long long>(i2) << indexBits) | i1);
+				}
+			}
+		}
+
+		//sort them
+		{
+			std::vector<unsigned long long> buffer(keys.size());
+			if (!RadixSort(keys, buffer, 2 * indexBits, chunkCount))
+			{
+				return false;
+			}
+		}
+
+		//count the duplicates
+		std::size_t edgeCount = 0;
+		for (std::size_t i = 0; i < keys.size(); ++i)
 		{
-			VerticesIndexes* tri = mesh->getNextTriangleVertIndexes();
+			if (i == 0 || keys[i] != keys[i - 1])
+				++edgeCount;
+		}
+		edgeTable.reserve(edgeCount);
 
-			//for all edges
-			for (unsigned j=0; j<3; ++j)
+		const unsigned long long indexMask = (1ULL << indexBits) - 1;
+		for (std::size_t i = 0; i < keys.size(); ++i)
+		{
+			if (i != 0 && keys[i] == keys[i - 1])
 			{
-				unsigned i1 = tri->i[j];
-				unsigned i2 = tri->i[(j+1) % 3];
-				//build unique index
-				unsigned long long edgeKey = ComputeEdgeKey(i1,i2);
-				++edgeMap[edgeKey];
+				++edgeTable.back().count;
+			}
+			else
+			{
+				EdgeUsage edge;
+				edge.i1 = static_cast<unsigned>(keys[i] & indexMask);
+				edge.i2 = static_cast<unsigned>(keys[i] >> indexBits);
+				edge.count = 1;
+				edgeTable.push_back(edge);
 			}
 		}
 	}
 	catch (const std::bad_alloc&)
 	{
 		//not enough memory
+		edgeTable.clear();
 		return false;
 	}
 
@@ -156,18 +325,18 @@ bool MeshSamplingTools::computeMeshEdgesConnectivity(GenericIndexedMesh* mesh, E
 		return false;
 
 	//count the number of triangles using each edge
-	EdgeUsageMap edgeCounters;
-	if (!buildMeshEdgeUsageMap(mesh,edgeCounters))
+	EdgeUsageTable edgeCounters;
+	if (!buildMeshEdgeUsageTable(mesh,edgeCounters))
 		return false;
 
 	//for all edges
 	stats.edgesCount = static_cast<unsigned>(edgeCounters.size());
-	for (std::map<unsigned long long, unsigned>::const_iterator edgeIt = edgeCounters.begin(); edgeIt != edgeCounters.end(); ++edgeIt)
+	for (const EdgeUsage& edge : edgeCounters)
 	{
-		assert(edgeIt->second != 0);
-		if (edgeIt->second == 1)
+		assert(edge.count != 0);
+		if (edge.count == 1)
 			++stats.edgesNotShared;
-		else if (edgeIt->second == 2)
+		else if (edge.count == 2)
 			++stats.edgesSharedByTwo;
 		else
 			++stats.edgesSharedByMore;
@@ -185,8 +354,8 @@ bool MeshSamplingTools::flagMeshVerticesByType(GenericIndexedMesh* mesh, ScalarF
 	flags->fill(NAN_VALUE);
 
 	//count the number of triangles using each edge
-	EdgeUsageMap edgeCounters;
-	if (!buildMeshEdgeUsageMap(mesh, edgeCounters))
+	EdgeUsageTable edgeCounters;
+	if (!buildMeshEdgeUsageTable(mesh, edgeCounters))
 		return false;
 
 	//now scan all the edges and flag their vertices
@@ -195,27 +364,24 @@ bool MeshSamplingTools::flagMeshVerticesByType(GenericIndexedMesh* mesh, ScalarF
 			stats->edgesCount = static_cast<unsigned>(edgeCounters.size());
 
 		//for all edges
-		for (std::map<unsigned long long, unsigned>::const_iterator edgeIt = edgeCounters.begin(); edgeIt != edgeCounters.end(); ++edgeIt)
+		for (const EdgeUsage& edge : edgeCounters)
 		{
-			unsigned i1, i2;
-			DecodeEdgeKey(edgeIt->first, i1, i2);
-
 			ScalarType flag = NAN_VALUE;
-			if (edgeIt->second == 1)
+			if (edge.count == 1)
 			{
 				//only one triangle uses this edge
 				flag = static_cast<ScalarType>(VERTEX_BORDER);
 				if (stats)
 					++stats->edgesNotShared;
 			}
-			else if (edgeIt->second == 2)
+			else if (edge.count == 2)
 			{
 				//two triangles use this edge
 				flag = static_cast<ScalarType>(VERTEX_NORMAL);
 				if (stats)
 					++stats->edgesSharedByTwo;
 			}
-			else if (edgeIt->second > 2)
+			else if (edge.count > 2)
 			{
 				//more than two triangles use this edge!
 				flag = static_cast<ScalarType>(VERTEX_NON_MANIFOLD);
@@ -224,8 +390,8 @@ bool MeshSamplingTools::flagMeshVerticesByType(GenericIndexedMesh* mesh, ScalarF
 			}
 			//else --> isolated vertex?
 
-			flags->setValue(i1, flag);
-			flags->setValue(i2, flag);
+			flags->setValue(edge.i1, flag);
+			flags->setValue(edge.i2, flag);
 		}
 	}
 
@@ -234,10 +400,232 @@ bool MeshSamplingTools::flagMeshVerticesByType(GenericIndexedMesh* mesh, ScalarF
 	return true;
 }
 
+bool MeshSamplingTools::extractBoundaryLoops(GenericIndexedMesh* mesh, std::vector< std::vector<unsigned> >& loops)
+{
+	loops.clear();
+
+	if (!mesh)
+		return false;
+
+	//count the number of triangles using each edge
+	EdgeUsageTable edgeCounters;
+	if (!buildMeshEdgeUsageTable(mesh, edgeCounters))
+		return false;
+
+	try
+	{
+		//border edges (sorted by key) and border vertices
+		std::vector<unsigned long long> borderKeys;
+		std::vector<bool> borderVertices;
+		for (const EdgeUsage& edge : edgeCounters)
+		{
+			if (edge.count == 1)
+			{
+				borderKeys.push_back(ComputeEdgeKey(edge.i1, edge.i2));
+				if (borderVertices.size() <= edge.i2)
+					borderVertices.resize(static_cast<std::size_t>(edge.i2) + 1, false);
+				borderVertices[edge.i1] = borderVertices[edge.i2] = true;
+			}
+		}
+		edgeCounters.clear();
+		edgeCounters.shrink_to_fit();
+
+		if (borderKeys.empty())
+		{
+			//closed mesh
+			return true;
+		}
+
+		//orient the border edges as in their triangle
+		std::vector< std::pair<unsigned, unsigned> > halfEdges;
+		halfEdges.reserve(borderKeys.size());
+		unsigned triCount = mesh->size();
+		for (unsigned n = 0; n < triCount; ++n)
+		{
+			const VerticesIndexes* tri = mesh->getTriangleVertIndexes(n);
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				unsigned i1 = tri->i[j];
+				unsigned i2 = tri->i[(j + 1) % 3];
+				if (	i1 < borderVertices.size() && borderVertices[i1]
+					&&	i2 < borderVertices.size() && borderVertices[i2]
+					&&	std::binary_search(borderKeys.begin(), borderKeys.end(), ComputeEdgeKey(i1, i2)))
+				{
+					halfEdges.emplace_back(i1, i2);
+				}
+			}
+		}
+		borderKeys.clear();
+		borderKeys.shrink_to_fit();
+
+		//sort them by starting vertex
+		std::sort(halfEdges.begin(), halfEdges.end());
+		std::vector<bool> used(halfEdges.size(), false);
+
+		//chain them
+		for (std::size_t first = 0; first < halfEdges.size(); ++first)
+		{
+			if (used[first])
+				continue;
+
+			std::vector<unsigned> loop;
+			const unsigned startIndex = halfEdges[first].first;
+			std::size_t current = first;
+			while (true)
+			{
+				used[current] = true;
+				loop.push_back(halfEdges[current].first);
+
+				unsigned nextIndex = halfEdges[current].second;
+				if (nextIndex == startIndex)
+				{
+					//the loop is closed
+					break;
+				}
+
+				//look for an unused border edge starting at the next vertex
+				std::size_t next = halfEdges.size();
+				for (std::vector< std::pair<unsigned, unsigned> >::const_iterator it = std::lower_bound(halfEdges.begin(), halfEdges.end(), std::make_pair(nextIndex, 0u));
+					it != halfEdges.end() && it->first == nextIndex;
+					++it)
+				{
+					std::size_t pos = static_cast<std::size_t>(it - halfEdges.begin());
+					if (!used[pos])
+					{
+						next = pos;
+						break;
+					}
+				}
+
+				if (next == halfEdges.size())
+				{
+					//open loop (inconsistent orientation or non-manifold vertex)
+					loop.push_back(nextIndex);
+					break;
+				}
+				current = next;
+			}
+
+			loops.push_back(std::move(loop));
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		loops.clear();
+		return false;
+	}
+
+	return true;
+}
+
+//! Number of triangles per sampling chunk (each chunk has its own random streams)
+static const unsigned c_samplingChunkSize = 16384;
+
+//! Thread-safe access to the vertices of the triangles of a mesh
+/** Indexed meshes are read directly (see GenericIndexedMesh::getTriangleVertices).
+	The vertices of the other meshes are gathered beforehand (their iterator is not
+	thread-safe).
+**/
+class MeshTriangles
+{
+public:
+
+	MeshTriangles() : m_indexedMesh(nullptr) {}
+
+	bool init(GenericMesh* mesh)
+	{
+		m_indexedMesh = dynamic_cast<GenericIndexedMesh*>(mesh);
+		if (m_indexedMesh)
+		{
+			return true;
+		}
+
+		unsigned triCount = mesh->size();
+		try
+		{
+			m_vertices.resize(3 * static_cast<std::size_t>(triCount));
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+
+		mesh->placeIteratorAtBeginning();
+		for (unsigned n = 0; n < triCount; ++n)
+		{
+			GenericTriangle* tri = mesh->_getNextTriangle();
+			m_vertices[3 * n    ] = *tri->_getA();
+			m_vertices[3 * n + 1] = *tri->_getB();
+			m_vertices[3 * n + 2] = *tri->_getC();
+		}
+
+		return true;
+	}
+
+	inline void get(unsigned n, CCVector3& O, CCVector3& A, CCVector3& B) const
+	{
+		if (m_indexedMesh)
+		{
+			m_indexedMesh->getTriangleVertices(n, O, A, B);
+		}
+		else
+		{
+			O = m_vertices[3 * n    ];
+			A = m_vertices[3 * n + 1];
+			B = m_vertices[3 * n + 2];
+		}
+	}
+
+protected:
+
+	GenericIndexedMesh* m_indexedMesh;
+	std::vector<CCVector3> m_vertices;
+};
+
+//! Seeds the random streams of a sampling chunk
+/** The streams only depend on the seed and on the chunk index (and not on the
+	number of threads or the order in which the chunks are processed).
+**/
+static void SeedChunkGenerators(unsigned seed, unsigned chunkIndex, std::mt19937& countGen, std::mt19937& posGen)
+{
+	std::seed_seq countSeq{ seed, chunkIndex, 0u };
+	countGen.seed(countSeq);
+	std::seed_seq posSeq{ seed, chunkIndex, 1u };
+	posGen.seed(posSeq);
+}
+
+//! Returns the number of points to sample on a triangle
+static unsigned PointsToSample(	const CCVector3& O,
+								const CCVector3& A,
+								const CCVector3& B,
+								double samplingDensity,
+								std::mt19937& gen,
+								std::uniform_real_distribution<double>& dist)
+{
+	//we compute the (twice) the triangle area
+	CCVector3 N = (A - O).cross(B - O);
+	double S = N.normd() / 2;
+
+	//we deduce the number of points to generate on this face
+	double fPointsToAdd = S*samplingDensity;
+	unsigned pointsToAdd = static_cast<unsigned>(fPointsToAdd);
+
+	//take care of the remaining fractional part
+	double fracPart = fPointsToAdd - static_cast<double>(pointsToAdd);
+	//we add a point with the same probability as its (relative) area
+	//(the number is always drawn so that the stream stays in sync between the two passes)
+	if (dist(gen) < fracPart)
+		pointsToAdd += 1;
+
+	return pointsToAdd;
+}
+
 PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 													unsigned numberOfPoints,
 													GenericProgressCallback* progressCb/*=0*/,
-													std::vector<unsigned>* triIndices/*=0*/)
+													std::vector<unsigned>* triIndices/*=0*/,
+													const SamplingParameters& params/*=SamplingParameters()*/)
 {
 	if (!mesh)
         return nullptr;
@@ -251,13 +639,14 @@ PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 	double samplingDensity = numberOfPoints / Stotal;
 
     //no normal needs to be computed here
-	return samplePointsOnMesh(mesh, samplingDensity, numberOfPoints, progressCb, triIndices);
+	return samplePointsOnMesh(mesh, samplingDensity, numberOfPoints, progressCb, triIndices, params);
 }
 
 PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 													double samplingDensity,
 													GenericProgressCallback* progressCb/*=0*/,
-													std::vector<unsigned>* triIndices/*=0*/)
+													std::vector<unsigned>* triIndices/*=0*/,
+													const SamplingParameters& params/*=SamplingParameters()*/)
 {
 	if (!mesh)
         return nullptr;
@@ -267,14 +656,15 @@ PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 
 	unsigned theoreticNumberOfPoints = static_cast<unsigned>(ceil(Stotal * samplingDensity));
 
-	return samplePointsOnMesh(mesh, samplingDensity, theoreticNumberOfPoints, progressCb, triIndices);
+	return samplePointsOnMesh(mesh, samplingDensity, theoreticNumberOfPoints, progressCb, triIndices, params);
 }
 
 PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 													double samplingDensity,
 													unsigned theoreticNumberOfPoints,
 													GenericProgressCallback* progressCb,
-													std::vector<unsigned>* triIndices/*=0*/)
+													std::vector<unsigned>* triIndices/*=0*/,
+													const SamplingParameters& params/*=SamplingParameters()*/)
 {
 	if (theoreticNumberOfPoints < 1)
         return nullptr;
@@ -284,29 +674,42 @@ PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
 	if (triCount == 0)
 		return nullptr;
 
-	PointCloud* sampledCloud = new PointCloud();
-	if (!sampledCloud->reserve(theoreticNumberOfPoints)) //not enough memory
+	if (triIndices)
 	{
-		delete sampledCloud;
+	    triIndices->clear(); //just in case
+	}
+
+	//thread-safe access to the triangles
+	MeshTriangles triangles;
+	if (!triangles.init(mesh))
+	{
+		//not enough memory
 		return nullptr;
 	}
 
-	if (triIndices)
+	//each chunk of triangles has its own random streams (derived from the seed and the chunk index)
+	unsigned seed = params.seed;
+	if (seed == 0)
 	{
-	    triIndices->clear(); //just in case
-		try
-		{
-			triIndices->reserve(theoreticNumberOfPoints);
-		}
-		catch (const std::bad_alloc&)
-		{
-			//not enough memory? DGM TODO: we should warn the caller
-			delete sampledCloud;
-			return nullptr;
-		}
+		std::random_device rd; // non-deterministic generator
+		seed = rd();
 	}
+	const int chunkCount = static_cast<int>((triCount + c_samplingChunkSize - 1) / c_samplingChunkSize);
 
-	NormalizedProgress normProgress(progressCb, triCount);
+	std::vector<std::size_t> chunkOffsets;
+	std::vector<unsigned char> chunkDone;
+	try
+	{
+		chunkOffsets.resize(static_cast<std::size_t>(chunkCount) + 1, 0);
+		chunkDone.resize(chunkCount, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return nullptr;
+	}
+
+	NormalizedProgress normProgress(progressCb, 2 * static_cast<unsigned>(chunkCount));
     if (progressCb)
     {
 		if (progressCb->textCanBeEdited())
@@ -319,120 +722,215 @@ PointCloud* MeshSamplingTools::samplePointsOnMesh(	GenericMesh* mesh,
         progressCb->update(0);
 		progressCb->start();
 	}
+	//shared by all the threads
+	std::atomic<bool> cancelled(false);
+
+	//first pass: number of points to sample in each chunk
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int c = 0; c < chunkCount; ++c)
+	{
+		if (cancelled)
+			continue;
 
-	unsigned addedPoints = 0;
-	std::random_device rd;   // non-deterministic generator
-	std::mt19937 gen(rd());  // to seed mersenne twister.
-	std::uniform_real_distribution<double> dist(0, 1);
+		std::mt19937 countGen, posGen;
+		SeedChunkGenerators(seed, static_cast<unsigned>(c), countGen, posGen);
+		std::uniform_real_distribution<double> dist(0, 1);
 
-	//for each triangle
-	mesh->placeIteratorAtBeginning();
-	for (unsigned n = 0; n < triCount; ++n)
-	{
-		const GenericTriangle* tri = mesh->_getNextTriangle();
+		unsigned start = static_cast<unsigned>(c) * c_samplingChunkSize;
+		unsigned stop = std::min(triCount, start + c_samplingChunkSize);
+		std::size_t chunkPoints = 0;
+		for (unsigned n = start; n < stop; ++n)
+		{
+			CCVector3 O, A, B;
+			triangles.get(n, O, A, B);
+			chunkPoints += PointsToSample(O, A, B, samplingDensity, countGen, dist);
+		}
+		chunkOffsets[c + 1] = chunkPoints;
 
-		//vertices (OAB)
-		const CCVector3 *O = tri->_getA();
-		const CCVector3 *A = tri->_getB();
-		const CCVector3 *B = tri->_getC();
+		if (progressCb && !normProgress.oneStep())
+			cancelled = true;
+	}
 
-		//edges (OA and OB)
-		CCVector3 u = *A - *O;
-		CCVector3 v = *B - *O;
+	if (cancelled)
+	{
+		if (progressCb)
+			progressCb->stop();
+		return new PointCloud();
+	}
 
-		//we compute the (twice) the triangle area
-		CCVector3 N = u.cross(v);
-		double S = N.normd() / 2;
+	//prefix sum: position of the first point of each chunk
+	for (int c = 0; c < chunkCount; ++c)
+	{
+		chunkOffsets[c + 1] += chunkOffsets[c];
+	}
+	std::size_t totalCount = chunkOffsets.back();
+	if (totalCount > std::numeric_limits<unsigned>::max())
+	{
+		//too many points
+		if (progressCb)
+			progressCb->stop();
+		return nullptr;
+	}
 
-		//we deduce the number of points to generate on this face
-		double fPointsToAdd = S*samplingDensity;
-		unsigned pointsToAdd = static_cast<unsigned>(fPointsToAdd);
+	PointCloud* sampledCloud = new PointCloud();
+	if (!sampledCloud->resize(static_cast<unsigned>(totalCount))) //not enough memory
+	{
+		delete sampledCloud;
+		if (progressCb)
+			progressCb->stop();
+		return nullptr;
+	}
 
-		//take care of the remaining fractional part
-		double fracPart = fPointsToAdd - static_cast<double>(pointsToAdd);
-		if (fracPart > 0)
+	if (triIndices)
+	{
+		try
+		{
+			triIndices->resize(totalCount);
+		}
+		catch (const std::bad_alloc&)
 		{
-			//we add a point with the same probability as its (relative) area
-			if (dist(gen) <= fracPart)
-				pointsToAdd += 1;
+			//not enough memory? DGM TODO: we should warn the caller
+			delete sampledCloud;
+			if (progressCb)
+				progressCb->stop();
+			return nullptr;
 		}
+	}
 
-		if (pointsToAdd)
+	//second pass: sampling (the number of points of each triangle is drawn again from the same stream)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int c = 0; c < chunkCount; ++c)
+	{
+		if (cancelled)
+			continue;
+
+		std::mt19937 countGen, posGen;
+		SeedChunkGenerators(seed, static_cast<unsigned>(c), countGen, posGen);
+		std::uniform_real_distribution<double> dist(0, 1);
+		std::vector<unsigned> strata;
+		bool chunkComplete = true;
+
+		unsigned start = static_cast<unsigned>(c) * c_samplingChunkSize;
+		unsigned stop = std::min(triCount, start + c_samplingChunkSize);
+		std::size_t pointIndex = chunkOffsets[c];
+		for (unsigned n = start; n < stop; ++n)
 		{
-			if (addedPoints + pointsToAdd >= theoreticNumberOfPoints)
+			//vertices (OAB)
+			CCVector3 O, A, B;
+			triangles.get(n, O, A, B);
+
+			unsigned pointsToAdd = PointsToSample(O, A, B, samplingDensity, countGen, dist);
+			if (pointsToAdd == 0)
+				continue;
+
+			//edges (OA and OB)
+			CCVector3 u = A - O;
+			CCVector3 v = B - O;
+
+			if (params.stratified && pointsToAdd > 1)
 			{
-				theoreticNumberOfPoints += pointsToAdd;
-				//reserve memory for the cloud
-				if (!sampledCloud->reserve(theoreticNumberOfPoints))
+				//Latin hypercube sampling of the unit square (one sample per row and per column)
+				try
 				{
-					delete sampledCloud;
-					sampledCloud = nullptr;
-					if (triIndices)
-					{
-						triIndices->resize(0);
-					}
+					strata.resize(pointsToAdd);
+				}
+				catch (const std::bad_alloc&)
+				{
+					//not enough memory
+					cancelled = true;
+					chunkComplete = false;
 					break;
 				}
-				//reserve memory for the triangle indexes
-				if (triIndices && triIndices->capacity() < theoreticNumberOfPoints) //not enough memory
+				for (unsigned i = 0; i < pointsToAdd; ++i)
 				{
-					try
-					{
-						triIndices->reserve(theoreticNumberOfPoints);
-					}
-					catch (const std::bad_alloc&)
-					{
-						delete sampledCloud;
-						sampledCloud = nullptr;
-						if (triIndices)
-						{
-							triIndices->resize(0);
-						}
-						break;
-					}
+					strata[i] = i;
+				}
+				for (unsigned i = pointsToAdd - 1; i > 0; --i)
+				{
+					unsigned j = std::min(i, static_cast<unsigned>(dist(posGen) * (i + 1)));
+					std::swap(strata[i], strata[j]);
 				}
-			}
 
-			for (unsigned i = 0; i < pointsToAdd; ++i)
-			{
-				//we generate random points as in:
-				//'Greg Turk. Generating random points in triangles. In A. S. Glassner, editor, Graphics Gems, pages 24-28. Academic Press, 1990.'
-				double x = dist(gen);
-				double y = dist(gen);
+				for (unsigned i = 0; i < pointsToAdd; ++i)
+				{
+					double r1 = (i + dist(posGen)) / pointsToAdd;
+					double r2 = (strata[i] + dist(posGen)) / pointsToAdd;
+
+					//area preserving (and continuous) mapping of the unit square on the triangle
+					double s = sqrt(r1);
+					double x = s * (1.0 - r2);
+					double y = s * r2;
 
-				//we test if the generated point lies on the right side of (AB)
-				if (x + y > 1.0)
+					CCVector3* P = const_cast<CCVector3*>(sampledCloud->getPoint(static_cast<unsigned>(pointIndex)));
+					*P = O + static_cast<PointCoordinateType>(x) * u + static_cast<PointCoordinateType>(y) * v;
+					if (triIndices)
+						(*triIndices)[pointIndex] = n;
+					++pointIndex;
+				}
+			}
+			else
+			{
+				for (unsigned i = 0; i < pointsToAdd; ++i)
 				{
-					x = 1.0 - x;
-					y = 1.0 - y;
-                }
+					//we generate random points as in:
+					//'Greg Turk. Generating random points in triangles. In A. S. Glassner, editor, Graphics Gems, pages 24-28. Academic Press, 1990.'
+					double x = dist(posGen);
+					double y = dist(posGen);
 
-				CCVector3 P = (*O) + static_cast<PointCoordinateType>(x) * u + static_cast<PointCoordinateType>(y) * v;
+					//we test if the generated point lies on the right side of (AB)
+					if (x + y > 1.0)
+					{
+						x = 1.0 - x;
+						y = 1.0 - y;
+					}
 
-				sampledCloud->addPoint(P);
-				if (triIndices)
-					triIndices->push_back(n);
-				++addedPoints;
+					CCVector3* P = const_cast<CCVector3*>(sampledCloud->getPoint(static_cast<unsigned>(pointIndex)));
+					*P = O + static_cast<PointCoordinateType>(x) * u + static_cast<PointCoordinateType>(y) * v;
+					if (triIndices)
+						(*triIndices)[pointIndex] = n;
+					++pointIndex;
+				}
 			}
 		}
+		if (!chunkComplete)
+			continue;
+		assert(pointIndex == chunkOffsets[c + 1]);
+		chunkDone[c] = 1;
 
 		if (progressCb && !normProgress.oneStep())
-			break;
+			cancelled = true;
 	}
 
-	if (sampledCloud) //can be in case of memory overflow!
+	if (cancelled)
 	{
-		if (addedPoints)
-		{
-			sampledCloud->resize(addedPoints); //should always be ok as addedPoints < theoreticNumberOfPoints
-			if (triIndices)
-				triIndices->resize(addedPoints);
-		}
-		else
+		//we only keep the chunks that have been fully sampled
+		std::size_t pointCount = 0;
+		for (int c = 0; c < chunkCount; ++c)
 		{
-			if (triIndices)
-				triIndices->resize(0);
+			if (!chunkDone[c])
+				continue;
+
+			for (std::size_t i = chunkOffsets[c]; i < chunkOffsets[c + 1]; ++i, ++pointCount)
+			{
+				if (pointCount == i)
+					continue;
+				*const_cast<CCVector3*>(sampledCloud->getPoint(static_cast<unsigned>(pointCount))) = *sampledCloud->getPoint(static_cast<unsigned>(i));
+				if (triIndices)
+					(*triIndices)[pointCount] = (*triIndices)[i];
+			}
 		}
+		sampledCloud->resize(static_cast<unsigned>(pointCount));
+		if (triIndices)
+			triIndices->resize(pointCount);
+	}
+
+	if (progressCb)
+	{
+		progressCb->stop();
 	}
 
 	return sampledCloud;
@@ -0,0 +1,267 @@
+//##########################################################################
+//#                                                                        #
+//#                               CCLIB                                    #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU Library General Public License as       #
+//#  published by the Free Software Foundation; version 2 or later of the  #
+//#  License.                                                              #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include <PreparedPolygon.h>
+
+//local
+#include <GenericIndexedCloud.h>
+
+//system
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace CCLib;
+
+//! Max average number of bands crossed by an edge (bounds the memory for polygons with many long edges)
+static const double c_maxBandsPerEdge = 8.0;
+
+PreparedPolygon::PreparedPolygon()
+	: m_vertexCount(0)
+	, m_minY(0)
+	, m_maxY(0)
+	, m_bandCount(0)
+	, m_invBandHeight(0.0)
+{
+}
+
+void PreparedPolygon::clear()
+{
+	m_vertexCount = 0;
+	m_minY = m_maxY = 0;
+	m_bandCount = 0;
+	m_invBandHeight = 0.0;
+	m_bandStart.clear();
+	m_bandEdges.clear();
+}
+
+bool PreparedPolygon::init(const GenericIndexedCloud* polyVertices)
+{
+	unsigned vertCount = (polyVertices ? polyVertices->size() : 0);
+
+	std::vector<PointCoordinateType> xs, ys;
+	try
+	{
+		xs.resize(vertCount);
+		ys.resize(vertCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		clear();
+		return false;
+	}
+
+	for (unsigned i = 0; i < vertCount; ++i)
+	{
+		CCVector3 P;
+		polyVertices->getPoint(i, P);
+		xs[i] = P.x;
+		ys[i] = P.y;
+	}
+
+	return init(xs, ys);
+}
+
+bool PreparedPolygon::init(const std::vector<CCVector2>& polyVertices)
+{
+	std::vector<PointCoordinateType> xs, ys;
+	try
+	{
+		xs.resize(polyVertices.size());
+		ys.resize(polyVertices.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		clear();
+		return false;
+	}
+
+	for (std::size_t i = 0; i < polyVertices.size(); ++i)
+	{
+		xs[i] = polyVertices[i].x;
+		ys[i] = polyVertices[i].y;
+	}
+
+	return init(xs, ys);
+}
+
+bool PreparedPolygon::init(const std::vector<PointCoordinateType>& xs, const std::vector<PointCoordinateType>& ys)
+{
+	clear();
+
+	unsigned vertCount = static_cast<unsigned>(xs.size());
+	m_vertexCount = vertCount;
+	if (vertCount < 2)
+	{
+		//no point can be inside (see ManualSegmentationTools::isPointInsidePoly)
+		return true;
+	}
+
+	//the horizontal edges can't be crossed (see the test in isInside)
+	unsigned edgeCount = 0;
+	double sumDY = 0.0;
+	bool first = true;
+	for (unsigned i = 1; i <= vertCount; ++i)
+	{
+		PointCoordinateType yA = ys[i - 1];
+		PointCoordinateType yB = ys[i % vertCount];
+		if (yA == yB)
+		{
+			continue;
+		}
+		++edgeCount;
+		sumDY += std::abs(static_cast<double>(yB) - yA);
+
+		PointCoordinateType y0 = std::min(yA, yB);
+		PointCoordinateType y1 = std::max(yA, yB);
+		if (first)
+		{
+			m_minY = y0;
+			m_maxY = y1;
+			first = false;
+		}
+		else
+		{
+			m_minY = std::min(m_minY, y0);
+			m_maxY = std::max(m_maxY, y1);
+		}
+	}
+
+	if (edgeCount == 0)
+	{
+		//no point can be inside
+		return true;
+	}
+
+	//number of bands: one per edge, unless the edges are long (relatively to the polygon height)
+	double height = static_cast<double>(m_maxY) - m_minY;
+	double bandCount = edgeCount;
+	double avgBandsPerEdge = sumDY / height * bandCount / edgeCount;
+	if (avgBandsPerEdge > c_maxBandsPerEdge)
+	{
+		bandCount *= c_maxBandsPerEdge / avgBandsPerEdge;
+	}
+	m_bandCount = std::max(1u, static_cast<unsigned>(bandCount));
+	m_invBandHeight = m_bandCount / height;
+
+	try
+	{
+		//count the edges of each band
+		m_bandStart.assign(m_bandCount + 1, 0);
+		for (unsigned i = 1; i <= vertCount; ++i)
+		{
+			PointCoordinateType yA = ys[i - 1];
+			PointCoordinateType yB = ys[i % vertCount];
+			if (yA == yB)
+			{
+				continue;
+			}
+			unsigned b0 = band(std::min(yA, yB));
+			unsigned b1 = band(std::max(yA, yB));
+			for (unsigned b = b0; b <= b1; ++b)
+			{
+				++m_bandStart[b + 1];
+			}
+		}
+		for (unsigned b = 0; b < m_bandCount; ++b)
+		{
+			m_bandStart[b + 1] += m_bandStart[b];
+		}
+
+		//dispatch the edges
+		m_bandEdges.resize(m_bandStart.back());
+		std::vector<unsigned> fillPos(m_bandStart.begin(), m_bandStart.end() - 1);
+		for (unsigned i = 1; i <= vertCount; ++i)
+		{
+			PointCoordinateType yA = ys[i - 1];
+			PointCoordinateType yB = ys[i % vertCount];
+			if (yA == yB)
+			{
+				continue;
+			}
+			Edge edge;
+			edge.A = CCVector2(xs[i - 1], yA);
+			edge.B = CCVector2(xs[i % vertCount], yB);
+
+			unsigned b0 = band(std::min(yA, yB));
+			unsigned b1 = band(std::max(yA, yB));
+			for (unsigned b = b0; b <= b1; ++b)
+			{
+				m_bandEdges[fillPos[b]++] = edge;
+			}
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool PreparedPolygon::isInside(const CCVector2& P) const
+{
+	//outside of the edges Y range, no edge can be crossed
+	if (m_bandEdges.empty() || !(P.y >= m_minY && P.y < m_maxY))
+	{
+		return false;
+	}
+
+	unsigned b = band(P.y);
+	const Edge* edges = m_bandEdges.data() + m_bandStart[b];
+	unsigned edgeCount = m_bandStart[b + 1] - m_bandStart[b];
+
+	bool inside = false;
+	for (unsigned i = 0; i < edgeCount; ++i)
+	{
+		const CCVector2& A = edges[i].A;
+		const CCVector2& B = edges[i].B;
+
+		//Point Inclusion in Polygon Test (inspired from W. Randolph Franklin - WRF)
+		//(exactly the same test as ManualSegmentationTools::isPointInsidePoly)
+		if ((B.y <= P.y && P.y < A.y) || (A.y <= P.y && P.y < B.y))
+		{
+			PointCoordinateType t = (P.x - B.x)*(A.y - B.y) - (A.x - B.x)*(P.y - B.y);
+			if (A.y < B.y)
+				t = -t;
+			if (t < 0)
+				inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+void PreparedPolygon::areInside(const CCVector2* points, unsigned count, unsigned char* insideFlags) const
+{
+	if (!points || !insideFlags)
+	{
+		assert(false);
+		return;
+	}
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int i = 0; i < static_cast<int>(count); ++i)
+	{
+		insideFlags[i] = isInside(points[i]) ? 1 : 0;
+	}
+}
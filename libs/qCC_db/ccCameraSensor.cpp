@@ -35,6 +35,14 @@
 #include <QImageReader>
 #include <QOpenGLTexture>
 
+//system
+#include <algorithm>
+#include <atomic>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 ccCameraSensor::IntrinsicParameters::IntrinsicParameters()
 	: vertFocal_pix(1.0f)
 	, skew(0)
@@ -810,6 +818,114 @@ bool ccCameraSensor::fromGlobalCoordToImageCoord(const CCVector3& globalCoord, C
 	return fromLocalCoordToImageCoord(localCoord, imageCoord, withLensError);
 }
 
+bool ccCameraSensor::fromGlobalCoordToImageCoord(	const CCLib::GenericIndexedCloud* points,
+													std::vector<CCVector2>& imageCoords,
+													std::vector<unsigned char>& inFrame,
+													bool withLensError/*=true*/,
+													const std::vector<unsigned>* pointIndexes/*=nullptr*/) const
+{
+	if (!points)
+	{
+		assert(false);
+		return false;
+	}
+
+	//global to local transformation (computed once and for all)
+	ccGLMatrix globalToLocal;
+	if (!getGlobalToLocalTransformation(globalToLocal))
+		return false;
+
+	size_t count = (pointIndexes ? pointIndexes->size() : points->size());
+	try
+	{
+		imageCoords.resize(count);
+		inFrame.resize(count);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccCameraSensor::fromGlobalCoordToImageCoord] Not enough memory!");
+		return false;
+	}
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int i = 0; i < static_cast<int>(count); ++i)
+	{
+		unsigned pointIndex = (pointIndexes ? pointIndexes->at(i) : static_cast<unsigned>(i));
+		CCVector3 localCoord = globalToLocal * (*points->getPoint(pointIndex));
+		inFrame[i] = (fromLocalCoordToImageCoord(localCoord, imageCoords[i], withLensError) ? 1 : 0);
+	}
+
+	return true;
+}
+
+bool ccCameraSensor::projectCloudInFrustum(	ccGenericPointCloud* cloud,
+											std::vector<unsigned>& pointIndexes,
+											std::vector<CCVector2>& imageCoords,
+											bool withLensError/*=true*/,
+											CCLib::GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	pointIndexes.clear();
+	imageCoords.clear();
+
+	if (!cloud)
+	{
+		assert(false);
+		return false;
+	}
+
+	ccOctree::Shared octree = cloud->getOctree();
+	if (!octree)
+	{
+		octree = cloud->computeOctree(progressCb);
+		if (!octree)
+		{
+			ccLog::Warning("[ccCameraSensor::projectCloudInFrustum] Failed to compute the cloud octree!");
+			return false;
+		}
+	}
+
+	//the cells outside of the frustum are skipped
+	std::vector<unsigned> inCameraFrustum;
+	if (!octree->intersectWithFrustum(this, inCameraFrustum))
+	{
+		return false;
+	}
+
+	//project the remaining points
+	std::vector<CCVector2> candidateCoords;
+	std::vector<unsigned char> inFrame;
+	if (!fromGlobalCoordToImageCoord(cloud, candidateCoords, inFrame, withLensError, &inCameraFrustum))
+	{
+		return false;
+	}
+
+	//only keep the points that are projected into the image boundaries
+	try
+	{
+		size_t inFrameCount = std::count(inFrame.begin(), inFrame.end(), 1);
+		pointIndexes.reserve(inFrameCount);
+		imageCoords.reserve(inFrameCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccCameraSensor::projectCloudInFrustum] Not enough memory!");
+		return false;
+	}
+
+	for (size_t i = 0; i < inCameraFrustum.size(); ++i)
+	{
+		if (inFrame[i])
+		{
+			pointIndexes.push_back(inCameraFrustum[i]);
+			imageCoords.push_back(candidateCoords[i]);
+		}
+	}
+
+	return true;
+}
+
 bool ccCameraSensor::fromImageCoordToGlobalCoord(const CCVector2& imageCoord, CCVector3& globalCoord, PointCoordinateType z0, bool withLensCorrection/*=true*/) const
 {
 	ccIndexedTransformation trans;
@@ -1004,14 +1120,17 @@ bool ccCameraSensor::computeUncertainty(CCLib::ReferenceCloud* points, std::vect
 		return false;
 	}
 
+	//global to local transformation (computed once and for all)
+	ccGLMatrix globalToLocal;
+	if (!getGlobalToLocalTransformation(globalToLocal))
+		return false;
+
 	for (unsigned i = 0; i < count; i++)
 	{
-		const CCVector3* coordGlobal = points->getPoint(i);
-		CCVector3 coordLocal;
+		CCVector3 coordLocal = globalToLocal * (*points->getPoint(i));
 		CCVector2 coordImage;
 
-		if (	fromGlobalCoordToLocalCoord(*coordGlobal,coordLocal)
-			&&	fromLocalCoordToImageCoord(coordLocal, coordImage) )
+		if (fromLocalCoordToImageCoord(coordLocal, coordImage))
 		{
 			computeUncertainty(coordImage, std::abs(coordLocal.z), accuracy[i]);
 		}
@@ -1175,6 +1294,23 @@ bool ccCameraSensor::isGlobalCoordInFrustum(const CCVector3& globalCoord/*, bool
 	if (!fromGlobalCoordToLocalCoord(globalCoord, localCoord/*, withLensCorrection*/))
 		return false;
 
+	return isLocalCoordInFrustum(localCoord);
+}
+
+bool ccCameraSensor::getGlobalToLocalTransformation(ccGLMatrix& trans) const
+{
+	ccIndexedTransformation sensorTrans;
+
+	if (!getActiveAbsoluteTransformation(sensorTrans))
+		return false;
+
+	trans = sensorTrans.inverse();
+
+	return true;
+}
+
+bool ccCameraSensor::isLocalCoordInFrustum(const CCVector3& localCoord) const
+{
 	// Tests if the projected point is between zNear and zFar
 	const float& z = localCoord.z;
 	const float& n = m_intrinsicParams.zNear_mm;
@@ -1947,19 +2083,35 @@ ccImage* ccCameraSensor::orthoRectifyAsImageDirect(	const ccImage* image,
 	const QRgb blackValue = qRgb(0, 0, 0);
 	const QRgb blackAlphaZero = qRgba(0, 0, 0, 0);
 
+	//global to local transformation (computed once and for all)
+	ccGLMatrix globalToLocal;
+	if (!getGlobalToLocalTransformation(globalToLocal))
+		return nullptr;
+
 	QImage image_data = image->data();
-	for (unsigned i = 0; i < w; ++i)
+
+	//the output rows are processed in parallel
+	uchar* orthoBits = orthoImage.bits();
+	const int orthoBytesPerLine = orthoImage.bytesPerLine();
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int jj = 0; jj < static_cast<int>(h); ++jj)
 	{
-		PointCoordinateType xip = static_cast<PointCoordinateType>(minC[0] + i*_pixelSize);
-		for (unsigned j = 0; j < h; ++j)
+		unsigned j = static_cast<unsigned>(jj);
+		PointCoordinateType yip = static_cast<PointCoordinateType>(minC[1] + j*_pixelSize);
+		QRgb* orthoRow = reinterpret_cast<QRgb*>(orthoBits + static_cast<size_t>(h - 1 - j) * orthoBytesPerLine);
+
+		for (unsigned i = 0; i < w; ++i)
 		{
-			PointCoordinateType yip = static_cast<PointCoordinateType>(minC[1] + j*_pixelSize);
+			PointCoordinateType xip = static_cast<PointCoordinateType>(minC[0] + i*_pixelSize);
 
 			QRgb rgb = blackValue; //output pixel is (transparent) black by default
 
 			CCVector3 P3D(xip,yip,Z0);
 			CCVector2 imageCoord;
-			if (fromGlobalCoordToImageCoord(P3D,imageCoord,undistortImages))
+			if (fromLocalCoordToImageCoord(globalToLocal * P3D, imageCoord, undistortImages))
 			{
 				int x = static_cast<int>(imageCoord.x);
 				int y = static_cast<int>(imageCoord.y);
@@ -1970,7 +2122,7 @@ ccImage* ccCameraSensor::orthoRectifyAsImageDirect(	const ccImage* image,
 			}
 
 			//pure black pixels are treated as transparent ones!
-			orthoImage.setPixel(i, h - 1 - j, rgb != blackValue ? rgb : blackAlphaZero);
+			orthoRow[i] = (rgb != blackValue ? rgb : blackAlphaZero);
 		}
 	}
 
@@ -2096,14 +2248,27 @@ ccImage* ccCameraSensor::orthoRectifyAsImage(	const ccImage* image,
 	const QRgb blackValue = qRgb(0, 0, 0);
 	const QRgb blackAlphaZero = qRgba(0, 0, 0, 0);
 
-	for (unsigned i = 0; i < w; ++i)
+	//the source image is only retrieved once (it may have to be loaded from the disk)
+	const QImage imageData = image->data();
+
+	//the output rows are processed in parallel
+	uchar* orthoBits = orthoImage.bits();
+	const int orthoBytesPerLine = orthoImage.bytesPerLine();
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int jj = 0; jj < static_cast<int>(h); ++jj)
 	{
-		double xip = minC[0] + static_cast<double>(i)*_pixelSize;
-		for (unsigned j = 0; j < h; ++j)
+		unsigned j = static_cast<unsigned>(jj);
+		double yip = minC[1] + static_cast<double>(j)*_pixelSize;
+		QRgb* orthoRow = reinterpret_cast<QRgb*>(orthoBits + static_cast<size_t>(h - 1 - j) * orthoBytesPerLine);
+
+		for (unsigned i = 0; i < w; ++i)
 		{
 			QRgb rgb = blackValue; //output pixel is (transparent) black by default
 
-			double yip = minC[1] + static_cast<double>(j)*_pixelSize;
+			double xip = minC[0] + static_cast<double>(i)*_pixelSize;
 			double q = (c2*xip - a2)*(c1*yip - b1) - (c2*yip - b2)*(c1*xip - a1);
 			double p = (a0 - xip)*(c1*yip - b1) - (b0 - yip)*(c1*xip - a1);
 			double yi = p / q;
@@ -2120,12 +2285,12 @@ ccImage* ccCameraSensor::orthoRectifyAsImage(	const ccImage* image,
 
 				if (x >= 0 && x < width)
 				{
-					rgb = image->data().pixel(x, y);
+					rgb = imageData.pixel(x, y);
 				}
 			}
 
 			//pure black pixels are treated as transparent ones!
-			orthoImage.setPixel(i, h - 1 - j, rgb != blackValue ? rgb : blackAlphaZero);
+			orthoRow[i] = (rgb != blackValue ? rgb : blackAlphaZero);
 		}
 	}
 
@@ -2135,12 +2300,99 @@ ccImage* ccCameraSensor::orthoRectifyAsImage(	const ccImage* image,
 	return new ccImage(orthoImage,getName());
 }
 
+//! Resamples (a part of) a projectively ortho-rectified image
+/** See ccCameraSensor::OrthoRectifyAsImages. The rows are processed in parallel.
+	\param source source image
+	\param a {a0, a1, a2} ortho-rectification parameters
+	\param b {b0, b1, b2} ortho-rectification parameters
+	\param c {c0(=1), c1, c2} ortho-rectification parameters
+	\param minC ortho-rectified image 3D min corner (2 values)
+	\param pixelSize ortho-rectified image pixel size
+	\param width source image width
+	\param height source image height
+	\param orthoHeight full ortho-rectified image height (in pixels)
+	\param firstCol first column of the part (in the full ortho-rectified image)
+	\param firstRow first row of the part (in the full ortho-rectified image)
+	\param output output part (ARGB32 format)
+**/
+static void OrthoRectifyImagePart(	const QImage& source,
+									const double* a,
+									const double* b,
+									const double* c,
+									const double* minC,
+									double pixelSize,
+									unsigned width,
+									unsigned height,
+									unsigned orthoHeight,
+									unsigned firstCol,
+									unsigned firstRow,
+									QImage& output)
+{
+	const double& a0 = a[0];
+	const double& a1 = a[1];
+	const double& a2 = a[2];
+	const double& b0 = b[0];
+	const double& b1 = b[1];
+	const double& b2 = b[2];
+	//const double& c0 = c[0];
+	const double& c1 = c[1];
+	const double& c2 = c[2];
+
+	uchar* outputBits = output.bits();
+	const int outputBytesPerLine = output.bytesPerLine();
+	const int outputWidth = output.width();
+	const int outputHeight = output.height();
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int row = 0; row < outputHeight; ++row)
+	{
+		unsigned j = orthoHeight - 1 - (firstRow + static_cast<unsigned>(row));
+		double yip = minC[1] + static_cast<double>(j)*pixelSize;
+		QRgb* outputRow = reinterpret_cast<QRgb*>(outputBits + static_cast<size_t>(row) * outputBytesPerLine);
+
+		for (int col = 0; col < outputWidth; ++col)
+		{
+			unsigned i = firstCol + static_cast<unsigned>(col);
+			double xip = minC[0] + static_cast<double>(i)*pixelSize;
+			double q = (c2*xip-a2)*(c1*yip-b1)-(c2*yip-b2)*(c1*xip-a1);
+			double p = (a0-xip)*(c1*yip-b1)-(b0-yip)*(c1*xip-a1);
+			double yi = p/q;
+
+			q = (c1*xip-a1)*(c2*yip-b2)-(c1*yip-b1)*(c2*xip-a2);
+			p = (a0-xip)*(c2*yip-b2)-(b0-yip)*(c2*xip-a2);
+			double  xi = p/q;
+
+			xi += 0.5 * width;
+			yi += 0.5 * height;
+
+			int x = static_cast<int>(xi);
+			int y = static_cast<int>(yi);
+			if (x >= 0 && x < static_cast<int>(width) && y >= 0 && y < static_cast<int>(height))
+			{
+				QRgb rgb = source.pixel(x,y);
+				//pure black pixels are treated as transparent ones!
+				if (qRed(rgb) + qGreen(rgb) + qBlue(rgb) > 0)
+					outputRow[col] = rgb;
+				else
+					outputRow[col] = qRgba(qRed(rgb), qGreen(rgb), qBlue(rgb), 0);
+			}
+			else
+			{
+				outputRow[col] = qRgba(255, 0, 255, 0);
+			}
+		}
+	}
+}
+
 bool ccCameraSensor::OrthoRectifyAsImages(	std::vector<ccImage*> images,
 											double a[], double b[], double c[],
 											unsigned maxSize,
 											QDir* outputDir/*=0*/,
 											std::vector<ccImage*>* result/*=0*/,
-											std::vector<std::pair<double,double> >* relativePos/*=0*/)
+											std::vector<std::pair<double,double> >* relativePos/*=0*/,
+											unsigned tileSize/*=0*/)
 {
 	size_t count = images.size();
 	if (count == 0)
@@ -2274,87 +2526,124 @@ bool ccCameraSensor::OrthoRectifyAsImages(	std::vector<ccImage*> images,
 		}
 	}
 
+	//tiles can only be saved on the disk
+	if (tileSize != 0 && !outputDir)
+	{
+		ccLog::Warning("[OrthoRectifyAsImages] Tiled output requires an output directory (tiling is ignored)");
+		tileSize = 0;
+	}
+	if (tileSize != 0 && result)
+	{
+		ccLog::Warning("[OrthoRectifyAsImages] Images are only saved as tiles (no image will be returned)");
+	}
+
+	//relative positions (relatively to first image)
+	if (relativePos)
+	{
+		for (size_t k=0; k<count; ++k)
+		{
+			double xShift = (minCorners[2*k  ]-minCorners[0])/pixelSize;
+			double yShift = (minCorners[2*k+1]-minCorners[1])/pixelSize;
+			relativePos->emplace_back(xShift, yShift);
+		}
+	}
+
+	//ortho-rectified images and log lines (so as to keep the images order)
+	//(the ccImage instances are only created afterwards, as their unique IDs can't be generated concurrently)
+	std::vector<QImage> orthoImages;
+	std::vector<QStringList> logLines;
+	try
+	{
+		orthoImages.resize(result && tileSize == 0 ? count : 0);
+		logLines.resize(count);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		ccLog::Warning("[OrthoRectifyAsImages] Not enough memory!");
+		return false;
+	}
+
+	//several images are processed concurrently if there's enough of them
+	//(otherwise the rows of each image are processed in parallel)
+	bool parallelImages = false;
+#if defined(_OPENMP)
+	parallelImages = (count > 1 && count >= static_cast<size_t>(omp_get_max_threads()));
+#endif
+	std::atomic<bool> success(true);
+
 	//projet each image accordingly
-	for (size_t k=0; k<count; ++k)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic) if(parallelImages)
+#endif
+	for (int kk=0; kk<static_cast<int>(count); ++kk)
 	{
-		double* minC = &minCorners[2*k];
-		double* maxC = &maxCorners[2*k];
+		size_t k = static_cast<size_t>(kk);
+		const double* minC = &minCorners[2*k];
+		const double* maxC = &maxCorners[2*k];
 		double dx = maxC[0]-minC[0];
 		double dy = maxC[1]-minC[1];
 
-		ccImage* image = images[k];
-		unsigned width = images[k]->getW();
-		unsigned height = images[k]->getH();
+		const ccImage* image = images[k];
+		unsigned width = image->getW();
+		unsigned height = image->getH();
 		unsigned w = static_cast<unsigned>(ceil(dx/pixelSize));
 		unsigned h = static_cast<unsigned>(ceil(dy/pixelSize));
 
-		QImage orthoImage(w,h,QImage::Format_ARGB32);
-		if (orthoImage.isNull()) //not enough memory!
-		{
-			//clear mem.
-			if (result)
-			{
-				while (!result->empty())
-				{
-					delete result->back();
-					result->pop_back();
-				}
-			}
-			ccLog::Warning("[OrthoRectifyAsImages] Not enough memory!");
-			return false;
-		}
+		//the source image is only retrieved once (it may have to be loaded from the disk)
+		const QImage imageData = image->data();
 
-		//ortho rectification parameters
-		const double& a0 = a[k*3  ];
-		const double& a1 = a[k*3+1];
-		const double& a2 = a[k*3+2];
-		const double& b0 = b[k*3  ];
-		const double& b1 = b[k*3+1];
-		const double& b2 = b[k*3+2];
-		//const double& c0 = c[k*3];
-		const double& c1 = c[k*3+1];
-		const double& c2 = c[k*3+2];
+		double xShiftGlobal = (minC[0]-globalCorners[0])/pixelSize;
+		double yShiftGlobal = (minC[1]-globalCorners[1])/pixelSize;
 
-		for (unsigned i=0; i<w; ++i)
+		if (tileSize != 0)
 		{
-			double xip = minC[0] + static_cast<double>(i)*pixelSize;
-			for (unsigned j=0;j<h;++j)
+			//each tile is generated and saved independently (to bound the memory consumption)
+			for (unsigned ty = 0; ty < h; ty += tileSize)
 			{
-				double yip = minC[1] + static_cast<double>(j)*pixelSize;
-				double q = (c2*xip-a2)*(c1*yip-b1)-(c2*yip-b2)*(c1*xip-a1);
-				double p = (a0-xip)*(c1*yip-b1)-(b0-yip)*(c1*xip-a1);
-				double yi = p/q;
-
-				q = (c1*xip-a1)*(c2*yip-b2)-(c1*yip-b1)*(c2*xip-a2);
-				p = (a0-xip)*(c2*yip-b2)-(b0-yip)*(c2*xip-a2);
-				double  xi = p/q;
+				unsigned th = std::min(tileSize, h - ty);
+				for (unsigned tx = 0; tx < w; tx += tileSize)
+				{
+					unsigned tw = std::min(tileSize, w - tx);
 
-				xi += 0.5 * width;
-				yi += 0.5 * height;
+					QImage tile(tw, th, QImage::Format_ARGB32);
+					if (tile.isNull()) //not enough memory!
+					{
+						success = false;
+						break;
+					}
+					OrthoRectifyImagePart(imageData, a + 3*k, b + 3*k, c + 3*k, minC, pixelSize, width, height, h, tx, ty, tile);
+
+					//export tile
+					QString exportFilename = QString("ortho_rectified_%1_%2_%3.png").arg(image->getName()).arg(tx / tileSize).arg(ty / tileSize);
+					tile.save(outputDir->absoluteFilePath(exportFilename));
+
+					//tile meta-data
+					double tileMinX = minC[0] + tx * pixelSize;
+					double tileMinY = minC[1] + (h - ty - th) * pixelSize;
+					double tileXShift = xShiftGlobal + tx;
+					double tileYShift = yShiftGlobal + (h - ty - th);
+					logLines[k] << QString("Image %1 Local3DBBox %2 %3 %4 %5 Local2DBBox %6 %7 %8 %9")
+									.arg(exportFilename)
+									.arg(tileMinX, 0, 'f', 6).arg(tileMinY, 0, 'f', 6).arg(tileMinX + tw * pixelSize, 0, 'f', 6).arg(tileMinY + th * pixelSize, 0, 'f', 6)
+									.arg(tileXShift, 0, 'f', 6).arg(tileYShift, 0, 'f', 6).arg(tileXShift + static_cast<double>(tw - 1), 0, 'f', 6).arg(tileYShift + static_cast<double>(th - 1), 0, 'f', 6);
+				}
 
-				int x = static_cast<int>(xi);
-				int y = static_cast<int>(yi);
-				if (x >= 0 && x < static_cast<int>(width) && y >= 0 && y < static_cast<int>(height))
+				if (!success)
 				{
-					QRgb rgb = image->data().pixel(x,y);
-					//pure black pixels are treated as transparent ones!
-					if (qRed(rgb) + qGreen(rgb) + qBlue(rgb) > 0)
-						orthoImage.setPixel(i, h - 1 - j, rgb);
-					else
-						orthoImage.setPixel(i, h - 1 - j, qRgba(qRed(rgb), qGreen(rgb), qBlue(rgb), 0));
+					break;
 				}
-				else
-					orthoImage.setPixel(i, h - 1 - j, qRgba(255, 0, 255, 0));
 			}
+			continue;
 		}
 
-		//eventually compute relative pos
-		if (relativePos)
+		QImage orthoImage(w,h,QImage::Format_ARGB32);
+		if (orthoImage.isNull()) //not enough memory!
 		{
-			double xShift = (minC[0]-minCorners[0])/pixelSize;
-			double yShift = (minC[1]-minCorners[1])/pixelSize;
-			relativePos->emplace_back(xShift, yShift);
+			success = false;
+			continue;
 		}
+		OrthoRectifyImagePart(imageData, a + 3*k, b + 3*k, c + 3*k, minC, pixelSize, width, height, h, 0, 0, orthoImage);
 
 		if (outputDir)
 		{
@@ -2363,23 +2652,47 @@ bool ccCameraSensor::OrthoRectifyAsImages(	std::vector<ccImage*> images,
 			orthoImage.save(outputDir->absoluteFilePath(exportFilename));
 
 			//export meta-data
-			QFile f(outputDir->absoluteFilePath("ortho_rectification_log.txt"));
-			if (f.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) //always append
+			logLines[k] << QString("Image %1 Local3DBBox %2 %3 %4 %5 Local2DBBox %6 %7 %8 %9")
+							.arg(exportFilename)
+							.arg(minC[0], 0, 'f', 6).arg(minC[1], 0, 'f', 6).arg(maxC[0], 0, 'f', 6).arg(maxC[1], 0, 'f', 6)
+							.arg(xShiftGlobal, 0, 'f', 6).arg(yShiftGlobal, 0, 'f', 6).arg(xShiftGlobal + static_cast<double>(w - 1), 0, 'f', 6).arg(yShiftGlobal + static_cast<double>(h - 1), 0, 'f', 6);
+		}
+
+		if (result)
+			orthoImages[k] = orthoImage;
+	}
+
+	if (outputDir)
+	{
+		//export meta-data (in the images order)
+		QFile f(outputDir->absoluteFilePath("ortho_rectification_log.txt"));
+		if (f.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) //always append
+		{
+			QTextStream stream(&f);
+			for (const QStringList& lines : logLines)
 			{
-				double xShiftGlobal = (minC[0]-globalCorners[0])/pixelSize;
-				double yShiftGlobal = (minC[1]-globalCorners[1])/pixelSize;
-				QTextStream stream(&f);
-				stream.setRealNumberNotation(QTextStream::FixedNotation);
-				stream.setRealNumberPrecision(6);
-				stream << "Image" << ' ' << exportFilename  << ' ';
-				stream << "Local3DBBox" << ' ' << minC[0] << ' ' << minC[1] << ' ' << maxC[0] << ' ' << maxC[1] << ' ';
-				stream << "Local2DBBox" << ' ' << xShiftGlobal << ' ' << yShiftGlobal <<  ' ' << xShiftGlobal+static_cast<double>(w-1) << ' ' << yShiftGlobal+static_cast<double>(h-1) << endl;
-				f.close();
+				for (const QString& line : lines)
+				{
+					stream << line << endl;
+				}
 			}
+			f.close();
 		}
+	}
 
-		if (result)
-			result->push_back(new ccImage(orthoImage,image->getName()));
+	if (!success)
+	{
+		ccLog::Warning("[OrthoRectifyAsImages] Not enough memory!");
+		return false;
+	}
+
+	if (result)
+	{
+		for (size_t k = 0; k < orthoImages.size(); ++k)
+		{
+			if (!orthoImages[k].isNull())
+				result->push_back(new ccImage(orthoImages[k], images[k]->getName()));
+		}
 	}
 
 	return true;
@@ -2422,6 +2735,8 @@ ccPointCloud* ccCameraSensor::orthoRectifyAsCloud(	const ccImage* image,
 
 	//ortho rectification
 	{
+		//the image data is fetched once (and not for each pixel)
+		const QImage imageData = image->data();
 		for (unsigned pi = 0; pi<width; ++pi)
 		{
 			double xi = static_cast<double>(pi) - 0.5*width;
@@ -2434,7 +2749,7 @@ ccPointCloud* ccCameraSensor::orthoRectifyAsCloud(	const ccImage* image,
 							defaultZ);
 
 				//and color?
-				QRgb rgb = image->data().pixel(pi, pj);
+				QRgb rgb = imageData.pixel(pi, pj);
 				int r = qRed(rgb);
 				int g = qGreen(rgb);
 				int b = qBlue(rgb);
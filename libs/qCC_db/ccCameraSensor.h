@@ -304,6 +304,39 @@ public: //coordinate systems conversion methods
 	**/
 	bool fromGlobalCoordToImageCoord(const CCVector3& globalCoord, CCVector2& imageCoord, bool withLensError = true) const;
 
+	//! Computes the coordinates of a set of 3D points in the image knowing their coordinates in the global coordinate system
+	/** Batch version of fromGlobalCoordToImageCoord: the sensor transformation is only computed once and
+		the points are projected in parallel.
+		\param points global coordinates of the 3D points
+		\param imageCoords image coordinates of the projected 3D points (output)
+		\param inFrame whether each point could be projected into the image boundaries or not (output)
+		\param withLensError to take lens distortion into account
+		\param pointIndexes optional subset of point indexes to project (all points are projected by default)
+		\return false if the sensor transformation is invalid or if there's not enough memory
+	**/
+	bool fromGlobalCoordToImageCoord(	const CCLib::GenericIndexedCloud* points,
+										std::vector<CCVector2>& imageCoords,
+										std::vector<unsigned char>& inFrame,
+										bool withLensError = true,
+										const std::vector<unsigned>* pointIndexes = nullptr) const;
+
+	//! Projects the points of a cloud that fall inside the sensor frustum
+	/** The cloud octree (computed if necessary) is used to skip the cells outside
+		of the frustum (see ccOctree::intersectWithFrustum). The remaining points are
+		then projected in parallel (see fromGlobalCoordToImageCoord).
+		\param cloud point cloud
+		\param pointIndexes indexes of the points projected into the image boundaries (output)
+		\param imageCoords corresponding image coordinates (output)
+		\param withLensError to take lens distortion into account
+		\param progressCb optional progress callback (for the octree computation)
+		\return success
+	**/
+	bool projectCloudInFrustum(	ccGenericPointCloud* cloud,
+								std::vector<unsigned>& pointIndexes,
+								std::vector<CCVector2>& imageCoords,
+								bool withLensError = true,
+								CCLib::GenericProgressCallback* progressCb = nullptr);
+
 	//! Computes the global coordinates of a 3D points from its 3D coordinates (pixel position in the image)
 	/** \param imageCoord image coordinates of the pixel (input) --> !! Note that the first index is (0,0) and the last (width-1,height-1) !!
 		\param globalCoord global coordinates of the corresponding 3D point (output)
@@ -414,6 +447,10 @@ public: //orthorectification tools
 		\param outputDir output directory for resulting images (is successful)
 		\param[out] orthoRectifiedImages resulting images (is successful)
 		\param[out] relativePos relative positions (relatively to first image)
+		\param tileSize if not 0, each ortho-rectified image is saved as tiles of tileSize x tileSize pixels
+			(bounds the memory consumption for very large mosaics - requires an output directory)
+		\warning In tiled mode, no image is returned: orthoRectifiedImages is left untouched even
+			if the method succeeds (the tiles are only saved in the output directory)
 		\return true if successful
 	**/
 	static bool OrthoRectifyAsImages(std::vector<ccImage*> images,
@@ -421,7 +458,8 @@ public: //orthorectification tools
 									unsigned maxSize,
 									QDir* outputDir = nullptr,
 									std::vector<ccImage*>* orthoRectifiedImages = nullptr,
-									std::vector<std::pair<double,double> >* relativePos = nullptr);
+									std::vector<std::pair<double,double> >* relativePos = nullptr,
+									unsigned tileSize = 0);
 
 	//! Computes ortho-rectification parameters for a given image
 	/** Requires at least 4 key points!
@@ -485,6 +523,14 @@ public: //misc
 	**/
 	bool isGlobalCoordInFrustum(const CCVector3& globalCoord/*, bool withLensCorrection*/) const;
 
+	//! Tests if a 3D point (expressed in the sensor coordinate system) is in the field of view of the camera
+	bool isLocalCoordInFrustum(const CCVector3& localCoord) const;
+
+	//! Returns the global to local (sensor) coordinate system transformation
+	/** \return false if the sensor has no valid transformation for its active index
+	**/
+	bool getGlobalToLocalTransformation(ccGLMatrix& trans) const;
+
 	//! Compute the coefficients of the 6 planes frustum in the global coordinates system (normal vector are headed the frustum inside), the edges direction vectors and the frustum center
 	/** \param planeCoefficients coefficients of the six planes
 		\param edges direction vectors of the frustum edges (there are 12 edges but some of them are colinear)
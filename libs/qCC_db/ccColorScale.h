@@ -195,6 +195,12 @@ public:
 	**/
 	void update();
 
+	//! Returns the version of the internal representation
+	/** Incremented each time the internal representation is updated
+		(can be used to invalidate data derived from it).
+	**/
+	inline unsigned version() const { return m_version; }
+
 	//! Returns relative position of a given value (wrt to scale absolute min and max)
 	/** Warning: only valid with absolute scales! Use 'getColorByRelativePos' otherwise.
 	**/
@@ -292,6 +298,9 @@ protected:
 	//! Internal representation validity
 	bool m_updated;
 
+	//! Internal representation version
+	unsigned m_version;
+
 	//! Whether scale is relative or not
 	bool m_relative;
 
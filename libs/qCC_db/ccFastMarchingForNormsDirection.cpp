@@ -80,6 +80,14 @@ int ccFastMarchingForNormsDirection::init(	ccGenericPointCloud* cloud,
 	CCLib::DgmOctree::cellCodesContainer cellCodes;
 	theOctree->getCellCodes(level,cellCodes,true);
 
+	//the cells are allocated at once
+	DirectionCell* cells = instantiateCellsTpl<DirectionCell>(static_cast<unsigned>(cellCodes.size()));
+	if (!cells)
+	{
+		//not enough memory
+		return -1;
+	}
+
 	CCLib::ReferenceCloud Yk(theOctree->associatedCloud());
 
 	while (!cellCodes.empty())
@@ -98,7 +106,7 @@ int ccFastMarchingForNormsDirection::init(	ccGenericPointCloud* cloud,
 		unsigned gridPos = pos2index(cellPos);
 
 		//create corresponding cell
-		DirectionCell* aCell = new DirectionCell;
+		DirectionCell* aCell = cells++;
 		{
 			//aCell->signConfidence = 1;
 			aCell->cellCode = cellCodes.back();
@@ -243,11 +251,7 @@ int ccFastMarchingForNormsDirection::step()
 				//otherwise we must update it's arrival time
 				else if (nCell->state == DirectionCell::TRIAL_CELL)
 				{
-					const float& t_old = nCell->T;
-					float t_new = computeT(nIndex);
-
-					if (t_new < t_old)
-						nCell->T = t_new;
+					updateTrialCell(nIndex, computeT(nIndex));
 				}
 			}
 		}
@@ -353,10 +357,10 @@ void ccFastMarchingForNormsDirection::initTrialCells()
 			if (nCell/* && nCell->state == DirectionCell::FAR_CELL*/)
 			{
 				assert(nCell->state == DirectionCell::FAR_CELL);
-				addTrialCell(nIndex);
 
-				//compute its approximate arrival time
+				//compute its approximate arrival time (before adding it to the TRIAL heap)
 				nCell->T = seedCell->T + m_neighboursDistance[i] * computeTCoefApprox(seedCell, nCell);
+				addTrialCell(nIndex);
 			}
 		}
 	}
@@ -443,6 +447,7 @@ int ccFastMarchingForNormsDirection::OrientNormals(	ccPointCloud* cloud,
 		cloud->setCurrentScalarField(oldSfIdx);
 		return -6;
 	}
+	ccLog::PrintDebug(QString("[orientNormalsWithFM] Fast Marching structure: %1 MB").arg(fm.memoryUsage() / 1048576.0, 0, 'f', 1));
 
 	//progress notification
 	if (progressCb)
@@ -25,9 +25,16 @@
 #include "ccProgressDialog.h"
 #include "ccSphere.h"
 
+//CCLib
+#include <GenericIndexedCloud.h>
+
 //Qt
 #include <QCoreApplication>
 
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 //maximum depth buffer dimension (width or height)
 static const int s_MaxDepthBufferSize = (1 << 14); //16384
 
@@ -137,23 +144,31 @@ void ccGBLSensor::setYawStep(PointCoordinateType dTheta)
 	}
 }
 
-void ccGBLSensor::projectPoint(	const CCVector3& sourcePoint,
-								CCVector2& destPoint,
-								PointCoordinateType &depth,
-								double posIndex/*=0*/) const
+ccGLMatrix ccGBLSensor::getWorldToSensorTransformation(double posIndex) const
 {
-	//project point in sensor world
-	CCVector3 P = sourcePoint;
-
 	//sensor to world global transformation = sensor position * rigid transformation
 	ccIndexedTransformation sensorPos; //identity by default
 	if (m_posBuffer)
-		m_posBuffer->getInterpolatedTransformation(posIndex,sensorPos);
+		m_posBuffer->getInterpolatedTransformation(posIndex, sensorPos);
 	sensorPos *= m_rigidTransformation;
 
+	//world to sensor = inverse transformation
+	return sensorPos.inverse();
+}
+
+void ccGBLSensor::projectPoint(	const CCVector3& sourcePoint,
+								CCVector2& destPoint,
+								PointCoordinateType &depth,
+								double posIndex/*=0*/) const
+{
 	//apply (inverse) global transformation (i.e world to sensor)
-	sensorPos.inverse().apply(P);
+	projectLocalPoint(getWorldToSensorTransformation(posIndex) * sourcePoint, destPoint, depth);
+}
 
+void ccGBLSensor::projectLocalPoint(const CCVector3& P,
+									CCVector2& destPoint,
+									PointCoordinateType &depth) const
+{
 	//convert to 2D sensor field of view + compute its distance
 	switch (m_rotationOrder)
 	{
@@ -248,62 +263,127 @@ ccGBLSensor::NormalGrid* ccGBLSensor::projectNormals(	CCLib::GenericCloud* cloud
 	if (m_posBuffer)
 		m_posBuffer->getInterpolatedTransformation(posIndex,sensorPos);
 	sensorPos *= m_rigidTransformation;
+	const CCVector3 sensorCenter = sensorPos.getTranslationAsVec3D();
+
+	//world to sensor transformation (computed once and for all)
+	const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
 
-	//poject each point + normal
+	//projects a point + normal (returns false if the point falls outside of the depth buffer)
+	auto projectNormal = [&](const CCVector3& P, const CCVector3& N, CCVector3& S, unsigned& cellIndex) -> bool
 	{
-		cloud->placeIteratorAtBeginning();
-		unsigned pointCount = cloud->size();
-		for (unsigned i=0; i<pointCount; ++i)
+		//project point
+		CCVector2 Q;
+		PointCoordinateType depth1;
+		projectLocalPoint(worldToSensor * P, Q, depth1);
+
+		S = CCVector3(0, 0, 0);
+
+		CCVector3 U = P - sensorCenter;
+		PointCoordinateType distToSensor = U.norm();
+
+		if (distToSensor > ZERO_TOLERANCE)
 		{
-			const CCVector3* P = cloud->getNextPoint();
-			const CCVector3& N = theNorms[i];
+			//normal component along sensor viewing dir.
+			S.z = -N.dot(U) / distToSensor;
 
-			//project point
-			CCVector2 Q;
-			PointCoordinateType depth1;
-			projectPoint(*P, Q, depth1, m_activeIndex);
+			if (S.z > 1.0 - ZERO_TOLERANCE)
+			{
+				S.x = 0;
+				S.y = 0;
+			}
+			else
+			{
+				//and point+normal
+				CCVector3 P2 = P + N;
+				CCVector2 S2;
+				PointCoordinateType depth2;
+				projectLocalPoint(worldToSensor * P2, S2, depth2);
+
+				//deduce other normals components
+				PointCoordinateType coef = sqrt((1 - S.z*S.z) / (S.x*S.x + S.y*S.y));
+				S.x = coef * (S2.x - Q.x);
+				S.y = coef * (S2.y - Q.y);
+			}
+		}
+		else
+		{
+			S = N;
+		}
 
-			CCVector3 S;
+		//project in Z-buffer
+		unsigned x, y;
+		if (!convertToDepthMapCoords(Q.x, Q.y, x, y))
+		{
+			return false;
+		}
+		cellIndex = y*m_depthBuffer.width + x;
+		return true;
+	};
+
+	unsigned pointCount = cloud->size();
+
+	//the points can be projected in parallel if we can access them directly
+	const CCLib::GenericIndexedCloud* indexedCloud = dynamic_cast<const CCLib::GenericIndexedCloud*>(cloud);
+	if (indexedCloud)
+	{
+		//the points are projected in parallel (by blocks) and the normals
+		//are accumulated sequentially (so that the result is deterministic)
+		static const unsigned BlockSize = (1 << 16);
+		std::vector<CCVector3> blockNormals;
+		std::vector<int> blockCells;
+		try
+		{
+			blockNormals.resize(std::min(pointCount, BlockSize));
+			blockCells.resize(std::min(pointCount, BlockSize));
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			delete normalGrid;
+			return nullptr;
+		}
 
-			CCVector3 U = *P - sensorPos.getTranslationAsVec3D();
-			PointCoordinateType distToSensor = U.norm();
+		for (unsigned start = 0; start < pointCount; start += BlockSize)
+		{
+			int count = static_cast<int>(std::min(BlockSize, pointCount - start));
 
-			if (distToSensor > ZERO_TOLERANCE)
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for (int j = 0; j < count; ++j)
 			{
-				//normal component along sensor viewing dir.
-				S.z = -N.dot(U) / distToSensor;
+				unsigned cellIndex = 0;
+				blockCells[j] = (projectNormal(*indexedCloud->getPoint(start + j), theNorms[start + j], blockNormals[j], cellIndex) ? static_cast<int>(cellIndex) : -1);
+			}
 
-				if (S.z > 1.0 - ZERO_TOLERANCE)
+			for (int j = 0; j < count; ++j)
+			{
+				if (blockCells[j] >= 0)
 				{
-					S.x = 0;
-					S.y = 0;
+					//add the transformed normal
+					normalGrid->at(blockCells[j]) += blockNormals[j];
 				}
 				else
 				{
-					//and point+normal
-					CCVector3 P2 = *P + CCVector3(N);
-					CCVector2 S2;
-					PointCoordinateType depth2;
-					projectPoint(P2, S2, depth2, m_activeIndex);
-
-					//deduce other normals components
-					PointCoordinateType coef = sqrt((1 - S.z*S.z) / (S.x*S.x + S.y*S.y));
-					S.x = coef * (S2.x - Q.x);
-					S.y = coef * (S2.y - Q.y);
+					//shouldn't happen!
+					assert(false);
 				}
 			}
-			else
-			{
-				S = CCVector3(N);
-			}
+		}
+	}
+	else //poject each point + normal
+	{
+		cloud->placeIteratorAtBeginning();
+		for (unsigned i=0; i<pointCount; ++i)
+		{
+			const CCVector3* P = cloud->getNextPoint();
 
-			//project in Z-buffer
-			unsigned x, y;
-			if (convertToDepthMapCoords(Q.x, Q.y, x, y))
+			CCVector3 S;
+			unsigned cellIndex = 0;
+			if (projectNormal(*P, theNorms[i], S, cellIndex))
 			{
 				//add the transformed normal
-				CCVector3& newN = normalGrid->at(y*m_depthBuffer.width + x);
-				newN += S;
+				normalGrid->at(cellIndex) += S;
 			}
 			else
 			{
@@ -375,6 +455,9 @@ ccGBLSensor::ColorGrid* ccGBLSensor::projectColors(	CCLib::GenericCloud* cloud,
 
 	//project colors
 	{
+		//world to sensor transformation (computed once and for all)
+		const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
+
 		unsigned pointCount = cloud->size();
 		cloud->placeIteratorAtBeginning();
 		{
@@ -383,7 +466,7 @@ ccGBLSensor::ColorGrid* ccGBLSensor::projectColors(	CCLib::GenericCloud* cloud,
 				const CCVector3 *P = cloud->getNextPoint();
 				CCVector2 Q;
 				PointCoordinateType depth;
-				projectPoint(*P, Q, depth, m_activeIndex);
+				projectLocalPoint(worldToSensor * (*P), Q, depth);
 
 				unsigned x, y;
 				if (convertToDepthMapCoords(Q.x, Q.y, x, y))
@@ -517,6 +600,10 @@ bool ccGBLSensor::computeAutoParameters(CCLib::GenericCloud* theCloud)
 
 	PointCoordinateType minPitch = 0, maxPitch = 0, minYaw = 0, maxYaw = 0;
 	PointCoordinateType maxDepth = 0;
+
+	//world to sensor transformation (computed once and for all)
+	const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
+
 	{
 		//first project all points to compute the (yaw,ptich) ranges
 		theCloud->placeIteratorAtBeginning();
@@ -526,7 +613,7 @@ bool ccGBLSensor::computeAutoParameters(CCLib::GenericCloud* theCloud)
 			CCVector2 Q;
 			PointCoordinateType depth;
 			//Q.x and Q.y are inside [-pi;pi] by default (result of atan2)
-			projectPoint(*P, Q, depth, m_activeIndex);
+			projectLocalPoint(worldToSensor * (*P), Q, depth);
 
 			//yaw
 			int angleYaw = static_cast<int>(Q.x * CC_RAD_TO_DEG);
@@ -584,7 +671,7 @@ bool ccGBLSensor::computeAutoParameters(CCLib::GenericCloud* theCloud)
 			const CCVector3 *P = theCloud->getNextPoint();
 			CCVector2 Q;
 			PointCoordinateType depth;
-			projectPoint(*P, Q, depth, m_activeIndex);
+			projectLocalPoint(worldToSensor * (*P), Q, depth);
 
 			if (i != 0)
 			{
@@ -688,22 +775,114 @@ bool ccGBLSensor::computeDepthBuffer(CCLib::GenericCloud* theCloud, int& errorCo
 			}
 		}
 
-		theCloud->placeIteratorAtBeginning();
+		//world to sensor transformation (computed once and for all)
+		const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
+
+		//progress bar
+		ccProgressDialog pdlg(true);
+		CCLib::NormalizedProgress nprogress(&pdlg, pointCount);
+		pdlg.setMethodTitle(QObject::tr("Depth buffer"));
+		pdlg.setInfo(QObject::tr("Points: %L1").arg(pointCount));
+		pdlg.start();
+		QCoreApplication::processEvents();
+
+		//the points can be projected in parallel if we can access them directly
+		CCLib::GenericIndexedCloud* indexedCloud = (projectedCloud ? nullptr : dynamic_cast<CCLib::GenericIndexedCloud*>(theCloud));
+		if (indexedCloud)
 		{
-			//progress bar
-			ccProgressDialog pdlg(true);
-			CCLib::NormalizedProgress nprogress(&pdlg, pointCount);
-			pdlg.setMethodTitle(QObject::tr("Depth buffer"));
-			pdlg.setInfo(QObject::tr("Points: %L1").arg(pointCount));
-			pdlg.start();
-			QCoreApplication::processEvents();
+			const unsigned zBuffSize = m_depthBuffer.width * m_depthBuffer.height;
 
+			//each thread accumulates the points in its own depth buffer (merged afterwards)
+			int threadCount = 1;
+#if defined(_OPENMP)
+			{
+				//we limit the memory used by the additional buffers (~512 Mb)
+				size_t maxExtraBuffers = (static_cast<size_t>(512) << 20) / (sizeof(PointCoordinateType) * zBuffSize);
+				threadCount = static_cast<int>(std::min<size_t>(static_cast<size_t>(std::max(omp_get_max_threads(), 1)), maxExtraBuffers + 1));
+			}
+#endif
+			std::vector< std::vector<PointCoordinateType> > extraBuffers;
+			try
+			{
+				extraBuffers.resize(threadCount - 1, std::vector<PointCoordinateType>(zBuffSize, 0));
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory: we'll use a single buffer
+				extraBuffers.clear();
+				threadCount = 1;
+			}
+			std::vector<PointCoordinateType> threadMaxDepth(threadCount, m_sensorRange);
+
+			static const unsigned BlockSize = (1 << 16);
+			for (unsigned start = 0; start < pointCount; start += BlockSize)
+			{
+				int count = static_cast<int>(std::min(BlockSize, pointCount - start));
+
+#if defined(_OPENMP)
+#pragma omp parallel num_threads(threadCount)
+#endif
+				{
+					int threadIndex = 0;
+#if defined(_OPENMP)
+					threadIndex = omp_get_thread_num();
+#endif
+					PointCoordinateType* zBuff = (threadIndex == 0 ? m_depthBuffer.zBuff.data() : extraBuffers[threadIndex - 1].data());
+					PointCoordinateType& maxDepth = threadMaxDepth[threadIndex];
+
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+					for (int j = 0; j < count; ++j)
+					{
+						CCVector2 Q;
+						PointCoordinateType depth;
+						projectLocalPoint(worldToSensor * (*indexedCloud->getPoint(start + j)), Q, depth);
+
+						unsigned x, y;
+						if (convertToDepthMapCoords(Q.x, Q.y, x, y))
+						{
+							PointCoordinateType& zBuf = zBuff[y*m_depthBuffer.width + x];
+							zBuf = std::max(zBuf, depth);
+							maxDepth = std::max(maxDepth, depth);
+						}
+					}
+				}
+
+				if (!nprogress.steps(static_cast<unsigned>(count)))
+				{
+					//cancelled by user
+					errorCode = ERROR_PROC_CANCELLED;
+					clearDepthBuffer();
+					return false;
+				}
+			}
+
+			//merge the per-thread depth buffers
+			for (const std::vector<PointCoordinateType>& buffer : extraBuffers)
+			{
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+				for (int k = 0; k < static_cast<int>(zBuffSize); ++k)
+				{
+					m_depthBuffer.zBuff[k] = std::max(m_depthBuffer.zBuff[k], buffer[k]);
+				}
+			}
+			for (PointCoordinateType maxDepth : threadMaxDepth)
+			{
+				m_sensorRange = std::max(m_sensorRange, maxDepth);
+			}
+		}
+		else
+		{
+			theCloud->placeIteratorAtBeginning();
 			for (unsigned i = 0; i < pointCount; ++i)
 			{
 				const CCVector3 *P = theCloud->getNextPoint();
 				CCVector2 Q;
 				PointCoordinateType depth;
-				projectPoint(*P, Q, depth, m_activeIndex);
+				projectLocalPoint(worldToSensor * (*P), Q, depth);
 
 				unsigned x, y;
 				if (convertToDepthMapCoords(Q.x, Q.y, x, y))
@@ -743,10 +922,15 @@ unsigned char ccGBLSensor::checkVisibility(const CCVector3& P) const
 		return POINT_VISIBLE;
 	}
 
+	return checkLocalVisibility(getWorldToSensorTransformation(m_activeIndex) * P);
+}
+
+unsigned char ccGBLSensor::checkLocalVisibility(const CCVector3& localPoint) const
+{
 	//project point
 	CCVector2 Q;
 	PointCoordinateType depth;
-	projectPoint(P, Q, depth, m_activeIndex);
+	projectLocalPoint(localPoint, Q, depth);
 
 	//out of sight
 	if (depth > m_sensorRange)
@@ -770,6 +954,71 @@ unsigned char ccGBLSensor::checkVisibility(const CCVector3& P) const
 	return POINT_VISIBLE;
 }
 
+bool ccGBLSensor::checkCloudVisibility(	const CCLib::GenericIndexedCloud* cloud,
+										std::vector<unsigned char>& visibility,
+										CCLib::GenericProgressCallback* progressCb/*=nullptr*/) const
+{
+	if (!cloud)
+	{
+		assert(false);
+		return false;
+	}
+
+	unsigned pointCount = cloud->size();
+	try
+	{
+		visibility.resize(pointCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	if (m_depthBuffer.zBuff.empty()) //no z-buffer?
+	{
+		std::fill(visibility.begin(), visibility.end(), POINT_VISIBLE);
+		return true;
+	}
+
+	//world to sensor transformation (computed once and for all)
+	const ccGLMatrix worldToSensor = getWorldToSensorTransformation(m_activeIndex);
+
+	CCLib::NormalizedProgress nprogress(progressCb, pointCount);
+	if (progressCb)
+	{
+		if (progressCb->textCanBeEdited())
+		{
+			progressCb->setMethodTitle(qPrintable(QObject::tr("Compute visibility")));
+			progressCb->setInfo(qPrintable(QObject::tr("Points: %L1").arg(pointCount)));
+		}
+		progressCb->update(0);
+		progressCb->start();
+	}
+
+	static const unsigned BlockSize = (1 << 16);
+	for (unsigned start = 0; start < pointCount; start += BlockSize)
+	{
+		int count = static_cast<int>(std::min(BlockSize, pointCount - start));
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int j = 0; j < count; ++j)
+		{
+			visibility[start + j] = checkLocalVisibility(worldToSensor * (*cloud->getPoint(start + j)));
+		}
+
+		if (progressCb && !nprogress.steps(static_cast<unsigned>(count)))
+		{
+			//cancelled by user
+			return false;
+		}
+	}
+
+	return true;
+}
+
 void ccGBLSensor::drawMeOnly(CC_DRAW_CONTEXT& context)
 {
 	if (!MACRO_Draw3D(context))
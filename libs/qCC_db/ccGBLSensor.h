@@ -25,6 +25,12 @@
 //CCLib
 #include <GenericCloud.h>
 
+namespace CCLib
+{
+	class GenericIndexedCloud;
+	class GenericProgressCallback;
+}
+
 class ccPointCloud;
 
 //! Ground-based Laser sensor
@@ -79,6 +85,18 @@ public:
 	**/
 	unsigned char checkVisibility(const CCVector3& P) const override;
 
+	//! Determines the "visibility" of all the points of a cloud at once
+	/** Same as checkVisibility but the sensor transformation is only computed once
+		and the points are processed in parallel.
+		\param cloud the points to test
+		\param visibility output visibility of each point (see checkVisibility)
+		\param progressCb optional progress callback
+		\return false if not enough memory or if the process was cancelled
+	**/
+	bool checkCloudVisibility(	const CCLib::GenericIndexedCloud* cloud,
+								std::vector<unsigned char>& visibility,
+								CCLib::GenericProgressCallback* progressCb = nullptr) const;
+
 	//! Computes angular parameters automatically (all but the angular steps!)
 	/** WARNING: this method uses the cloud global iterator.
 	**/
@@ -227,6 +245,21 @@ protected:
 	bool fromFile_MeOnly(QFile& in, short dataVersion, int flags) override;
 	void drawMeOnly(CC_DRAW_CONTEXT& context) override;
 
+	//! Returns the world to sensor transformation (i.e. the inverse of sensor position * rigid transformation)
+	/** \param posIndex sensor position index (see ccIndexedTransformationBuffer)
+	**/
+	ccGLMatrix getWorldToSensorTransformation(double posIndex) const;
+
+	//! Projects a point already expressed in the sensor frame (see projectPoint)
+	void projectLocalPoint(	const CCVector3& localPoint,
+							CCVector2& destPoint,
+							PointCoordinateType &depth) const;
+
+	//! Determines the visibility of a point already expressed in the sensor frame (see checkVisibility)
+	/** \warning The depth buffer must have been computed.
+	**/
+	unsigned char checkLocalVisibility(const CCVector3& localPoint) const;
+
 	//! Converts 2D angular coordinates (yaw,pitch) in integer depth buffer coordinates
 	bool convertToDepthMapCoords(PointCoordinateType yaw, PointCoordinateType pitch, unsigned& i, unsigned& j) const;
 
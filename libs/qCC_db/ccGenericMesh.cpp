@@ -732,7 +732,8 @@ ccPointCloud* ccGenericMesh::samplePoints(	bool densityBased,
 											bool withNormals,
 											bool withRGB,
 											bool withTexture,
-											CCLib::GenericProgressCallback* pDlg/*=nullptr*/)
+											CCLib::GenericProgressCallback* pDlg/*=nullptr*/,
+											const CCLib::MeshSamplingTools::SamplingParameters& params/*=CCLib::MeshSamplingTools::SamplingParameters()*/)
 {
 	if (samplingParameter <= 0)
 	{
@@ -751,11 +752,11 @@ ccPointCloud* ccGenericMesh::samplePoints(	bool densityBased,
 	CCLib::PointCloud* sampledCloud = nullptr;
 	if (densityBased)
 	{
-		sampledCloud = CCLib::MeshSamplingTools::samplePointsOnMesh(this, samplingParameter, pDlg, triIndices.data());
+		sampledCloud = CCLib::MeshSamplingTools::samplePointsOnMesh(this, samplingParameter, pDlg, triIndices.data(), params);
 	}
 	else
 	{
-		sampledCloud = CCLib::MeshSamplingTools::samplePointsOnMesh(this, static_cast<unsigned>(samplingParameter), pDlg, triIndices.data());
+		sampledCloud = CCLib::MeshSamplingTools::samplePointsOnMesh(this, static_cast<unsigned>(samplingParameter), pDlg, triIndices.data(), params);
 	}
 
 	//convert to real point cloud
@@ -20,6 +20,7 @@
 
 //CCLib
 #include <GenericIndexedMesh.h>
+#include <MeshSamplingTools.h>
 
 //Local
 #include "ccAdvancedTypes.h"
@@ -197,12 +198,22 @@ public:
 	void enableStippling(bool state) { m_stippling = state; }
 
 	//! Samples points on a mesh
+	/** See CCLib::MeshSamplingTools::samplePointsOnMesh.
+		\param densityBased whether the sampling parameter is a density or a number of points
+		\param samplingParameter sampling density or number of points
+		\param withNormals whether to interpolate the normals of the sampled points
+		\param withRGB whether to interpolate the colors of the sampled points
+		\param withTexture whether to get the colors of the sampled points from the texture
+		\param pDlg progress dialog (optional)
+		\param params sampling parameters (seed, stratification)
+	**/
 	ccPointCloud* samplePoints(	bool densityBased,
 								double samplingParameter,
 								bool withNormals,
 								bool withRGB,
 								bool withTexture,
-								CCLib::GenericProgressCallback* pDlg = nullptr);
+								CCLib::GenericProgressCallback* pDlg = nullptr,
+								const CCLib::MeshSamplingTools::SamplingParameters& params = CCLib::MeshSamplingTools::SamplingParameters());
 
 	//! Imports the parameters from another mesh
 	/** Only the specific parameters are imported.
@@ -52,8 +52,84 @@
 #include "StFootPrint.h"
 
 //Qt
+#include <QHash>
 #include <QIcon>
 
+//system
+#include <algorithm>
+
+//! Returns the number following a given prefix in a child name (or -1 if the child doesn't match)
+static int NumberAfterPrefix(const ccHObject* child, const QString& name, const QString& prefix, CC_CLASS_ENUM type_filter)
+{
+	if (name.length() > prefix.length() && name.startsWith(prefix) && child->isKindOf(type_filter))
+	{
+		return name.mid(prefix.length()).toInt();
+	}
+	return -1;
+}
+
+//! Children name index
+struct ccHObject::ChildrenNameIndex
+{
+	//! Children by name
+	QHash<QString, ccHObject::Container> byName;
+	//! Greatest number per prefix and type (computed on demand, see ccHObject::getMaxChildNumber)
+	std::map<std::pair<QString, CC_CLASS_ENUM>, int> maxNumbers;
+
+	void add(ccHObject* child, const QString& name)
+	{
+		byName[name].push_back(child);
+
+		for (auto& maxNumber : maxNumbers)
+		{
+			maxNumber.second = std::max(maxNumber.second, NumberAfterPrefix(child, name, maxNumber.first.first, maxNumber.first.second));
+		}
+	}
+
+	bool remove(const ccHObject* child, const QString& name)
+	{
+		auto it = byName.find(name);
+		if (it == byName.end())
+		{
+			return false;
+		}
+		ccHObject::Container& children = it.value();
+		auto childIt = std::find(children.begin(), children.end(), child);
+		if (childIt == children.end())
+		{
+			return false;
+		}
+		children.erase(childIt);
+		if (children.empty())
+		{
+			byName.erase(it);
+		}
+
+		//if the child had the greatest number, it will have to be computed again
+		for (auto maxIt = maxNumbers.begin(); maxIt != maxNumbers.end(); )
+		{
+			if (maxIt->second >= 0 && NumberAfterPrefix(child, name, maxIt->first.first, maxIt->first.second) == maxIt->second)
+			{
+				maxIt = maxNumbers.erase(maxIt);
+			}
+			else
+			{
+				++maxIt;
+			}
+		}
+
+		return true;
+	}
+
+	//! Returns whether a child can be indexed
+	static bool IsIndexable(const ccHObject* parent, const ccHObject* child)
+	{
+		//the labels names are computed on the fly, and the renaming of the
+		//children that are not owned by the parent wouldn't be notified
+		return child->getParent() == parent && !child->isA(CC_TYPES::LABEL_2D);
+	}
+};
+
 ccHObject::ccHObject(const QString& name)
 	: ccObject(name)
 	, ccDrawableObject()
@@ -107,6 +183,93 @@ ccHObject::~ccHObject()
 	removeAllChildren();
 }
 
+void ccHObject::setName(const QString& name)
+{
+	if (name == m_name)
+	{
+		return;
+	}
+
+	QString previousName = m_name;
+	ccObject::setName(name);
+
+	if (m_parent)
+	{
+		m_parent->onChildRenamed(this, previousName);
+	}
+}
+
+ccHObject::ChildrenNameIndex* ccHObject::getChildrenNameIndex() const
+{
+	if (!m_childrenNameIndex)
+	{
+		for (const ccHObject* child : m_children)
+		{
+			if (!ChildrenNameIndex::IsIndexable(this, child))
+			{
+				return nullptr;
+			}
+		}
+
+		try
+		{
+			std::unique_ptr<ChildrenNameIndex> index(new ChildrenNameIndex);
+			index->byName.reserve(static_cast<int>(m_children.size()));
+			for (ccHObject* child : m_children)
+			{
+				index->add(child, child->getName());
+			}
+			m_childrenNameIndex = std::move(index);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory: we'll use the slow way
+			return nullptr;
+		}
+	}
+
+	return m_childrenNameIndex.get();
+}
+
+void ccHObject::releaseChildrenNameIndex() const
+{
+	m_childrenNameIndex.reset();
+}
+
+void ccHObject::onChildRenamed(ccHObject* child, const QString& previousName)
+{
+	if (m_childrenNameIndex && m_childrenNameIndex->remove(child, previousName))
+	{
+		m_childrenNameIndex->add(child, child->getName());
+	}
+}
+
+int ccHObject::getMaxChildNumber(const QString& prefix, CC_CLASS_ENUM type_filter/*=CC_TYPES::OBJECT*/) const
+{
+	ChildrenNameIndex* index = getChildrenNameIndex();
+	if (index)
+	{
+		auto it = index->maxNumbers.find(std::make_pair(prefix, type_filter));
+		if (it != index->maxNumbers.end())
+		{
+			return it->second;
+		}
+	}
+
+	int maxNumber = -1;
+	for (const ccHObject* child : m_children)
+	{
+		maxNumber = std::max(maxNumber, NumberAfterPrefix(child, child->getName(), prefix, type_filter));
+	}
+
+	if (index)
+	{
+		index->maxNumbers[std::make_pair(prefix, type_filter)] = maxNumber;
+	}
+
+	return maxNumber;
+}
+
 void ccHObject::notifyGeometryUpdate()
 {
 	//the associated display bounding-box is (potentially) deprecated!!!
@@ -336,6 +499,12 @@ void ccHObject::onDeletionOf(const ccHObject* obj)
 	{
 		//we can't swap children as we want to keep the order!
 		m_children.erase(m_children.begin() + pos);
+
+		if (m_childrenNameIndex)
+		{
+			//the object is being deleted: we can't rely on the overridden methods
+			m_childrenNameIndex.reset();
+		}
 	}
 }
 
@@ -390,6 +559,14 @@ bool ccHObject::addChild(ccHObject* child, int dependencyFlags/*=DP_PARENT_OF_OT
 			child->setDisplay(getDisplay());
 	}
 
+	if (m_childrenNameIndex)
+	{
+		if (ChildrenNameIndex::IsIndexable(this, child))
+			m_childrenNameIndex->add(child, child->getName());
+		else
+			m_childrenNameIndex.reset();
+	}
+
 	return true;
 }
 
@@ -463,6 +640,42 @@ unsigned ccHObject::filterChildrenByName( Container& filteredChildren,
 	CC_CLASS_ENUM type_filter/*=CC_TYPES::OBJECT*/,
 	ccGenericGLDisplay* inDisplay/*=0*/) const
 {
+	if (strict && !recursive)
+	{
+		ChildrenNameIndex* index = getChildrenNameIndex();
+		if (index)
+		{
+			auto it = index->byName.find(filter);
+			if (it == index->byName.end())
+			{
+				return static_cast<unsigned>(filteredChildren.size());
+			}
+
+			Container candidates = it.value();
+			if (candidates.size() > 1)
+			{
+				//same order as the children
+				std::sort(candidates.begin(), candidates.end(), [this](const ccHObject* a, const ccHObject* b)
+				{
+					return getChildIndex(a) < getChildIndex(b);
+				});
+			}
+
+			for (ccHObject* child : candidates)
+			{
+				if (child->isKindOf(type_filter) && (!inDisplay || child->getDisplay() == inDisplay))
+				{
+					if (std::find(filteredChildren.begin(), filteredChildren.end(), child) == filteredChildren.end())
+					{
+						filteredChildren.push_back(child);
+					}
+				}
+			}
+
+			return static_cast<unsigned>(filteredChildren.size());
+		}
+	}
+
 	for (auto child : m_children)
 	{
 		if (!child->isKindOf(type_filter)) {
@@ -536,6 +749,7 @@ void ccHObject::transferChildren(ccHObject& newParent, bool forceFatherDependent
 		assert(child->getParent() == &newParent || child->getParent() == nullptr);
 	}
 	m_children.clear();
+	m_childrenNameIndex.reset();
 }
 
 void ccHObject::swapChildren(unsigned firstChildIndex, unsigned secondChildIndex)
@@ -961,6 +1175,11 @@ void ccHObject::detachChild(ccHObject* child)
 	{
 		//we can't swap children as we want to keep the order!
 		m_children.erase(m_children.begin()+pos);
+
+		if (m_childrenNameIndex && !m_childrenNameIndex->remove(child, child->getName()))
+		{
+			m_childrenNameIndex.reset();
+		}
 	}
 }
 
@@ -978,6 +1197,7 @@ void ccHObject::detatchAllChildren()
 		}
 	}
 	m_children.clear();
+	m_childrenNameIndex.reset();
 }
 
 void ccHObject::removeChild(ccHObject* child)
@@ -1004,6 +1224,11 @@ void ccHObject::removeChild(int pos)
 	//the dependency mechanism can 'backfire' ;)
 	m_children.erase(m_children.begin() + pos);
 
+	if (m_childrenNameIndex && !m_childrenNameIndex->remove(child, child->getName()))
+	{
+		m_childrenNameIndex.reset();
+	}
+
 	//backup dependency flags
 	int flags = getDependencyFlagsWith(child);
 
@@ -1027,6 +1252,8 @@ void ccHObject::removeChild(int pos)
 
 void ccHObject::removeAllChildren()
 {
+	m_childrenNameIndex.reset();
+
 	while (!m_children.empty())
 	{
 		ccHObject* child = m_children.back();
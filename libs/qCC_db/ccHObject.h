@@ -22,6 +22,9 @@
 #include "ccObject.h"
 #include "ccBBox.h"
 
+//system
+#include <memory>
+
 class QIcon;
 
 //! Hierarchical CloudCompare Object
@@ -70,6 +73,9 @@ public: //base members access
 	**/
 	inline ccHObject* getParent() const { return m_parent; }
 
+	//inherited from ccObject
+	void setName(const QString& name) override;
+
 	//! Returns the icon associated to this entity
 	/** ccDBRoot will call this method: if an invalid icon is returned
 		the default icon for that type will be used instead.
@@ -169,12 +175,36 @@ public: //children management
 							bool strict = false,
 							ccGenericGLDisplay* inDisplay = nullptr) const;
 
+	//! Collects the children whose name matches a filter
+	/** \param filteredChildren result container
+		\param recursive specifies if the search should be recursive
+		\param filter name pattern (if strict is false) or exact name (if strict is true)
+		\param strict whether the name must be equal to the filter or only contain it
+		\param type_filter children type (isKindOf)
+		\param inDisplay [optional] display in which the children are displayed
+		\return number of collected children
+		Note: the non-recursive strict searches use the children name index (see getMaxChildNumber)
+	**/
 	unsigned filterChildrenByName(Container& filteredChildren,
 		bool recursive = false,
 		QString filter = QString(),
 		bool strict = false, CC_CLASS_ENUM type_filter = CC_TYPES::OBJECT,
 		ccGenericGLDisplay* inDisplay = nullptr) const;
 
+	//! Returns the greatest number following a given prefix in the (direct) children names
+	/** E.g. 12 for the children 'Plane3' and 'Plane12' with the prefix 'Plane'.
+		The children are indexed by name the first time this method (or a strict
+		search by name) is called. The index and the numbers per prefix are then
+		kept up to date when children are added, removed or renamed (see setName).
+		\param prefix name prefix
+		\param type_filter children type (isKindOf)
+		\return the greatest number or -1 if no child matches
+	**/
+	int getMaxChildNumber(const QString& prefix, CC_CLASS_ENUM type_filter = CC_TYPES::OBJECT) const;
+
+	//! Releases the children name index (see getMaxChildNumber)
+	void releaseChildrenNameIndex() const;
+
 	//! Detaches a specific child
 	/** This method does not delete the child.
 		Removes any dependency between the flag and this object
@@ -444,12 +474,24 @@ protected:
 	**/
 	virtual void onUpdateOf(ccHObject* obj) { /*does nothing by default*/ }
 
+	//! Children name index (see getMaxChildNumber)
+	struct ChildrenNameIndex;
+
+	//! Returns the children name index (built on demand - may be null if the children can't be indexed)
+	ChildrenNameIndex* getChildrenNameIndex() const;
+
+	//! Called when a child is renamed
+	void onChildRenamed(ccHObject* child, const QString& previousName);
+
 	//! Parent
 	ccHObject* m_parent;
 
 	//! Children
 	Container m_children;
 
+	//! Children name index (see getChildrenNameIndex)
+	mutable std::unique_ptr<ChildrenNameIndex> m_childrenNameIndex;
+
 	//! Selection behavior
 	SelectionBehavior m_selectionBehavior;
 
@@ -22,6 +22,7 @@
 
 //Local
 #include "ccCameraSensor.h"
+#include "ccImageCache.h"
 
 //Qt
 #include <QFileInfo>
@@ -118,8 +119,8 @@ QImage ccImage::data() const
 //inline const QImage & ccImage::data() const
 {
 	if (m_image.isNull()) {
-		QImageReader reader(m_file_name);
-		return reader.read();
+		//the image is not held in memory (decoded only once, see ccImageCache)
+		return ccImageCache::Get(m_file_name);
 	}
 	else {
 		return m_image;
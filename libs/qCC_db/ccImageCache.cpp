@@ -0,0 +1,191 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccImageCache.h"
+
+//Local
+#include "ccLog.h"
+
+//Qt
+#include <QHash>
+#include <QImageReader>
+#include <QMutex>
+#include <QSet>
+#include <QWaitCondition>
+
+//system
+#include <list>
+#include <utility>
+
+//! Default memory budget (in bytes)
+static const size_t c_defaultMaxMemory = 512 << 20;
+
+namespace
+{
+	//! Cached image
+	struct CachedImage
+	{
+		QString filename;
+		QImage image;
+		size_t size = 0;
+	};
+
+	//! Cache state (shared by all the threads)
+	struct ImageCache
+	{
+		//! Images (the most recently used first)
+		std::list<CachedImage> images;
+		//! Images indexed by filename
+		QHash<QString, std::list<CachedImage>::iterator> index;
+		//! Images being decoded
+		QSet<QString> pending;
+		//! Memory used by the cached images (in bytes)
+		size_t memoryUsage = 0;
+		//! Memory budget (in bytes)
+		size_t maxMemory = c_defaultMaxMemory;
+
+		QMutex mutex;
+		//! Signaled when an image has been decoded
+		QWaitCondition decoded;
+
+		//! Releases the least recently used images until the memory budget is respected (the mutex must be locked)
+		void shrink(size_t budget)
+		{
+			while (!images.empty() && memoryUsage > budget)
+			{
+				const CachedImage& last = images.back();
+				memoryUsage -= last.size;
+				index.remove(last.filename);
+				images.pop_back();
+			}
+		}
+	};
+
+	ImageCache& Instance()
+	{
+		static ImageCache s_cache;
+		return s_cache;
+	}
+}
+
+static size_t ImageSize(const QImage& image)
+{
+	return static_cast<size_t>(image.bytesPerLine()) * static_cast<size_t>(image.height());
+}
+
+QImage ccImageCache::Get(const QString& filename)
+{
+	ImageCache& cache = Instance();
+
+	cache.mutex.lock();
+	while (true)
+	{
+		auto it = cache.index.find(filename);
+		if (it != cache.index.end())
+		{
+			//move the image to the front of the LRU list
+			cache.images.splice(cache.images.begin(), cache.images, it.value());
+			QImage image = it.value()->image;
+			cache.mutex.unlock();
+			return image;
+		}
+		if (!cache.pending.contains(filename))
+		{
+			break;
+		}
+		//another thread is already decoding this image
+		cache.decoded.wait(&cache.mutex);
+	}
+	cache.pending.insert(filename);
+	cache.mutex.unlock();
+
+	//the image is decoded outside of the lock
+	QImageReader reader(filename);
+	QImage image = reader.read();
+	if (image.isNull())
+	{
+		ccLog::Warning(QString("[ccImageCache] Failed to read image '%1': %2").arg(filename, reader.errorString()));
+	}
+
+	cache.mutex.lock();
+	cache.pending.remove(filename);
+	size_t size = ImageSize(image);
+	if (!image.isNull() && size <= cache.maxMemory)
+	{
+		try
+		{
+			CachedImage cached;
+			cached.filename = filename;
+			cached.image = image;
+			cached.size = size;
+			cache.images.push_front(std::move(cached));
+			cache.index.insert(filename, cache.images.begin());
+			cache.memoryUsage += size;
+			cache.shrink(cache.maxMemory);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory: the image is simply not cached
+		}
+	}
+	cache.decoded.wakeAll();
+	cache.mutex.unlock();
+
+	return image;
+}
+
+void ccImageCache::SetMaxMemory(size_t bytes)
+{
+	ImageCache& cache = Instance();
+	QMutexLocker locker(&cache.mutex);
+	cache.maxMemory = bytes;
+	cache.shrink(bytes);
+}
+
+size_t ccImageCache::GetMaxMemory()
+{
+	ImageCache& cache = Instance();
+	QMutexLocker locker(&cache.mutex);
+	return cache.maxMemory;
+}
+
+size_t ccImageCache::GetMemoryUsage()
+{
+	ImageCache& cache = Instance();
+	QMutexLocker locker(&cache.mutex);
+	return cache.memoryUsage;
+}
+
+void ccImageCache::Clear()
+{
+	ImageCache& cache = Instance();
+	QMutexLocker locker(&cache.mutex);
+	cache.shrink(0);
+}
+
+void ccImageCache::Remove(const QString& filename)
+{
+	ImageCache& cache = Instance();
+	QMutexLocker locker(&cache.mutex);
+	auto it = cache.index.find(filename);
+	if (it != cache.index.end())
+	{
+		cache.memoryUsage -= it.value()->size;
+		cache.images.erase(it.value());
+		cache.index.erase(it);
+	}
+}
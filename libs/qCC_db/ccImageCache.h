@@ -0,0 +1,65 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_IMAGE_CACHE_HEADER
+#define CC_IMAGE_CACHE_HEADER
+
+//Local
+#include "qCC_db.h"
+
+//Qt
+#include <QImage>
+#include <QString>
+
+//! Process-wide cache of the decoded images (LRU)
+/** The images that are not held in memory (see ccImage::loadWithWidthHeight)
+	are decoded from their file each time their data is requested. This cache
+	keeps the most recently used ones, within a memory budget.
+
+	The cache is thread-safe: an image requested by several threads at the
+	same time is only decoded once (the other threads wait for it). Different
+	images are decoded concurrently.
+**/
+class QCC_DB_LIB_API ccImageCache
+{
+public:
+
+	//! Returns the (decoded) image stored in a file
+	/** \param filename image filename
+		\return the image (or a null image if the file can't be read)
+	**/
+	static QImage Get(const QString& filename);
+
+	//! Sets the memory budget (in bytes - 0 disables the cache)
+	/** The least recently used images are released if necessary.
+	**/
+	static void SetMaxMemory(size_t bytes);
+
+	//! Returns the memory budget (in bytes)
+	static size_t GetMaxMemory();
+
+	//! Returns the memory currently used by the cached images (in bytes)
+	static size_t GetMemoryUsage();
+
+	//! Releases the cached images
+	static void Clear();
+
+	//! Releases the cached image of a given file (e.g. if the file has changed)
+	static void Remove(const QString& filename);
+};
+
+#endif //CC_IMAGE_CACHE_HEADER
@@ -59,6 +59,7 @@ ccMesh::ccMesh(ccGenericPointCloud* vertices)
 	, m_triMtlIndexes(nullptr)
 	, m_texCoordIndexes(nullptr)
 	, m_triNormalIndexes(nullptr)
+	, m_vertexAdjacencyIsValid(false)
 {
 	setAssociatedCloud(vertices);
 
@@ -77,6 +78,7 @@ ccMesh::ccMesh(CCLib::GenericIndexedMesh* giMesh, ccGenericPointCloud* giVertice
 	, m_triMtlIndexes(nullptr)
 	, m_texCoordIndexes(nullptr)
 	, m_triNormalIndexes(nullptr)
+	, m_vertexAdjacencyIsValid(false)
 {
 	setAssociatedCloud(giVertices);
 
@@ -202,18 +204,6 @@ bool ccMesh::computePerVertexNormals()
 
 	ccPointCloud* cloud = static_cast<ccPointCloud*>(m_associatedCloud);
 
-	//we instantiate a temporary structure to store each vertex normal (uncompressed)
-	std::vector<CCVector3> theNorms;
-	try
-	{
-		theNorms.resize(vertCount, s_blankNorm);
-	}
-	catch (const std::bad_alloc&)
-	{
-		ccLog::Warning("[ccMesh::computePerVertexNormals] Not enough memory!");
-		return false;
-	}
-
 	//allocate compressed normals array on vertices cloud
 	bool normalsWereAllocated = cloud->hasNormals();
 	if (/*!normalsWereAllocated && */!cloud->resizeTheNormsTable()) //we call it whatever the case (just to be sure)
@@ -222,38 +212,36 @@ bool ccMesh::computePerVertexNormals()
 		return false;
 	}
 
-	//for each triangle
-	placeIteratorAtBeginning();
+	//for each vertex, we gather the normals of its incident triangles
+	//(in the same order as a sequential loop on the triangles would do)
+	const VertexAdjacency* adjacency = getVertexAdjacency();
+	if (!adjacency)
 	{
-		for (unsigned i = 0; i < triCount; ++i)
-		{
-			CCLib::VerticesIndexes* tsi = getNextTriangleVertIndexes();
+		ccLog::Warning("[ccMesh::computePerVertexNormals] Not enough memory!");
+		return false;
+	}
 
-			assert(tsi->i1 < vertCount && tsi->i2 < vertCount && tsi->i3 < vertCount);
-			const CCVector3 *A = cloud->getPoint(tsi->i1);
-			const CCVector3 *B = cloud->getPoint(tsi->i2);
-			const CCVector3 *C = cloud->getPoint(tsi->i3);
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int i = 0; i < static_cast<int>(vertCount); ++i)
+	{
+		CCVector3 N = s_blankNorm;
+		for (unsigned k = adjacency->offsets[i]; k < adjacency->offsets[i + 1]; ++k)
+		{
+			const CCLib::VerticesIndexes& tsi = m_triVertIndexes->getValue(adjacency->triangles[k]);
+			const CCVector3 *A = cloud->getPoint(tsi.i1);
+			const CCVector3 *B = cloud->getPoint(tsi.i2);
+			const CCVector3 *C = cloud->getPoint(tsi.i3);
 
 			//compute face normal (right hand rule)
-			CCVector3 N = (*B-*A).cross(*C-*A);
 			//N.normalize(); //DGM: no normalization = weighting by surface!
-
-			//we add this normal to all triangle vertices
-			theNorms[tsi->i1] += N;
-			theNorms[tsi->i2] += N;
-			theNorms[tsi->i3] += N;
+			N += (*B - *A).cross(*C - *A);
 		}
-	}
 
-	//for each vertex
-	{
-		for (unsigned i = 0; i < vertCount; i++)
-		{
-			CCVector3& N = theNorms[i];
-			//normalize the 'mean' normal
-			N.normalize();
-			cloud->setPointNormal(i, N);
-		}
+		//normalize the 'mean' normal
+		N.normalize();
+		cloud->setPointNormal(i, N);
 	}
 
 	//apply it also to sub-meshes!
@@ -547,6 +535,80 @@ void ccMesh::transformTriNormals(const ccGLMatrix& trans)
 	}
 }
 
+void ccMesh::invalidateVertexAdjacency()
+{
+	m_vertexAdjacency.offsets.clear();
+	m_vertexAdjacency.offsets.shrink_to_fit();
+	m_vertexAdjacency.triangles.clear();
+	m_vertexAdjacency.triangles.shrink_to_fit();
+	m_vertexAdjacencyIsValid = false;
+}
+
+const ccMesh::VertexAdjacency* ccMesh::getVertexAdjacency()
+{
+	if (!m_associatedCloud)
+	{
+		return nullptr;
+	}
+
+	unsigned vertCount = m_associatedCloud->size();
+	size_t triCount = m_triVertIndexes->size();
+
+	if (	m_vertexAdjacencyIsValid
+		&&	m_vertexAdjacency.offsets.size() == static_cast<size_t>(vertCount) + 1
+		&&	m_vertexAdjacency.triangles.size() == 3 * triCount)
+	{
+		//nothing to do
+		return &m_vertexAdjacency;
+	}
+
+	invalidateVertexAdjacency();
+
+	try
+	{
+		m_vertexAdjacency.offsets.resize(static_cast<size_t>(vertCount) + 1, 0);
+		m_vertexAdjacency.triangles.resize(3 * triCount);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		invalidateVertexAdjacency();
+		return nullptr;
+	}
+
+	//count the incident triangles of each vertex
+	std::vector<unsigned>& offsets = m_vertexAdjacency.offsets;
+	for (size_t i = 0; i < triCount; ++i)
+	{
+		const CCLib::VerticesIndexes& tri = m_triVertIndexes->getValue(i);
+		assert(tri.i1 < vertCount && tri.i2 < vertCount && tri.i3 < vertCount);
+		++offsets[tri.i1 + 1];
+		++offsets[tri.i2 + 1];
+		++offsets[tri.i3 + 1];
+	}
+	for (unsigned i = 0; i < vertCount; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	//dispatch the triangles (in increasing order)
+	{
+		std::vector<unsigned> positions(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triCount; ++i)
+		{
+			const CCLib::VerticesIndexes& tri = m_triVertIndexes->getValue(i);
+			for (unsigned j = 0; j < 3; ++j)
+			{
+				m_vertexAdjacency.triangles[positions[tri.i[j]]++] = static_cast<unsigned>(i);
+			}
+		}
+	}
+
+	m_vertexAdjacencyIsValid = true;
+
+	return &m_vertexAdjacency;
+}
+
 bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 								PointCoordinateType factor,
 								ccProgressDialog* progressCb/*=0*/)
@@ -572,27 +634,14 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 		return false;
 	}
 
-	//compute the number of edges to which belong each vertex
-	std::vector<unsigned> edgesCount;
-	try
-	{
-		edgesCount.resize(vertCount, 0);
-	}
-	catch (const std::bad_alloc&)
+	//the number of edges to which belong each vertex is twice its number of incident triangles
+	const VertexAdjacency* adjacency = getVertexAdjacency();
+	if (!adjacency)
 	{
 		//not enough memory
 		return false;
 	}
 
-	placeIteratorAtBeginning();
-	for(unsigned j=0; j<faceCount; j++)
-	{
-		const CCLib::VerticesIndexes* tri = getNextTriangleVertIndexes();
-		edgesCount[tri->i1] += 2;
-		edgesCount[tri->i2] += 2;
-		edgesCount[tri->i3] += 2;
-	}
-
 	//progress dialog
 	CCLib::NormalizedProgress nProgress(progressCb, nbIteration);
 	if (progressCb)
@@ -605,25 +654,38 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 	//repeat Laplacian smoothing iterations
 	for (unsigned iter = 0; iter < nbIteration; iter++)
 	{
-		std::fill(verticesDisplacement.begin(), verticesDisplacement.end(), CCVector3(0, 0, 0));
-
-		//for each triangle
-		placeIteratorAtBeginning();
-		for (unsigned j = 0; j < faceCount; j++)
+		//for each vertex, we gather the displacements induced by its incident triangles
+		//(in the same order as a sequential loop on the triangles would do)
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < static_cast<int>(vertCount); ++i)
 		{
-			const CCLib::VerticesIndexes* tri = getNextTriangleVertIndexes();
+			CCVector3 D(0, 0, 0);
+			for (unsigned k = adjacency->offsets[i]; k < adjacency->offsets[i + 1]; ++k)
+			{
+				//a degenerate triangle may appear several times (its contributions are all handled at once)
+				if (k != adjacency->offsets[i] && adjacency->triangles[k] == adjacency->triangles[k - 1])
+					continue;
+
+				const CCLib::VerticesIndexes& tri = m_triVertIndexes->getValue(adjacency->triangles[k]);
 
-			const CCVector3* A = m_associatedCloud->getPoint(tri->i1);
-			const CCVector3* B = m_associatedCloud->getPoint(tri->i2);
-			const CCVector3* C = m_associatedCloud->getPoint(tri->i3);
+				const CCVector3* A = m_associatedCloud->getPoint(tri.i1);
+				const CCVector3* B = m_associatedCloud->getPoint(tri.i2);
+				const CCVector3* C = m_associatedCloud->getPoint(tri.i3);
 
-			CCVector3 dAB = (*B-*A);
-			CCVector3 dAC = (*C-*A);
-			CCVector3 dBC = (*C-*B);
+				CCVector3 dAB = (*B-*A);
+				CCVector3 dAC = (*C-*A);
+				CCVector3 dBC = (*C-*B);
 
-			verticesDisplacement[tri->i1] += dAB + dAC;
-			verticesDisplacement[tri->i2] += dBC - dAB;
-			verticesDisplacement[tri->i3] -= dAC + dBC;
+				if (tri.i1 == static_cast<unsigned>(i))
+					D += dAB + dAC;
+				if (tri.i2 == static_cast<unsigned>(i))
+					D += dBC - dAB;
+				if (tri.i3 == static_cast<unsigned>(i))
+					D -= dAC + dBC;
+			}
+			verticesDisplacement[i] = D;
 		}
 
 		if (!nProgress.oneStep())
@@ -633,13 +695,17 @@ bool ccMesh::laplacianSmooth(	unsigned nbIteration,
 		}
 
 		//apply displacement
-		for (unsigned i = 0; i < vertCount; i++)
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < static_cast<int>(vertCount); ++i)
 		{
-			if (edgesCount[i])
+			unsigned edgesCount = 2 * adjacency->degree(i);
+			if (edgesCount)
 			{
 				//this is a "persistent" pointer and we know what type of cloud is behind ;)
 				CCVector3* P = const_cast<CCVector3*>(m_associatedCloud->getPointPersistentPtr(i));
-				(*P) += verticesDisplacement[i] * (factor / edgesCount[i]);
+				(*P) += verticesDisplacement[i] * (factor / edgesCount);
 			}
 		}
 	}
@@ -1577,6 +1643,7 @@ const ccGLMatrix& ccMesh::getGLTransformationHistory() const
 void ccMesh::addTriangle(unsigned i1, unsigned i2, unsigned i3)
 {
 	m_triVertIndexes->emplace_back(CCLib::VerticesIndexes(i1, i2, i3));
+	m_vertexAdjacencyIsValid = false;
 	notifyGeometryUpdate();	// call releaseVBOs
 }
 
@@ -1600,6 +1667,7 @@ bool ccMesh::reserve(size_t n)
 bool ccMesh::resize(size_t n)
 {
 	m_bBox.setValidity(false);
+	invalidateVertexAdjacency();
 	notifyGeometryUpdate();	// call releaseVBOs
 
 	if (m_triMtlIndexes)
@@ -1631,6 +1699,7 @@ void ccMesh::swapTriangles(unsigned index1, unsigned index2)
 	assert(std::max(index1, index2) < size());
 
 	m_triVertIndexes->swap(index1, index2);
+	m_vertexAdjacencyIsValid = false;
 	if (m_triMtlIndexes)
 		m_triMtlIndexes->swap(index1, index2);
 	if (m_texCoordIndexes)
@@ -2588,6 +2657,8 @@ ccMesh* ccMesh::createNewMeshFromSelection(bool removeSelectedFaces)
 
 void ccMesh::shiftTriangleIndexes(unsigned shift)
 {
+	invalidateVertexAdjacency();
+
 	for (CCLib::VerticesIndexes& ti : *m_triVertIndexes)
 	{
 		ti.i1 += shift;
@@ -3018,6 +3089,7 @@ bool ccMesh::fromFile_MeOnly(QFile& in, short dataVersion, int flags)
 	//triangles indexes (dataVersion>=20)
 	if (!m_triVertIndexes)
 		return false;
+	invalidateVertexAdjacency();
 	if (!ccSerializationHelper::GenericArrayFromFile<CCLib::VerticesIndexes, 3, unsigned>(*m_triVertIndexes, in, dataVersion))
 		return false;
 
@@ -25,6 +25,9 @@
 //Local
 #include "ccGenericMesh.h"
 
+//System
+#include <vector>
+
 class ccProgressDialog;
 class ccPolyline;
 
@@ -335,6 +338,30 @@ public:
 	//! Computes per-triangle normals
 	bool computePerTriangleNormals();
 
+	//! Vertex-to-triangle adjacency (CSR - 'Compressed Sparse Row' - format)
+	struct VertexAdjacency
+	{
+		//! Position of the first incident triangle of each vertex in 'triangles' (vertex count + 1 values)
+		std::vector<unsigned> offsets;
+		//! Incident triangles (sorted by vertex, then by increasing triangle index)
+		std::vector<unsigned> triangles;
+
+		//! Returns the number of incident triangles of a given vertex
+		inline unsigned degree(unsigned vertexIndex) const { return offsets[vertexIndex + 1] - offsets[vertexIndex]; }
+	};
+
+	//! Returns the vertex-to-triangle adjacency
+	/** The structure is computed on the first call, then cached. It is automatically
+		invalidated when triangles are added, removed or swapped. If the triangles
+		vertex indexes are modified directly (see getTriangleVertIndexes), one should
+		call invalidateVertexAdjacency.
+		\return adjacency structure (or nullptr if not enough memory)
+	**/
+	const VertexAdjacency* getVertexAdjacency();
+
+	//! Releases the cached vertex-to-triangle adjacency (see getVertexAdjacency)
+	void invalidateVertexAdjacency();
+
 	//! Laplacian smoothing
 	/** \param nbIteration smoothing iterations
 		\param factor smoothing 'force'
@@ -469,6 +496,11 @@ protected: //members
 	using triangleNormalsIndexesSet = ccArray<Tuple3i, 3, int>;
 	//! Mesh normals indexes (per-triangle)
 	triangleNormalsIndexesSet* m_triNormalIndexes;
+
+	//! Cached vertex-to-triangle adjacency (see getVertexAdjacency)
+	VertexAdjacency m_vertexAdjacency;
+	//! Whether the cached vertex-to-triangle adjacency is up-to-date
+	bool m_vertexAdjacencyIsValid;
 };
 
 #endif //CC_MESH_HEADER
@@ -25,6 +25,9 @@
 #include <QSharedPointer>
 #include <QVariant>
 
+//system
+#include <atomic>
+
 
 //! Object state flag
 enum CC_OBJECT_FLAG {	//CC_UNUSED			= 1, //DGM: not used anymore (former CC_FATHER_DEPENDENT)
@@ -165,6 +168,8 @@ namespace CC_TYPES
 }
 
 //! Unique ID generator (should be unique for the whole application instance - with plugins, etc.)
+/** Thread-safe (entities may be created by worker threads).
+**/
 class QCC_DB_LIB_API ccUniqueIDGenerator
 {
 public:
@@ -182,10 +187,14 @@ public:
 	//! Returns the value of the last generated unique ID
 	unsigned getLast() const { return m_lastUniqueID; }
 	//! Updates the value of the last generated unique ID with the current one
-	void update(unsigned ID) { if (ID > m_lastUniqueID) m_lastUniqueID = ID; }
+	void update(unsigned ID)
+	{
+		unsigned last = m_lastUniqueID;
+		while (ID > last && !m_lastUniqueID.compare_exchange_weak(last, ID)) {}
+	}
 
 protected:
-	unsigned m_lastUniqueID;
+	std::atomic<unsigned> m_lastUniqueID;
 };
 
 //! Generic "CloudCompare Object" template
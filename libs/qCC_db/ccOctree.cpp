@@ -501,10 +501,33 @@ bool ccOctree::intersectWithFrustum(ccCameraSensor* sensor, std::vector<unsigned
 	std::vector< std::pair<unsigned, CCVector3> > pointsToTest;
 	m_frustumIntersector->computeFrustumIntersectionWithOctree(pointsToTest, inCameraFrustum, globalPlaneCoefficients, globalCorners, globalEdges, globalCenter);
 	
-	// project points
+	// project points (the sensor transformation is only computed once)
+	ccGLMatrix globalToLocal;
+	if (!sensor->getGlobalToLocalTransformation(globalToLocal))
+		return false;
+
+	std::vector<unsigned char> inFrustum;
+	try
+	{
+		inFrustum.resize(pointsToTest.size(), 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[ccOctree::intersectWithFrustum] Not enough memory!");
+		return false;
+	}
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int i = 0; i < static_cast<int>(pointsToTest.size()); i++)
+	{
+		inFrustum[i] = (sensor->isLocalCoordInFrustum(globalToLocal * pointsToTest[i].second) ? 1 : 0);
+	}
+
 	for (size_t i = 0; i < pointsToTest.size(); i++)
 	{
-		if (sensor->isGlobalCoordInFrustum(pointsToTest[i].second/*, false*/))
+		if (inFrustum[i])
 			inCameraFrustum.push_back(pointsToTest[i].first);
 	}
 
@@ -23,6 +23,7 @@
 //CCLib
 #include <GeometricalAnalysisTools.h>
 #include <ManualSegmentationTools.h>
+#include <PreparedPolygon.h>
 #include <ReferenceCloud.h>
 #include "ccPlane.h"
 #include "ccHObjectCaster.h"
@@ -45,6 +46,7 @@
 #include "ccNormalVectors.h"
 #include "ccOctree.h"
 #include "ccPointCloudLOD.h"
+#include "ccPointCloudVBOStager.h"
 #include "ccPolyline.h"
 #include "ccProgressDialog.h"
 #include "ccScalarField.h"
@@ -53,6 +55,8 @@
 #include <QCoreApplication>
 #include <QElapsedTimer>
 #include <QSharedPointer>
+#include <QTimer>
+#include <QWidget>
 
 //system
 #include <cassert>
@@ -68,6 +72,7 @@ ccPointCloud::ccPointCloud(QString name) throw()
 	, m_currentDisplayedScalarField(nullptr)
 	, m_currentDisplayedScalarFieldIndex(-1)
 	, m_visibilityCheckEnabled(false)
+	, m_vboStager(nullptr)
 	, m_lod(nullptr)
 	, m_fwfData(nullptr)
 {
@@ -434,6 +439,12 @@ ccPointCloud::~ccPointCloud()
 {
 	clear();
 
+	if (m_vboStager)
+	{
+		delete m_vboStager;
+		m_vboStager = nullptr;
+	}
+
 	if (m_lod)
 	{
 		delete m_lod;
@@ -451,6 +462,7 @@ void ccPointCloud::clear()
 
 void ccPointCloud::unallocatePoints()
 {
+	cancelVBOStaging();
 	clearLOD();	// we have to clear the LOD structure before clearing the colors / SFs, so we can't leave it to notifyGeometryUpdate()
 	showSFColorsScale(false); //SFs will be destroyed
 	BaseClass::reset();
@@ -1070,6 +1082,7 @@ void ccPointCloud::unallocateNorms()
 {
 	if (m_normals)
 	{
+		cancelVBOStaging();
 		m_normals->release();
 		m_normals = nullptr;
 
@@ -1084,6 +1097,7 @@ void ccPointCloud::unallocateColors()
 {
 	if (m_rgbColors)
 	{
+		cancelVBOStaging();
 		m_rgbColors->release();
 		m_rgbColors = nullptr;
 
@@ -1119,6 +1133,9 @@ bool ccPointCloud::reserveThePointsTable(unsigned newNumberOfPoints)
 
 bool ccPointCloud::reserveTheRGBTable()
 {
+	//the VBOs staging buffers may be filled in the background
+	cancelVBOStaging();
+
 	if (m_points.capacity() == 0)
 	{
 		ccLog::Warning("[ccPointCloud] Calling reserveTheRGBTable with an zero capacity cloud");
@@ -1146,6 +1163,9 @@ bool ccPointCloud::reserveTheRGBTable()
 
 bool ccPointCloud::resizeTheRGBTable(bool fillWithWhite/*=false*/)
 {
+	//the VBOs staging buffers may be filled in the background
+	cancelVBOStaging();
+
 	if (m_points.empty())
 	{
 		ccLog::Warning("[ccPointCloud] Calling resizeTheRGBTable with an empty cloud");
@@ -1174,6 +1194,9 @@ bool ccPointCloud::resizeTheRGBTable(bool fillWithWhite/*=false*/)
 
 bool ccPointCloud::reserveTheNormsTable()
 {
+	//the VBOs staging buffers may be filled in the background
+	cancelVBOStaging();
+
 	if (m_points.capacity() == 0)
 	{
 		ccLog::Warning("[ccPointCloud] Calling reserveTheNormsTable with an zero capacity cloud");
@@ -1202,6 +1225,9 @@ bool ccPointCloud::reserveTheNormsTable()
 
 bool ccPointCloud::resizeTheNormsTable()
 {
+	//the VBOs staging buffers may be filled in the background
+	cancelVBOStaging();
+
 	if (m_points.empty())
 	{
 		ccLog::Warning("[ccPointCloud] Calling resizeTheNormsTable with an empty cloud");
@@ -1389,6 +1415,9 @@ bool ccPointCloud::reserve(unsigned newNumberOfPoints)
 	if (newNumberOfPoints < size())
 		return false;
 
+	//the VBOs staging buffers may be filled in the background
+	cancelVBOStaging();
+
 	//call parent method first (for points + scalar fields)
 	if (	!BaseClass::reserve(newNumberOfPoints)
 		||	(hasColors() && !reserveTheRGBTable())
@@ -1414,6 +1443,9 @@ bool ccPointCloud::resize(unsigned newNumberOfPoints)
 	if (newNumberOfPoints < size() && isLocked())
 		return false;
 
+	//the VBOs staging buffers may be filled in the background
+	cancelVBOStaging();
+
 	//call parent method first (for points + scalar fields)
 	if (!BaseClass::resize(newNumberOfPoints))
 	{
@@ -1544,9 +1576,19 @@ void ccPointCloud::invalidateBoundingBox()
 	notifyGeometryUpdate();	//calls releaseVBOs()
 }
 
+void ccPointCloud::addPoint(const CCVector3& P)
+{
+	//the points table may be reallocated
+	cancelVBOStaging();
+
+	BaseClass::addPoint(P);
+}
+
 void ccPointCloud::addRGBColor(const ccColor::Rgb& C)
 {
 	assert(m_rgbColors && m_rgbColors->isAllocated());
+	//the colors table may be reallocated
+	cancelVBOStaging();
 	m_rgbColors->emplace_back(C);
 
 	//We must update the VBOs
@@ -1561,6 +1603,8 @@ void ccPointCloud::addNorm(const CCVector3& N)
 void ccPointCloud::addNormIndex(CompressedNormType index)
 {
 	assert(m_normals && m_normals->isAllocated());
+	//the normals table may be reallocated
+	cancelVBOStaging();
 	m_normals->addElement(index);
 }
 
@@ -2178,7 +2222,8 @@ void ccPointCloud::glChunkVertexPointer(const CC_DRAW_CONTEXT& context, size_t c
 		&&	m_vboManager.state == vboSet::INITIALIZED
 		&&	m_vboManager.vbos.size() > static_cast<size_t>(chunkIndex)
 		&& m_vboManager.vbos[chunkIndex]
-		&& m_vboManager.vbos[chunkIndex]->isCreated())
+		&& m_vboManager.vbos[chunkIndex]->isCreated()
+		&&	isChunkVBOUpToDate(chunkIndex))
 	{
 		//we can use VBOs directly
 		if (m_vboManager.vbos[chunkIndex]->bind())
@@ -2227,7 +2272,8 @@ void ccPointCloud::glChunkNormalPointer(const CC_DRAW_CONTEXT& context, size_t c
 		&&	m_vboManager.hasNormals
 		&&	m_vboManager.vbos.size() > static_cast<size_t>(chunkIndex)
 		&&	m_vboManager.vbos[chunkIndex]
-		&&	m_vboManager.vbos[chunkIndex]->isCreated())
+		&&	m_vboManager.vbos[chunkIndex]->isCreated()
+		&&	isChunkVBOUpToDate(chunkIndex))
 	{
 		//we can use VBOs directly
 		if (m_vboManager.vbos[chunkIndex]->bind())
@@ -2284,7 +2330,8 @@ void ccPointCloud::glChunkColorPointer(const CC_DRAW_CONTEXT& context, size_t ch
 		&&	m_vboManager.hasColors
 		&&	m_vboManager.vbos.size() > static_cast<size_t>(chunkIndex)
 		&& m_vboManager.vbos[chunkIndex]
-		&& m_vboManager.vbos[chunkIndex]->isCreated())
+		&& m_vboManager.vbos[chunkIndex]->isCreated()
+		&&	isChunkVBOUpToDate(chunkIndex))
 	{
 		//we can use VBOs directly
 		if (m_vboManager.vbos[chunkIndex]->bind())
@@ -2327,7 +2374,8 @@ void ccPointCloud::glChunkSFPointer(const CC_DRAW_CONTEXT& context, size_t chunk
 		&&	m_vboManager.hasColors
 		&&	m_vboManager.vbos.size() > static_cast<size_t>(chunkIndex)
 		&&	m_vboManager.vbos[chunkIndex]
-		&&	m_vboManager.vbos[chunkIndex]->isCreated())
+		&&	m_vboManager.vbos[chunkIndex]->isCreated()
+		&&	isChunkVBOUpToDate(chunkIndex))
 	{
 		assert(m_vboManager.colorIsSF && m_vboManager.sourceSF == m_currentDisplayedScalarField);
 		//we can use VBOs directly
@@ -2352,14 +2400,22 @@ void ccPointCloud::glChunkSFPointer(const CC_DRAW_CONTEXT& context, size_t chunk
 		ScalarType* _sf = ccChunk::Start(*m_currentDisplayedScalarField, chunkIndex);
 		ColorCompType* _sfColors = s_rgbBuffer3ub;
 		size_t chunkSize = ccChunk::Size(chunkIndex, m_currentDisplayedScalarField->size());
-		for (size_t j = 0; j < chunkSize; j += decimStep, _sf += decimStep)
+		if (decimStep == 1)
+		{
+			//convert all the scalar values at once
+			m_currentDisplayedScalarField->getColors(_sf, chunkSize, reinterpret_cast<ccColor::Rgb*>(_sfColors), ccColor::lightGrey);
+		}
+		else
 		{
-			//convert the scalar value to a RGB color
-			const ccColor::Rgb* col = m_currentDisplayedScalarField->getColor(*_sf);
-			assert(col);
-			*_sfColors++ = col->r;
-			*_sfColors++ = col->g;
-			*_sfColors++ = col->b;
+			for (size_t j = 0; j < chunkSize; j += decimStep, _sf += decimStep)
+			{
+				//convert the scalar value to a RGB color
+				const ccColor::Rgb* col = m_currentDisplayedScalarField->getColor(*_sf);
+				assert(col);
+				*_sfColors++ = col->r;
+				*_sfColors++ = col->g;
+				*_sfColors++ = col->b;
+			}
 		}
 		glFunc->glColorPointer(3, GL_UNSIGNED_BYTE, 0, s_rgbBuffer3ub);
 	}
@@ -3384,6 +3440,9 @@ void ccPointCloud::setCurrentDisplayedScalarField(int index)
 
 void ccPointCloud::deleteScalarField(int index)
 {
+	//the VBOs staging buffers may be filled in the background
+	cancelVBOStaging();
+
 	//we 'store' the currently displayed SF, as the SF order may be mixed up
 	setCurrentInScalarField(m_currentDisplayedScalarFieldIndex);
 
@@ -3400,6 +3459,9 @@ void ccPointCloud::deleteScalarField(int index)
 
 void ccPointCloud::deleteAllScalarFields()
 {
+	//the VBOs staging buffers may be filled in the background
+	cancelVBOStaging();
+
 	//the father does all the work
 	BaseClass::deleteAllScalarFields();
 
@@ -3424,10 +3486,9 @@ bool ccPointCloud::setRGBColorWithCurrentScalarField(bool mixWithExistingColor/*
 			if (!resizeTheRGBTable(false))
 				return false;
 
-		for (unsigned i = 0; i < count; i++)
+		if (count)
 		{
-			const ccColor::Rgb* col = getPointScalarValueColor(i);
-			m_rgbColors->setValue(i, col ? *col : ccColor::black);
+			m_currentDisplayedScalarField->getColors(m_currentDisplayedScalarField->data(), count, m_rgbColors->data(), ccColor::black);
 		}
 	}
 	else
@@ -4702,12 +4763,38 @@ CCLib::ReferenceCloud* ccPointCloud::crop2D(const ccPolyline* poly, unsigned cha
 	unsigned char X = ((orthoDim+1) % 3);
 	unsigned char Y = ((X+1) % 3);
 
-	for (unsigned i=0; i<count; ++i)
+	//the polygon edges are indexed once
+	CCLib::PreparedPolygon preparedPoly;
+	std::vector<unsigned char> insideFlags;
+	try
 	{
-		const CCVector3* P = point(i);
+		insideFlags.resize(count);
+	}
+	catch (const std::bad_alloc&)
+	{
+		insideFlags.clear();
+	}
+	if (insideFlags.empty() || !preparedPoly.init(poly))
+	{
+		ccLog::Warning("[ccPointCloud::crop] Not enough memory!");
+		delete ref;
+		return nullptr;
+	}
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int i = 0; i < static_cast<int>(count); ++i)
+	{
+		const CCVector3* P = point(static_cast<unsigned>(i));
 
 		CCVector2 P2D( P->u[X], P->u[Y] );
-		bool pointIsInside = CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, poly);
+		insideFlags[i] = preparedPoly.isInside(P2D) ? 1 : 0;
+	}
+
+	for (unsigned i=0; i<count; ++i)
+	{
+		bool pointIsInside = (insideFlags[i] != 0);
 		if (inside == pointIsInside)
 		{
 			ref->addPointIndex(i);
@@ -4766,6 +4853,24 @@ static bool CatchGLErrors(GLenum err, const char* context)
 //DGM: normals are so slow that it's a waste of memory and time to load them in VBOs!
 #define DONT_LOAD_NORMALS_IN_VBOS
 
+//! Min. number of chunks above which the VBOs are updated in the background
+static const size_t s_asyncVBOMinChunkCount = 16; //~1M. points
+//! Max. time spent uploading the staged VBOs at each display (in ms)
+static const qint64 s_asyncVBOUploadTimeBudget_ms = 10;
+//! Delay before the next display when some VBOs are still being staged (in ms)
+static const int s_asyncVBORefreshDelay_ms = 20;
+
+//! Returns the size of a VBO (see VBO::init)
+static int VBOSizeBytes(int count, bool withColors, bool withNormals)
+{
+	int totalSizeBytes = sizeof(PointCoordinateType) * count * 3;
+	if (withColors)
+		totalSizeBytes += sizeof(ColorCompType) * count * 3;
+	if (withNormals)
+		totalSizeBytes += sizeof(PointCoordinateType) * count * 3;
+	return totalSizeBytes;
+}
+
 bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams)
 {
 	if (isColorOverriden())
@@ -4811,7 +4916,7 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 		}
 #endif
 		//nothing to do?
-		if (m_vboManager.updateFlags == 0)
+		if (m_vboManager.updateFlags == 0 && m_vboPendingFlags.empty())
 		{
 			return true;
 		}
@@ -4849,6 +4954,19 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 		}
 	}
 
+	//large clouds: the VBOs are updated in the background
+	if (chunksCount >= s_asyncVBOMinChunkCount)
+	{
+		return updateVBOsAsync(context, glParams);
+	}
+	else if (!m_vboPendingFlags.empty())
+	{
+		//the cloud has been reduced in the meantime
+		cancelVBOStaging();
+		m_vboPendingFlags.clear();
+		m_vboManager.updateFlags = vboSet::UPDATE_ALL;
+	}
+
 	//init VBOs
 	unsigned pointsInVBOs = 0;
 	int totalSizeBytesBefore = m_vboManager.totalMemSizeBytes;
@@ -4916,18 +5034,11 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 						//copy SF colors in static array
 						{
 							assert(m_vboManager.sourceSF);
-							ColorCompType* _sfColors = s_rgbBuffer3ub;
-							ScalarType* _sf = ccChunk::Start(*m_vboManager.sourceSF, i);
-							for (int j = 0; j < chunkSize; j++, _sf++)
-							{
-								//we need to convert scalar value to color into a temporary structure
-								const ccColor::Rgb* col = m_vboManager.sourceSF->getColor(*_sf);
-								if (!col)
-									col = &ccColor::lightGrey;
-								*_sfColors++ = col->r;
-								*_sfColors++ = col->g;
-								*_sfColors++ = col->b;
-							}
+							static_assert(sizeof(ccColor::Rgb) == 3 * sizeof(ColorCompType), "Unexpected color structure size");
+							m_vboManager.sourceSF->getColors(	ccChunk::Start(*m_vboManager.sourceSF, i),
+																chunkSize,
+																reinterpret_cast<ccColor::Rgb*>(s_rgbBuffer3ub),
+																ccColor::lightGrey);
 						}
 						//then send them in VRAM
 						m_vboManager.vbos[i]->write(m_vboManager.vbos[i]->rgbShift, s_rgbBuffer3ub, sizeof(ColorCompType)*chunkSize * 3);
@@ -5018,6 +5129,255 @@ bool ccPointCloud::updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams
 	return true;
 }
 
+bool ccPointCloud::updateVBOsAsync(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams)
+{
+	size_t chunksCount = m_vboManager.vbos.size();
+
+	if (!m_vboStager)
+	{
+		m_vboStager = new ccPointCloudVBOStager;
+	}
+
+	QOpenGLFunctions_2_1* glFunc = context.glFunctions<QOpenGLFunctions_2_1>();
+	assert(glFunc != nullptr);
+
+	//releases the VBOs that are not up-to-date (the corresponding chunks will be displayed the standard way)
+	auto releasePendingVBOs = [&]()
+	{
+		for (size_t i = 0; i < m_vboPendingFlags.size(); ++i)
+		{
+			VBO*& vbo = m_vboManager.vbos[i];
+			if (m_vboPendingFlags[i] != 0 && vbo)
+			{
+				if (vbo->isCreated())
+				{
+					m_vboManager.totalMemSizeBytes -= VBOSizeBytes(static_cast<int>(ccChunk::Size(i, m_points)), m_vboManager.hasColors, m_vboManager.hasNormals);
+				}
+				vbo->destroy();
+				delete vbo;
+				vbo = nullptr;
+			}
+		}
+		m_vboPendingFlags.clear();
+	};
+
+	//new update request
+	if (m_vboManager.updateFlags != 0)
+	{
+		try
+		{
+			m_vboPendingFlags.resize(chunksCount, 0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning(QString("[ccPointCloud::updateVBOs] Not enough memory! (cloud '%1')").arg(getName()));
+			releaseVBOs();
+			m_vboManager.state = vboSet::FAILED;
+			return false;
+		}
+
+		assert(!glParams.showSF		|| m_currentDisplayedScalarField);
+		assert(!glParams.showColors	|| m_rgbColors);
+
+		bool hasColors = glParams.showSF || glParams.showColors;
+#ifndef DONT_LOAD_NORMALS_IN_VBOS
+		bool hasNormals = glParams.showNorms;
+#else
+		bool hasNormals = false;
+#endif
+
+		//if the VBOs layout changes, their content will be lost: we'd better
+		//display the chunks the standard way until they are uploaded again
+		bool previousHasColors = m_vboManager.hasColors;
+		bool previousHasNormals = m_vboManager.hasNormals;
+		bool layoutChanged = (previousHasColors != hasColors || previousHasNormals != hasNormals);
+
+		m_vboManager.hasColors  = hasColors;
+		m_vboManager.colorIsSF  = glParams.showSF;
+		m_vboManager.sourceSF   = glParams.showSF ? m_currentDisplayedScalarField : nullptr;
+		m_vboManager.hasNormals = hasNormals;
+
+		//only stage what is actually displayed
+		int mask = vboSet::UPDATE_POINTS;
+		if (hasColors)
+			mask |= vboSet::UPDATE_COLORS;
+		if (hasNormals)
+			mask |= vboSet::UPDATE_NORMALS;
+
+		for (size_t i = 0; i < chunksCount; ++i)
+		{
+			VBO*& vbo = m_vboManager.vbos[i];
+			if (vbo && layoutChanged)
+			{
+				if (vbo->isCreated())
+				{
+					m_vboManager.totalMemSizeBytes -= VBOSizeBytes(static_cast<int>(ccChunk::Size(i, m_points)), previousHasColors, previousHasNormals);
+				}
+				vbo->destroy();
+				delete vbo;
+				vbo = nullptr;
+			}
+
+			m_vboPendingFlags[i] = ((vbo ? m_vboPendingFlags[i] | m_vboManager.updateFlags : vboSet::UPDATE_ALL) & mask);
+		}
+
+		m_vboStager->cancel();
+		m_vboManager.updateFlags = 0;
+		m_vboManager.state = vboSet::INITIALIZED;
+
+		if (glParams.showSF)
+		{
+			//the VBOs will be up-to-date with the current SF values
+			m_currentDisplayedScalarField->setModificationFlag(false);
+		}
+	}
+
+	//(re)start the staging process if necessary
+	if (!m_vboPendingFlags.empty() && !m_vboStager->isActive())
+	{
+		if (!ccPointCloudVBOStager::HasPendingUpdates(m_vboPendingFlags))
+		{
+			//we are done
+			m_vboPendingFlags.clear();
+		}
+		else if (m_vboStager->hasFailed())
+		{
+			//not enough memory: the remaining chunks will be displayed the standard way
+			ccLog::Warning(QString("[ccPointCloud::updateVBOs] Not enough memory to stage all VBOs (cloud '%1')").arg(getName()));
+			releasePendingVBOs();
+		}
+		else if (!m_vboStager->start(*this, m_vboPendingFlags, m_vboManager.sourceSF))
+		{
+			ccLog::Warning(QString("[ccPointCloud::updateVBOs] Not enough memory! (cloud '%1')").arg(getName()));
+			releaseVBOs();
+			m_vboManager.state = vboSet::FAILED;
+			return false;
+		}
+	}
+
+	//data stored in the VBOs
+	int layoutFlags = vboSet::UPDATE_POINTS;
+	if (m_vboManager.hasColors)
+		layoutFlags |= vboSet::UPDATE_COLORS;
+	if (m_vboManager.hasNormals)
+		layoutFlags |= vboSet::UPDATE_NORMALS;
+
+	//upload the staged chunks (for a limited time, so that the display remains responsive)
+	QElapsedTimer timer;
+	timer.start();
+	ccPointCloudVBOStager::Chunk chunk;
+	while (m_vboStager->takeChunk(chunk))
+	{
+		size_t i = chunk.index;
+		assert(i < chunksCount);
+
+		VBO*& vbo = m_vboManager.vbos[i];
+		if (!vbo)
+		{
+			vbo = new VBO;
+		}
+
+		bool wasCreated = vbo->isCreated();
+		int previousSizeBytes = 0;
+		if (wasCreated && vbo->bind())
+		{
+			previousSizeBytes = std::max(0, vbo->size());
+			vbo->release();
+		}
+		bool reallocated = false;
+		int vboSizeBytes = vbo->init(static_cast<int>(chunk.count), m_vboManager.hasColors, m_vboManager.hasNormals, false, &reallocated);
+		if (vboSizeBytes > 0)
+		{
+			if (reallocated && wasCreated && chunk.updateFlags != layoutFlags)
+			{
+				//the VBO content has been cleared but we only have some of the data:
+				//the chunk will be staged again (entirely)
+				vbo->destroy();
+				delete vbo;
+				vbo = nullptr;
+				m_vboManager.totalMemSizeBytes -= previousSizeBytes;
+				m_vboPendingFlags[i] = layoutFlags;
+				continue;
+			}
+
+			vbo->bind();
+			if (chunk.updateFlags & vboSet::UPDATE_POINTS)
+			{
+				vbo->write(0, chunk.points.data(), static_cast<int>(sizeof(PointCoordinateType) * chunk.points.size()));
+			}
+			if (chunk.updateFlags & vboSet::UPDATE_COLORS)
+			{
+				vbo->write(vbo->rgbShift, chunk.colors.data(), static_cast<int>(sizeof(ccColor::Rgb) * chunk.colors.size()));
+			}
+			if (chunk.updateFlags & vboSet::UPDATE_NORMALS)
+			{
+				vbo->write(vbo->normalShift, chunk.normals.data(), static_cast<int>(sizeof(PointCoordinateType) * chunk.normals.size()));
+			}
+			vbo->release();
+
+			if (CatchGLErrors(glFunc->glGetError(), "ccPointCloud::updateVBOsAsync"))
+			{
+				vboSizeBytes = -1;
+			}
+		}
+
+		if (vboSizeBytes < 0)
+		{
+			//VBO initialization failed: we stop here (the remaining chunks will be displayed the standard way)
+			vbo->destroy();
+			delete vbo;
+			vbo = nullptr;
+			m_vboManager.totalMemSizeBytes -= previousSizeBytes;
+			m_vboStager->cancel();
+			m_vboPendingFlags[i] = layoutFlags;
+			releasePendingVBOs();
+
+			bool noVBO = true;
+			for (VBO* v : m_vboManager.vbos)
+			{
+				if (v)
+				{
+					noVBO = false;
+					break;
+				}
+			}
+			if (noVBO)
+			{
+				ccLog::Warning(QString("[ccPointCloud::updateVBOs] Failed to initialize VBOs (not enough memory?) (cloud '%1')").arg(getName()));
+				m_vboManager.state = vboSet::FAILED;
+				m_vboManager.vbos.resize(0);
+				return false;
+			}
+			break;
+		}
+
+		m_vboManager.totalMemSizeBytes += vboSizeBytes - previousSizeBytes;
+		ccPointCloudVBOStager::ChunkUploaded(m_vboPendingFlags, chunk);
+
+		if (timer.elapsed() >= s_asyncVBOUploadTimeBudget_ms)
+		{
+			break;
+		}
+	}
+
+	if (!m_vboPendingFlags.empty() && m_currentDisplay)
+	{
+		//the display should be refreshed until all the chunks are uploaded
+		QWidget* widget = m_currentDisplay->asWidget();
+		if (widget)
+		{
+			ccGenericGLDisplay* display = m_currentDisplay;
+			QTimer::singleShot(s_asyncVBORefreshDelay_ms, widget, [display]() { display->redraw(false, false); });
+		}
+		else
+		{
+			m_currentDisplay->toBeRefreshed();
+		}
+	}
+
+	return true;
+}
+
 int VBO::init(int count, bool withColors, bool withNormals, bool withTex, bool* reallocated/*=0*/)
 {
 	//required memory
@@ -5080,8 +5440,20 @@ int VBO::init(int count, bool withColors, bool withNormals, bool withTex, bool*
 	return totalSizeBytes;
 }
 
+void ccPointCloud::cancelVBOStaging()
+{
+	//the pending updates will be staged again (see updateVBOsAsync)
+	if (m_vboStager)
+	{
+		m_vboStager->cancel();
+	}
+}
+
 void ccPointCloud::releaseVBOs()
 {
+	cancelVBOStaging();
+	m_vboPendingFlags.clear();
+
 	if (m_vboManager.state == vboSet::NEW)
 		return;
 
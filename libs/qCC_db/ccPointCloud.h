@@ -40,6 +40,7 @@ class ccMesh;
 class QGLBuffer;
 class ccProgressDialog;
 class ccPointCloudLOD;
+class ccPointCloudVBOStager;
 
 class VBO : public QGLBuffer
 {
@@ -563,6 +564,12 @@ public: //other methods
 	**/
 	void setPointNormal(unsigned pointIndex, const CCVector3& N);
 
+	//! Adds a 3D point (see CCLib::PointCloudTpl::addPoint)
+	/** Cancels the VBOs staging process first (the points table may be reallocated).
+		\param P a 3D point
+	**/
+	void addPoint(const CCVector3& P);
+
 	//! Pushes a compressed normal vector
 	/** \param index compressed normal vector
 	**/
@@ -816,13 +823,37 @@ protected: // VBO
 	//! Init/updates VBOs
 	bool updateVBOs(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams);
 
+	//! Init/updates VBOs asynchronously (for large clouds)
+	/** The VBOs staging buffers are filled by a worker thread (see ccPointCloudVBOStager)
+		and the staged chunks are uploaded progressively (at each call). The chunks that
+		have no VBO yet, or whose VBO is not up-to-date, are displayed the standard way
+		in the meantime (see isChunkVBOUpToDate).
+	**/
+	bool updateVBOsAsync(const CC_DRAW_CONTEXT& context, const glDrawParams& glParams);
+
 	//! Release VBOs
 	void releaseVBOs();
 
+	//! Cancels the VBOs staging process (if any)
+	/** Must be called before any modification of the cloud structure.
+	**/
+	void cancelVBOStaging();
 
 	//! Set of VBOs attached to this cloud
 	vboSet m_vboManager;
 
+	//! VBOs staging (for asynchronous updates)
+	ccPointCloudVBOStager* m_vboStager;
+
+	//! Pending update flags for each VBO (asynchronous updates only)
+	std::vector<int> m_vboPendingFlags;
+
+	//! Returns whether the VBO of a given chunk has no pending update (asynchronous updates only)
+	inline bool isChunkVBOUpToDate(size_t chunkIndex) const
+	{
+		return m_vboPendingFlags.empty() || (chunkIndex < m_vboPendingFlags.size() && m_vboPendingFlags[chunkIndex] == 0);
+	}
+
 	//per-block data transfer to the GPU (VBO or standard mode)
 	void glChunkVertexPointer(const CC_DRAW_CONTEXT& context, size_t chunkIndex, unsigned decimStep, bool useVBOs);
 	void glChunkColorPointer (const CC_DRAW_CONTEXT& context, size_t chunkIndex, unsigned decimStep, bool useVBOs);
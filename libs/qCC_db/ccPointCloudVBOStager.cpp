@@ -0,0 +1,322 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#include "ccPointCloudVBOStager.h"
+
+//Local
+#include "ccChunk.h"
+#include "ccNormalVectors.h"
+#include "ccPointCloud.h"
+#include "ccScalarField.h"
+
+//Qt
+#include <QThread>
+
+//system
+#include <cstring>
+
+//! Worker thread for ccPointCloudVBOStager
+class ccPointCloudVBOStagerThread : public QThread
+{
+public:
+
+	//! Default constructor
+	explicit ccPointCloudVBOStagerThread(ccPointCloudVBOStager& stager)
+		: QThread()
+		, m_stager(stager)
+	{}
+
+protected:
+
+	//reimplemented from QThread
+	void run() override { m_stager.run(); }
+
+	//! Associated stager
+	ccPointCloudVBOStager& m_stager;
+};
+
+ccPointCloudVBOStager::ccPointCloudVBOStager()
+	: m_cloud(nullptr)
+	, m_sourceSF(nullptr)
+	, m_running(false)
+	, m_cancelled(false)
+	, m_failed(false)
+	, m_started(false)
+	, m_thread(nullptr)
+{
+}
+
+ccPointCloudVBOStager::~ccPointCloudVBOStager()
+{
+	cancel();
+
+	delete m_thread;
+	m_thread = nullptr;
+}
+
+bool ccPointCloudVBOStager::start(	const ccPointCloud& cloud,
+									const std::vector<int>& chunkUpdateFlags,
+									const ccScalarField* sourceSF)
+{
+	cancel();
+
+	QMutexLocker locker(&m_mutex);
+
+	try
+	{
+		m_chunkUpdateFlags = chunkUpdateFlags;
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		m_failed = true;
+		return false;
+	}
+
+	m_cloud = &cloud;
+	m_sourceSF = sourceSF;
+	m_running = true;
+	m_cancelled = false;
+	m_failed = false;
+
+	if (!m_thread)
+	{
+		m_thread = new ccPointCloudVBOStagerThread(*this);
+	}
+	m_started = true;
+	m_thread->start();
+
+	return true;
+}
+
+void ccPointCloudVBOStager::cancel()
+{
+	if (!m_thread || !m_started)
+	{
+		return;
+	}
+	m_started = false;
+
+	m_mutex.lock();
+	m_cancelled = true;
+	m_queueNotFull.wakeAll();
+	m_mutex.unlock();
+
+	m_thread->wait();
+
+	m_mutex.lock();
+	m_queue.clear();
+	m_running = false;
+	m_mutex.unlock();
+}
+
+bool ccPointCloudVBOStager::isActive()
+{
+	QMutexLocker locker(&m_mutex);
+	return m_running || !m_queue.empty();
+}
+
+bool ccPointCloudVBOStager::hasFailed()
+{
+	QMutexLocker locker(&m_mutex);
+	return m_failed;
+}
+
+bool ccPointCloudVBOStager::takeChunk(Chunk& chunk)
+{
+	QMutexLocker locker(&m_mutex);
+	if (m_queue.empty())
+	{
+		return false;
+	}
+
+	chunk = std::move(m_queue.front());
+	m_queue.pop_front();
+	m_queueNotFull.wakeAll();
+
+	return true;
+}
+
+bool ccPointCloudVBOStager::waitForChunk(Chunk& chunk)
+{
+	QMutexLocker locker(&m_mutex);
+	while (m_queue.empty() && m_running)
+	{
+		m_queueNotEmpty.wait(&m_mutex);
+	}
+
+	if (m_queue.empty())
+	{
+		return false;
+	}
+
+	chunk = std::move(m_queue.front());
+	m_queue.pop_front();
+	m_queueNotFull.wakeAll();
+
+	return true;
+}
+
+void ccPointCloudVBOStager::run()
+{
+	for (size_t i = 0; i < m_chunkUpdateFlags.size(); ++i)
+	{
+		if (m_chunkUpdateFlags[i] == 0)
+		{
+			//nothing to do for this chunk
+			continue;
+		}
+
+		//wait for some room in the queue
+		m_mutex.lock();
+		while (!m_cancelled && m_queue.size() >= MAX_QUEUED_CHUNKS)
+		{
+			m_queueNotFull.wait(&m_mutex);
+		}
+		bool cancelled = m_cancelled;
+		m_mutex.unlock();
+
+		if (cancelled)
+		{
+			break;
+		}
+
+		Chunk chunk;
+		if (!FillChunk(*m_cloud, i, m_chunkUpdateFlags[i], m_sourceSF, chunk))
+		{
+			//not enough memory
+			m_mutex.lock();
+			m_failed = true;
+			m_mutex.unlock();
+			break;
+		}
+
+		m_mutex.lock();
+		m_queue.push_back(std::move(chunk));
+		m_queueNotEmpty.wakeAll();
+		m_mutex.unlock();
+	}
+
+	m_mutex.lock();
+	m_running = false;
+	m_queueNotEmpty.wakeAll();
+	m_mutex.unlock();
+}
+
+bool ccPointCloudVBOStager::FillChunk(	const ccPointCloud& cloud,
+										size_t chunkIndex,
+										int updateFlags,
+										const ccScalarField* sourceSF,
+										Chunk& chunk)
+{
+	size_t chunkCount = ccChunk::Count(cloud.size());
+	if (chunkIndex >= chunkCount)
+	{
+		assert(false);
+		return false;
+	}
+
+	unsigned firstIndex = static_cast<unsigned>(ccChunk::StartPos(chunkIndex));
+	unsigned count = static_cast<unsigned>(ccChunk::Size(chunkIndex, chunkCount, cloud.size()));
+
+	//we can only stage the colors if they are available
+	if ((updateFlags & vboSet::UPDATE_COLORS) && !sourceSF && !cloud.hasColors())
+	{
+		updateFlags &= (~vboSet::UPDATE_COLORS);
+	}
+	if ((updateFlags & vboSet::UPDATE_NORMALS) && !cloud.hasNormals())
+	{
+		updateFlags &= (~vboSet::UPDATE_NORMALS);
+	}
+
+	chunk.index = chunkIndex;
+	chunk.updateFlags = updateFlags;
+	chunk.count = count;
+
+	try
+	{
+		chunk.points.resize((updateFlags & vboSet::UPDATE_POINTS) ? 3 * count : 0);
+		chunk.colors.resize((updateFlags & vboSet::UPDATE_COLORS) ? count : 0);
+		chunk.normals.resize((updateFlags & vboSet::UPDATE_NORMALS) ? 3 * count : 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		chunk.points.clear();
+		chunk.colors.clear();
+		chunk.normals.clear();
+		return false;
+	}
+
+	//points
+	if (updateFlags & vboSet::UPDATE_POINTS)
+	{
+		memcpy(chunk.points.data(), cloud.getPoint(firstIndex), sizeof(PointCoordinateType) * 3 * count);
+	}
+
+	//colors
+	if (updateFlags & vboSet::UPDATE_COLORS)
+	{
+		if (sourceSF)
+		{
+			assert(sourceSF->size() >= cloud.size());
+			sourceSF->getColors(ccChunk::Start(*sourceSF, chunkIndex), count, chunk.colors.data(), ccColor::lightGrey);
+		}
+		else
+		{
+			memcpy(chunk.colors.data(), ccChunk::Start(*cloud.rgbColors(), chunkIndex), sizeof(ccColor::Rgb) * count);
+		}
+	}
+
+	//normals (we must decode them)
+	if (updateFlags & vboSet::UPDATE_NORMALS)
+	{
+		const CompressedNormType* inNorms = ccChunk::Start(*cloud.normals(), chunkIndex);
+		PointCoordinateType* outNorms = chunk.normals.data();
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int j = 0; j < static_cast<int>(count); ++j)
+		{
+			const CCVector3& N = ccNormalVectors::GetNormal(inNorms[j]);
+			outNorms[3 * j    ] = N.x;
+			outNorms[3 * j + 1] = N.y;
+			outNorms[3 * j + 2] = N.z;
+		}
+	}
+
+	return true;
+}
+
+void ccPointCloudVBOStager::ChunkUploaded(std::vector<int>& pendingFlags, const Chunk& chunk)
+{
+	assert(chunk.index < pendingFlags.size());
+	pendingFlags[chunk.index] = 0;
+}
+
+bool ccPointCloudVBOStager::HasPendingUpdates(const std::vector<int>& pendingFlags)
+{
+	for (int flags : pendingFlags)
+	{
+		if (flags != 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,179 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                    COPYRIGHT: CloudCompare project                     #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_POINT_CLOUD_VBO_STAGER_HEADER
+#define CC_POINT_CLOUD_VBO_STAGER_HEADER
+
+//Local
+#include "ccColorTypes.h"
+
+//CCLib
+#include <CCGeom.h>
+
+//Qt
+#include <QMutex>
+#include <QWaitCondition>
+
+//system
+#include <deque>
+#include <vector>
+
+class ccPointCloud;
+class ccScalarField;
+class ccPointCloudVBOStagerThread;
+
+//! Fills the VBO staging buffers of a point cloud in the background
+/** The buffers (points, colors - either RGB or converted from a scalar field -
+	and decoded normals) are filled chunk by chunk (see ccChunk) by a worker
+	thread. The GL thread only has to take the staged chunks (see takeChunk)
+	and to upload them. No OpenGL context is required by this class.
+
+	The number of staged chunks waiting to be taken is bounded (the worker
+	thread waits when the queue is full).
+
+	Warning: the cloud must not be modified (apart from its values) while
+	the staging is in progress (see cancel).
+**/
+class QCC_DB_LIB_API ccPointCloudVBOStager
+{
+public:
+
+	//! Staged chunk
+	struct Chunk
+	{
+		//! Chunk index
+		size_t index = 0;
+		//! Staged data (see vboSet::UPDATE_FLAGS)
+		int updateFlags = 0;
+		//! Number of points
+		unsigned count = 0;
+		//! Points coordinates (if updateFlags & UPDATE_POINTS)
+		std::vector<PointCoordinateType> points;
+		//! Colors (if updateFlags & UPDATE_COLORS)
+		std::vector<ccColor::Rgb> colors;
+		//! Decoded normals (if updateFlags & UPDATE_NORMALS)
+		std::vector<PointCoordinateType> normals;
+	};
+
+	//! Default constructor
+	ccPointCloudVBOStager();
+
+	//! Destructor
+	/** Cancels the staging process (if any).
+	**/
+	~ccPointCloudVBOStager();
+
+	//! Max number of staged chunks waiting to be taken
+	static const size_t MAX_QUEUED_CHUNKS = 32;
+
+	//! Starts the staging process (asynchronous)
+	/** Any previous staging process is cancelled first.
+		\param cloud point cloud
+		\param chunkUpdateFlags update flags for each chunk (0 = nothing to do)
+		\param sourceSF scalar field from which the colors are computed (or null to use the cloud RGB colors)
+		\return false if not enough memory
+	**/
+	bool start(	const ccPointCloud& cloud,
+				const std::vector<int>& chunkUpdateFlags,
+				const ccScalarField* sourceSF);
+
+	//! Cancels the staging process (and waits for the worker thread to stop)
+	/** The chunks that have not been taken yet are discarded. Cheap if no
+		process has been started since the last call.
+	**/
+	void cancel();
+
+	//! Returns whether the staging process is running or some staged chunks have not been taken yet
+	bool isActive();
+
+	//! Returns whether the last staging process has failed (not enough memory)
+	bool hasFailed();
+
+	//! Takes the next staged chunk (if any)
+	/** Doesn't block.
+		\return whether a chunk was available or not
+	**/
+	bool takeChunk(Chunk& chunk);
+
+	//! Waits for the next staged chunk
+	/** \return false if the staging process is over (and no chunk is available)
+	**/
+	bool waitForChunk(Chunk& chunk);
+
+	//! Fills a chunk staging buffers (synchronously)
+	/** \param cloud point cloud
+		\param chunkIndex chunk index
+		\param updateFlags data to stage (see vboSet::UPDATE_FLAGS)
+		\param sourceSF scalar field from which the colors are computed (or null to use the cloud RGB colors)
+		\param chunk output chunk
+		\return false if not enough memory
+	**/
+	static bool FillChunk(	const ccPointCloud& cloud,
+							size_t chunkIndex,
+							int updateFlags,
+							const ccScalarField* sourceSF,
+							Chunk& chunk);
+
+	//! Clears the pending update flags of a chunk once it has been uploaded
+	/** The staged chunk corresponds to the current pending flags (the staging
+		process is restarted each time new updates are requested).
+		\param pendingFlags pending update flags for each chunk
+		\param chunk uploaded chunk
+	**/
+	static void ChunkUploaded(std::vector<int>& pendingFlags, const Chunk& chunk);
+
+	//! Returns whether some chunks have pending updates
+	static bool HasPendingUpdates(const std::vector<int>& pendingFlags);
+
+protected:
+
+	friend class ccPointCloudVBOStagerThread;
+
+	//! Staging process (called by the worker thread)
+	void run();
+
+	//! Associated cloud
+	const ccPointCloud* m_cloud;
+	//! Source scalar field (if any)
+	const ccScalarField* m_sourceSF;
+	//! Update flags for each chunk
+	std::vector<int> m_chunkUpdateFlags;
+
+	//! Staged chunks (waiting to be taken)
+	std::deque<Chunk> m_queue;
+
+	//! For concurrent access
+	QMutex m_mutex;
+	//! Signaled when a chunk is taken
+	QWaitCondition m_queueNotFull;
+	//! Signaled when a chunk is staged (or when the process ends)
+	QWaitCondition m_queueNotEmpty;
+
+	//! Whether the worker thread is running
+	bool m_running;
+	//! Whether the process has been cancelled
+	bool m_cancelled;
+	//! Whether the process has failed
+	bool m_failed;
+	//! Whether a process has been started since the last cancellation (only accessed by the calling thread)
+	bool m_started;
+
+	//! Worker thread
+	ccPointCloudVBOStagerThread* m_thread;
+};
+
+#endif //CC_POINT_CLOUD_VBO_STAGER_HEADER
@@ -19,6 +19,7 @@
 
 //CCLib
 #include <Delaunay2dMesh.h>
+#include <ReferenceCloud.h>
 
 //qCC_db
 #include "ccGenericPointCloud.h"
@@ -31,8 +32,16 @@
 #include <QMap>
 
 //System
+#include <atomic>
 #include <cassert>
 
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+//minimum number of points to fill the grid in parallel
+static const unsigned s_minPointCountForParallelFill = 1000000;
+
 //default field names
 struct DefaultFieldNames : public QMap<ccRasterGrid::ExportableFields, QString>
 {
@@ -113,7 +122,7 @@ void ccRasterGrid::clear()
 	//reset
 	width = height = 0;
 
-	rows.resize(0);
+	cells.resize(0);
 	scalarFields.resize(0);
 
 	minHeight = maxHeight = meanHeight = 0;
@@ -133,16 +142,12 @@ bool ccRasterGrid::init(unsigned w,
 
 	try
 	{
-		rows.resize(h);
-		for (Row& row : rows)
-		{
-			row.resize(w);
-		}
+		cells.resize(static_cast<size_t>(w) * h);
 	}
 	catch (const std::bad_alloc&)
 	{
 		//not enough memory
-		rows.resize(0);
+		cells.resize(0);
 		return false;
 	}
 
@@ -230,31 +235,11 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 	//we always handle the colors (if any)
 	hasColors = cloud->hasColors();
 
-	for (unsigned n = 0; n<pointCount; ++n)
+	//updates the statistics of the cell (i,j) with the point #n
+	auto projectPoint = [&](unsigned n, const CCVector3* P, int i, int j)
 	{
-		//for each point
-		const CCVector3* P = cloud->getPoint(n);
-
-		//project it inside the grid
-		CCVector3d relativePos = CCVector3d::fromArray(P->u) - minCorner;
-		int i = static_cast<int>((relativePos.u[X] / gridStep + 0.5));
-		int j = static_cast<int>((relativePos.u[Y] / gridStep + 0.5));
-
-		//we skip points that fall outside of the grid!
-		if (	i < 0 || i >= static_cast<int>(width)
-			||	j < 0 || j >= static_cast<int>(height) )
-		{
-			if (!nProgress.oneStep())
-			{
-				//process cancelled by the user
-				return false;
-			}
-			continue;
-		}
-		assert(i >= 0 && j >= 0);
-
 		//update the cell statistics
-		ccRasterCell& aCell = rows[j][i];
+		ccRasterCell& aCell = cell(i, j);
 		if (aCell.nbPoints)
 		{
 			if (P->u[Z] < aCell.minHeight)
@@ -294,6 +279,7 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 			{
 				//we keep track of the point which is the closest to the cell center (in 2D)
 				CCVector2d C((i + 0.5) * gridStep, (j + 0.5) * gridStep);
+				CCVector3d relativePos = CCVector3d::fromArray(P->u) - minCorner;
 				const CCVector3* Q = cloud->getPoint(aCell.pointIndex); //former closest point
 				CCVector3d relativePosQ = CCVector3d::fromArray(Q->u) - minCorner;
 
@@ -337,8 +323,8 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 			assert(pc);
 
 			//absolute position of the cell (e.g. in the 2D SF grid(s))
-			int pos = j * static_cast<int>(width)+i;
-			assert(pos < static_cast<int>(gridTotalSize));
+			size_t pos = static_cast<size_t>(j) * width + i;
+			assert(pos < gridTotalSize);
 
 			for (size_t k = 0; k < scalarFields.size(); ++k)
 			{
@@ -384,11 +370,162 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 
 		//update the number of points in the cell
 		++aCell.nbPoints;
+	};
 
-		if (!nProgress.oneStep())
+	//number of bands of rows (for parallel processing)
+	int bandCount = 1;
+#if defined(_OPENMP)
+	if (pointCount >= s_minPointCountForParallelFill)
+	{
+		bandCount = std::min(static_cast<int>(height), 4 * omp_get_max_threads());
+	}
+#endif
+
+	if (bandCount > 1)
+	{
+		//we dispatch the point indexes by bands of rows, without changing their relative order
+		//(so that each cell receives its points in the same order as in the sequential version)
+		const int chunkCount = std::max(1, bandCount / 4);
+		auto bandOf = [&](int j) { return static_cast<int>((static_cast<size_t>(j) * bandCount) / height); };
+		auto chunkStart = [&](int c) { return static_cast<unsigned>((static_cast<size_t>(pointCount) * c) / chunkCount); };
+
+		std::vector<unsigned> sortedIndexes;
+		std::vector<size_t> bandStart;
+		std::vector<size_t> chunkOffsets; //chunkCount x bandCount
+		try
 		{
-			//process cancelled by user
-			return false;
+			bandStart.resize(bandCount + 1, 0);
+			chunkOffsets.resize(static_cast<size_t>(chunkCount) * bandCount, 0);
+		}
+		catch (const std::bad_alloc&)
+		{
+			//not enough memory
+			bandCount = 1;
+		}
+
+		if (bandCount > 1)
+		{
+			//count the points per chunk and per band
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for (int c = 0; c < chunkCount; ++c)
+			{
+				size_t* counts = chunkOffsets.data() + static_cast<size_t>(c) * bandCount;
+				for (unsigned n = chunkStart(c); n < chunkStart(c + 1); ++n)
+				{
+					std::pair<int, int> pos = computeCellPos(*cloud->getPoint(n), X, Y);
+					if (	pos.first >= 0 && pos.first < static_cast<int>(width)
+						&&	pos.second >= 0 && pos.second < static_cast<int>(height) )
+					{
+						++counts[bandOf(pos.second)];
+					}
+				}
+			}
+
+			//convert the counts to offsets
+			size_t insideCount = 0;
+			for (int b = 0; b < bandCount; ++b)
+			{
+				bandStart[b] = insideCount;
+				for (int c = 0; c < chunkCount; ++c)
+				{
+					size_t& offset = chunkOffsets[static_cast<size_t>(c) * bandCount + b];
+					size_t count = offset;
+					offset = insideCount;
+					insideCount += count;
+				}
+			}
+			bandStart[bandCount] = insideCount;
+
+			try
+			{
+				sortedIndexes.resize(insideCount);
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory: we'll use the sequential version
+				bandCount = 1;
+			}
+
+			if (bandCount > 1)
+			{
+				//dispatch the point indexes
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+				for (int c = 0; c < chunkCount; ++c)
+				{
+					size_t* offsets = chunkOffsets.data() + static_cast<size_t>(c) * bandCount;
+					for (unsigned n = chunkStart(c); n < chunkStart(c + 1); ++n)
+					{
+						std::pair<int, int> pos = computeCellPos(*cloud->getPoint(n), X, Y);
+						if (	pos.first >= 0 && pos.first < static_cast<int>(width)
+							&&	pos.second >= 0 && pos.second < static_cast<int>(height) )
+						{
+							sortedIndexes[offsets[bandOf(pos.second)]++] = n;
+						}
+					}
+				}
+				chunkOffsets.clear();
+				chunkOffsets.shrink_to_fit();
+
+				//now fill the bands in parallel (each band owns its rows)
+				nProgress.scale(static_cast<unsigned>(insideCount));
+				std::atomic<bool> cancelled(false);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+				for (int b = 0; b < bandCount; ++b)
+				{
+					for (size_t k = bandStart[b]; k < bandStart[b + 1] && !cancelled; ++k)
+					{
+						unsigned n = sortedIndexes[k];
+						const CCVector3* P = cloud->getPoint(n);
+						std::pair<int, int> pos = computeCellPos(*P, X, Y);
+						assert(bandOf(pos.second) == b);
+						projectPoint(n, P, pos.first, pos.second);
+
+						if (!nProgress.oneStep())
+						{
+							//process cancelled by the user
+							cancelled = true;
+						}
+					}
+				}
+
+				if (cancelled)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	if (bandCount <= 1)
+	{
+		for (unsigned n = 0; n < pointCount; ++n)
+		{
+			//for each point
+			const CCVector3* P = cloud->getPoint(n);
+
+			//project it inside the grid
+			std::pair<int, int> pos = computeCellPos(*P, X, Y);
+			int i = pos.first;
+			int j = pos.second;
+
+			//we skip points that fall outside of the grid!
+			if (	i >= 0 && i < static_cast<int>(width)
+				&&	j >= 0 && j < static_cast<int>(height) )
+			{
+				projectPoint(n, P, i, j);
+			}
+
+			if (!nProgress.oneStep())
+			{
+				//process cancelled by user
+				return false;
+			}
 		}
 	}
 
@@ -402,7 +539,7 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 			double* _gridSF = scalarField.data();
 			for (unsigned j = 0; j < height; ++j)
 			{
-				Row& row = rows[j];
+				ccRasterCell* row = this->row(j);
 				for (unsigned i = 0; i < width; ++i, ++_gridSF)
 				{
 					if (row[i].nbPoints > 1)
@@ -419,39 +556,42 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 
 	//update the main grid (average height and std.dev. computation + current 'height' value)
 	{
-		for (unsigned j = 0; j < height; ++j)
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int j = 0; j < static_cast<int>(height); ++j)
 		{
-			Row& row = rows[j];
+			ccRasterCell* row = this->row(j);
 			for (unsigned i = 0; i < width; ++i)
 			{
-				ccRasterCell& cell = row[i];
-				if (cell.nbPoints > 1)
+				ccRasterCell& aCell = row[i];
+				if (aCell.nbPoints > 1)
 				{
-					cell.avgHeight /= cell.nbPoints;
-					cell.stdDevHeight = sqrt(fabs(cell.stdDevHeight / cell.nbPoints - cell.avgHeight*cell.avgHeight));
+					aCell.avgHeight /= aCell.nbPoints;
+					aCell.stdDevHeight = sqrt(fabs(aCell.stdDevHeight / aCell.nbPoints - aCell.avgHeight*aCell.avgHeight));
 					if (hasColors && projectionType == PROJ_AVERAGE_VALUE)
 					{
-						cell.color /= cell.nbPoints;
+						aCell.color /= aCell.nbPoints;
 					}
 				}
 				else
 				{
-					cell.stdDevHeight = 0;
+					aCell.stdDevHeight = 0;
 				}
 
-				if (cell.nbPoints != 0)
+				if (aCell.nbPoints != 0)
 				{
 					//set the right 'height' value
 					switch (projectionType)
 					{
 					case PROJ_MINIMUM_VALUE:
-						cell.h = cell.minHeight;
+						aCell.h = aCell.minHeight;
 						break;
 					case PROJ_AVERAGE_VALUE:
-						cell.h = cell.avgHeight;
+						aCell.h = aCell.avgHeight;
 						break;
 					case PROJ_MAXIMUM_VALUE:
-						cell.h = cell.maxHeight;
+						aCell.h = aCell.maxHeight;
 						break;
 					default:
 						assert(false);
@@ -467,7 +607,7 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 	{
 		for (unsigned i = 0; i < height; ++i)
 			for (unsigned j = 0; j < width; ++j)
-				if (rows[i][j].nbPoints)
+				if (cell(j, i).nbPoints)
 					++nonEmptyCellCount;
 	}
 
@@ -498,7 +638,7 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 			unsigned index = 0;
 			for (unsigned j = 0; j < height; ++j)
 			{
-				const Row& row = rows[j];
+				const ccRasterCell* row = this->row(j);
 				for (unsigned i = 0; i < width; ++i)
 				{
 					if (row[i].nbPoints)
@@ -539,15 +679,15 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 					//now scan the cells
 					{
 						//pre-computation for barycentric coordinates
-						const double& valA = rows[ P[0][1] ][ P[0][0] ].h;
-						const double& valB = rows[ P[1][1] ][ P[1][0] ].h;
-						const double& valC = rows[ P[2][1] ][ P[2][0] ].h;
+						const double& valA = cell(P[0][0], P[0][1]).h;
+						const double& valB = cell(P[1][0], P[1][1]).h;
+						const double& valC = cell(P[2][0], P[2][1]).h;
 
 						double det = static_cast<double>((P[1][1] - P[2][1])*(P[0][0] - P[2][0]) + (P[2][0] - P[1][0])*(P[0][1] - P[2][1]));
 
 						for (int j = yMin; j <= yMax; ++j)
 						{
-							Row& row = rows[static_cast<unsigned>(j)];
+							ccRasterCell* row = this->row(static_cast<unsigned>(j));
 
 							for (int i = xMin; i <= xMax; ++i)
 							{
@@ -583,9 +723,9 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 										//interpolate color as well!
 										if (hasColors)
 										{
-											const CCVector3d& colA = rows[P[0][1]][P[0][0]].color;
-											const CCVector3d& colB = rows[P[1][1]][P[1][0]].color;
-											const CCVector3d& colC = rows[P[2][1]][P[2][0]].color;
+											const CCVector3d& colA = cell(P[0][0], P[0][1]).color;
+											const CCVector3d& colB = cell(P[1][0], P[1][1]).color;
+											const CCVector3d& colC = cell(P[2][0], P[2][1]).color;
 											row[i].color = l1 * colA + l2 * colB + l3 * colC;
 										}
 
@@ -615,44 +755,7 @@ bool ccRasterGrid::fillWith(	ccGenericPointCloud* cloud,
 	}
 
 	//computation of the average and extreme height values in the grid
-	{
-		minHeight = 0;
-		maxHeight = 0;
-		meanHeight = 0;
-		validCellCount = 0;
-
-		for (unsigned i=0; i<height; ++i)
-		{
-			for (unsigned j=0; j<width; ++j)
-			{
-				double h = rows[i][j].h;
-
-				if (std::isfinite(h)) //valid height
-				{
-					if (validCellCount)
-					{
-						if (h < minHeight)
-							minHeight = h;
-						else if (h > maxHeight)
-							maxHeight = h;
-
-						meanHeight += h;
-					}
-					else
-					{
-						//first valid cell
-						meanHeight = minHeight = maxHeight = h;
-					}
-					++validCellCount;
-				}
-			}
-		}
-		
-		if (validCellCount)
-		{
-			meanHeight /= validCellCount;
-		}
-	}
+	updateCellStats();
 
 	setValid(true);
 
@@ -691,15 +794,354 @@ void ccRasterGrid::fillEmptyCells(	EmptyCellFillOption fillEmptyCellsStrategy,
 		{
 			for (unsigned j = 0; j < width; ++j)
 			{
-				if (!std::isfinite(rows[i][j].h)) //empty cell (NaN)
+				ccRasterCell& aCell = cell(j, i);
+				if (!std::isfinite(aCell.h)) //empty cell (NaN)
 				{
-					rows[i][j].h = defaultHeight;
+					aCell.h = defaultHeight;
 				}
 			}
 		}
 	}
 }
 
+void ccRasterGrid::updateCellStats()
+{
+	minHeight = 0;
+	maxHeight = 0;
+	meanHeight = 0;
+	nonEmptyCellCount = 0;
+	validCellCount = 0;
+
+	for (const ccRasterCell& aCell : cells)
+	{
+		if (aCell.nbPoints)
+		{
+			++nonEmptyCellCount;
+		}
+
+		double h = aCell.h;
+		if (std::isfinite(h)) //valid height
+		{
+			if (validCellCount)
+			{
+				if (h < minHeight)
+					minHeight = h;
+				else if (h > maxHeight)
+					maxHeight = h;
+
+				meanHeight += h;
+			}
+			else
+			{
+				//first valid cell
+				meanHeight = minHeight = maxHeight = h;
+			}
+			++validCellCount;
+		}
+	}
+
+	if (validCellCount)
+	{
+		meanHeight /= validCellCount;
+	}
+}
+
+bool ccRasterGrid::crop(unsigned i0, unsigned j0, unsigned w, unsigned h, unsigned char Z)
+{
+	if (w == 0 || h == 0 || i0 + w > width || j0 + h > height || Z > 2)
+	{
+		assert(false);
+		return false;
+	}
+
+	if (w == width && h == height)
+	{
+		//nothing to do
+		return true;
+	}
+
+	//the destination of each cell is always before its source: we can work in place
+	for (unsigned j = 0; j < h; ++j)
+	{
+		const ccRasterCell* srcRow = row(j0 + j) + i0;
+		ccRasterCell* destRow = cells.data() + static_cast<size_t>(j) * w;
+		for (unsigned i = 0; i < w; ++i)
+		{
+			destRow[i] = srcRow[i];
+		}
+	}
+	cells.resize(static_cast<size_t>(w) * h);
+
+	for (SF& gridSF : scalarFields)
+	{
+		if (gridSF.empty())
+			continue;
+		for (unsigned j = 0; j < h; ++j)
+		{
+			const double* srcRow = gridSF.data() + static_cast<size_t>(j0 + j) * width + i0;
+			double* destRow = gridSF.data() + static_cast<size_t>(j) * w;
+			for (unsigned i = 0; i < w; ++i)
+			{
+				destRow[i] = srcRow[i];
+			}
+		}
+		gridSF.resize(static_cast<size_t>(w) * h);
+	}
+
+	//vertical dimension
+	const unsigned char X = Z == 2 ? 0 : Z + 1;
+	const unsigned char Y = X == 2 ? 0 : X + 1;
+
+	minCorner.u[X] += i0 * gridStep;
+	minCorner.u[Y] += j0 * gridStep;
+	width = w;
+	height = h;
+
+	updateCellStats();
+
+	return true;
+}
+
+bool ccRasterGrid::GenerateByTiles(	ccGenericPointCloud* cloud,
+									const ccBBox& box,
+									double gridStep,
+									unsigned char Z,
+									ProjectionType projectionType,
+									EmptyCellFillOption fillEmptyCellsStrategy,
+									double customCellHeight,
+									ProjectionType sfInterpolation,
+									unsigned tileSize,
+									unsigned margin,
+									TileCallback callback,
+									TiledGridStats* stats/*=nullptr*/,
+									ccProgressDialog* progressDialog/*=nullptr*/)
+{
+	if (!cloud || tileSize == 0 || !callback)
+	{
+		assert(false);
+		return false;
+	}
+
+	//global grid size
+	unsigned gridWidth = 0, gridHeight = 0;
+	if (!ComputeGridSize(Z, box, gridStep, gridWidth, gridHeight))
+	{
+		return false;
+	}
+	const CCVector3d minCorner = CCVector3d::fromArray(box.minCorner().u);
+
+	//vertical dimension
+	const unsigned char X = Z == 2 ? 0 : Z + 1;
+	const unsigned char Y = X == 2 ? 0 : X + 1;
+
+	const unsigned tileCountX = (gridWidth + tileSize - 1) / tileSize;
+	const unsigned tileCountY = (gridHeight + tileSize - 1) / tileSize;
+	const unsigned tileCount = tileCountX * tileCountY;
+
+	const unsigned pointCount = cloud->size();
+
+	auto cellPos = [&](unsigned n)
+	{
+		const CCVector3* P = cloud->getPoint(n);
+		//DGM: we use the 'PixelIsArea' convention
+		int i = static_cast<int>(((P->u[X] - minCorner.u[X]) / gridStep + 0.5));
+		int j = static_cast<int>(((P->u[Y] - minCorner.u[Y]) / gridStep + 0.5));
+		return std::pair<int, int>(i, j);
+	};
+
+	if (progressDialog)
+	{
+		progressDialog->setMethodTitle(QObject::tr("Tiled grid generation"));
+		progressDialog->setInfo(QObject::tr("Points: %L1\nCells: %L2 x %L3\nTiles: %L4").arg(pointCount).arg(gridWidth).arg(gridHeight).arg(tileCount));
+		progressDialog->start();
+		progressDialog->show();
+		QCoreApplication::processEvents();
+	}
+	CCLib::NormalizedProgress nProgress(progressDialog, tileCount);
+
+	const bool interpolate = (fillEmptyCellsStrategy == INTERPOLATE);
+	ccPointCloud* pc = cloud->isA(CC_TYPES::POINT_CLOUD) ? static_cast<ccPointCloud*>(cloud) : nullptr;
+
+	//global statistics
+	TiledGridStats globalStats;
+	double sumHeight = 0;
+
+	unsigned tileIndex = 0;
+	for (unsigned ty = 0; ty < tileCountY; ++ty)
+	{
+		//rows of the current band of tiles (margins included)
+		const unsigned y0 = ty * tileSize;
+		const unsigned tileHeight = std::min(tileSize, gridHeight - y0);
+		const unsigned jMin = (y0 > margin ? y0 - margin : 0);
+		const unsigned jMax = std::min(y0 + tileHeight + margin, gridHeight); //excluded
+
+		//dispatch the points of the band in the tiles (a point may belong to several tiles because of the margins)
+		//we scan the whole cloud for each band, so that only the indexes of the current band are kept in memory
+		std::vector< std::vector<unsigned> > tileIndexes;
+		try
+		{
+			tileIndexes.resize(tileCountX);
+			for (unsigned n = 0; n < pointCount; ++n)
+			{
+				std::pair<int, int> pos = cellPos(n);
+				if (	pos.second < static_cast<int>(jMin) || pos.second >= static_cast<int>(jMax)
+					||	pos.first < 0 || pos.first >= static_cast<int>(gridWidth))
+				{
+					continue;
+				}
+				int i = pos.first;
+				int txMin = std::max(0, (i - static_cast<int>(margin)) / static_cast<int>(tileSize));
+				int txMax = std::min(static_cast<int>(tileCountX) - 1, (i + static_cast<int>(margin)) / static_cast<int>(tileSize));
+				for (int tx = txMin; tx <= txMax; ++tx)
+				{
+					tileIndexes[tx].push_back(n);
+				}
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			ccLog::Warning("[Rasterize] Not enough memory");
+			return false;
+		}
+
+		for (unsigned tx = 0; tx < tileCountX; ++tx, ++tileIndex)
+		{
+			const unsigned x0 = tx * tileSize;
+			const unsigned tileWidth = std::min(tileSize, gridWidth - x0);
+			const unsigned iMin = (x0 > margin ? x0 - margin : 0);
+			const unsigned iMax = std::min(x0 + tileWidth + margin, gridWidth); //excluded
+
+			//extract the points of the tile (margins included)
+			ccPointCloud* tileCloud = nullptr;
+			if (!tileIndexes[tx].empty())
+			{
+				CCLib::ReferenceCloud tileRef(cloud);
+				if (!tileRef.reserve(static_cast<unsigned>(tileIndexes[tx].size())))
+				{
+					ccLog::Warning("[Rasterize] Not enough memory");
+					return false;
+				}
+				for (unsigned n : tileIndexes[tx])
+				{
+					tileRef.addPointIndex(n);
+				}
+				tileIndexes[tx].clear();
+				tileIndexes[tx].shrink_to_fit();
+
+				tileCloud = pc ? pc->partialClone(&tileRef) : ccPointCloud::From(&tileRef, cloud);
+				if (!tileCloud)
+				{
+					ccLog::Warning("[Rasterize] Not enough memory");
+					return false;
+				}
+			}
+
+			ccRasterGrid tile;
+			CCVector3d tileCorner = minCorner;
+			tileCorner.u[X] += iMin * gridStep;
+			tileCorner.u[Y] += jMin * gridStep;
+			if (!tile.init(iMax - iMin, jMax - jMin, gridStep, tileCorner))
+			{
+				delete tileCloud;
+				ccLog::Warning("[Rasterize] Not enough memory");
+				return false;
+			}
+
+			if (tileCloud)
+			{
+				if (!tile.fillWith(tileCloud, Z, projectionType, interpolate, sfInterpolation, nullptr))
+				{
+					delete tileCloud;
+					return false;
+				}
+			}
+			else
+			{
+				//empty tile: we still need the (empty) scalar fields
+				if (pc && sfInterpolation != INVALID_PROJECTION_TYPE)
+				{
+					try
+					{
+						tile.scalarFields.resize(pc->getNumberOfScalarFields());
+						for (SF& gridSF : tile.scalarFields)
+						{
+							gridSF.resize(tile.cells.size(), std::numeric_limits<SF::value_type>::quiet_NaN());
+						}
+					}
+					catch (const std::bad_alloc&)
+					{
+						ccLog::Warning("[Rasterize] Not enough memory");
+						return false;
+					}
+				}
+				tile.hasColors = cloud->hasColors();
+				tile.setValid(true);
+			}
+
+			//remove the margins
+			tile.crop(x0 - iMin, y0 - jMin, tileWidth, tileHeight, Z);
+
+			if (fillEmptyCellsStrategy == FILL_CUSTOM_HEIGHT)
+			{
+				tile.fillEmptyCells(FILL_CUSTOM_HEIGHT, customCellHeight);
+				tile.updateCellStats();
+			}
+
+			//update the global statistics
+			if (tile.validCellCount)
+			{
+				if (globalStats.validCellCount)
+				{
+					globalStats.minHeight = std::min(globalStats.minHeight, tile.minHeight);
+					globalStats.maxHeight = std::max(globalStats.maxHeight, tile.maxHeight);
+				}
+				else
+				{
+					globalStats.minHeight = tile.minHeight;
+					globalStats.maxHeight = tile.maxHeight;
+				}
+				sumHeight += tile.meanHeight * tile.validCellCount;
+				globalStats.validCellCount += tile.validCellCount;
+			}
+			globalStats.nonEmptyCellCount += tile.nonEmptyCellCount;
+
+			TileInfo info;
+			info.x0 = x0;
+			info.y0 = y0;
+			info.index = tileIndex;
+			info.count = tileCount;
+			info.cloud = tileCloud;
+
+			bool success = callback(tile, info);
+
+			delete tileCloud;
+			tileCloud = nullptr;
+
+			if (!success)
+			{
+				return false;
+			}
+
+			if (!nProgress.oneStep())
+			{
+				//process cancelled by user
+				return false;
+			}
+		}
+	}
+
+	if (globalStats.validCellCount)
+	{
+		globalStats.meanHeight = sumHeight / globalStats.validCellCount;
+	}
+	if (stats)
+	{
+		*stats = globalStats;
+	}
+
+	return true;
+}
+
 ccPointCloud* ccRasterGrid::convertToCloud(	const std::vector<ExportableFields>& exportedFields,
 											bool interpolateSF,
 											bool interpolateColors,
@@ -754,10 +1196,10 @@ ccPointCloud* ccRasterGrid::convertToCloud(	const std::vector<ExportableFields>&
 		{
 			for (unsigned i = 0; i < width; ++i)
 			{
-				const ccRasterCell& cell = rows[j][i];
-				if (cell.nbPoints) //non empty cell
+				const ccRasterCell& aCell = cell(i, j);
+				if (aCell.nbPoints) //non empty cell
 				{
-					refCloud.addPointIndex(cell.pointIndex);
+					refCloud.addPointIndex(aCell.pointIndex);
 				}
 			}
 		}
@@ -779,10 +1221,10 @@ ccPointCloud* ccRasterGrid::convertToCloud(	const std::vector<ExportableFields>&
 			{
 				for (unsigned i = 0; i < width; ++i)
 				{
-					const ccRasterCell& cell = rows[j][i];
-					if (cell.nbPoints) //non empty cell
+					const ccRasterCell& aCell = cell(i, j);
+					if (aCell.nbPoints) //non empty cell
 					{
-						const_cast<CCVector3*>(cloudGrid->getPoint(pointIndex))->u[Z] = static_cast<PointCoordinateType>(cell.h);
+						const_cast<CCVector3*>(cloudGrid->getPoint(pointIndex))->u[Z] = static_cast<PointCoordinateType>(aCell.h);
 						++pointIndex;
 					}
 				}
@@ -895,7 +1337,7 @@ ccPointCloud* ccRasterGrid::convertToCloud(	const std::vector<ExportableFields>&
 
 	for (unsigned j = 0; j < height; ++j)
 	{
-		const ccRasterCell* aCell = rows[j].data();
+		const ccRasterCell* aCell = row(j);
 		double Px = box.minCorner().u[X]/* + gridStep / 2*/;
 		
 		for (unsigned i = 0; i < width; ++i, ++aCell)
@@ -1090,7 +1532,7 @@ ccPointCloud* ccRasterGrid::convertToCloud(	const std::vector<ExportableFields>&
 					const double* _sfGrid = scalarFields[k].data();
 					for (unsigned j = 0; j < height; ++j)
 					{
-						const ccRasterGrid::Row& row = rows[j];
+						const ccRasterCell* row = this->row(j);
 						for (unsigned i = 0; i < width; ++i, ++_sfGrid)
 						{
 							if (std::isfinite(row[i].h)) //valid cell (could have been interpolated)
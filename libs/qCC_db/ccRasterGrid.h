@@ -23,6 +23,7 @@
 #include "ccBBox.h"
 
 //system
+#include <functional>
 #include <limits>
 
 class ccGenericPointCloud;
@@ -125,6 +126,9 @@ struct QCC_DB_LIB_API ccRasterGrid
 	//! Fills the grid with a point cloud
 	/** Since version 2.8, we now use the "PixelIsArea" convention by default (as GDAL)
 	This means that the height is computed at the center of the grid cell.
+	On big clouds, the points are dispatched in bands of rows that are filled
+	in parallel (each cell still receives its points in the same order, so the
+	result is strictly identical to the sequential version).
 	**/
 	bool fillWith(	ccGenericPointCloud* cloud,
 					unsigned char projectionDimension,
@@ -146,6 +150,91 @@ struct QCC_DB_LIB_API ccRasterGrid
 	void fillEmptyCells(EmptyCellFillOption fillEmptyCellsStrategy,
 						double customCellHeight = 0);
 
+	//! Crops the grid (keeps only the cells of a given window)
+	/** The grid statistics (min, max and mean heights, etc.) are updated.
+		\param i0 first column of the window
+		\param j0 first row of the window
+		\param w window width (in cells)
+		\param h window height (in cells)
+		\param Z vertical dimension (to update the grid min corner)
+		\return success
+	**/
+	bool crop(unsigned i0, unsigned j0, unsigned w, unsigned h, unsigned char Z);
+
+	//! Updates the grid statistics (number of non-empty and valid cells, min, max and mean heights)
+	void updateCellStats();
+
+	//! Tile description (see GenerateByTiles)
+	struct TileInfo
+	{
+		//! Position of the tile (first column) in the global grid
+		unsigned x0 = 0;
+		//! Position of the tile (first row) in the global grid
+		unsigned y0 = 0;
+		//! Tile index
+		unsigned index = 0;
+		//! Total number of tiles
+		unsigned count = 0;
+		//! Cloud used to fill the tile (its points indexes are the ones referenced by the tile cells)
+		ccGenericPointCloud* cloud = nullptr;
+	};
+
+	//! Statistics of a grid generated by tiles (see GenerateByTiles)
+	struct TiledGridStats
+	{
+		//! Min height (computed on the NON-EMPTY or INTERPOLATED cells)
+		double minHeight = 0;
+		//! Max height (computed on the NON-EMPTY or INTERPOLATED cells)
+		double maxHeight = 0;
+		//! Average height (computed on the NON-EMPTY or INTERPOLATED cells)
+		double meanHeight = 0;
+		//! Number of NON-EMPTY cells
+		size_t nonEmptyCellCount = 0;
+		//! Number of VALID cells
+		size_t validCellCount = 0;
+	};
+
+	//! Callback called for each generated tile (should return false to stop the process)
+	using TileCallback = std::function<bool(ccRasterGrid& tile, const TileInfo& info)>;
+
+	//! Generates a (very large) grid tile by tile
+	/** The memory used is bounded by the size of a tile (and by the number of points
+		falling in a row of tiles) instead of the whole grid size. The cloud is scanned
+		once per row of tiles, so that no per-point structure is allocated. Each tile is filled
+		with a margin of extra cells all around it, so that the empty cells close to
+		the tile borders can be interpolated as well. The margins are then removed
+		before the tile is sent to the callback.
+		\warning The empty cells are only filled for the 'INTERPOLATE' and 'FILL_CUSTOM_HEIGHT'
+		strategies (the others require the global statistics, available in 'stats' at the end).
+		\param cloud input cloud
+		\param box grid bounding-box
+		\param gridStep grid step
+		\param Z vertical dimension
+		\param projectionType projection type
+		\param fillEmptyCellsStrategy empty cells filling strategy
+		\param customCellHeight custom height (for the 'FILL_CUSTOM_HEIGHT' strategy)
+		\param sfInterpolation scalar fields projection type
+		\param tileSize tile size (in cells)
+		\param margin margin size (in cells)
+		\param callback callback called for each tile
+		\param stats global statistics (optional)
+		\param progressDialog progress dialog (optional)
+		\return success
+	**/
+	static bool GenerateByTiles(ccGenericPointCloud* cloud,
+								const ccBBox& box,
+								double gridStep,
+								unsigned char Z,
+								ProjectionType projectionType,
+								EmptyCellFillOption fillEmptyCellsStrategy,
+								double customCellHeight,
+								ProjectionType sfInterpolation,
+								unsigned tileSize,
+								unsigned margin,
+								TileCallback callback,
+								TiledGridStats* stats = nullptr,
+								ccProgressDialog* progressDialog = nullptr);
+
 	//! Sets valid
 	inline void setValid(bool state) { valid = state; }
 	//! Returns whether the grid is 'valid' or not
@@ -169,11 +258,18 @@ struct QCC_DB_LIB_API ccRasterGrid
 		return {minCorner.u[X] + (i + 0.5) * gridStep, minCorner.u[Y] + (j + 0.5) * gridStep};
 	}
 
-	//! Row
-	using Row = std::vector<ccRasterCell>;
+	//! Returns the cells of a given row
+	inline ccRasterCell* row(unsigned j) { return cells.data() + static_cast<size_t>(j) * width; }
+	//! Returns the cells of a given row (const version)
+	inline const ccRasterCell* row(unsigned j) const { return cells.data() + static_cast<size_t>(j) * width; }
+
+	//! Returns a given cell
+	inline ccRasterCell& cell(unsigned i, unsigned j) { return cells[static_cast<size_t>(j) * width + i]; }
+	//! Returns a given cell (const version)
+	inline const ccRasterCell& cell(unsigned i, unsigned j) const { return cells[static_cast<size_t>(j) * width + i]; }
 
-	//! All cells
-	std::vector<Row> rows;
+	//! All cells (stored row by row in a single contiguous array)
+	std::vector<ccRasterCell> cells;
 
 	//! Scalar field
 	using SF = std::vector<double>;
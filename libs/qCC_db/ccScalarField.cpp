@@ -25,6 +25,7 @@
 
 //system
 #include <algorithm>
+#include <cstring>
 
 using namespace CCLib;
 
@@ -39,6 +40,8 @@ ccScalarField::ccScalarField(const char* name/*=0*/)
 	, m_alwaysShowZero(false)
 	, m_colorScale(nullptr)
 	, m_colorRampSteps(0)
+	, m_colorLUTScale(nullptr)
+	, m_colorLUTScaleVersion(0)
 	, m_modified(true)
 	, m_globalShift(0)
 {
@@ -57,6 +60,8 @@ ccScalarField::ccScalarField(const ccScalarField& sf)
 	, m_alwaysShowZero(sf.m_alwaysShowZero)
 	, m_colorScale(sf.m_colorScale)
 	, m_colorRampSteps(sf.m_colorRampSteps)
+	, m_colorLUTScale(nullptr)
+	, m_colorLUTScaleVersion(0)
 	, m_histogram(sf.m_histogram)
 	, m_modified(sf.m_modified)
 	, m_globalShift(sf.m_globalShift)
@@ -65,6 +70,11 @@ ccScalarField::ccScalarField(const ccScalarField& sf)
 }
 
 ScalarType ccScalarField::normalize(ScalarType d) const
+{
+	return normalize(d, strcmp(getName(), "Segmentation") == 0);
+}
+
+ScalarType ccScalarField::normalize(ScalarType d, bool isSegmentation) const
 {
 	if (/*!ValidValue(d) || */!m_displayRange.isInRange(d)) //NaN values are also rejected by 'isInRange'!
 	{
@@ -81,8 +91,7 @@ ScalarType ccScalarField::normalize(ScalarType d) const
 			else if (d >= m_saturationRange.stop())
 				return static_cast<ScalarType>(1);
 
-			QString name = getName();
-			if (name == QString("Segmentation")) {
+			if (isSegmentation) {
 				return (int(d - m_saturationRange.start()) % 256) / 256.0;
 			}
 			return (d - m_saturationRange.start()) / m_saturationRange.range();
@@ -121,6 +130,82 @@ ScalarType ccScalarField::normalize(ScalarType d) const
 	return static_cast<ScalarType>(-1);
 }
 
+bool ccScalarField::updateColorLUT() const
+{
+	assert(m_colorScale);
+	if (	m_colorLUTScale == m_colorScale.data()
+		&&	m_colorLUTScaleVersion == m_colorScale->version()
+		&&	m_colorLUT.size() == m_colorRampSteps)
+	{
+		//nothing to do
+		return true;
+	}
+
+	try
+	{
+		m_colorLUT.resize(m_colorRampSteps);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		m_colorLUT.clear();
+		m_colorLUTScale = nullptr;
+		return false;
+	}
+
+	//same quantization as ccColorScale::getColorByRelativePos
+	for (unsigned i = 0; i < m_colorRampSteps; ++i)
+	{
+		m_colorLUT[i] = m_colorScale->getColorByIndex((i * (ccColorScale::MAX_STEPS - 1)) / m_colorRampSteps);
+	}
+
+	m_colorLUTScale = m_colorScale.data();
+	m_colorLUTScaleVersion = m_colorScale->version();
+
+	return true;
+}
+
+void ccScalarField::getColors(const ScalarType* values, size_t count, ccColor::Rgb* colors, const ccColor::Rgb& hiddenColor/*=ccColor::black*/) const
+{
+	assert(m_colorScale && values && colors);
+
+	QMutexLocker locker(&m_colorLUTMutex);
+
+	if (!updateColorLUT())
+	{
+		//not enough memory: we fall back to the standard (slower) way
+		for (size_t i = 0; i < count; ++i)
+		{
+			const ccColor::Rgb* col = getColor(values[i]);
+			colors[i] = (col ? *col : hiddenColor);
+		}
+		return;
+	}
+
+	const ccColor::Rgb* lut = m_colorLUT.data();
+	const unsigned steps = m_colorRampSteps;
+	const ccColor::Rgb outOfRangeColor = (m_showNaNValuesInGrey ? ccColor::lightGrey : hiddenColor);
+	const bool isSegmentation = (strcmp(getName(), "Segmentation") == 0);
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (count > 65536)
+#endif
+	for (int i = 0; i < static_cast<int>(count); ++i)
+	{
+		double relativePos = normalize(values[i], isSegmentation);
+		if (relativePos >= 0.0 && relativePos <= 1.0)
+		{
+			//same quantization as ccColorScale::getColorByRelativePos
+			unsigned index = (static_cast<unsigned>((relativePos*steps)*65535.0)) >> 16;
+			colors[i] = lut[index];
+		}
+		else
+		{
+			colors[i] = outOfRangeColor;
+		}
+	}
+}
+
 void ccScalarField::setColorScale(ccColorScale::Shared scale)
 {
 	if (m_colorScale != scale)
@@ -129,6 +214,7 @@ void ccScalarField::setColorScale(ccColorScale::Shared scale)
 		bool isAbsolute = (scale && !scale->isRelative());
 
 		m_colorScale = scale;
+		m_colorLUTScale = nullptr;
 
 		if (isAbsolute)
 			m_symmetricalScale = false;
@@ -24,6 +24,9 @@
 //qCC_db
 #include "ccColorScale.h"
 
+//Qt
+#include <QMutex>
+
 //! A scalar field associated to display-related parameters
 /** Extends the CCLib::ScalarField object.
 **/
@@ -139,6 +142,19 @@ public:
 	//! Shortcut to getColor
 	inline const ccColor::Rgb* getValueColor(unsigned index) const { return getColor(getValue(index)); }
 
+	//! Converts a set of scalar values to colors (wrt to the current display parameters)
+	/** Gives the same result as getColor, but much faster: the quantized colors of the
+		color ramp are cached in a look-up table (built again only if the color scale
+		or the number of steps change) and the display parameters are only evaluated once.
+		This method can be called from any thread.
+		Warning: must no be called if the SF is not associated to a color scale!
+		\param values scalar values
+		\param count number of values
+		\param colors output colors (must be able to hold 'count' colors)
+		\param hiddenColor color for the hidden values (i.e. when getColor returns a null pointer)
+	**/
+	void getColors(const ScalarType* values, size_t count, ccColor::Rgb* colors, const ccColor::Rgb& hiddenColor = ccColor::black) const;
+
 	//! Sets whether NaN/out of displayed range values should be displayed in grey or hidden
 	void showNaNValuesInGrey(bool state);
 
@@ -234,6 +250,18 @@ protected: //methods
 	**/
 	ScalarType normalize(ScalarType val) const;
 
+	//! Normalizes a scalar value between 0 and 1 (wrt to current parameters)
+	/**	\param val scalar value
+		\param isSegmentation whether the scalar field is a 'Segmentation' field
+		\return a number between 0 and 1 if inside displayed range or -1 otherwise
+	**/
+	ScalarType normalize(ScalarType val, bool isSegmentation) const;
+
+	//! Updates the color look-up table (if necessary)
+	/** \return false if not enough memory
+	**/
+	bool updateColorLUT() const;
+
 protected: //members
 
 	//! Displayed values range
@@ -269,6 +297,15 @@ protected: //members
 	//! Number of color ramps steps (for display)
 	unsigned m_colorRampSteps;
 
+	//! Color look-up table (one color per color ramp step)
+	mutable std::vector<ccColor::Rgb> m_colorLUT;
+	//! Color scale used to build the color look-up table
+	mutable const ccColorScale* m_colorLUTScale;
+	//! Version of the color scale used to build the color look-up table
+	mutable unsigned m_colorLUTScaleVersion;
+	//! For concurrent access to the color look-up table
+	mutable QMutex m_colorLUTMutex;
+
 	//! Associated histogram values (for display)
 	Histogram m_histogram;
 
@@ -0,0 +1,191 @@
+#include "TestPointCloudVBOStager.h"
+
+#include "ccChunk.h"
+#include "ccPointCloud.h"
+#include "ccPointCloudVBOStager.h"
+
+#include <cstring>
+#include <vector>
+
+//! Checks that a staged chunk matches the cloud data
+static bool CheckChunk(const ccPointCloud& cloud, const ccPointCloudVBOStager::Chunk& chunk)
+{
+	size_t chunkCount = ccChunk::Count(cloud.size());
+	if (chunk.index >= chunkCount || chunk.count != ccChunk::Size(chunk.index, chunkCount, cloud.size()))
+	{
+		return false;
+	}
+	unsigned firstIndex = static_cast<unsigned>(ccChunk::StartPos(chunk.index));
+
+	if (chunk.updateFlags & vboSet::UPDATE_POINTS)
+	{
+		if (chunk.points.size() != 3 * chunk.count
+			|| memcmp(chunk.points.data(), cloud.getPoint(firstIndex), sizeof(PointCoordinateType) * 3 * chunk.count) != 0)
+		{
+			return false;
+		}
+	}
+	if (chunk.updateFlags & vboSet::UPDATE_COLORS)
+	{
+		if (chunk.colors.size() != chunk.count)
+		{
+			return false;
+		}
+		for (unsigned i = 0; i < chunk.count; ++i)
+		{
+			const ccColor::Rgb& C = cloud.getPointColor(firstIndex + i);
+			if (chunk.colors[i].r != C.r || chunk.colors[i].g != C.g || chunk.colors[i].b != C.b)
+			{
+				return false;
+			}
+		}
+	}
+	if (chunk.updateFlags & vboSet::UPDATE_NORMALS)
+	{
+		if (chunk.normals.size() != 3 * chunk.count)
+		{
+			return false;
+		}
+		for (unsigned i = 0; i < chunk.count; ++i)
+		{
+			const CCVector3& N = cloud.getPointNormal(firstIndex + i);
+			if (chunk.normals[3 * i] != N.x || chunk.normals[3 * i + 1] != N.y || chunk.normals[3 * i + 2] != N.z)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void TestPointCloudVBOStager::initTestCase()
+{
+	//2 full chunks + a partial one
+	const unsigned pointCount = static_cast<unsigned>(2 * ccChunk::SIZE + 1234);
+
+	m_cloud = new ccPointCloud("stager test");
+	QVERIFY(m_cloud->reserve(pointCount));
+	QVERIFY(m_cloud->reserveTheRGBTable());
+	QVERIFY(m_cloud->reserveTheNormsTable());
+	for (unsigned i = 0; i < pointCount; ++i)
+	{
+		m_cloud->addPoint(CCVector3(static_cast<PointCoordinateType>(i % 1000), static_cast<PointCoordinateType>(i / 1000), static_cast<PointCoordinateType>(i % 7)));
+		m_cloud->addRGBColor(static_cast<ColorCompType>(i % 256), static_cast<ColorCompType>((i / 256) % 256), static_cast<ColorCompType>((3 * i) % 256));
+		CCVector3 N(static_cast<PointCoordinateType>(i % 3), static_cast<PointCoordinateType>(1), static_cast<PointCoordinateType>(i % 5));
+		N.normalize();
+		m_cloud->addNorm(N);
+	}
+	QCOMPARE(m_cloud->size(), pointCount);
+	QVERIFY(m_cloud->hasColors());
+	QVERIFY(m_cloud->hasNormals());
+}
+
+void TestPointCloudVBOStager::cleanupTestCase()
+{
+	delete m_cloud;
+	m_cloud = nullptr;
+}
+
+void TestPointCloudVBOStager::stageAllChunks() const
+{
+	size_t chunkCount = ccChunk::Count(m_cloud->size());
+	QCOMPARE(chunkCount, static_cast<size_t>(3));
+
+	std::vector<int> pendingFlags(chunkCount, vboSet::UPDATE_POINTS | vboSet::UPDATE_COLORS | vboSet::UPDATE_NORMALS);
+	QVERIFY(ccPointCloudVBOStager::HasPendingUpdates(pendingFlags));
+
+	ccPointCloudVBOStager stager;
+	QVERIFY(stager.start(*m_cloud, pendingFlags, nullptr));
+
+	std::vector<bool> staged(chunkCount, false);
+	ccPointCloudVBOStager::Chunk chunk;
+	while (stager.waitForChunk(chunk))
+	{
+		QVERIFY(chunk.index < chunkCount);
+		QVERIFY(!staged[chunk.index]);
+		QCOMPARE(chunk.updateFlags, pendingFlags[chunk.index]);
+		QVERIFY(CheckChunk(*m_cloud, chunk));
+		staged[chunk.index] = true;
+
+		ccPointCloudVBOStager::ChunkUploaded(pendingFlags, chunk);
+		QCOMPARE(pendingFlags[chunk.index], 0);
+	}
+
+	for (bool s : staged)
+	{
+		QVERIFY(s);
+	}
+	QVERIFY(!ccPointCloudVBOStager::HasPendingUpdates(pendingFlags));
+	QVERIFY(!stager.isActive());
+	QVERIFY(!stager.hasFailed());
+}
+
+void TestPointCloudVBOStager::stagePointsOnly() const
+{
+	size_t chunkCount = ccChunk::Count(m_cloud->size());
+
+	//only the last chunk has pending updates
+	std::vector<int> pendingFlags(chunkCount, 0);
+	pendingFlags.back() = vboSet::UPDATE_POINTS;
+
+	ccPointCloudVBOStager stager;
+	QVERIFY(stager.start(*m_cloud, pendingFlags, nullptr));
+
+	ccPointCloudVBOStager::Chunk chunk;
+	QVERIFY(stager.waitForChunk(chunk));
+	QCOMPARE(chunk.index, chunkCount - 1);
+	QCOMPARE(chunk.updateFlags, static_cast<int>(vboSet::UPDATE_POINTS));
+	QVERIFY(chunk.colors.empty());
+	QVERIFY(chunk.normals.empty());
+	QVERIFY(CheckChunk(*m_cloud, chunk));
+	ccPointCloudVBOStager::ChunkUploaded(pendingFlags, chunk);
+
+	QVERIFY(!stager.waitForChunk(chunk));
+	QVERIFY(!ccPointCloudVBOStager::HasPendingUpdates(pendingFlags));
+}
+
+void TestPointCloudVBOStager::cancelAndRestart() const
+{
+	size_t chunkCount = ccChunk::Count(m_cloud->size());
+	std::vector<int> pendingFlags(chunkCount, vboSet::UPDATE_POINTS | vboSet::UPDATE_COLORS | vboSet::UPDATE_NORMALS);
+
+	ccPointCloudVBOStager stager;
+
+	//cancel without any process
+	stager.cancel();
+	QVERIFY(!stager.isActive());
+
+	QVERIFY(stager.start(*m_cloud, pendingFlags, nullptr));
+
+	//upload the first chunk only
+	ccPointCloudVBOStager::Chunk chunk;
+	QVERIFY(stager.waitForChunk(chunk));
+	QVERIFY(CheckChunk(*m_cloud, chunk));
+	ccPointCloudVBOStager::ChunkUploaded(pendingFlags, chunk);
+
+	//the chunks that have not been taken yet are discarded
+	stager.cancel();
+	QVERIFY(!stager.isActive());
+	QVERIFY(!stager.takeChunk(chunk));
+	QVERIFY(ccPointCloudVBOStager::HasPendingUpdates(pendingFlags));
+
+	//a second cancel is harmless
+	stager.cancel();
+
+	//restart with the remaining pending chunks
+	QVERIFY(stager.start(*m_cloud, pendingFlags, nullptr));
+	size_t restagedCount = 0;
+	while (stager.waitForChunk(chunk))
+	{
+		QVERIFY(pendingFlags[chunk.index] != 0);
+		QVERIFY(CheckChunk(*m_cloud, chunk));
+		ccPointCloudVBOStager::ChunkUploaded(pendingFlags, chunk);
+		++restagedCount;
+	}
+	QCOMPARE(restagedCount, chunkCount - 1);
+	QVERIFY(!ccPointCloudVBOStager::HasPendingUpdates(pendingFlags));
+	QVERIFY(!stager.isActive());
+}
+
+QTEST_GUILESS_MAIN(TestPointCloudVBOStager)
@@ -0,0 +1,30 @@
+#ifndef CC_TEST_POINT_CLOUD_VBO_STAGER_HEADER
+#define CC_TEST_POINT_CLOUD_VBO_STAGER_HEADER
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+class ccPointCloud;
+
+//! Headless tests of the VBO staging (no OpenGL context required)
+class TestPointCloudVBOStager : public QObject
+{
+Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	/* Staging tests (the staged chunks are compared with the cloud data) */
+	void stageAllChunks() const;
+
+	void stagePointsOnly() const;
+
+	void cancelAndRestart() const;
+
+private:
+	//! Cloud with points, colors and normals (spanning several chunks)
+	ccPointCloud* m_cloud = nullptr;
+};
+
+
+#endif //CC_TEST_POINT_CLOUD_VBO_STAGER_HEADER
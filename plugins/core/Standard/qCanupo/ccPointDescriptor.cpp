@@ -50,6 +50,9 @@ public:
 	//! Default constructor
 	DimensionalityScaleParamsComputer() : m_firstScale(true) {}
 
+	//inherited from ScaleParamsComputer
+	virtual ScaleParamsComputer* clone() const { return new DimensionalityScaleParamsComputer(*this); }
+
 	//inherited from ScaleParamsComputer
 	virtual unsigned getID() const { return DESC_DIMENSIONALITY; }
 
@@ -76,14 +79,30 @@ public:
 	//inherited from ScaleParamsComputer
 	virtual bool computeScaleParams(CCLib::ReferenceCloud& neighbors, double radius, float params[], bool& invalidScale)
 	{
-		//PCA analysis
-		if (neighbors.size() >= 3)
+		unsigned pointCount = neighbors.size();
+		if (pointCount >= 3)
 		{
 			CCLib::Neighbourhood Z(&neighbors);
+			return computeScaleParamsFromCovariance(Z.computeCovarianceMatrix(), pointCount, radius, params, invalidScale);
+		}
+		else
+		{
+			return computeScaleParamsFromCovariance(CCLib::SquareMatrixd(), pointCount, radius, params, invalidScale);
+		}
+	}
 
+	//inherited from ScaleParamsComputer
+	virtual bool usesCovarianceOnly() const { return true; }
+
+	//inherited from ScaleParamsComputer
+	virtual bool computeScaleParamsFromCovariance(const CCLib::SquareMatrixd& covMat, unsigned pointCount, double radius, float params[], bool& invalidScale)
+	{
+		//PCA analysis
+		if (pointCount >= 3)
+		{
 			CCLib::SquareMatrixd eigVectors;
 			std::vector<double> eigValues;
-			if (Jacobi<double>::ComputeEigenValuesAndVectors(Z.computeCovarianceMatrix(), eigVectors, eigValues, true))
+			if (Jacobi<double>::ComputeEigenValuesAndVectors(covMat, eigVectors, eigValues, true))
 			{
 				Jacobi<double>::SortEigenValuesAndVectors(eigVectors, eigValues); //decreasing order of their associated eigenvalues
 
@@ -150,6 +169,9 @@ public:
 	//! Default constructor
 	DimensionalityAndSFScaleParamsComputer() : m_firstScale(true) {}
 
+	//inherited from ScaleParamsComputer
+	virtual ScaleParamsComputer* clone() const { return new DimensionalityAndSFScaleParamsComputer(*this); }
+
 	//inherited from ScaleParamsComputer
 	virtual unsigned getID() const { return DESC_DIMENSIONALITY_SF; }
 
@@ -283,6 +305,9 @@ public:
 	//! Default constructor
 	CurvatureScaleParamsComputer() : m_firstScale(true) {}
 
+	//inherited from ScaleParamsComputer
+	virtual ScaleParamsComputer* clone() const { return new CurvatureScaleParamsComputer(*this); }
+
 	//inherited from ScaleParamsComputer
 	virtual unsigned getID() const { return DESC_CURVATURE; }
 
@@ -337,6 +362,9 @@ public:
 	//! Default constructor
 	CustomScaleParamsComputer() : m_firstScale(true) {}
 
+	//inherited from ScaleParamsComputer
+	virtual ScaleParamsComputer* clone() const { return new CustomScaleParamsComputer(*this); }
+
 	//inherited from ScaleParamsComputer
 	virtual unsigned getID() const { return DESC_CUSTOM; }
 
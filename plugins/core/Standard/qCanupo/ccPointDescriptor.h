@@ -24,6 +24,7 @@
 
 //CCLib
 #include <ReferenceCloud.h>
+#include <SquareMatrix.h>
 
 //system
 #include <vector>
@@ -63,6 +64,13 @@ public:
 public:
 	virtual ~ScaleParamsComputer() = default;
 	
+	//! Returns a new instance of this computer
+	/** The computers have a per-point state (see reset): the descriptors can only be
+		computed in parallel if each thread can have its own instance.
+		\return a new instance (to be deleted by the caller) or nullptr if not supported
+	**/
+	virtual ScaleParamsComputer* clone() const { return nullptr; }
+
 	//! Returns the associated descriptor ID
 	virtual unsigned getID() const = 0;
 
@@ -88,6 +96,24 @@ public:
 	**/
 	virtual bool computeScaleParams(CCLib::ReferenceCloud& neighbors, double radius, float params[], bool& invalidScale) = 0;
 
+	//! Returns whether the parameters only depend on the covariance matrix of the neighbors
+	/** In this case, computeScaleParamsFromCovariance is called instead of computeScaleParams
+		(the covariance matrices of all the scales are accumulated incrementally from a single
+		neighborhood extraction).
+	**/
+	virtual bool usesCovarianceOnly() const { return false; }
+
+	//! Computes the parameters at a given scale from the covariance matrix of the neighbors
+	/** Same as computeScaleParams (see usesCovarianceOnly).
+		\param[in] covMat covariance matrix of the neighbors at the current scale
+		\param[in] pointCount number of neighbors at the current scale
+		\param[in] radius current radius (half scale) value
+		\param[out] params the computed parameters
+		\param[out] invalidScale whether this scale is 'invalid'
+		\return false if an error occurred
+	**/
+	virtual bool computeScaleParamsFromCovariance(const CCLib::SquareMatrixd& /*covMat*/, unsigned /*pointCount*/, double /*radius*/, float /*params*/[], bool& /*invalidScale*/) { return false; }
+
 protected:
 };
 
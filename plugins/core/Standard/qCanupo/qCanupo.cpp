@@ -256,6 +256,64 @@ void qCanupoPlugin::doClassifyAction()
 	}
 }
 
+//! Computes the descriptors of a set of training core points
+/** If the whole cloud is used as core points, the descriptors previously stored as
+	meta-data on the cloud are reused (if they are compatible). Otherwise the newly
+	computed descriptors are stored so that the next training (or classification) can
+	reuse them.
+**/
+static bool ComputeTrainingDescriptors(	CCLib::GenericIndexedCloudPersist* corePoints,
+										ccPointCloud* cloud,
+										ccGenericPointCloud* sourceCloud,
+										CorePointDescSet& descriptors,
+										const std::vector<float>& scales,
+										unsigned descriptorID,
+										int maxThreadCount,
+										bool& invalidDescriptors,
+										QString& errorStr,
+										ccProgressDialog* pDlg,
+										ccMainAppInterface* app)
+{
+	invalidDescriptors = false;
+
+	bool wholeCloud = (corePoints == cloud);
+	if (wholeCloud && qCanupoTools::LoadDescriptorsFromMetaData(cloud, descriptors, sourceCloud))
+	{
+		if (	descriptors.descriptorID() == descriptorID
+			&&	qCanupoTools::CompareVectors(descriptors.scales(), scales))
+		{
+			app->dispToConsole(QString("[qCanupo] Reusing the MSC descriptors stored as meta-data (cloud '%1')").arg(cloud->getName()));
+			return true;
+		}
+		//incompatible descriptors
+		descriptors = CorePointDescSet();
+	}
+
+	if (!qCanupoTools::ComputeCorePointsDescriptors(corePoints,
+		descriptors,
+		sourceCloud,
+		scales,
+		invalidDescriptors,
+		errorStr,
+		descriptorID,
+		maxThreadCount,
+		pDlg))
+	{
+		return false;
+	}
+
+	//we don't overwrite the existing meta-data silently
+	if (wholeCloud && !qCanupoTools::HasDescriptorsMetaData(cloud))
+	{
+		if (qCanupoTools::SaveDescriptorsAsMetaData(cloud, descriptors, sourceCloud))
+		{
+			app->dispToConsole(QString("[qCanupo] MSC descriptors have been saved as meta-data (cloud '%1')").arg(cloud->getName()));
+		}
+	}
+
+	return true;
+}
+
 void qCanupoPlugin::doTrainAction()
 {
 	//disclaimer accepted?
@@ -393,17 +451,18 @@ void qCanupoPlugin::doTrainAction()
 		{
 			bool invalidDescriptors = false;
 			QString errorStr;
-			if (!qCanupoTools::ComputeCorePointsDescriptors(corePoints1,
-				descriptors1,
+			if (!ComputeTrainingDescriptors(corePoints1,
+				cloud1,
 				//if the origin cloud was specified, then we'll use it as base cloud for descriptors
 				originCloud ? originCloud : cloud1,
+				descriptors1,
 				scales,
-				invalidDescriptors,
-				errorStr,
 				descriptorID,
 				ctDlg.getMaxThreadCount(),
-				&pDlg/*,
-				octree*/))
+				invalidDescriptors,
+				errorStr,
+				&pDlg,
+				m_app))
 			{
 				m_app->dispToConsole(QString("Failed to compute core points descriptors: %1").arg(errorStr), ccMainAppInterface::ERR_CONSOLE_MESSAGE);
 				break;
@@ -419,17 +478,18 @@ void qCanupoPlugin::doTrainAction()
 		{
 			bool invalidDescriptors = false;
 			QString errorStr;
-			if (!qCanupoTools::ComputeCorePointsDescriptors(corePoints2,
-				descriptors2,
+			if (!ComputeTrainingDescriptors(corePoints2,
+				cloud2,
 				//if the origin cloud was specified, then we'll use it as base cloud for descriptors
 				originCloud ? originCloud : cloud2,
+				descriptors2,
 				scales,
-				invalidDescriptors,
-				errorStr,
 				descriptorID,
 				ctDlg.getMaxThreadCount(),
-				&pDlg/*,
-				octree*/))
+				invalidDescriptors,
+				errorStr,
+				&pDlg,
+				m_app))
 			{
 				m_app->dispToConsole(QString("Failed to compute core points descriptors: %1").arg(errorStr), ccMainAppInterface::ERR_CONSOLE_MESSAGE);
 				break;
@@ -448,15 +508,17 @@ void qCanupoPlugin::doTrainAction()
 			//computes the 'descriptors'
 			bool invalidDescriptors = false;
 			QString errorStr;
-			if (!qCanupoTools::ComputeCorePointsDescriptors(evaluationPoints,
-				evaluationDescriptors,
+			if (!ComputeTrainingDescriptors(evaluationPoints,
 				evaluationCloud,
+				evaluationCloud,
+				evaluationDescriptors,
 				scales,
-				invalidDescriptors,
-				errorStr,
 				descriptorID,
 				ctDlg.getMaxThreadCount(),
-				&pDlg))
+				invalidDescriptors,
+				errorStr,
+				&pDlg,
+				m_app))
 			{
 				m_app->dispToConsole(QString("Failed to compute core points descriptors: %1").arg(errorStr), ccMainAppInterface::ERR_CONSOLE_MESSAGE);
 				break;
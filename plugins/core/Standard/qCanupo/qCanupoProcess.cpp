@@ -45,9 +45,6 @@ static const char CANUPO_PER_LEVEL_ROUGHNESS_SF_NAME[] = "CANUPO.roughness";
 #endif
 static const char CANUPO_PER_LEVEL_ADDITIONAL_SF_NAME[] = "CANUPO.(x-y)";
 
-//Reserved name for CANUPO 'MSC' meta-data
-static const char s_canupoMSCMetaData[] = "CanupoMSCData";
-
 //Tries to refine the classification (returns the new confidence if successful)
 float RefinePointClassif(	const Classifier& classifier,
 							const float confidence,
@@ -300,26 +297,19 @@ bool qCanupoProcess::Classify(	QString classifierFilename,
 	ccProgressDialog pDlg(true, parentWidget);
 
 	//does the core point cloud has associated meta-data?
-	QVariant mscMetaData;
+	bool hasMetaData = false;
 	bool useExistingMetaData = false;
-	if (realCorePoints)
+	if (realCorePoints && qCanupoTools::HasDescriptorsMetaData(realCorePoints))
 	{
-		mscMetaData = realCorePoints->getMetaData(s_canupoMSCMetaData);
-		if (mscMetaData.isValid())
+		hasMetaData = true;
+		if (qCanupoTools::LoadDescriptorsFromMetaData(realCorePoints, corePointsDescriptors, cloud))
 		{
-			bool validMetaData = (	mscMetaData.type() == QVariant::ByteArray
-								&&	corePointsDescriptors.fromByteArray(mscMetaData.toByteArray()));
-
-			if (validMetaData)
-			{
-				useExistingMetaData = true;
-			}
-			else
-			{
-				if (app)
-					app->dispToConsole("[qCanupo] Failed to read core point cloud associated MSC meta data?!", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
-				mscMetaData.clear();
-			}
+			useExistingMetaData = true;
+		}
+		else
+		{
+			if (app)
+				app->dispToConsole("[qCanupo] The core point cloud associated MSC meta data can't be used (invalid, or computed on another cloud)", ccMainAppInterface::WRN_CONSOLE_MESSAGE);
 		}
 	}
 
@@ -1042,7 +1032,7 @@ bool qCanupoProcess::Classify(	QString classifierFilename,
 				if (realCorePoints && !useExistingMetaData)
 				{
 					bool proceed = true;
-					if (mscMetaData.isValid())
+					if (hasMetaData)
 					{
 						proceed = (silent || QMessageBox::question(	parentWidget,
 																	"Overwrite MSC meta-data?",
@@ -1054,10 +1044,8 @@ bool qCanupoProcess::Classify(	QString classifierFilename,
 
 					if (proceed)
 					{
-						mscMetaData = corePointsDescriptors.toByteArray();
-						if (mscMetaData.isValid())
+						if (qCanupoTools::SaveDescriptorsAsMetaData(realCorePoints, corePointsDescriptors, cloud))
 						{
-							realCorePoints->setMetaData(s_canupoMSCMetaData, mscMetaData);
 							if (app)
 								app->dispToConsole(QString("[qCanupo] MSC descriptors have been saved as meta-data (cloud '%1')").arg(realCorePoints->getName()));
 						}
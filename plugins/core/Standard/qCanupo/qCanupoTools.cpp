@@ -40,8 +40,15 @@
 #include <QComboBox>
 #include <QMainWindow>
 #include <QProgressDialog>
+#include <QScopedPointer>
 #include <QtConcurrentMap>
 
+//system
+#include <algorithm>
+
+//! Number of core points processed by each (parallel) task
+static const unsigned c_corePointsBatchSize = 256;
+
 //ComputeCorePointsDescriptors parameters
 static struct
 {
@@ -57,20 +64,115 @@ static struct
 	bool errorOccurred;
 
 	ScaleParamsComputer* computer; //the per-scale parameters computer 
+	bool cloneComputer; //whether each task should use its own copy of the computer (parallel mode)
 
 	std::vector<ccScalarField*>* roughnessSFs; //for test
 
 
 } s_computeCorePointsDescParams;
 
-//! Per-point descriptor computer (all the parameters are stored in s_computeCorePointsDescParams)
-void ComputeCorePointDescriptor(unsigned index)
+//! Per-task workspace (reused from one core point to the next)
+struct CorePointDescWorkspace
 {
-	if (s_computeCorePointsDescParams.processCanceled)
-		return;
+	CorePointDescWorkspace(ccGenericPointCloud* sourceCloud, size_t scaleCount)
+		: subset(sourceCloud)
+		, scaleCounts(scaleCount, 0)
+		, scaleSums(scaleCount * 9, 0.0)
+	{}
 
-	const CCVector3* P = s_computeCorePointsDescParams.corePoints->getPoint(index);
+	//! Neighbors (at the biggest scale)
 	CCLib::DgmOctree::NeighboursSet neighbours;
+	//! Neighbors subset (generic computers only)
+	CCLib::ReferenceCloud subset;
+	//! Number of neighbors at each scale
+	std::vector<size_t> scaleCounts;
+	//! Sums of the neighbors coordinates (3) and of their products (6) at each scale
+	std::vector<double> scaleSums;
+};
+
+//! Computes the parameters of all the scales from their covariance matrices
+/** The neighbors being sorted by increasing distance, the neighborhood of each scale is
+	a prefix of the biggest one: the moments are accumulated incrementally, from the
+	smallest scale to the biggest.
+**/
+static bool ComputeScalesParamsFromCovariance(	const CCVector3* P,
+												CorePointDesc& desc,
+												ScaleParamsComputer* computer,
+												CorePointDescWorkspace& workspace)
+{
+	const std::vector<float>& scales = s_computeCorePointsDescParams.descriptors->scales();
+	size_t scaleCount = scales.size();
+	unsigned dimPerScale = s_computeCorePointsDescParams.descriptors->dimPerScale();
+
+	//accumulate the moments (relatively to the core point, for the sake of accuracy)
+	{
+		double sums[9] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+		size_t j = 0;
+		for (size_t i = scaleCount; i-- != 0;) //we start from the smallest
+		{
+			for (; j < workspace.scaleCounts[i]; ++j)
+			{
+				CCVector3d Q = CCVector3d::fromArray((*workspace.neighbours[j].point - *P).u);
+				sums[0] += Q.x;
+				sums[1] += Q.y;
+				sums[2] += Q.z;
+				sums[3] += Q.x * Q.x;
+				sums[4] += Q.y * Q.y;
+				sums[5] += Q.z * Q.z;
+				sums[6] += Q.x * Q.y;
+				sums[7] += Q.x * Q.z;
+				sums[8] += Q.y * Q.z;
+			}
+			memcpy(&(workspace.scaleSums[i * 9]), sums, sizeof(double) * 9);
+		}
+	}
+
+	for (size_t i = 0; i < scaleCount; ++i)
+	{
+		const double radius = scales[i] / 2; //we start from the biggest
+		const size_t count = workspace.scaleCounts[i];
+		const double* sums = &(workspace.scaleSums[i * 9]);
+
+		CCLib::SquareMatrixd covMat(3);
+		if (count != 0)
+		{
+			CCVector3d G(sums[0] / count, sums[1] / count, sums[2] / count);
+			covMat.m_values[0][0] = sums[3] / count - G.x * G.x;
+			covMat.m_values[1][1] = sums[4] / count - G.y * G.y;
+			covMat.m_values[2][2] = sums[5] / count - G.z * G.z;
+			covMat.m_values[1][0] = covMat.m_values[0][1] = sums[6] / count - G.x * G.y;
+			covMat.m_values[2][0] = covMat.m_values[0][2] = sums[7] / count - G.x * G.z;
+			covMat.m_values[2][1] = covMat.m_values[1][2] = sums[8] / count - G.y * G.z;
+		}
+
+		bool invalidScale = false;
+		if (!computer->computeScaleParamsFromCovariance(covMat, static_cast<unsigned>(count), radius, &(desc.params[i*dimPerScale]), invalidScale))
+		{
+			return false;
+		}
+
+		if (invalidScale)
+		{
+			s_computeCorePointsDescParams.invalidDescriptors = true;
+			//no need to compute the remaining scales!
+			for (size_t j = i + 1; j < scaleCount; ++j)
+			{
+				//copy the same parameters for all scales (see CANUPO paper)
+				memcpy(&(desc.params[j*dimPerScale]), &(desc.params[i*dimPerScale]), sizeof(float)*dimPerScale);
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+//! Per-point descriptor computer (all the parameters are stored in s_computeCorePointsDescParams)
+static bool ComputeCorePointDescriptor(unsigned index, ScaleParamsComputer* computer, CorePointDescWorkspace& workspace)
+{
+	const CCVector3* P = s_computeCorePointsDescParams.corePoints->getPoint(index);
+	CCLib::DgmOctree::NeighboursSet& neighbours = workspace.neighbours;
+	neighbours.clear();
 
 	//extract the neighbors (maximum radius)
 	float maxRadius = s_computeCorePointsDescParams.descriptors->scales().front()/2;
@@ -79,127 +181,174 @@ void ComputeCorePointDescriptor(unsigned index)
 																				neighbours,
 																				s_computeCorePointsDescParams.octreeLevel);
 
-	if (n != 0)
+	if (n == 0)
 	{
-		size_t scaleCount = s_computeCorePointsDescParams.descriptors->scales().size();
+		//if the widest neighborhood has less than 3 points, we can't compute a valid descriptor!
+		s_computeCorePointsDescParams.invalidDescriptors = true;
+		return true;
+	}
 
-		//get reference on corresponding descriptor
-		assert(s_computeCorePointsDescParams.descriptors->size() > index);
-		CorePointDesc& desc = s_computeCorePointsDescParams.descriptors->at(index);
+	const std::vector<float>& scales = s_computeCorePointsDescParams.descriptors->scales();
+	size_t scaleCount = scales.size();
 
-		unsigned dimPerScale = s_computeCorePointsDescParams.descriptors->dimPerScale();
-		assert(desc.params.size() == scaleCount*dimPerScale);
+	//get reference on corresponding descriptor
+	assert(s_computeCorePointsDescParams.descriptors->size() > index);
+	CorePointDesc& desc = s_computeCorePointsDescParams.descriptors->at(index);
 
-		//init the whole neighborhood subset (we will prune it each time)
-		CCLib::ReferenceCloud subset(s_computeCorePointsDescParams.sourceCloud);
-		{
-			if (!subset.reserve(n))
-			{
-				//not enough memory!
-				s_computeCorePointsDescParams.errorOccurred = true;
-				s_computeCorePointsDescParams.processCanceled = true; //to make the loop stop!
-				return;
-			}
+	unsigned dimPerScale = s_computeCorePointsDescParams.descriptors->dimPerScale();
+	assert(desc.params.size() == scaleCount*dimPerScale);
 
-			//sort the neighbors by increasing distance
-			ParallelSort(neighbours.begin(), neighbours.end(), CCLib::DgmOctree::PointDescriptor::distComp);
+	//sort the neighbors by increasing distance (we are already in a parallel task)
+	std::sort(neighbours.begin(), neighbours.begin() + n, CCLib::DgmOctree::PointDescriptor::distComp);
 
-			for (int j = 0; j < n; ++j)
-			{
-				subset.addPointIndex(neighbours[j].pointIndex);
-			}
-		}
+	//number of neighbors in each (nested) neighborhood
+	workspace.scaleCounts[0] = static_cast<size_t>(n);
+	for (size_t i = 1; i < scaleCount; ++i)
+	{
+		const double radius = scales[i] / 2;
+		double squareRadius = radius*radius;
+		CCLib::DgmOctree::PointDescriptor fakeDesc(nullptr, 0, squareRadius);
+		CCLib::DgmOctree::NeighboursSet::iterator up = std::upper_bound(neighbours.begin(), neighbours.begin() + n, fakeDesc, CCLib::DgmOctree::PointDescriptor::distComp);
+		size_t count = std::max<size_t>(1, up - neighbours.begin());
+		workspace.scaleCounts[i] = std::min(count, workspace.scaleCounts[i - 1]);
+	}
+
+	computer->reset();
 
-		s_computeCorePointsDescParams.computer->reset();
+	if (!s_computeCorePointsDescParams.roughnessSFs && computer->usesCovarianceOnly())
+	{
+		return ComputeScalesParamsFromCovariance(P, desc, computer, workspace);
+	}
 
-		for (size_t i=0; i<scaleCount; ++i)
+	//init the whole neighborhood subset (we will prune it each time)
+	CCLib::ReferenceCloud& subset = workspace.subset;
+	subset.clear(false);
+	if (!subset.reserve(n))
+	{
+		//not enough memory!
+		return false;
+	}
+	for (int j = 0; j < n; ++j)
+	{
+		subset.addPointIndex(neighbours[j].pointIndex);
+	}
+
+	for (size_t i=0; i<scaleCount; ++i)
+	{
+		const double radius = scales[i]/2; //we start from the biggest
+
+		//trim the points that don't fall in the current neighborhood
+		subset.resize(static_cast<unsigned>(workspace.scaleCounts[i]));
+
+		//optional: compute per-level roughness
+		if (s_computeCorePointsDescParams.roughnessSFs)
 		{
-			const double radius = s_computeCorePointsDescParams.descriptors->scales()[i]/2; //we start from the biggest
+			ScalarType roughness = NAN_VALUE;
 
-			if (i != 0)
+			if (subset.size() >= 3)
 			{
-				//trim the points that don't fall in the current neighborhood
-				double squareRadius = radius*radius;
-				CCLib::DgmOctree::PointDescriptor fakeDesc(nullptr,0,squareRadius);
-				CCLib::DgmOctree::NeighboursSet::iterator up = std::upper_bound(neighbours.begin(),neighbours.end(),fakeDesc,CCLib::DgmOctree::PointDescriptor::distComp);
-				if (up != neighbours.end())
+				//to compute we take the nearest point to the query point as 'central' point
+				//warning: it should work in most of the cases, apart if the core points have nothing to do
+				//with the global cloud!!!
+				unsigned lastIndex = subset.size()-1;
+				subset.swap(0, lastIndex);
+
+				//temporarily remove the central point (now at the end)
+				unsigned globalIndex = subset.getPointGlobalIndex(lastIndex);
+				subset.resize(lastIndex);
+				
+				CCLib::Neighbourhood Z(&subset);
+				const PointCoordinateType* lsPlane = Z.getLSPlane();
+				if (lsPlane)
 				{
-					size_t count = std::max<size_t>( 1, up - neighbours.begin() );
-			
-					neighbours.resize(count);
-					subset.resize(static_cast<unsigned>(count));
+					//distance to the LS plane fitted on the nearest neighbors
+					const CCVector3* centralPoint = s_computeCorePointsDescParams.sourceCloud->getPoint(globalIndex);
+					roughness = fabs(CCLib::DistanceComputationTools::computePoint2PlaneDistance(centralPoint,lsPlane));
 				}
+
+				//put back the point at its original place!
+				subset.addPointIndex(globalIndex);
+				subset.swap(0, lastIndex);
 			}
 
-			//optional: compute per-level roughness
-			if (s_computeCorePointsDescParams.roughnessSFs)
+			assert(s_computeCorePointsDescParams.roughnessSFs->size() == scaleCount);
+			ccScalarField* sf = s_computeCorePointsDescParams.roughnessSFs->at(i);
+			assert(sf && sf->currentSize() > index);
+			sf->setValue(index,roughness);
+		}
+
+		bool invalidScale = false;
+		if (!computer->computeScaleParams(subset, radius, &(desc.params[i*dimPerScale]), invalidScale))
+		{
+			//an error occurred!
+			return false;
+		}
+
+		if (invalidScale)
+		{
+			s_computeCorePointsDescParams.invalidDescriptors = true;
+			//no need to compute the remaining scales!
+			for (size_t j=i+1; j<scaleCount; ++j)
 			{
-				ScalarType roughness = NAN_VALUE;
+				//copy the same parameters for all scales (see CANUPO paper)
+				memcpy(&(desc.params[j*dimPerScale]), &(desc.params[i*dimPerScale]), sizeof(float)*dimPerScale);
+			}
+			break;
+		}
+	}
 
-				if (subset.size() >= 3)
-				{
-					//to compute we take the nearest point to the query point as 'central' point
-					//warning: it should work in most of the cases, apart if the core points have nothing to do
-					//with the global cloud!!!
-					unsigned lastIndex = subset.size()-1;
-					subset.swap(0, lastIndex);
-
-					//temporarily remove the central point (now at the end)
-					unsigned globalIndex = subset.getPointGlobalIndex(lastIndex);
-					subset.resize(lastIndex);
-					
-					CCLib::Neighbourhood Z(&subset);
-					const PointCoordinateType* lsPlane = Z.getLSPlane();
-					if (lsPlane)
-					{
-						//distance to the LS plane fitted on the nearest neighbors
-						const CCVector3* centralPoint = s_computeCorePointsDescParams.sourceCloud->getPoint(globalIndex);
-						roughness = fabs(CCLib::DistanceComputationTools::computePoint2PlaneDistance(centralPoint,lsPlane));
-					}
+	return true;
+}
 
-					//put back the point at its original place!
-					subset.addPointIndex(globalIndex);
-					subset.swap(0, lastIndex);
-				}
+//! Per-batch descriptors computer (all the parameters are stored in s_computeCorePointsDescParams)
+static void ComputeCorePointsDescriptorsBatch(unsigned batchIndex)
+{
+	if (s_computeCorePointsDescParams.processCanceled)
+		return;
 
-				assert(s_computeCorePointsDescParams.roughnessSFs->size() == scaleCount);
-				ccScalarField* sf = s_computeCorePointsDescParams.roughnessSFs->at(i);
-				assert(sf && sf->currentSize() > index);
-				sf->setValue(index,roughness);
-			}
+	unsigned corePtsCount = s_computeCorePointsDescParams.corePoints->size();
+	unsigned firstIndex = batchIndex * c_corePointsBatchSize;
+	unsigned lastIndex = std::min(firstIndex + c_corePointsBatchSize, corePtsCount);
+	assert(firstIndex < lastIndex);
+
+	try
+	{
+		//the computers have a per-point state: each task needs its own copy in parallel mode
+		QScopedPointer<ScaleParamsComputer> clonedComputer(s_computeCorePointsDescParams.cloneComputer ? s_computeCorePointsDescParams.computer->clone() : nullptr);
+		ScaleParamsComputer* computer = s_computeCorePointsDescParams.cloneComputer ? clonedComputer.data() : s_computeCorePointsDescParams.computer;
+		if (!computer)
+		{
+			s_computeCorePointsDescParams.errorOccurred = true;
+			s_computeCorePointsDescParams.processCanceled = true; //to make the loop stop!
+			return;
+		}
+
+		CorePointDescWorkspace workspace(s_computeCorePointsDescParams.sourceCloud, s_computeCorePointsDescParams.descriptors->scales().size());
 
-			bool invalidScale = false;
-			if (!s_computeCorePointsDescParams.computer->computeScaleParams(subset, radius, &(desc.params[i*dimPerScale]), invalidScale))
+		for (unsigned i = firstIndex; i < lastIndex; ++i)
+		{
+			if (s_computeCorePointsDescParams.processCanceled)
+				return;
+
+			if (!ComputeCorePointDescriptor(i, computer, workspace))
 			{
 				//an error occurred!
 				s_computeCorePointsDescParams.errorOccurred = true;
 				s_computeCorePointsDescParams.processCanceled = true; //to make the loop stop!
 				return;
 			}
-
-			if (invalidScale)
-			{
-				s_computeCorePointsDescParams.invalidDescriptors = true;
-				//no need to compute the remaining scales!
-				for (size_t j=i+1; j<scaleCount; ++j)
-				{
-					//copy the same parameters for all scales (see CANUPO paper)
-					memcpy(&(desc.params[j*dimPerScale]), &(desc.params[i*dimPerScale]), sizeof(float)*dimPerScale);
-				}
-				//neighbours.clear();
-				//subset.clear(true);
-				break;
-			}
 		}
 	}
-	else
+	catch (const std::bad_alloc&)
 	{
-		//if the widest neighborhood has less than 3 points, we can't compute a valid descriptor!
-		s_computeCorePointsDescParams.invalidDescriptors = true;
+		//not enough memory!
+		s_computeCorePointsDescParams.errorOccurred = true;
+		s_computeCorePointsDescParams.processCanceled = true; //to make the loop stop!
+		return;
 	}
-	
+
 	//progress notification
-	if (s_computeCorePointsDescParams.nProgress && !s_computeCorePointsDescParams.nProgress->oneStep())
+	if (s_computeCorePointsDescParams.nProgress && !s_computeCorePointsDescParams.nProgress->steps(lastIndex - firstIndex))
 	{
 		s_computeCorePointsDescParams.processCanceled = true;
 	}
@@ -317,12 +466,25 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 	useParallelStrategy = false;
 #endif
 
-	std::vector<unsigned> corePointsIndexes;
+	//the core points are processed by batches (to reuse the per-task workspace)
+	unsigned batchCount = (corePtsCount + c_corePointsBatchSize - 1) / c_corePointsBatchSize;
+
+	if (useParallelStrategy)
+	{
+		//each task needs its own computer (see ScaleParamsComputer::clone)
+		QScopedPointer<ScaleParamsComputer> testClone(s_computeCorePointsDescParams.computer->clone());
+		if (!testClone)
+		{
+			useParallelStrategy = false;
+		}
+	}
+
+	std::vector<unsigned> batchIndexes;
 	if (useParallelStrategy)
 	{
 		try
 		{
-			corePointsIndexes.resize(corePtsCount);
+			batchIndexes.resize(batchCount);
 		}
 		catch (const std::bad_alloc&)
 		{
@@ -333,9 +495,9 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 
 	if (useParallelStrategy)
 	{
-		for (unsigned i=0; i<corePtsCount; ++i)
+		for (unsigned i=0; i<batchCount; ++i)
 		{
-			corePointsIndexes[i] = i;
+			batchIndexes[i] = i;
 		}
 
 		if (maxThreadCount == 0)
@@ -344,14 +506,16 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 		}
 		assert(maxThreadCount <= QThread::idealThreadCount());
 		QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
-		QtConcurrent::blockingMap(corePointsIndexes, ComputeCorePointDescriptor);
+		s_computeCorePointsDescParams.cloneComputer = true;
+		QtConcurrent::blockingMap(batchIndexes, ComputeCorePointsDescriptorsBatch);
 	}
 	else
 	{
-		//manually call the static per-point method!
-		for (unsigned i=0; i<corePtsCount; ++i)
+		//manually call the static per-batch method!
+		s_computeCorePointsDescParams.cloneComputer = false;
+		for (unsigned i=0; i<batchCount; ++i)
 		{
-			ComputeCorePointDescriptor(i);
+			ComputeCorePointsDescriptorsBatch(i);
 		}
 	}
 
@@ -375,6 +539,7 @@ bool qCanupoTools::ComputeCorePointsDescriptors(CCLib::GenericIndexedCloud* core
 	s_computeCorePointsDescParams.errorOccurred = false;
 	s_computeCorePointsDescParams.invalidDescriptors = false;
 	s_computeCorePointsDescParams.computer = nullptr;
+	s_computeCorePointsDescParams.cloneComputer = false;
 
 	if (progressCb)
 	{
@@ -416,6 +581,76 @@ size_t qCanupoTools::TestVectorsOverlap(const std::vector<float>& first, const s
 }
 
 
+//MSC descriptors meta-data keys
+static const char s_canupoMSCMetaData[] = "CanupoMSCData";
+static const char s_canupoMSCSourceMetaData[] = "CanupoMSCSource";
+
+//! Returns a tag identifying the cloud on which descriptors are computed
+/** We don't rely on the unique ID as it changes from one session to the other.
+	The (global) bounding box is written with full precision, so that two clouds
+	with the same number of points can hardly get the same tag.
+**/
+static QString GetDescriptorsSourceTag(ccGenericPointCloud* sourceCloud)
+{
+	ccBBox box = sourceCloud->getOwnBB();
+	CCVector3d minCorner = sourceCloud->toGlobal3d(box.minCorner());
+	CCVector3d maxCorner = sourceCloud->toGlobal3d(box.maxCorner());
+	return QString("%1 points - [%2;%3;%4]-[%5;%6;%7]")
+		.arg(sourceCloud->size())
+		.arg(minCorner.x, 0, 'g', 17).arg(minCorner.y, 0, 'g', 17).arg(minCorner.z, 0, 'g', 17)
+		.arg(maxCorner.x, 0, 'g', 17).arg(maxCorner.y, 0, 'g', 17).arg(maxCorner.z, 0, 'g', 17);
+}
+
+bool qCanupoTools::HasDescriptorsMetaData(const ccPointCloud* corePoints)
+{
+	return corePoints && corePoints->hasMetaData(s_canupoMSCMetaData);
+}
+
+bool qCanupoTools::LoadDescriptorsFromMetaData(	const ccPointCloud* corePoints,
+												CorePointDescSet& descriptors,
+												ccGenericPointCloud* sourceCloud)
+{
+	assert(corePoints && sourceCloud);
+
+	QVariant mscMetaData = corePoints->getMetaData(s_canupoMSCMetaData);
+	if (	mscMetaData.type() != QVariant::ByteArray
+		||	!descriptors.fromByteArray(mscMetaData.toByteArray())
+		||	descriptors.size() != corePoints->size())
+	{
+		descriptors = CorePointDescSet();
+		return false;
+	}
+
+	//check the source cloud (if the descriptors are tagged)
+	QVariant sourceMetaData = corePoints->getMetaData(s_canupoMSCSourceMetaData);
+	if (sourceMetaData.isValid() && sourceMetaData.toString() != GetDescriptorsSourceTag(sourceCloud))
+	{
+		descriptors = CorePointDescSet();
+		return false;
+	}
+
+	return true;
+}
+
+bool qCanupoTools::SaveDescriptorsAsMetaData(	ccPointCloud* corePoints,
+												const CorePointDescSet& descriptors,
+												ccGenericPointCloud* sourceCloud)
+{
+	assert(corePoints && sourceCloud);
+
+	QByteArray data = descriptors.toByteArray();
+	if (data.isEmpty())
+	{
+		//not enough memory
+		return false;
+	}
+
+	corePoints->setMetaData(s_canupoMSCMetaData, data);
+	corePoints->setMetaData(s_canupoMSCSourceMetaData, GetDescriptorsSourceTag(sourceCloud));
+
+	return true;
+}
+
 QString qCanupoTools::GetEntityName(ccHObject* obj)
 {
 	if (!obj)
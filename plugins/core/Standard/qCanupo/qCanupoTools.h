@@ -92,6 +92,28 @@ public:
 												CCLib::DgmOctree* inputOctree = 0,
 												std::vector<ccScalarField*>* roughnessSFs = 0 /*for tests*/); 
 
+	//! Returns whether a core points cloud has descriptors stored as meta-data
+	static bool HasDescriptorsMetaData(const ccPointCloud* corePoints);
+
+	//! Loads the descriptors stored as meta-data on a core points cloud
+	/** The descriptors are rejected if they don't match the core points, or if they
+		have been computed on another source cloud than the specified one.
+		\param corePoints core points cloud
+		\param descriptors output descriptors
+		\param sourceCloud cloud on which the descriptors should have been computed
+		\return whether valid descriptors have been loaded
+	**/
+	static bool LoadDescriptorsFromMetaData(const ccPointCloud* corePoints,
+											CorePointDescSet& descriptors,
+											ccGenericPointCloud* sourceCloud);
+
+	//! Saves descriptors as meta-data on a core points cloud (see LoadDescriptorsFromMetaData)
+	/** \return false if not enough memory
+	**/
+	static bool SaveDescriptorsAsMetaData(	ccPointCloud* corePoints,
+											const CorePointDescSet& descriptors,
+											ccGenericPointCloud* sourceCloud);
+
 	//! Returns a long description of a given entity (name + [ID])
 	static QString GetEntityName(ccHObject* obj);
 
@@ -18,6 +18,12 @@
 #include "ccTrace.h"
 #include <queue>
 #include <bitset>
+#include <limits>
+
+const int ccTrace::CostCache::UNKNOWN_COST = std::numeric_limits<int>::min();
+
+//max number of edges in the cost cache (~8 bytes each, plus the per-point ranges) before it is flushed
+static const size_t c_maxCachedEdges = (1 << 25);
 
 ccTrace::ccTrace(ccPointCloud* associatedCloud) : ccPolyline(associatedCloud)
 {
@@ -181,6 +187,9 @@ bool ccTrace::optimizePath(int maxIterations)
 	//update stored cost function etc.
 	updateMetadata();
 
+	//flush the cached costs if the cost function has changed
+	updateCostCache();
+
 	//update internal vars
 	m_maxIterations = maxIterations;
 
@@ -321,6 +330,11 @@ std::deque<int> ccTrace::optimizeSegment(int start, int end, int offset)
 	}
 	unsigned char level = oct->findBestLevelForAGivenNeighbourhoodSizeExtraction(m_search_r);
 
+	//which cost functions are used (the RGB cost depends on the start/end points, so it can't be cached)
+	bool useRGB = (m_cloud->hasColors() && (COST_MODE & MODE::RGB));
+	bool needsNeighbourhood = ((COST_MODE & MODE::CURVE) && !isCurvaturePrecomputed())
+							|| (m_cloud->hasColors() && (COST_MODE & MODE::GRADIENT) && !isGradientPrecomputed());
+
 	//initialize start node on node_buffer and add to openQueue
 	node_buffer[0].set(start, 0, nullptr);
 	openQueue.push(&node_buffer[0]);
@@ -382,32 +396,52 @@ std::deque<int> ccTrace::optimizeSegment(int start, int end, int offset)
 					(cur->y - end_v->y)*(cur->y - end_v->y) +
 					(cur->z - end_v->z)*(cur->z - end_v->z);
 
-		//fill "neighbours" with nodes - essentially get results of a "sphere" search around active current point
-		m_neighbours.clear();
-    
-		oct->getPointsInSphericalNeighbourhood(*cur, PointCoordinateType(m_search_r), m_neighbours, level);
+		//get the neighbours of the active current point ("sphere" search) from the cache - they are only searched the first time
+		size_t firstEdge = 0;
+		unsigned edgeCount = 0;
+		bool neighboursLoaded = getCachedNeighbours(current_idx, oct, level, firstEdge, edgeCount);
 
 		//loop through neighbours
-		for (size_t i = 0; i < m_neighbours.size(); i++)
+		for (size_t e = firstEdge; e < firstEdge + edgeCount; e++)
 		{
-			m_p = m_neighbours[i];
+			int next_idx = m_costCache.neighbours[e];
 			
-			if (visited[m_p.pointIndex]) //Has this node been visited before? If so then bail.
+			if (visited[next_idx]) //Has this node been visited before? If so then bail.
 				continue;
 
 			//calculate (squared) distance from this neighbour to the end
-			next_d2 =	(m_p.point->x - end_v->x)*(m_p.point->x - end_v->x) +
-						(m_p.point->y - end_v->y)*(m_p.point->y - end_v->y) +
-						(m_p.point->z - end_v->z)*(m_p.point->z - end_v->z);
+			const CCVector3* next = m_cloud->getPoint(next_idx);
+			next_d2 =	(next->x - end_v->x)*(next->x - end_v->x) +
+						(next->y - end_v->y)*(next->y - end_v->y) +
+						(next->z - end_v->z)*(next->z - end_v->z);
 
 			if (next_d2 >= cur_d2) //Bigger than the original distance? If so then bail.
 				continue;
 
-			//calculate cost to this neighbour
-			cost = getSegmentCost(current_idx, m_p.pointIndex);
+			//calculate cost to this neighbour (the static part is only computed once per edge)
+			int& staticCost = m_costCache.costs[e];
+			if (staticCost == CostCache::UNKNOWN_COST)
+			{
+				if (needsNeighbourhood && !neighboursLoaded)
+				{
+					//the slow curvature/gradient costs need the neighbourhood of the current point
+					m_neighbours.clear();
+					for (size_t j = firstEdge; j < firstEdge + edgeCount; j++)
+					{
+						const CCVector3* P = m_cloud->getPoint(m_costCache.neighbours[j]);
+						m_neighbours.push_back(CCLib::DgmOctree::PointDescriptor(P, m_costCache.neighbours[j], (*P - *cur).norm2d()));
+					}
+					neighboursLoaded = true;
+				}
+				m_p = CCLib::DgmOctree::PointDescriptor(next, next_idx, (*next - *cur).norm2d());
+				staticCost = getStaticSegmentCost(current_idx, next_idx);
+			}
+			cost = staticCost;
+			if (useRGB)
+				cost += getSegmentCostRGB(current_idx, next_idx);
 
 			#ifdef DEBUG_PATH
-			m_cloud->setPointScalarValue(m_p.pointIndex, static_cast<ScalarType>(cost)); //STORE VISITED NODES (AND COST) FOR DEBUG VISUALISATIONS
+			m_cloud->setPointScalarValue(next_idx, static_cast<ScalarType>(cost)); //STORE VISITED NODES (AND COST) FOR DEBUG VISUALISATIONS
 			#endif
 
 			//transform into cost from start node
@@ -423,7 +457,7 @@ std::deque<int> ccTrace::optimizeSegment(int start, int end, int offset)
 			}
 
 			//initialize node on node buffer
-			node_buffer[nodeCount].set(m_p.pointIndex, cost, current);
+			node_buffer[nodeCount].set(next_idx, cost, current);
 
 			//push node to open set
 			openQueue.push(&node_buffer[nodeCount]);
@@ -432,7 +466,7 @@ std::deque<int> ccTrace::optimizeSegment(int start, int end, int offset)
 			nodeCount++;
 
 			//mark node as visited
-			visited[m_p.pointIndex] = true;
+			visited[next_idx] = true;
 		}
 	}
 
@@ -441,12 +475,19 @@ std::deque<int> ccTrace::optimizeSegment(int start, int end, int offset)
 }
 
 int ccTrace::getSegmentCost(int p1, int p2)
+{
+	int cost = getStaticSegmentCost(p1, p2);
+	if (m_cloud->hasColors() && (COST_MODE & MODE::RGB)) //check cloud has colour data
+		cost += getSegmentCostRGB(p1, p2);
+
+	return cost;
+}
+
+int ccTrace::getStaticSegmentCost(int p1, int p2)
 {
 	int cost=1; //n.b. default value is 1 so that if no cost functions are used, the function doesn't crash (and returns the unweighted shortest path)
 	if (m_cloud->hasColors()) //check cloud has colour data
 	{
-		if (COST_MODE & MODE::RGB)
-			cost += getSegmentCostRGB(p1, p2);
 		if (COST_MODE & MODE::DARK)
 			cost += getSegmentCostDark(p1, p2);
 		if (COST_MODE & MODE::LIGHT)
@@ -471,6 +512,65 @@ int ccTrace::getSegmentCost(int p1, int p2)
 	return cost;
 }
 
+void ccTrace::updateCostCache()
+{
+	const CCLib::ScalarField* displayedSF = m_cloud ? m_cloud->getCurrentDisplayedScalarField() : nullptr;
+	unsigned cloudSize = m_cloud ? m_cloud->size() : 0;
+	bool hasColors = m_cloud && m_cloud->hasColors();
+	bool gradientPrecomputed = m_cloud && isGradientPrecomputed();
+	bool curvaturePrecomputed = m_cloud && isCurvaturePrecomputed();
+
+	if (	m_costCache.costMode != COST_MODE
+		||	m_costCache.cloudSize != cloudSize
+		||	m_costCache.searchRadius != m_search_r
+		||	m_costCache.displayedSF != displayedSF
+		||	m_costCache.hasColors != hasColors
+		||	m_costCache.gradientPrecomputed != gradientPrecomputed
+		||	m_costCache.curvaturePrecomputed != curvaturePrecomputed)
+	{
+		m_costCache.clear();
+		m_costCache.costMode = COST_MODE;
+		m_costCache.cloudSize = cloudSize;
+		m_costCache.searchRadius = m_search_r;
+		m_costCache.displayedSF = displayedSF;
+		m_costCache.hasColors = hasColors;
+		m_costCache.gradientPrecomputed = gradientPrecomputed;
+		m_costCache.curvaturePrecomputed = curvaturePrecomputed;
+	}
+}
+
+bool ccTrace::getCachedNeighbours(int pointIdx, ccOctree::Shared& oct, unsigned char level, size_t& firstEdge, unsigned& edgeCount)
+{
+	auto it = m_costCache.ranges.find(pointIdx);
+	if (it != m_costCache.ranges.end())
+	{
+		firstEdge = it->second.first;
+		edgeCount = it->second.second;
+		return false;
+	}
+
+	//fill "neighbours" with nodes - essentially get results of a "sphere" search around the point
+	m_neighbours.clear();
+	oct->getPointsInSphericalNeighbourhood(*m_cloud->getPoint(pointIdx), PointCoordinateType(m_search_r), m_neighbours, level);
+
+	//the cache is flushed when it gets too big (the edges of the previously expanded points are not used anymore at this point)
+	if (m_costCache.neighbours.size() + m_neighbours.size() > c_maxCachedEdges)
+	{
+		m_costCache.clear();
+	}
+
+	firstEdge = m_costCache.neighbours.size();
+	edgeCount = static_cast<unsigned>(m_neighbours.size());
+	for (const CCLib::DgmOctree::PointDescriptor& n : m_neighbours)
+	{
+		m_costCache.neighbours.push_back(static_cast<int>(n.pointIndex));
+	}
+	m_costCache.costs.resize(firstEdge + edgeCount, CostCache::UNKNOWN_COST);
+	m_costCache.ranges[pointIdx] = std::make_pair(firstEdge, edgeCount);
+
+	return true;
+}
+
 int ccTrace::getSegmentCostRGB(int p1, int p2)
 {
 	//get colors
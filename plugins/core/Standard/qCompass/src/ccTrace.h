@@ -175,6 +175,12 @@ public:
 	*/
 	int getSegmentCost(int p1, int p2);
 
+	/*
+	Clears the cached neighbourhood graph and edge costs (see optimizeSegment). The cache is automatically
+	invalidated when the cost function (or the cloud) changes, so this is only needed to release memory.
+	*/
+	void clearCostCache() { m_costCache.clear(); }
+
 	//functions for calculating cost SFs
 	void buildGradientCost(QWidget* parent);
 	void buildCurvatureCost(QWidget* parent);
@@ -221,6 +227,10 @@ protected:
 	int getSegmentCostScalar(int p1, int p2);
 	int getSegmentCostScalarInv(int p1, int p2);
 
+	//sum of the cost functions that don't depend on the start/end points of the segment (i.e. all but getSegmentCostRGB(...)).
+	//These can be cached in the neighbourhood graph and reused for all the segments.
+	int getStaticSegmentCost(int p1, int p2);
+
 	//calculate the search radius that should be used for the shortest path calcs
 	float calculateOptimumSearchRadius();
 
@@ -264,6 +274,51 @@ private:
 		}
 	};
 
+	/*
+	Neighbourhood graph of the cloud, built lazily by optimizeSegment (the neighbours of a point are searched the first time
+	it is expanded) and reused by all the following searches. The static part of the cost of each edge is also stored
+	the first time it is needed (see getStaticSegmentCost). The cached costs are only valid for a given cost function
+	(COST_MODE, active scalar field, precomputed gradient/curvature, etc.) - see updateCostCache().
+	*/
+	class CostCache
+	{
+	public:
+
+		//marks an edge whose cost has not been computed yet
+		static const int UNKNOWN_COST;
+
+		void clear()
+		{
+			ranges.clear();
+			neighbours.clear();
+			costs.clear();
+		}
+
+		//parameters for which the cached costs are valid
+		int costMode = 0;
+		unsigned cloudSize = 0;
+		float searchRadius = 0;
+		const CCLib::ScalarField* displayedSF = nullptr;
+		bool hasColors = false;
+		bool gradientPrecomputed = false;
+		bool curvaturePrecomputed = false;
+
+		//first edge and number of edges of each expanded point
+		std::unordered_map<int, std::pair<size_t, unsigned>> ranges;
+		//neighbours (edge ends) and static costs of the edges
+		std::vector<int> neighbours;
+		std::vector<int> costs;
+	};
+
+	CostCache m_costCache;
+
+	//clears the cost cache if the cost function (or the cloud) has changed since it was built
+	void updateCostCache();
+
+	//returns the first edge and number of edges of a point in the cost cache (searching its neighbours if necessary).
+	//If the neighbours were searched, they are also stored in m_neighbours (and the method returns true).
+	bool getCachedNeighbours(int pointIdx, ccOctree::Shared& oct, unsigned char level, size_t& firstEdge, unsigned& edgeCount);
+
 	//random vars that we keep to optimise speed
 	int m_start_rgb[3];
 	int m_end_rgb[3]; //[r,g,b] values for start and end nodes
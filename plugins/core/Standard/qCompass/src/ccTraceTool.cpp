@@ -178,6 +178,7 @@ void ccTraceTool::finishCurrentTrace()
 	{
 		t->setActive(false);
 		t->finalizePath();
+		t->clearCostCache(); //the trace won't be edited anymore (until it is picked-up again)
 
 		//check for shift key modifier (flips the fitPlane modifier)
 		bool fitPlane = ccCompass::fitPlanes;
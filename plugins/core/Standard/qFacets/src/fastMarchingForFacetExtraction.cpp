@@ -137,6 +137,14 @@ int FastMarchingForFacetExtraction::init(	ccGenericPointCloud* cloud,
 	theOctree->getCellCodes(level, cellCodes, true);
 	size_t cellCount = cellCodes.size();
 
+	//the cells are allocated at once
+	PlanarCell* cells = instantiateCellsTpl<PlanarCell>(static_cast<unsigned>(cellCount));
+	if (!cells)
+	{
+		//not enough memory
+		return -1;
+	}
+
 	CCLib::NormalizedProgress nProgress(progressCb, static_cast<unsigned>(cellCount));
 	if (progressCb)
 	{
@@ -160,7 +168,7 @@ int FastMarchingForFacetExtraction::init(	ccGenericPointCloud* cloud,
 				unsigned gridPos = pos2index(cellPos);
 
 				//create corresponding cell
-				PlanarCell* aCell = new PlanarCell;
+				PlanarCell* aCell = cells++;
 				aCell->cellCode = cellCodes.back();
 				aCell->N = N;
 				aCell->C = C;
@@ -249,11 +257,7 @@ int FastMarchingForFacetExtraction::step()
 						//otherwise we must update it's arrival time
 						else if (nCell->state == PlanarCell::TRIAL_CELL)
 						{
-							const float& t_old = nCell->T;
-							float t_new = computeT(nIndex);
-
-							if (t_new < t_old)
-								nCell->T = t_new;
+							updateTrialCell(nIndex, computeT(nIndex));
 						}
 					}
 				}
@@ -385,8 +389,8 @@ unsigned FastMarchingForFacetExtraction::updateFlagsTable(	ccGenericPointCloud*
 			//++pointCount;
 		}
 
+		//the cell is removed from the grid (its memory is released with the grid)
 		m_theGrid[m_activeCells[i]] = 0;
-		delete aCell;
 	}
 
 	return pointCount;
@@ -468,10 +472,10 @@ void FastMarchingForFacetExtraction::initTrialCells()
 			if (nCell/* && nCell->state == PlanarCell::FAR_CELL*/)
 			{
 				assert(nCell->state == PlanarCell::FAR_CELL);
-				addTrialCell(nIndex);
 
-				//compute its approximate arrival time
+				//compute its approximate arrival time (before adding it to the TRIAL heap)
 				nCell->T = seedCell->T + m_neighboursDistance[i] * computeTCoefApprox(seedCell,nCell);
+				addTrialCell(nIndex);
 			}
 		}
 	}
@@ -565,6 +569,7 @@ int FastMarchingForFacetExtraction::ExtractPlanarFacets(	ccPointCloud* theCloud,
 		ccLog::Error("[FastMarchingForFacetExtraction] Something went wrong during initialization...");
 		return -6;
 	}
+	ccLog::PrintDebug(QString("[FastMarchingForFacetExtraction] Fast Marching structure: %1 MB").arg(fm.memoryUsage() / 1048576.0, 0, 'f', 1));
 
 	//progress notification
 	if (progressCb)
@@ -19,6 +19,7 @@
 
 //CCLib
 #include <GenericProgressCallback.h>
+#include <Jacobi.h>
 #include <ParallelSort.h>
 
 //qCC_db
@@ -27,6 +28,13 @@
 //Qt
 #include <QApplication>
 
+//system
+#include <algorithm>
+#include <unordered_map>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 //static bool AscendingLeafErrorComparison(const ccKdTree::Leaf* a, const ccKdTree::Leaf* b)
 //{
 //	return a->error < b->error;
@@ -34,33 +42,362 @@
 
 static bool DescendingLeafSizeComparison(const ccKdTree::Leaf* a, const ccKdTree::Leaf* b)
 {
-	return a->points->size() > b->points->size();
+	unsigned sizeA = a->points->size();
+	unsigned sizeB = b->points->size();
+	if (sizeA != sizeB)
+		return sizeA > sizeB;
+
+	//the cells don't share points: we use the first point index to make the order deterministic
+	return sizeA != 0 && a->points->getPointGlobalIndex(0) < b->points->getPointGlobalIndex(0);
 }
 
-struct Candidate
+//! Sufficient statistics of a set of points
+/** The moments of two sets can be merged without going through their points again,
+	and the least squares plane (as well as the RMS distance to any plane) can be
+	deduced from them.
+**/
+struct PointSetMoments
 {
-	ccKdTree::Leaf* leaf;
-	PointCoordinateType dist;
-	PointCoordinateType radius;
-	CCVector3 centroid;
+	//! Number of points
+	double count;
+	//! Gravity center
+	CCVector3d mean;
+	//! Sums of the squared deviations to the gravity center (XX, YY, ZZ, XY, XZ, YZ)
+	double m2[6];
+
+	PointSetMoments() : count(0), mean(0, 0, 0) { std::fill(m2, m2 + 6, 0.0); }
 
-	Candidate() : leaf(0), dist(PC_NAN), radius(0) {}
-	Candidate(ccKdTree::Leaf* l) : leaf(l), dist(PC_NAN), radius(0)
+	//! Computes the moments of a set of points
+	void compute(CCLib::GenericIndexedCloud* cloud)
 	{
-		if (leaf && leaf->points)
+		*this = PointSetMoments();
+
+		unsigned pointCount = cloud->size();
+		if (pointCount == 0)
+			return;
+
+		for (unsigned i = 0; i < pointCount; ++i)
+			mean += CCVector3d::fromArray(cloud->getPoint(i)->u);
+		mean /= pointCount;
+
+		for (unsigned i = 0; i < pointCount; ++i)
 		{
-			CCLib::Neighbourhood N(leaf->points);
-			centroid = *N.getGravityCenter();
-			radius = N.computeLargestRadius();
+			CCVector3d P = CCVector3d::fromArray(cloud->getPoint(i)->u) - mean;
+			m2[0] += P.x * P.x;
+			m2[1] += P.y * P.y;
+			m2[2] += P.z * P.z;
+			m2[3] += P.x * P.y;
+			m2[4] += P.x * P.z;
+			m2[5] += P.y * P.z;
 		}
+		count = pointCount;
+	}
+
+	//! Merges the moments of another set (pairwise update of Chan et al.)
+	void add(const PointSetMoments& other)
+	{
+		if (other.count == 0)
+			return;
+		if (count == 0)
+		{
+			*this = other;
+			return;
+		}
+
+		double n = count + other.count;
+		CCVector3d delta = other.mean - mean;
+		double w = count * other.count / n;
+
+		m2[0] += other.m2[0] + w * delta.x * delta.x;
+		m2[1] += other.m2[1] + w * delta.y * delta.y;
+		m2[2] += other.m2[2] + w * delta.z * delta.z;
+		m2[3] += other.m2[3] + w * delta.x * delta.y;
+		m2[4] += other.m2[4] + w * delta.x * delta.z;
+		m2[5] += other.m2[5] + w * delta.y * delta.z;
+
+		mean += delta * (other.count / n);
+		count = n;
+	}
+
+	//! Fits the least squares plane (same approach as CCLib::Neighbourhood::getLSPlane)
+	bool fitPlane(PointCoordinateType planeEq[4]) const
+	{
+		if (count < 3)
+			return false;
+
+		CCLib::SquareMatrixd covMat(3);
+		covMat.m_values[0][0] = m2[0] / count;
+		covMat.m_values[1][1] = m2[1] / count;
+		covMat.m_values[2][2] = m2[2] / count;
+		covMat.m_values[1][0] = covMat.m_values[0][1] = m2[3] / count;
+		covMat.m_values[2][0] = covMat.m_values[0][2] = m2[4] / count;
+		covMat.m_values[2][1] = covMat.m_values[1][2] = m2[5] / count;
+
+		//the plane normal is the eigen vector corresponding to the smallest eigen value
+		CCLib::SquareMatrixd eigVectors;
+		std::vector<double> eigValues;
+		if (!Jacobi<double>::ComputeEigenValuesAndVectors(covMat, eigVectors, eigValues, true))
+			return false;
+
+		CCVector3d vec(0, 0, 1);
+		double minEigValue = 0;
+		Jacobi<double>::GetMinEigenValueAndVector(eigVectors, eigValues, minEigValue, vec.u);
+
+		CCVector3 N = CCVector3::fromArray(vec.u);
+		if (N.norm2() < ZERO_TOLERANCE)
+			return false;
+		N.normalize();
+
+		CCVector3 G = CCVector3::fromArray(mean.u);
+		planeEq[0] = N.x;
+		planeEq[1] = N.y;
+		planeEq[2] = N.z;
+		planeEq[3] = G.dot(N);
+
+		return true;
+	}
+
+	//! Returns the RMS distance to a (unit) plane
+	double rms(const PointCoordinateType planeEq[4]) const
+	{
+		if (count == 0)
+			return 0.0;
+
+		//sum[(N.P - d)^2] = N' * M2 * N + count * (N.mean - d)^2
+		CCVector3d N(planeEq[0], planeEq[1], planeEq[2]);
+		double spread =	m2[0] * N.x * N.x
+					+	m2[1] * N.y * N.y
+					+	m2[2] * N.z * N.z
+					+	2.0 * (m2[3] * N.x * N.y + m2[4] * N.x * N.z + m2[5] * N.y * N.z);
+		double offset = N.dot(mean) - planeEq[3];
+
+		return sqrt((std::max(0.0, spread) + count * offset * offset) / count);
 	}
 };
 
+//! Data associated to each cell (computed once)
+struct CellData
+{
+	//! Moments of the cell points
+	PointSetMoments moments;
+	//! Gravity center
+	CCVector3 centroid;
+	//! Largest distance between the points and the gravity center
+	PointCoordinateType radius;
+	//! Bounding-box
+	CCVector3 bbMin;
+	CCVector3 bbMax;
+
+	CellData() : centroid(0, 0, 0), radius(0), bbMin(0, 0, 0), bbMax(0, 0, 0) {}
+};
+
+struct Candidate
+{
+	unsigned cellIndex;
+	PointCoordinateType dist;
+
+	explicit Candidate(unsigned index) : cellIndex(index), dist(PC_NAN) {}
+};
+
 static bool CandidateDistAscendingComparison(const Candidate& a, const Candidate& b)
 {
 	return a.dist < b.dist;
 }
 
+//! Evaluates the fusion of the current set of cells with a candidate cell
+/** The evaluation doesn't modify anything (so that the candidates can be evaluated in parallel).
+**/
+class CandidateEvaluator
+{
+public:
+
+	enum Status { BAD_ORIENTATION, TOO_FAR, BAD_FIT, VALID, NOT_ENOUGH_MEMORY };
+
+	struct Result
+	{
+		Status status;
+		double error;
+
+		Result() : status(BAD_FIT), error(-1.0) {}
+	};
+
+	CandidateEvaluator(	const std::vector<ccKdTree::Leaf*>& leaves,
+						const std::vector<CellData>& cells,
+						const std::vector<unsigned>& fusedCells,
+						const PointSetMoments& fusedMoments,
+						const CCVector3& fusedNormal,
+						double minCosNormAngle,
+						PointCoordinateType overlapCoef,
+						double maxError,
+						CCLib::DistanceComputationTools::ERROR_MEASURES errorMeasure)
+		: m_leaves(leaves)
+		, m_cells(cells)
+		, m_fusedCells(fusedCells)
+		, m_fusedMoments(fusedMoments)
+		, m_fusedNormal(fusedNormal)
+		, m_minCosNormAngle(minCosNormAngle)
+		, m_overlapCoef(overlapCoef)
+		, m_maxError(maxError)
+		, m_errorMeasure(errorMeasure)
+	{}
+
+	Result evaluate(unsigned cellIndex) const
+	{
+		Result result;
+
+		//if the leaf orientation is too different
+		if (fabs(CCVector3(m_leaves[cellIndex]->planeEq).dot(m_fusedNormal)) < m_minCosNormAngle)
+		{
+			result.status = BAD_ORIENTATION;
+			return result;
+		}
+
+		//if the leaf is too far
+		if (!isCloseToFusedSet(cellIndex))
+		{
+			result.status = TOO_FAR;
+			return result;
+		}
+
+		//fit a plane on the fused set and estimate the resulting error
+		PointSetMoments moments = m_fusedMoments;
+		moments.add(m_cells[cellIndex].moments);
+
+		PointCoordinateType planeEquation[4];
+		if (moments.fitPlane(planeEquation))
+		{
+			if (m_errorMeasure == CCLib::DistanceComputationTools::RMS)
+			{
+				result.error = moments.rms(planeEquation);
+			}
+			else if (!computeError(cellIndex, planeEquation, result.error))
+			{
+				result.status = NOT_ENOUGH_MEMORY;
+				return result;
+			}
+		}
+
+		result.status = (result.error < 0.0 || result.error > m_maxError ? BAD_FIT : VALID);
+		return result;
+	}
+
+protected:
+
+	//! Returns whether the candidate is close enough to the points of the fused set
+	/** Equivalent to testing the minimum distance between the candidate centroid and
+		all the fused points, but the cells that are too far are discarded based on
+		their bounding-box.
+	**/
+	bool isCloseToFusedSet(unsigned cellIndex) const
+	{
+		const CellData& candidate = m_cells[cellIndex];
+
+		//the most recently fused cells are tested first (they are more likely to be close)
+		for (std::vector<unsigned>::const_reverse_iterator it = m_fusedCells.rbegin(); it != m_fusedCells.rend(); ++it)
+		{
+			const CellData& cell = m_cells[*it];
+
+			//the distance between the centroid and the bounding-box is a lower bound for all the cell points
+			CCVector3 D(0, 0, 0);
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				if (candidate.centroid.u[k] < cell.bbMin.u[k])
+					D.u[k] = cell.bbMin.u[k] - candidate.centroid.u[k];
+				else if (candidate.centroid.u[k] > cell.bbMax.u[k])
+					D.u[k] = cell.bbMax.u[k] - candidate.centroid.u[k];
+			}
+			PointCoordinateType minDist = sqrt(D.norm2());
+			if (candidate.radius < minDist / m_overlapCoef)
+			{
+				continue;
+			}
+
+			CCLib::ReferenceCloud* points = m_leaves[*it]->points;
+			for (unsigned j = 0; j < points->size(); ++j)
+			{
+				PointCoordinateType dist = sqrt((*points->getPoint(j) - candidate.centroid).norm2());
+				if (!(candidate.radius < dist / m_overlapCoef))
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	//! Computes the (non RMS) error of the fused set (see DistanceComputationTools::ComputeCloud2PlaneDistance)
+	bool computeError(unsigned cellIndex, const PointCoordinateType* planeEquation, double& error) const
+	{
+		float percent = 0.0f;
+		switch (m_errorMeasure)
+		{
+		case CCLib::DistanceComputationTools::MAX_DIST_68_PERCENT:
+			percent = 0.32f;
+			break;
+		case CCLib::DistanceComputationTools::MAX_DIST_95_PERCENT:
+			percent = 0.05f;
+			break;
+		case CCLib::DistanceComputationTools::MAX_DIST_99_PERCENT:
+			percent = 0.01f;
+			break;
+		case CCLib::DistanceComputationTools::MAX_DIST:
+			break;
+		default:
+			assert(false);
+			error = -1.0;
+			return true;
+		}
+
+		std::vector<PointCoordinateType> distances;
+		try
+		{
+			if (percent != 0.0f)
+				distances.reserve(static_cast<size_t>(m_fusedMoments.count) + m_leaves[cellIndex]->points->size());
+		}
+		catch (const std::bad_alloc&)
+		{
+			return false;
+		}
+
+		PointCoordinateType maxDist = 0;
+		for (size_t i = 0; i <= m_fusedCells.size(); ++i)
+		{
+			CCLib::ReferenceCloud* points = m_leaves[i < m_fusedCells.size() ? m_fusedCells[i] : cellIndex]->points;
+			for (unsigned j = 0; j < points->size(); ++j)
+			{
+				PointCoordinateType d = std::abs(CCVector3::vdot(points->getPoint(j)->u, planeEquation) - planeEquation[3]);
+				if (percent != 0.0f)
+					distances.push_back(d);
+				else
+					maxDist = std::max(d, maxDist);
+			}
+		}
+
+		if (percent != 0.0f && !distances.empty())
+		{
+			//max distance once the 'percent' biggest values are ignored
+			size_t tailSize = static_cast<size_t>(ceil(static_cast<float>(distances.size()) * percent));
+			std::vector<PointCoordinateType>::iterator nth = distances.begin() + (distances.size() - tailSize);
+			std::nth_element(distances.begin(), nth, distances.end());
+			maxDist = *nth;
+		}
+
+		error = maxDist;
+		return true;
+	}
+
+	const std::vector<ccKdTree::Leaf*>& m_leaves;
+	const std::vector<CellData>& m_cells;
+	const std::vector<unsigned>& m_fusedCells;
+	const PointSetMoments& m_fusedMoments;
+	const CCVector3& m_fusedNormal;
+	double m_minCosNormAngle;
+	PointCoordinateType m_overlapCoef;
+	double m_maxError;
+	CCLib::DistanceComputationTools::ERROR_MEASURES m_errorMeasure;
+};
+
 bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 											double maxError,
 											CCLib::DistanceComputationTools::ERROR_MEASURES errorMeasure,
@@ -109,6 +446,50 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 		}
 	}
 
+	//compute the data of each cell once and for all
+	std::vector<CellData> cells;
+	std::unordered_map<const ccKdTree::Leaf*, unsigned> cellIndexes;
+	try
+	{
+		cells.resize(leaves.size());
+		cellIndexes.reserve(leaves.size());
+		for (size_t i = 0; i < leaves.size(); ++i)
+			cellIndexes[leaves[i]] = static_cast<unsigned>(i);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory!
+		ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
+		return false;
+	}
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int i = 0; i < static_cast<int>(leaves.size()); ++i)
+	{
+		CCLib::ReferenceCloud* points = leaves[i]->points;
+		if (!points || points->size() == 0)
+			continue;
+
+		CellData& cell = cells[i];
+		cell.moments.compute(points);
+		points->getBoundingBox(cell.bbMin, cell.bbMax);
+
+		CCLib::Neighbourhood N(points);
+		cell.centroid = *N.getGravityCenter();
+		cell.radius = N.computeLargestRadius();
+	}
+
+	//the candidates are evaluated in parallel, by batches (the first valid one is kept in 'closest first' mode)
+#if defined(_OPENMP)
+	const size_t batchSize = (closestFirst ? static_cast<size_t>(std::max(1, omp_get_max_threads())) : leaves.size());
+#else
+	const size_t batchSize = (closestFirst ? 1 : leaves.size());
+#endif
+	std::vector<unsigned> batch;
+	std::vector<CandidateEvaluator::Result> evaluations;
+
 	// cosine of the max angle between fused 'planes'
 	const double c_minCosNormAngle = cos(maxAngle_deg * CC_DEG_TO_RAD);
 
@@ -137,11 +518,32 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 			//we create a new "macro cell" index
 			currentCell->userData = macroIndex++;
 
-			//we init the current set of 'fused' points with the cell's points
-			CCLib::ReferenceCloud* currentPointSet = currentCell->points;
+			//we init the current set of 'fused' cells with the cell itself
+			std::vector<unsigned> fusedCells;
+			try
+			{
+				fusedCells.push_back(static_cast<unsigned>(i));
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory!
+				ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
+				return false;
+			}
+			PointSetMoments fusedMoments = cells[i].moments;
 			//get current fused set centroid and normal
-			CCVector3 currentCentroid = *CCLib::Neighbourhood(currentPointSet).getGravityCenter();
-			CCVector3 currentNormal(currentCell->planeEq);
+			const CCVector3 currentCentroid = cells[i].centroid;
+			const CCVector3 currentNormal(currentCell->planeEq);
+
+			CandidateEvaluator evaluator(	leaves,
+											cells,
+											fusedCells,
+											fusedMoments,
+											currentNormal,
+											c_minCosNormAngle,
+											overlapCoef,
+											maxError,
+											errorMeasure);
 
 			//visited neighbors
 			ccKdTree::LeafSet visitedNeighbors;
@@ -176,25 +578,34 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 
 					//add those (new) neighbors to the 'visitedNeighbors' set
 					//and to the candidates set by the way if they are not yet there
-					for (ccKdTree::LeafSet::iterator it=neighbors.begin(); it != neighbors.end(); ++it)
+					try
 					{
-						ccKdTree::Leaf* neighbor = *it;
-						std::pair<ccKdTree::LeafSet::iterator,bool> ret = visitedNeighbors.insert(neighbor);
-						//neighbour not already in the set?
-						if (ret.second)
+						std::vector<unsigned> newCells;
+						for (ccKdTree::LeafSet::iterator it=neighbors.begin(); it != neighbors.end(); ++it)
 						{
-							//we create the corresponding candidate
-							try
-							{
-								candidates.push_back(Candidate(neighbor));
-							}
-							catch (const std::bad_alloc&)
+							ccKdTree::Leaf* neighbor = *it;
+							std::pair<ccKdTree::LeafSet::iterator,bool> ret = visitedNeighbors.insert(neighbor);
+							//neighbour not already in the set?
+							if (ret.second)
 							{
-								//not enough memory!
-								ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
-								return false;
+								assert(cellIndexes.find(neighbor) != cellIndexes.end());
+								newCells.push_back(cellIndexes[neighbor]);
 							}
 						}
+
+						//the (hash) set order depends on the leaves addresses: we use the cells order instead
+						std::sort(newCells.begin(), newCells.end());
+						for (unsigned cellIndex : newCells)
+						{
+							//we create the corresponding candidate
+							candidates.push_back(Candidate(cellIndex));
+						}
+					}
+					catch (const std::bad_alloc&)
+					{
+						//not enough memory!
+						ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
+						return false;
 					}
 				}
 
@@ -205,7 +616,7 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 					if (closestFirst && candidates.size() > 1)
 					{
 						for (std::list<Candidate>::iterator it = candidates.begin(); it !=candidates.end(); ++it)
-							it->dist = (it->centroid-currentCentroid).norm2();
+							it->dist = (cells[it->cellIndex].centroid-currentCentroid).norm2();
 
 						//sort candidates by their distance
 						candidates.sort(CandidateDistAscendingComparison);
@@ -213,114 +624,105 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 					
 					//we will keep track of the best fused 'couple' at each pass
 					std::list<Candidate>::iterator bestIt = candidates.end();
-					CCLib::ReferenceCloud* bestFused = 0;
-					CCVector3 bestNormal(0,0,0);
 					double bestError = -1.0;
 
 					unsigned skipCount = 0;
-					for (std::list<Candidate>::iterator it = candidates.begin(); it != candidates.end(); /*++it*/)
+					bool stop = false;
+					for (std::list<Candidate>::iterator it = candidates.begin(); it != candidates.end() && !stop; /*++it*/)
 					{
-						assert(it->leaf && it->leaf->points);
-						assert(currentPointSet->getAssociatedCloud() == it->leaf->points->getAssociatedCloud());
-
-						//if the leaf orientation is too different
-						if (fabs(CCVector3(it->leaf->planeEq).dot(currentNormal)) < c_minCosNormAngle)
+						//evaluate the next batch of candidates (in parallel)
+						try
 						{
-							it = candidates.erase(it);
-							//++it;
-							//++skipCount;
-							continue;
+							batch.clear();
+							for (std::list<Candidate>::iterator jt = it; jt != candidates.end() && batch.size() < batchSize; ++jt)
+								batch.push_back(jt->cellIndex);
+							evaluations.resize(batch.size());
 						}
-
-						//compute the minimum distance between the candidate centroid and the 'currentPointSet'
-						PointCoordinateType minDistToMainSet = 0.0;
-						{
-							for (unsigned j=0; j<currentPointSet->size(); ++j)
-							{
-								const CCVector3* P = currentPointSet->getPoint(j);
-								PointCoordinateType d2 = (*P-it->centroid).norm2();
-								if (d2 < minDistToMainSet || j == 0)
-									minDistToMainSet = d2;
-							}
-							minDistToMainSet = sqrt(minDistToMainSet);
-						}
-						
-						//if the leaf is too far
-						if (it->radius < minDistToMainSet / overlapCoef)
-						{
-							++it;
-							++skipCount;
-							continue;
-						}
-
-						//fuse the main set with the current candidate
-						CCLib::ReferenceCloud* fused = new CCLib::ReferenceCloud(*currentPointSet);
-						if (!fused->add(*(it->leaf->points)))
+						catch (const std::bad_alloc&)
 						{
 							//not enough memory!
 							ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
-							delete fused;
-							if (currentPointSet != currentCell->points)
-								delete currentPointSet;
 							return false;
 						}
 
-						//fit a plane and estimate the resulting error
-						double error = -1.0;
-						const PointCoordinateType* planeEquation = CCLib::Neighbourhood(fused).getLSPlane();
-						if (planeEquation)
-							error = CCLib::DistanceComputationTools::ComputeCloud2PlaneDistance(fused, planeEquation, errorMeasure);
-
-						if (error < 0.0 || error > maxError)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+						for (int k = 0; k < static_cast<int>(batch.size()); ++k)
 						{
-							//candidate is rejected
-							it = candidates.erase(it);
+							evaluations[k] = evaluator.evaluate(batch[k]);
 						}
-						else
+
+						//then process the results in order (as a sequential process would do)
+						for (size_t k = 0; k < batch.size(); ++k)
 						{
-							//otherwise we keep track of the best one!
-							if (bestError < 0.0 || error < bestError)
+							assert(it != candidates.end() && it->cellIndex == batch[k]);
+							const CandidateEvaluator::Result& evaluation = evaluations[k];
+
+							switch (evaluation.status)
 							{
-								bestIt = it;
-								bestError = error;
-								if (bestFused)
-									delete bestFused;
-								bestFused = fused;
-								bestNormal = CCVector3(planeEquation);
-								fused = 0;
-								
-								if (closestFirst)
-									break; //if we have found a good candidate, we stop here (closest first ;)
+							case CandidateEvaluator::BAD_ORIENTATION:
+							case CandidateEvaluator::BAD_FIT:
+								//candidate is rejected
+								it = candidates.erase(it);
+								break;
+
+							case CandidateEvaluator::TOO_FAR:
+								++it;
+								++skipCount;
+								break;
+
+							case CandidateEvaluator::VALID:
+								//otherwise we keep track of the best one!
+								if (bestError < 0.0 || evaluation.error < bestError)
+								{
+									bestIt = it;
+									bestError = evaluation.error;
+
+									if (closestFirst)
+									{
+										stop = true; //if we have found a good candidate, we stop here (closest first ;)
+										break;
+									}
+								}
+								++it;
+								break;
+
+							case CandidateEvaluator::NOT_ENOUGH_MEMORY:
+							default:
+								//not enough memory!
+								ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
+								return false;
 							}
-							++it;
-						}
 
-						if (fused)
-						{
-							delete fused;
-							fused = 0;
+							if (stop)
+								break;
 						}
 					}
 
 					//we have a (best) candidate for this pass?
 					if (bestIt != candidates.end())
 					{
-						assert(bestFused && bestError >= 0.0);
-						if (currentPointSet != currentCell->points)
-							delete currentPointSet;
-						currentPointSet = bestFused;
+						assert(bestError >= 0.0);
+						try
 						{
-							//update infos
-							CCLib::Neighbourhood N(currentPointSet);
-							//currentCentroid = *N.getGravityCenter(); //if we update it, the search will naturally shift along one dimension!
-							//currentNormal = bestNormal; //same thing here for normals
+							fusedCells.push_back(bestIt->cellIndex);
 						}
+						catch (const std::bad_alloc&)
+						{
+							//not enough memory!
+							ccLog::Warning("[ccKdTreeForFacetExtraction] Not enough memory!");
+							return false;
+						}
+						//update infos
+						fusedMoments.add(cells[bestIt->cellIndex].moments);
+						//the current centroid and normal are not updated (otherwise the search would naturally shift along one dimension!)
 
-						bestIt->leaf->userData = currentCell->userData;
-						//bestIt->leaf->userData = macroIndex++; //FIXME TEST
+						ccKdTree::Leaf* bestLeaf = leaves[bestIt->cellIndex];
+						bestLeaf->userData = currentCell->userData;
 
 						//we will test this cell's neighbors as well
-						cellsToTest.push_back(bestIt->leaf);
+						cellsToTest.push_back(bestLeaf);
 
 						if (progressCb && !nProgress.oneStep()) //process canceled by user
 						{
@@ -346,11 +748,6 @@ bool ccKdTreeForFacetExtraction::FuseCells(	ccKdTree* kdTree,
 			
 			} //no more candidates or cells to test
 
-			//end of the fusion process for the current leaf
-			if (currentPointSet != currentCell->points)
-				delete currentPointSet;
-			currentPointSet = 0;
-
 			if (cancelled)
 				break;
 		}
@@ -30,6 +30,8 @@ public:
 
 	//! Fuses cells
 	/** Creates a new scalar fields with the groups indexes.
+		The candidate cells are evaluated in parallel (the planes are fitted on the merged
+		moments of the cells) but the result doesn't depend on the number of threads.
 		\param kdTree Kd-tree
 		\param maxError max error after fusion (see errorMeasure)
 		\param errorMeasure error measure type
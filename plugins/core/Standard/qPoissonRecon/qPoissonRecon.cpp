@@ -34,6 +34,7 @@
 //qCC_db
 #include <ccPointCloud.h>
 #include <ccMesh.h>
+#include <ccChunk.h>
 #include <ccProgressDialog.h>
 #include <ccScalarField.h>
 
@@ -44,6 +45,8 @@
 #include <time.h>
 #include <unistd.h>
 #endif
+#include <limits>
+#include <vector>
 
 template <typename Real>
 class PointCloudWrapper : public PoissonReconLib::ICloud<Real>
@@ -100,121 +103,200 @@ protected:
 	const ccPointCloud& m_cloud;
 };
 
-template <typename Real>
-class MeshWrapper : public PoissonReconLib::IMesh<Real>
+//! Append-only buffer made of fixed size chunks
+/** Contrarily to a single vector, it never reallocates (nor copies) the elements
+	while growing, and it wastes at most one chunk.
+**/
+template <typename T>
+class ChunkedBuffer
 {
 public:
-	explicit MeshWrapper(ccMesh& mesh, ccPointCloud& vertices, CCLib::ScalarField* densitySF = nullptr)
-		: m_mesh(mesh)
-		, m_vertices(vertices)
-		, m_densitySF(densitySF)
-		, m_error(false)
-	{}
+	ChunkedBuffer() : m_size(0) {}
+
+	//! Returns the number of elements
+	size_t size() const { return m_size; }
 
-	bool checkMeshCapacity()
+	//! Adds an element (returns false if not enough memory)
+	bool push_back(const T& value)
 	{
-		if (m_error)
+		if ((m_size & (ccChunk::SIZE - 1)) == 0)
 		{
-			//no need to go further
-			return false;
-		}
-		if (m_mesh.size() == m_mesh.capacity() && !m_mesh.reserve(m_mesh.size() + 1024))
-		{
-			m_error = true;
-			return false;
+			try
+			{
+				std::vector<T> chunk;
+				chunk.reserve(ccChunk::SIZE);
+				m_chunks.push_back(std::move(chunk));
+			}
+			catch (const std::bad_alloc&)
+			{
+				//not enough memory
+				return false;
+			}
 		}
+		m_chunks.back().push_back(value);
+		++m_size;
 		return true;
 	}
 
-	bool checkVertexCapacity()
+	//! Hands over all the elements (in order), releasing each chunk as soon as it has been consumed
+	template <class Consumer> void flush(Consumer consume)
 	{
-		if (m_error)
+		for (std::vector<T>& chunk : m_chunks)
 		{
-			//no need to go further
-			return false;
-		}
-		if (m_vertices.size() == m_vertices.capacity() && !m_vertices.reserve(m_vertices.size() + 4096))
-		{
-			m_error = true;
-			return false;
+			for (const T& value : chunk)
+			{
+				consume(value);
+			}
+			std::vector<T>().swap(chunk);
 		}
-		return true;
+		clear();
 	}
 
-	virtual void addVertex(const Real* coords) override
+	//! Releases all the elements
+	void clear()
 	{
-		if (!checkVertexCapacity())
-		{
-			return;
-		}
-		CCVector3 P = CCVector3::fromArray(coords);
-		m_vertices.addPoint(P);
+		m_chunks.clear();
+		m_size = 0;
 	}
 
-	virtual void addNormal(const Real* coords) override
+protected:
+	std::vector< std::vector<T> > m_chunks;
+	size_t m_size;
+};
+
+//! Receives the reconstructed mesh
+/** The library only outputs the mesh once the reconstruction is over, and without
+	announcing its size. The elements are therefore staged in chunks (no reallocation
+	while the library still holds its own copy of the mesh), then transferred to
+	exactly sized ccMesh / ccPointCloud tables (see transferTo).
+**/
+template <typename Real>
+class MeshWrapper : public PoissonReconLib::IMesh<Real>
+{
+public:
+	MeshWrapper(bool withColors, bool withDensity)
+		: m_withColors(withColors)
+		, m_withDensity(withDensity)
+		, m_error(false)
+	{}
+
+	virtual void addVertex(const Real* coords) override
 	{
-		if (!checkVertexCapacity())
-		{
-			return;
-		}
-		if (!m_vertices.hasNormals() && !m_vertices.reserveTheNormsTable())
+		if (!m_error && !m_vertices.push_back(CCVector3::fromArray(coords)))
 		{
 			m_error = true;
-			return;
 		}
-		CCVector3 N = CCVector3::fromArray(coords);
-		m_vertices.addNorm(N);
+	}
+
+	virtual void addNormal(const Real* /*coords*/) override
+	{
+		//the vertex normals are recomputed from the triangles afterwards (see ccMesh::computeNormals)
 	}
 
 	virtual void addColor(const Real* rgb) override
 	{
-		if (!checkVertexCapacity())
+		if (!m_withColors || m_error)
 		{
 			return;
 		}
-		if (!m_vertices.hasColors())
+		ccColor::Rgb C(	static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[0]))),
+						static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[1]))),
+						static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[2]))) );
+		if (!m_colors.push_back(C))
 		{
-			if (!m_vertices.reserveTheRGBTable())
-			{
-				m_error = true;
-				return;
-			}
+			m_error = true;
 		}
-		m_vertices.addRGBColor(	static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[0]))),
-								static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[1]))),
-								static_cast<ColorCompType>(std::min((Real)255, std::max((Real)0, rgb[2]))) );
 	}
 
 	virtual void addDensity(double d) override
 	{
-		if (!m_densitySF)
+		if (!m_withDensity || m_error)
 		{
 			return;
 		}
-		if (m_densitySF->size() == m_densitySF->capacity() && !m_densitySF->reserveSafe(m_densitySF->size() + 4096))
+		if (!m_densities.push_back(static_cast<ScalarType>(d)))
 		{
 			m_error = true;
-			return;
 		}
-		m_densitySF->addElement(static_cast<ScalarType>(d));
 	}
 
 	void addTriangle(size_t i1, size_t i2, size_t i3) override
 	{
-		if (!checkMeshCapacity())
+		if (!m_error && !m_triangles.push_back(CCLib::VerticesIndexes(static_cast<unsigned>(i1), static_cast<unsigned>(i2), static_cast<unsigned>(i3))))
 		{
-			return;
+			m_error = true;
 		}
-		m_mesh.addTriangle(static_cast<unsigned>(i1), static_cast<unsigned>(i2), static_cast<unsigned>(i3));
 	}
 
 	bool isInErrorState() const { return m_error; }
 
+	//! Moves the staged mesh to the output entities
+	/** Each table is allocated once, with its final size, and the corresponding chunks
+		are released as soon as they are copied.
+	**/
+	bool transferTo(ccMesh& mesh, ccPointCloud& vertices, CCLib::ScalarField* densitySF)
+	{
+		if (m_error)
+		{
+			return false;
+		}
+
+		size_t vertCount = m_vertices.size();
+		if (	vertCount > std::numeric_limits<unsigned>::max()
+			||	m_triangles.size() > std::numeric_limits<unsigned>::max()
+			||	(m_colors.size() != 0 && m_colors.size() != vertCount)
+			||	(densitySF && m_densities.size() != vertCount) )
+		{
+			//inconsistent or too big mesh
+			return false;
+		}
+
+		//vertices
+		if (!vertices.reserveThePointsTable(static_cast<unsigned>(vertCount)))
+		{
+			return false;
+		}
+		m_vertices.flush([&vertices](const CCVector3& P) { vertices.addPoint(P); });
+
+		//colors
+		if (m_colors.size() != 0)
+		{
+			if (!vertices.reserveTheRGBTable())
+			{
+				return false;
+			}
+			m_colors.flush([&vertices](const ccColor::Rgb& C) { vertices.addRGBColor(C); });
+		}
+
+		//density
+		if (densitySF)
+		{
+			if (!densitySF->reserveSafe(vertCount))
+			{
+				return false;
+			}
+			m_densities.flush([densitySF](ScalarType d) { densitySF->addElement(d); });
+		}
+
+		//triangles
+		if (!mesh.reserve(m_triangles.size()))
+		{
+			return false;
+		}
+		m_triangles.flush([&mesh](const CCLib::VerticesIndexes& tri) { mesh.addTriangle(tri.i1, tri.i2, tri.i3); });
+
+		return true;
+	}
+
 protected:
-	ccMesh& m_mesh;
-	ccPointCloud& m_vertices;
+	bool m_withColors;
+	bool m_withDensity;
 	bool m_error;
-	CCLib::ScalarField* m_densitySF;
+
+	ChunkedBuffer<CCVector3> m_vertices;
+	ChunkedBuffer<ccColor::Rgb> m_colors;
+	ChunkedBuffer<ScalarType> m_densities;
+	ChunkedBuffer<CCLib::VerticesIndexes> m_triangles;
 };
 
 //dialog for qPoissonRecon plugin
@@ -271,7 +353,7 @@ bool doReconstruct()
 		return false;
 	}
 
-	MeshWrapper<PointCoordinateType> meshWrapper(*s_mesh, *s_meshVertices, s_densitySF);
+	MeshWrapper<PointCoordinateType> meshWrapper(s_params.withColors && s_cloud->hasColors(), s_densitySF != nullptr);
 	PointCloudWrapper<PointCoordinateType> cloudWrapper(*s_cloud);
 	
 	if (!PoissonReconLib::Reconstruct(s_params, cloudWrapper, meshWrapper) || meshWrapper.isInErrorState())
@@ -279,7 +361,8 @@ bool doReconstruct()
 		return false;
 	}
 
-	return true;
+	//the library has released its own copy of the mesh at this point
+	return meshWrapper.transferTo(*s_mesh, *s_meshVertices, s_densitySF);
 }
 
 void qPoissonRecon::doAction()
@@ -474,11 +557,7 @@ void qPoissonRecon::doAction()
 	newPC->setEnabled(false);
 	newMesh->setVisible(true);
 	newMesh->computeNormals(true);
-	if (!cloudHasColors)
-	{
-		newPC->unallocateColors();
-		newPC->showColors(false);
-	}
+	newPC->showColors(newPC->hasColors());
 	newMesh->showColors(newPC->hasColors());
 
 	if (densitySF)
@@ -6,6 +6,7 @@
  *
  */
 #include <stdio.h>
+#include <atomic>
 #include "Random.h"
 
 using namespace MiscLib;
@@ -19,10 +20,29 @@ using namespace MiscLib;
 #define is_odd(x)     ( (x) & 1 )
 #define evenize(x)    ( (x) & (MM-2) )
 
-size_t MiscLib::rn_buf[MiscLib_RN_BUFSIZE];
-size_t MiscLib::rn_point = MiscLib_RN_BUFSIZE;
+thread_local size_t MiscLib::rn_buf[MiscLib_RN_BUFSIZE];
+thread_local size_t MiscLib::rn_point = MiscLib_RN_BUFSIZE;
+
+// last seed (set with rn_setseed) and number of calls to rn_setseed
+static std::atomic<size_t> s_rnSeed(0);
+static std::atomic<size_t> s_rnSeedGeneration(0);
+// number of threads that have derived their seed from the last one
+static std::atomic<size_t> s_rnSeededThreads(0);
+// seed generation of the calling thread state (0 = not seeded yet)
+static thread_local size_t t_rnSeedGeneration = 0;
+
+static void rn_seedbuffer(size_t seed);
 
 void MiscLib::rn_setseed(size_t seed)
+{
+  s_rnSeed = seed;
+  s_rnSeededThreads = 0;
+  t_rnSeedGeneration = ++s_rnSeedGeneration;
+  rn_point = MiscLib_RN_BUFSIZE;
+  rn_seedbuffer(seed);
+}
+
+static void rn_seedbuffer(size_t seed)
 {
   register int t, j;
   size_t x[KK+KK-1];
@@ -56,6 +76,13 @@ void MiscLib::rn_setseed(size_t seed)
 
 size_t MiscLib::rn_refresh()
 {
+  if (t_rnSeedGeneration != s_rnSeedGeneration)
+  {
+    // first draw of this thread since the last call to rn_setseed
+    t_rnSeedGeneration = s_rnSeedGeneration;
+    rn_seedbuffer(s_rnSeed + MiscLib_RN_CONST * (++s_rnSeededThreads));
+  }
+
 /* You remember Duff's device? If it would help then it should be used here */
   rn_point=1;
 
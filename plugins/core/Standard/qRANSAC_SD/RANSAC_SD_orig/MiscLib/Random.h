@@ -13,8 +13,11 @@
 
 namespace MiscLib
 {
-	extern size_t rn_buf[];
-	extern size_t rn_point;
+	// the generator state is per thread (so that it can be used in parallel loops):
+	// rn_setseed seeds the calling thread, the other threads derive their own seed
+	// from it the first time they draw a number (see rn_refresh)
+	extern thread_local size_t rn_buf[];
+	extern thread_local size_t rn_point;
 	void rn_setseed(size_t);
 	size_t rn_refresh(void);
 	inline size_t rn_rand()
@@ -4,6 +4,7 @@
 #include "RansacShapeDetector.h"
 #include <algorithm>
 #include <functional>
+#include <chrono>
 #include <ctime>
 #include <deque>
 #include <iostream>
@@ -21,6 +22,23 @@
 
 using namespace MiscLib;
 
+// wall-clock timer (the performance counter of MiscLib measures the CPU time on some platforms)
+class PhaseTimer
+{
+public:
+	PhaseTimer() : m_start(std::chrono::steady_clock::now()) {}
+	// returns the elapsed time (in seconds) since the last call (or the construction)
+	double Lap()
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double elapsed = std::chrono::duration<double>(now - m_start).count();
+		m_start = now;
+		return elapsed;
+	}
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
+
 RansacShapeDetector::RansacShapeDetector()
 : m_maxCandTries(20)
 , m_reqSamples(0)
@@ -110,8 +128,8 @@ void RansacShapeDetector::GenerateCandidates(
 #endif
 	for(int candIter = 0; candIter < 200; ++candIter)
 	{
-		// pick a sample level
-		double s = ((double)rand()) / (double)RAND_MAX;
+		// pick a sample level (rand() is not meant to be called concurrently)
+		double s = rn_frand();
 		size_t sampleLevel = 0;
 		for(; sampleLevel < sampleLevelProbSum.size() - 1; ++sampleLevel)
 			if(sampleLevelProbSum[sampleLevel] >= s)
@@ -463,6 +481,9 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 	srand((unsigned int)time(NULL));
 	rn_setseed((size_t)time(NULL));
 
+	m_timings = Timings();
+	PhaseTimer totalTimer, timer;
+
 	CandidatesType candidates;
 
 	ScorePrimitiveShapeVisitor< FlatNormalThreshPointCompatibilityFunc,
@@ -525,6 +546,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 		globalOctreeIndices.end(), pc.begin());
 	globalOctree.Build(bcube);
 	size_t globalOctTreeMaxNodeDepth = globalOctree.MaxDepth();
+	m_timings.m_octrees += timer.Lap();
 
 	MiscLib::Vector< double > sampleLevelProbability(
 		globalOctTreeMaxNodeDepth + 1);
@@ -562,8 +584,10 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 		if(candidates.size())
 			bestExpectedValue = candidates.back().ExpectedValue();
 		bestExpectedValue = std::min((float)(currentSize - numInvalid), bestExpectedValue);
+		timer.Lap();
 		do
 		{
+			size_t previouslyDrawnCandidates = drawnCandidates;
 			GenerateCandidates(globalOctree,
 				octrees, pc, subsetScoreVisitor,
 				currentSize, numInvalid,
@@ -572,6 +596,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 				&sampleLevelScores,
 				&bestExpectedValue,
 				&candidates);
+			m_timings.m_drawnCandidates += drawnCandidates - previouslyDrawnCandidates;
 		}
 		while(CandidateFailureProbability(bestExpectedValue,
 				currentSize - numInvalid, drawnCandidates,
@@ -579,6 +604,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 			&& CandidateFailureProbability(static_cast<float>(m_options.m_minSupport),
 				currentSize - numInvalid, drawnCandidates,
 				globalOctTreeMaxNodeDepth) > m_options.m_probability);
+		m_timings.m_candidateGeneration += timer.Lap();
 		// find the best candidate:
 		float bestCandidateFailureProbability;
 		float failureProbability = std::numeric_limits< float >::infinity();
@@ -590,6 +616,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 			globalOctTreeMaxNodeDepth, &maxForgottenCandidate,
 			&bestCandidateFailureProbability))
 		{
+			m_timings.m_candidateSelection += timer.Lap();
 			if(!foundCandidate)
 			{
 				// this is the first candidate
@@ -659,6 +686,7 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 				candidates.back().GlobalScore(globalScoreVisitor, globalOctree);
 				candidates.back().ConnectedComponent(pc, m_options.m_bitmapEpsilon);
 			}
+			m_timings.m_fitting += timer.Lap();
 			if(candidates.back().Size() == 0)
 				std::cout << "ERROR: candidate size == 0 after fitting" << std::endl;
 			// best candidate is ok!
@@ -716,12 +744,9 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 					}
 				}
 
-				// reindex global octree
+				// reindex global octree (sequential: the indices are compacted in place)
 				size_t minInvalidIndex = currentSize - numInvalid + beginIdx;
 				int j = 0;
-#ifdef DOPARALLEL
-				#pragma omp parallel for schedule(static)
-#endif
 				for(int i = 0; i < static_cast<int>(globalOctreeIndices.size()); ++i)
 					if(shapeIndex[globalOctreeIndices[i]] < minInvalidIndex)
 						globalOctreeIndices[j++] = shapeIndex[globalOctreeIndices[i]];
@@ -830,7 +855,9 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 					&& candidates[i].Size() > 0)
 					candidates[remainingCandidates++] = candidates[i];
 			candidates.resize(remainingCandidates);
+			m_timings.m_housekeeping += timer.Lap();
 		} // Ende abgrasen
+		m_timings.m_candidateSelection += timer.Lap();
 		if(foundCandidate)
 		{
 			std::sort(candidates.begin(), candidates.end(), std::greater< Candidate >());
@@ -903,6 +930,8 @@ RansacShapeDetector::Detect(PointCloud &pc, size_t beginIdx, size_t endIdx,
 		if(shapes->at(i - 1).second == 0)
 			shapes->erase(shapes->begin() + i - 1);
 	}
+	m_timings.m_housekeeping += timer.Lap();
+	m_timings.m_total = totalTimer.Lap();
 	return currentSize - numInvalid;
 }
 
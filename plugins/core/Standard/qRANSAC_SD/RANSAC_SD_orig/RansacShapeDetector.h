@@ -35,6 +35,26 @@ class DLL_LINKAGE RansacShapeDetector
 			enum { NO_FITTING, LS_FITTING } m_fitting;
 			float m_probability;
 		};
+		// wall-clock time spent in each phase of the detection (in seconds)
+		struct Timings
+		{
+			Timings()
+			: m_octrees(0)
+			, m_candidateGeneration(0)
+			, m_candidateSelection(0)
+			, m_fitting(0)
+			, m_housekeeping(0)
+			, m_total(0)
+			, m_drawnCandidates(0)
+			{}
+			double m_octrees; // construction of the subset and global octrees
+			double m_candidateGeneration; // sampling, construction and first scoring of the candidates
+			double m_candidateSelection; // bounds refinement and selection of the best candidate
+			double m_fitting; // global score, least-squares fitting and connected components
+			double m_housekeeping; // removal of the assigned points, candidates update
+			double m_total;
+			size_t m_drawnCandidates; // total number of drawn samples (candidates)
+		};
 		RansacShapeDetector();
 		RansacShapeDetector(const Options &options);
 		virtual ~RansacShapeDetector();
@@ -44,6 +64,8 @@ class DLL_LINKAGE RansacShapeDetector
 		void AutoAcceptSize(size_t s) { m_autoAcceptSize = s; }
 		size_t AutoAcceptSize() const { return m_autoAcceptSize; }
 		const Options &GetOptions() const { return m_options; }
+		// timings of the last call to Detect
+		const Timings &GetTimings() const { return m_timings; }
 
 	private:
 		typedef MiscLib::Vector< PrimitiveShapeConstructor * > ConstructorsType;
@@ -101,6 +123,7 @@ class DLL_LINKAGE RansacShapeDetector
 		size_t m_maxCandTries;
 		size_t m_reqSamples;
 		size_t m_autoAcceptSize;
+		Timings m_timings;
 };
 
 #endif
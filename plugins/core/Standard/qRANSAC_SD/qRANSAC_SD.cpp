@@ -38,6 +38,7 @@
 #include <QApplication>
 #include <QtConcurrentRun>
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QProgressDialog>
 #include <QMainWindow>
 
@@ -122,11 +123,14 @@ void qRansacSD::doActionOneEnt(ccHObject* ent, bool bDiag, double distance, doub
 	double globalScale = pc->getGlobalScale();
 
 	//Convert CC point cloud to RANSAC_SD type
+	//(the detector reorders the points in place, so we can't work directly on the CC cloud)
+	QElapsedTimer conversionTimer;
+	conversionTimer.start();
 	PointCloud cloud;
 	{
 		try
 		{
-			cloud.reserve(count);
+			cloud.resize(count);
 		}
 		catch (...)
 		{
@@ -134,13 +138,17 @@ void qRansacSD::doActionOneEnt(ccHObject* ent, bool bDiag, double distance, doub
 			return;
 		}
 
-		//default point & normal
-		Point Pt;
-		Pt.normal[0] = 0.0;
-		Pt.normal[1] = 0.0;
-		Pt.normal[2] = 0.0;
-		for (unsigned i = 0; i < count; ++i)
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+		for (int i = 0; i < static_cast<int>(count); ++i)
 		{
+			//default point & normal
+			Point Pt;
+			Pt.normal[0] = 0.0;
+			Pt.normal[1] = 0.0;
+			Pt.normal[2] = 0.0;
+
 			const CCVector3* P = pc->getPoint(i);
 			Pt.pos[0] = static_cast<float>(P->x);
 			Pt.pos[1] = static_cast<float>(P->y);
@@ -152,7 +160,7 @@ void qRansacSD::doActionOneEnt(ccHObject* ent, bool bDiag, double distance, doub
 				Pt.normal[1] = static_cast<float>(N.y);
 				Pt.normal[2] = static_cast<float>(N.z);
 			}
-			cloud.push_back(Pt);
+			cloud[i] = Pt;
 		}
 
 		//manually set bounding box!
@@ -165,6 +173,7 @@ void qRansacSD::doActionOneEnt(ccHObject* ent, bool bDiag, double distance, doub
 		cbbMax[2] = static_cast<float>(bbMax.z);
 		cloud.setBBox(cbbMin, cbbMax);
 	}
+	double conversionTime_s = conversionTimer.elapsed() / 1000.0;
 
 	//cloud scale (useful for setting several parameters
 	const float scale = cloud.getScale();
@@ -313,6 +322,19 @@ void qRansacSD::doActionOneEnt(ccHObject* ent, bool bDiag, double distance, doub
 		pDlg.hide();
 		QApplication::processEvents();
 	}
+
+	//timing report (to tune the parameters)
+	{
+		const RansacShapeDetector::Timings& timings = detector.GetTimings();
+		m_app->dispToConsole(QString("[qRansacSD] %1 shape(s) detected in %2 s (%3 candidates drawn)").arg(shapes.size()).arg(timings.m_total, 0, 'f', 2).arg(timings.m_drawnCandidates));
+		m_app->dispToConsole(QString("[qRansacSD] Timings: conversion %1 s / octrees %2 s / candidates generation %3 s / candidates selection %4 s / fitting %5 s / housekeeping %6 s")
+			.arg(conversionTime_s, 0, 'f', 2)
+			.arg(timings.m_octrees, 0, 'f', 2)
+			.arg(timings.m_candidateGeneration, 0, 'f', 2)
+			.arg(timings.m_candidateSelection, 0, 'f', 2)
+			.arg(timings.m_fitting, 0, 'f', 2)
+			.arg(timings.m_housekeeping, 0, 'f', 2));
+	}
 	//else
 	//{
 	//	remaining = detector.Detect(cloud, 0, cloud.size(), &shapes);
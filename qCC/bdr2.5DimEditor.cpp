@@ -368,14 +368,18 @@ ccHObject* bdr2Point5DimEditor::projectToImage(ccHObject * obj)
 		associate_cloud->setGlobalScale(0);
 		associate_cloud->setVisible(true);
 
-		for (size_t i = 0; i < associate_cloud->size(); i++) {
-			CCVector3* v = const_cast<CCVector3*>(associate_cloud->getPoint(i));
-			CCVector3 image_pt;
-			if (FromGlobalToImage(*v, image_pt)) {
-				inside_image++;
-			}			
-			image_pt.z = IMAGE_MARKER_DISPLAY_Z;
-			*v = image_pt;
+		//! batch projection (the sensor transformation is only computed once)
+		std::vector<CCVector2> image_coords;
+		std::vector<unsigned char> in_frame;
+		if (cam->fromGlobalCoordToImageCoord(associate_cloud, image_coords, in_frame)) {
+			const PointCoordinateType image_height = static_cast<PointCoordinateType>(m_image->getH());
+			for (unsigned i = 0; i < associate_cloud->size(); i++) {
+				if (in_frame[i]) {
+					inside_image++;
+				}
+				CCVector3* v = const_cast<CCVector3*>(associate_cloud->getPoint(i));
+				*v = CCVector3(image_coords[i].x, image_height - image_coords[i].y, IMAGE_MARKER_DISPLAY_Z);
+			}
 		}
 		// project even if the point is out of range, but remove that no point is inside
 		if (inside_image == 0) {
@@ -6,6 +6,7 @@
 
 //CCLib
 #include <ManualSegmentationTools.h>
+#include <PreparedPolygon.h>
 #include <SquareMatrix.h>
 
 //qCC_db
@@ -1381,6 +1382,10 @@ void bdr3DGeometryEditPanel::confirmCreate()
 		if (cloud && cloud->size() > 0) {
 			double max_d(-FLT_MAX);
 			double min_d(FLT_MAX);
+
+			//the polygon edges are indexed once for all the points
+			CCLib::PreparedPolygon preparedPoly;
+			bool prepared = m_editPoly->isClosed() && preparedPoly.init(m_editPoly);
 			
 			for (size_t i = 0; i < cloud->size(); i++) {
 				CCVector3d Q2D;
@@ -1410,7 +1415,7 @@ void bdr3DGeometryEditPanel::confirmCreate()
 					if (!isPointInside) { continue; }
 
 					if (m_editPoly->isClosed()) {
-						isPointInside = CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_editPoly);
+						isPointInside = prepared ? preparedPoly.isInside(P2D) : CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_editPoly);
 					}
 					else {
 						isPointInside = !polyline.empty() &&
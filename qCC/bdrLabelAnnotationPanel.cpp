@@ -5,7 +5,7 @@
 #include "ccItemSelectionDlg.h"
 
 //CCLib
-#include <ManualSegmentationTools.h>
+#include <PreparedPolygon.h>
 #include <SquareMatrix.h>
 
 //qCC_db
@@ -698,6 +698,14 @@ void bdrLabelAnnotationPanel::segment(bool keepPointsInside)
 	const double half_w = camera.viewport[2] / 2.0;
 	const double half_h = camera.viewport[3] / 2.0;
 
+	//the polygon edges are indexed once for all the points
+	CCLib::PreparedPolygon preparedPoly;
+	if (!preparedPoly.init(m_segmentationPoly))
+	{
+		ccLog::Error("Not enough memory!");
+		return;
+	}
+
 	//for each selected entity
 	for (QSet<ccHObject*>::const_iterator p = m_toSegment.constBegin(); p != m_toSegment.constEnd(); ++p)
 	{
@@ -727,7 +735,7 @@ void bdrLabelAnnotationPanel::segment(bool keepPointsInside)
 				CCVector2 P2D(	static_cast<PointCoordinateType>(Q2D.x-half_w),
 								static_cast<PointCoordinateType>(Q2D.y-half_h) );
 				
-				bool pointInside = pointInFrustrum && CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_segmentationPoly);
+				bool pointInside = pointInFrustrum && preparedPoly.isInside(P2D);
 
 				visibilityArray[i] = (keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
 
@@ -810,6 +818,14 @@ void bdrLabelAnnotationPanel::setLabel()
 	const double half_h = camera.viewport[3] / 2.0;
 
 	int label_index = m_UI->typeComboBox->currentIndex();
+
+	//the polygon edges are indexed once for all the points
+	CCLib::PreparedPolygon preparedPoly;
+	if (!preparedPoly.init(m_segmentationPoly))
+	{
+		ccLog::Error("Not enough memory!");
+		return;
+	}
 	
 	//for each selected entity
 	for (QSet<ccHObject*>::const_iterator p = m_toSegment.constBegin(); p != m_toSegment.constEnd(); ++p)
@@ -840,7 +856,7 @@ void bdrLabelAnnotationPanel::setLabel()
 				CCVector2 P2D(static_cast<PointCoordinateType>(Q2D.x - half_w),
 					static_cast<PointCoordinateType>(Q2D.y - half_h));
 
-				bool pointInside = pointInFrustrum && CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_segmentationPoly);
+				bool pointInside = pointInFrustrum && preparedPoly.isInside(P2D);
 
 				//visibilityArray[i] = (keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
 
@@ -922,6 +938,29 @@ void bdrLabelAnnotationPanel::createEntity()
 			new_ent->setGlobalScale(cloud->getGlobalScale());
 			new_ent->setGlobalShift(cloud->getGlobalShift());
 
+			//the polygon edges are indexed once for all the points
+			CCLib::PreparedPolygon preparedPoly;
+			bool prepared = false;
+			if (mode2d)	{
+				prepared = preparedPoly.init(poly);
+			}
+			else {
+				//the polygon vertices are only projected once
+				std::vector<CCVector2> poly_vertices;
+				for (CCVector3 p : poly->getPoints(false)) {
+					CCVector3d pq2d;
+					camera.project(p, pq2d);
+					poly_vertices.push_back(CCVector2(pq2d.x - half_w, pq2d.y - half_h));
+				}
+				prepared = preparedPoly.init(poly_vertices);
+			}
+			if (!prepared) {
+				ccLog::Warning("Not enough memory!");
+				delete new_ent;
+				new_ent = nullptr;
+				continue;
+			}
+
 			bool use_color = true;
 			for (int i = 0; i < static_cast<int>(cloudSize); ++i)
 			{
@@ -937,21 +976,7 @@ void bdrLabelAnnotationPanel::createEntity()
 				CCVector2 P2D(static_cast<PointCoordinateType>(Q2D.x - half_w),
 					static_cast<PointCoordinateType>(Q2D.y - half_h));
 				
-				bool pointInside(false);
-				if (mode2d)	{
-					pointInside = CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, poly);
-				}
-				else {
-					std::vector<CCVector2> poly_vertices;
-					for (CCVector3 p : poly->getPoints(false)) {
-						CCVector3d pq2d;
-						camera.project(p, pq2d);
-						poly_vertices.push_back(CCVector2(pq2d.x - half_w, pq2d.y - half_h));
-					}
-					pointInside = CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, poly_vertices);
-				}
-
-				if (!pointInside) { continue; }
+				if (!preparedPoly.isInside(P2D)) { continue; }
 				new_ent->addPoint(*P3D);
 
 				if (use_color) {
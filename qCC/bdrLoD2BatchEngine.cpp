@@ -0,0 +1,405 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "bdrLoD2BatchEngine.h"
+
+//Local
+#include "mainwindow.h"
+#include "stocker_parser.h"
+
+//CCLib
+#include <GenericProgressCallback.h>
+
+//qCC_db
+#include <ccLog.h>
+#include <ccPointCloud.h>
+
+//Qt
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+//system
+#include <algorithm>
+#include <cassert>
+
+//! Rough memory cost of a primitive point during the reconstruction (copies, outlines, polygon partition)
+static const size_t c_bytesPerPrimitivePoint = 256;
+
+bdrLoD2BatchEngine::bdrLoD2BatchEngine(const Parameters& params)
+	: m_params(params)
+	, m_memoryBudget(0)
+	, m_memoryInUse(0)
+	, m_cancelRequested(false)
+	, m_processedCount(0)
+{
+}
+
+bdrLoD2BatchEngine::~bdrLoD2BatchEngine()
+{
+}
+
+QString bdrLoD2BatchEngine::ToString(Status status)
+{
+	switch (status)
+	{
+	case PENDING:
+		return "pending";
+	case SUCCESS:
+		return "success";
+	case FAILED:
+		return "failed";
+	case TIMED_OUT:
+		return "timed out";
+	case SKIPPED_MEMORY:
+		return "skipped (memory)";
+	case CANCELED:
+		return "canceled";
+	case INVALID:
+		return "invalid";
+	}
+	return QString();
+}
+
+size_t bdrLoD2BatchEngine::EstimateMemory(const BDBuildingContext& context)
+{
+	if (!context.primGroup)
+	{
+		return 0;
+	}
+
+	ccHObject::Container clouds;
+	context.primGroup->filterChildren(clouds, true, CC_TYPES::POINT_CLOUD, true);
+
+	size_t pointCount = 0;
+	for (ccHObject* cloud : clouds)
+	{
+		pointCount += static_cast<ccPointCloud*>(cloud)->size();
+	}
+
+	return pointCount * c_bytesPerPrimitivePoint;
+}
+
+void bdrLoD2BatchEngine::acquireMemory(size_t bytes)
+{
+	if (m_memoryBudget == 0)
+	{
+		return;
+	}
+
+	QMutexLocker locker(&m_memoryMutex);
+	//a building bigger than the whole budget is processed alone
+	while (m_memoryInUse != 0 && m_memoryInUse + bytes > m_memoryBudget)
+	{
+		m_memoryReleased.wait(&m_memoryMutex);
+	}
+	m_memoryInUse += bytes;
+}
+
+void bdrLoD2BatchEngine::releaseMemory(size_t bytes)
+{
+	if (m_memoryBudget == 0)
+	{
+		return;
+	}
+
+	QMutexLocker locker(&m_memoryMutex);
+	assert(m_memoryInUse >= bytes);
+	m_memoryInUse -= bytes;
+	m_memoryReleased.wakeAll();
+}
+
+void bdrLoD2BatchEngine::process(size_t index)
+{
+	const Task& task = m_tasks[index];
+	BDBuildingContext& context = *m_contexts[index];
+	Result& result = m_results[index];
+
+	if (result.status != PENDING)
+	{
+		//already rejected
+		return;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	acquireMemory(result.estimatedMemory);
+
+	if (m_cancelRequested)
+	{
+		releaseMemory(result.estimatedMemory);
+		result.status = CANCELED;
+		return;
+	}
+
+	context.timeout_ms = static_cast<qint64>(m_params.timeout_s * 1000.0);
+	context.timer.start();
+
+	try
+	{
+		bool success = true;
+		if (task.packFootprints)
+		{
+			success = PackFootprints_PPP(context,
+										-1, true,
+										m_params.fpDataPtsRatio,
+										m_params.fpDataRatio,
+										m_params.fpSharpWeight);
+		}
+		m_footprintEntityCounts[index] = context.addedEntities.size();
+
+		if (success && !context.timedOut() && !context.canceled())
+		{
+			result.model = LoD2FromFootPrint_PPP(context,
+												task.entity->isA(CC_TYPES::ST_FOOTPRINT) ? task.entity : nullptr,
+												m_params.maxIter,
+												m_params.capHole,
+												m_params.fitFootprint,
+												m_params.dataPtsRatio,
+												m_params.dataRatio,
+												m_params.intsThreshold,
+												m_params.alpha,
+												m_params.minArea,
+												m_params.maxIntersection,
+												m_params.clusterHori,
+												m_params.clusterVerti);
+		}
+
+		if (context.timedOut())
+		{
+			result.status = TIMED_OUT;
+			result.model = nullptr;
+		}
+		else if (!result.model && context.canceled())
+		{
+			result.status = CANCELED;
+		}
+		else
+		{
+			result.status = result.model ? SUCCESS : FAILED;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		ccLog::Warning(QString("[BDRecon] LoD2 batch: building '%1' - %2").arg(task.entity->getName(), e.what()));
+		result.status = FAILED;
+		result.model = nullptr;
+	}
+	catch (...)
+	{
+		result.status = FAILED;
+		result.model = nullptr;
+	}
+
+	releaseMemory(result.estimatedMemory);
+
+	result.duration_s = timer.elapsed() / 1000.0;
+	if (result.status == SUCCESS)
+	{
+		result.blockCount = context.addedEntities.size() - m_footprintEntityCounts[index];
+	}
+
+	unsigned processedCount = 0;
+	{
+		QMutexLocker locker(&m_countMutex);
+		processedCount = ++m_processedCount;
+	}
+	ccLog::Print(QString("[BDRecon] LoD2 batch: building '%1' %2 in %3 s (%4/%5)")
+		.arg(task.entity->getName())
+		.arg(ToString(result.status))
+		.arg(result.duration_s, 0, 'f', 1)
+		.arg(processedCount)
+		.arg(m_tasks.size()));
+}
+
+bool bdrLoD2BatchEngine::run(const std::vector<Task>& tasks, CCLib::GenericProgressCallback* progressCb/*=nullptr*/)
+{
+	try
+	{
+		m_tasks = tasks;
+		m_contexts.clear();
+		m_contexts.reserve(tasks.size());
+		for (size_t i = 0; i < tasks.size(); ++i)
+		{
+			m_contexts.emplace_back(new BDBuildingContext);
+		}
+		m_footprintEntityCounts.assign(tasks.size(), 0);
+		m_results.assign(tasks.size(), Result());
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Warning("[BDRecon] LoD2 batch: not enough memory");
+		return false;
+	}
+	m_processedCount = 0;
+	m_cancelRequested = false;
+	m_memoryInUse = 0;
+	m_memoryBudget = static_cast<size_t>(m_params.maxMemory_mb * 1024.0 * 1024.0);
+	size_t buildingMemoryCap = static_cast<size_t>(m_params.maxBuildingMemory_mb * 1024.0 * 1024.0);
+
+	//resolve the building entities (the DB tree is only accessed here)
+	std::vector<size_t> order;
+	for (size_t i = 0; i < m_tasks.size(); ++i)
+	{
+		Result& result = m_results[i];
+		result.entity = m_tasks[i].entity;
+
+		if (!result.entity || !ResolveBuildingContext(result.entity, *m_contexts[i]))
+		{
+			result.status = INVALID;
+			continue;
+		}
+		m_contexts[i]->cancelRequested = &m_cancelRequested;
+
+		result.estimatedMemory = EstimateMemory(*m_contexts[i]);
+		if (buildingMemoryCap != 0 && result.estimatedMemory > buildingMemoryCap)
+		{
+			ccLog::Warning(QString("[BDRecon] LoD2 batch: building '%1' skipped (estimated memory: %2 MB)")
+				.arg(result.entity->getName())
+				.arg(result.estimatedMemory / (1024 * 1024)));
+			result.status = SKIPPED_MEMORY;
+			continue;
+		}
+
+		order.push_back(i);
+	}
+
+	if (order.empty())
+	{
+		ccLog::Warning("[BDRecon] LoD2 batch: no valid building");
+		return false;
+	}
+
+	//the biggest buildings first (so that they don't end up alone at the end)
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+	{
+		return m_results[a].estimatedMemory > m_results[b].estimatedMemory;
+	});
+
+	int threadCount = m_params.maxThreadCount > 0 ? m_params.maxThreadCount : QThread::idealThreadCount();
+	threadCount = std::max(1, std::min(threadCount, static_cast<int>(order.size())));
+
+	ccLog::Print(QString("[BDRecon] LoD2 batch: %1 building(s) on %2 thread(s)").arg(order.size()).arg(threadCount));
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(threadCount);
+	for (size_t index : order)
+	{
+		QtConcurrent::run(&pool, [this, index]() { process(index); });
+	}
+	if (progressCb)
+	{
+		progressCb->update(0.0f);
+		while (!pool.waitForDone(100))
+		{
+			if (progressCb->isCancelRequested() && !m_cancelRequested)
+			{
+				ccLog::Warning("[BDRecon] LoD2 batch: canceled by the user");
+				m_cancelRequested = true;
+			}
+
+			unsigned processedCount = 0;
+			{
+				QMutexLocker locker(&m_countMutex);
+				processedCount = m_processedCount;
+			}
+			progressCb->update(100.0f * processedCount / order.size());
+			QCoreApplication::processEvents();
+		}
+		progressCb->update(100.0f);
+	}
+	else
+	{
+		pool.waitForDone();
+	}
+
+	//the point clouds XY indexes are only shared by the buildings of this batch
+	ReleaseCloudXYIndexes();
+
+	ccLog::Print("[BDRecon] LoD2 batch: " + summary());
+
+	return std::any_of(m_results.begin(), m_results.end(), [](const Result& result) { return result.status == SUCCESS; });
+}
+
+void bdrLoD2BatchEngine::finalize(MainWindow* win)
+{
+	for (size_t i = 0; i < m_results.size(); ++i)
+	{
+		if (m_results[i].status == INVALID || m_results[i].status == SKIPPED_MEMORY)
+		{
+			continue;
+		}
+		BDBuildingContext& context = *m_contexts[i];
+
+		//discard the blocks of the buildings that couldn't be reconstructed (they are not in the DB tree yet)
+		if (m_results[i].status != SUCCESS)
+		{
+			for (size_t j = m_footprintEntityCounts[i]; j < context.addedEntities.size(); ++j)
+			{
+				ccHObject* block = context.addedEntities[j];
+				if (block->getParent())
+				{
+					block->getParent()->removeChild(block);
+				}
+				else
+				{
+					delete block;
+				}
+			}
+			context.addedEntities.resize(m_footprintEntityCounts[i]);
+		}
+
+		//remove the replaced entities
+		for (ccHObject* entity : context.removedEntities)
+		{
+			if (win)
+			{
+				win->removeFromDB(entity);
+			}
+			else if (entity->getParent())
+			{
+				entity->getParent()->removeChild(entity);
+			}
+		}
+		context.removedEntities.clear();
+	}
+}
+
+QString bdrLoD2BatchEngine::summary() const
+{
+	size_t counts[INVALID + 1] = { 0 };
+	double totalDuration_s = 0.0;
+	for (const Result& result : m_results)
+	{
+		++counts[result.status];
+		totalDuration_s += result.duration_s;
+	}
+
+	QString text = QString("%1 succeeded, %2 failed, %3 timed out, %4 skipped (memory), %5 canceled, %6 invalid")
+		.arg(counts[SUCCESS])
+		.arg(counts[FAILED])
+		.arg(counts[TIMED_OUT])
+		.arg(counts[SKIPPED_MEMORY])
+		.arg(counts[CANCELED])
+		.arg(counts[INVALID]);
+	text += QString(" - cumulated reconstruction time: %1 s").arg(totalDuration_s, 0, 'f', 1);
+
+	return text;
+}
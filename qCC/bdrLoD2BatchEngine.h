@@ -0,0 +1,198 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef BDR_LOD2_BATCH_ENGINE_HEADER
+#define BDR_LOD2_BATCH_ENGINE_HEADER
+
+//qCC_db
+#include <ccHObject.h>
+
+//Qt
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+//system
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace CCLib
+{
+	class GenericProgressCallback;
+}
+
+class MainWindow;
+struct BDBuildingContext;
+
+//! Batch LoD2 reconstruction of buildings (see PackFootprints_PPP and LoD2FromFootPrint_PPP)
+/** The buildings are independent: they are scheduled on a pool of threads (the biggest
+	ones first). The entities of each building are resolved beforehand, so that the workers
+	only access their own building sub-tree. The DB tree is only updated once all the
+	buildings are processed (see finalize).
+
+	Limits:
+	- timeout: the reconstruction can't be interrupted in the middle of a polygon partition,
+	  so the time budget is checked between two stages (and two footprints). The blocks of
+	  a building that exceeds its budget are discarded.
+	- memory: the memory required by a building is (roughly) estimated from the number of
+	  points of its primitives. The buildings exceeding the per-building cap are skipped, and
+	  the concurrent reconstructions are throttled so that the sum of their estimates stays
+	  below the global cap.
+	- cancel: the buildings that are not started yet are skipped, and the running ones stop
+	  at the next check of their time budget.
+**/
+class bdrLoD2BatchEngine
+{
+public:
+
+	//! Reconstruction and scheduling parameters
+	struct Parameters
+	{
+		//! Footprints polygon partition (see PackFootprints_PPP)
+		double fpDataPtsRatio = 0.5;
+		double fpDataRatio = 0.5;
+		double fpSharpWeight = 3.0;
+
+		//! Roof polygon partition (see LoD2FromFootPrint_PPP)
+		int maxIter = -1;
+		bool capHole = false;
+		bool fitFootprint = true;
+		double dataPtsRatio = 0.5;
+		double dataRatio = 0.5;
+		double intsThreshold = 0.2;
+		double alpha = 1.0;
+		double minArea = 2.0;
+		double maxIntersection = 0.8;
+		double clusterHori = 0.2;
+		double clusterVerti = 0.1;
+
+		//! Max number of threads (0 = ideal thread count)
+		int maxThreadCount = 0;
+		//! Time budget per building in seconds (0 = unlimited)
+		double timeout_s = 0.0;
+		//! Max (estimated) memory per building in MB (0 = unlimited)
+		double maxBuildingMemory_mb = 0.0;
+		//! Max (estimated) memory of all the concurrent reconstructions in MB (0 = unlimited)
+		double maxMemory_mb = 0.0;
+	};
+
+	//! Building to reconstruct
+	struct Task
+	{
+		//! Building or footprint entity
+		ccHObject* entity = nullptr;
+		//! Whether to run the footprints polygon partition first
+		bool packFootprints = false;
+	};
+
+	//! Reconstruction status
+	enum Status { PENDING, SUCCESS, FAILED, TIMED_OUT, SKIPPED_MEMORY, CANCELED, INVALID };
+
+	//! Reconstruction result (one per task)
+	struct Result
+	{
+		//! Building or footprint entity
+		ccHObject* entity = nullptr;
+		//! Reconstructed model (the building block group)
+		ccHObject* model = nullptr;
+		Status status = PENDING;
+		//! Reconstruction duration (in seconds)
+		double duration_s = 0.0;
+		//! Estimated memory (in bytes)
+		size_t estimatedMemory = 0;
+		//! Number of reconstructed blocks
+		size_t blockCount = 0;
+	};
+
+	//! Default constructor
+	explicit bdrLoD2BatchEngine(const Parameters& params);
+
+	//! Destructor
+	~bdrLoD2BatchEngine();
+
+	//! Reconstructs the buildings (blocking)
+	/** Must be called from the main thread. The DB tree must not be accessed until
+		the method returns.
+		\param tasks buildings to reconstruct
+		\param progressCb optional progress callback (its cancel request is honored). If set,
+		the calling thread processes the events while waiting for the workers: the caller
+		must prevent any access to the buildings in the meantime (modal dialog, etc.)
+		\return false if no building could be reconstructed
+	**/
+	bool run(const std::vector<Task>& tasks, CCLib::GenericProgressCallback* progressCb = nullptr);
+
+	//! Updates the building sub-trees once the reconstruction is over
+	/** Removes the replaced entities (footprints, etc.) and the blocks of the
+		buildings that couldn't be reconstructed.
+		\param win main window (the entities are also removed from the DB tree) or null
+	**/
+	void finalize(MainWindow* win);
+
+	//! Returns the results (in the same order as the tasks)
+	const std::vector<Result>& results() const { return m_results; }
+
+	//! Returns a summary of the results
+	QString summary() const;
+
+	//! Returns the status as a string
+	static QString ToString(Status status);
+
+	//! Estimates the memory required to reconstruct a building (in bytes)
+	static size_t EstimateMemory(const BDBuildingContext& context);
+
+protected:
+
+	//! Reconstructs one building (called by the workers)
+	void process(size_t index);
+
+	//! Waits for enough memory budget
+	void acquireMemory(size_t bytes);
+	//! Releases some memory budget
+	void releaseMemory(size_t bytes);
+
+	//! Parameters
+	Parameters m_params;
+
+	//! Tasks
+	std::vector<Task> m_tasks;
+	//! Building contexts (one per task)
+	std::vector<std::unique_ptr<BDBuildingContext>> m_contexts;
+	//! Number of entities added by the footprints partition (one per task)
+	std::vector<size_t> m_footprintEntityCounts;
+	//! Results (one per task)
+	std::vector<Result> m_results;
+
+	//! Memory budget (in bytes - 0 = unlimited)
+	size_t m_memoryBudget;
+	//! Memory currently in use (in bytes)
+	size_t m_memoryInUse;
+	//! Memory budget mutex
+	QMutex m_memoryMutex;
+	//! Signaled when some memory budget is released
+	QWaitCondition m_memoryReleased;
+
+	//! Whether the reconstruction has been canceled
+	std::atomic<bool> m_cancelRequested;
+
+	//! Number of processed buildings
+	unsigned m_processedCount;
+	//! Processed buildings counter mutex
+	QMutex m_countMutex;
+};
+
+#endif //BDR_LOD2_BATCH_ENGINE_HEADER
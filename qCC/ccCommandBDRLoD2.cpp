@@ -0,0 +1,170 @@
+#include "ccCommandBDRLoD2.h"
+
+//local
+#include "bdrLoD2BatchEngine.h"
+#include "stocker_parser.h"
+
+//qCC_io
+#include <BinFilter.h>
+
+//Qt
+#include <QFileInfo>
+
+constexpr char COMMAND_BDR_LOD2[]						= "BDR_LOD2";
+constexpr char COMMAND_BDR_LOD2_THREADS[]				= "THREADS";
+constexpr char COMMAND_BDR_LOD2_TIMEOUT[]				= "TIMEOUT";
+constexpr char COMMAND_BDR_LOD2_MAX_MEMORY[]			= "MAX_MEMORY";
+constexpr char COMMAND_BDR_LOD2_MAX_BUILDING_MEMORY[]	= "MAX_BUILDING_MEMORY";
+constexpr char COMMAND_BDR_LOD2_PACK_FOOTPRINTS[]		= "PACK_FOOTPRINTS";
+
+CommandBDRLoD2::CommandBDRLoD2()
+	: ccCommandLineInterface::Command("LoD2 batch reconstruction", COMMAND_BDR_LOD2)
+{}
+
+bool CommandBDRLoD2::process(ccCommandLineInterface& cmd)
+{
+	cmd.print("[BDR LOD2]");
+
+	//look for local options
+	bdrLoD2BatchEngine::Parameters params;
+	bool packFootprints = false;
+
+	while (!cmd.arguments().empty())
+	{
+		QString argument = cmd.arguments().front();
+		if (ccCommandLineInterface::IsCommand(argument, COMMAND_BDR_LOD2_THREADS))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			bool ok = false;
+			params.maxThreadCount = cmd.arguments().empty() ? 0 : cmd.arguments().takeFirst().toInt(&ok);
+			if (!ok || params.maxThreadCount < 0)
+			{
+				return cmd.error(QString("Invalid thread count! (after %1)").arg(COMMAND_BDR_LOD2_THREADS));
+			}
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_BDR_LOD2_TIMEOUT))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			bool ok = false;
+			params.timeout_s = cmd.arguments().empty() ? 0 : cmd.arguments().takeFirst().toDouble(&ok);
+			if (!ok || params.timeout_s < 0)
+			{
+				return cmd.error(QString("Invalid timeout value! (after %1)").arg(COMMAND_BDR_LOD2_TIMEOUT));
+			}
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_BDR_LOD2_MAX_MEMORY))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			bool ok = false;
+			params.maxMemory_mb = cmd.arguments().empty() ? 0 : cmd.arguments().takeFirst().toDouble(&ok);
+			if (!ok || params.maxMemory_mb < 0)
+			{
+				return cmd.error(QString("Invalid memory value! (after %1)").arg(COMMAND_BDR_LOD2_MAX_MEMORY));
+			}
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_BDR_LOD2_MAX_BUILDING_MEMORY))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			bool ok = false;
+			params.maxBuildingMemory_mb = cmd.arguments().empty() ? 0 : cmd.arguments().takeFirst().toDouble(&ok);
+			if (!ok || params.maxBuildingMemory_mb < 0)
+			{
+				return cmd.error(QString("Invalid memory value! (after %1)").arg(COMMAND_BDR_LOD2_MAX_BUILDING_MEMORY));
+			}
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_BDR_LOD2_PACK_FOOTPRINTS))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			packFootprints = true;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (cmd.arguments().empty())
+	{
+		return cmd.error(QString("Missing parameter: project file after \"-%1\"").arg(COMMAND_BDR_LOD2));
+	}
+	QString projectFile = cmd.arguments().takeFirst();
+
+	cmd.print(QString("Loading project '%1'").arg(projectFile));
+	BDBaseHObject* baseObj = LoadBDReconProjectBin(projectFile);
+	if (!baseObj)
+	{
+		return cmd.error(QString("Failed to load the project '%1' (a saved BIN file is required)").arg(projectFile));
+	}
+
+	ccHObject::Container buildings;
+	baseObj->filterChildren(buildings, true, CC_TYPES::ST_BUILDING, true);
+
+	std::vector<bdrLoD2BatchEngine::Task> tasks;
+	tasks.reserve(buildings.size());
+	for (ccHObject* building : buildings)
+	{
+		if (!building->isEnabled())
+		{
+			continue;
+		}
+		bdrLoD2BatchEngine::Task task;
+		task.entity = building;
+		task.packFootprints = packFootprints;
+		tasks.push_back(task);
+	}
+	cmd.print(QString("%1 building(s) to reconstruct").arg(tasks.size()));
+
+	bdrLoD2BatchEngine engine(params);
+	bool success = engine.run(tasks);
+	engine.finalize(nullptr);
+
+	//save the models (next to the building clouds, as in the GUI)
+	unsigned savedCount = 0;
+	for (const bdrLoD2BatchEngine::Result& result : engine.results())
+	{
+		if (result.status != bdrLoD2BatchEngine::SUCCESS || !result.model)
+		{
+			continue;
+		}
+		stocker::BuildUnit* sp = baseObj->GetBuildingSp(GetBaseName(result.entity->getName()).toStdString());
+		if (!sp)
+		{
+			continue;
+		}
+
+		SetGlobalShiftAndScale(result.model);
+
+		QString path = QString::fromStdString(ExcludeExt(sp->file_path.ori_points) + ".bin");
+		FileIOFilter::SaveParameters parameters;
+		{
+			parameters.alwaysDisplaySaveDialog = false;
+			parameters.parentWidget = nullptr;
+		}
+		if (FileIOFilter::SaveToFile(result.model, path, parameters, BinFilter::GetFileFilter()) == CC_FERR_NO_ERROR)
+		{
+			++savedCount;
+		}
+		else
+		{
+			cmd.warning(QString("Failed to save the model of building '%1'").arg(result.entity->getName()));
+		}
+	}
+
+	cmd.print(engine.summary());
+	cmd.print(QString("%1 model(s) saved").arg(savedCount));
+
+	delete baseObj;
+	baseObj = nullptr;
+
+	return success ? true : cmd.error("No building could be reconstructed");
+}
@@ -0,0 +1,14 @@
+#ifndef COMMAND_BDR_LOD2_HEADER
+#define COMMAND_BDR_LOD2_HEADER
+
+#include "ccCommandLineInterface.h"
+
+//! Batch LoD2 reconstruction of the buildings of a project (see bdrLoD2BatchEngine)
+struct CommandBDRLoD2 : public ccCommandLineInterface::Command
+{
+	CommandBDRLoD2();
+
+	bool process(ccCommandLineInterface& cmd) override;
+};
+
+#endif //COMMAND_BDR_LOD2_HEADER
@@ -0,0 +1,337 @@
+#include "ccCommandLineCache.h"
+
+//qCC_db
+#include <ccMesh.h>
+#include <ccOctree.h>
+#include <ccScalarField.h>
+
+//Qt
+#include <QFileInfo>
+
+ccCommandLineCache::ccCommandLineCache(size_t maxMemory_MB)
+	: m_maxMemory(maxMemory_MB << 20)
+	, m_memoryUsed(0)
+	, m_useCounter(0)
+{
+}
+
+ccCommandLineCache::~ccCommandLineCache()
+{
+	clear();
+}
+
+QString ccCommandLineCache::GetKey(	const QString& filename,
+									const ccCommandLineInterface::CLLoadParameters& parameters,
+									FileIOFilter::Shared filter)
+{
+	//the same file loaded with a different Global Shift gives different coordinates!
+	QString key = QFileInfo(filename).absoluteFilePath();
+	key += QString("|%1").arg(static_cast<int>(parameters.shiftHandlingMode));
+	if (parameters.m_coordinatesShiftEnabled)
+	{
+		key += QString("|%1;%2;%3").arg(parameters.m_coordinatesShift.x, 0, 'f', 6).arg(parameters.m_coordinatesShift.y, 0, 'f', 6).arg(parameters.m_coordinatesShift.z, 0, 'f', 6);
+	}
+	if (filter)
+	{
+		key += QString("|%1").arg(filter->getDefaultExtension());
+	}
+
+	return key;
+}
+
+size_t ccCommandLineCache::EstimateMemory(const ccPointCloud* cloud)
+{
+	if (!cloud)
+	{
+		assert(false);
+		return 0;
+	}
+
+	size_t pointSize = sizeof(CCVector3);
+	if (cloud->hasColors())
+		pointSize += sizeof(ccColor::Rgb);
+	if (cloud->hasNormals())
+		pointSize += sizeof(CompressedNormType);
+	pointSize += cloud->getNumberOfScalarFields() * sizeof(ScalarType);
+	if (cloud->getOctree())
+		pointSize += sizeof(CCLib::DgmOctree::IndexAndCode);
+
+	return pointSize * cloud->size();
+}
+
+size_t ccCommandLineCache::EstimateMemory(const ccGenericMesh* mesh)
+{
+	if (!mesh)
+	{
+		assert(false);
+		return 0;
+	}
+
+	size_t memory = mesh->size() * sizeof(CCLib::VerticesIndexes);
+	if (mesh->hasTriNormals())
+		memory += mesh->size() * sizeof(Tuple3i);
+
+	const ccGenericPointCloud* vertices = mesh->getAssociatedCloud();
+	if (vertices && vertices->isA(CC_TYPES::POINT_CLOUD))
+	{
+		memory += EstimateMemory(static_cast<const ccPointCloud*>(vertices));
+	}
+
+	return memory;
+}
+
+void ccCommandLineCache::Release(Entry& entry)
+{
+	for (CLCloudDesc& desc : entry.clouds)
+	{
+		delete desc.pc;
+	}
+	entry.clouds.clear();
+
+	for (CLMeshDesc& desc : entry.meshes)
+	{
+		delete desc.mesh;
+	}
+	entry.meshes.clear();
+}
+
+void ccCommandLineCache::remove(const QString& key)
+{
+	auto it = m_entries.find(key);
+	if (it == m_entries.end())
+	{
+		return;
+	}
+
+	assert(m_memoryUsed >= it->memory);
+	m_memoryUsed -= it->memory;
+	Release(*it);
+	m_entries.erase(it);
+}
+
+void ccCommandLineCache::clear()
+{
+	for (Entry& entry : m_entries)
+	{
+		Release(entry);
+	}
+	m_entries.clear();
+	m_memoryUsed = 0;
+}
+
+void ccCommandLineCache::makeRoom(size_t memory)
+{
+	while (!m_entries.empty() && m_memoryUsed + memory > m_maxMemory)
+	{
+		//look for the least recently used entry
+		auto lru = m_entries.begin();
+		for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+		{
+			if (it->lastUsed < lru->lastUsed)
+			{
+				lru = it;
+			}
+		}
+
+		ccLog::Print(QString("[Cache] Evicting '%1'").arg(lru.key().section('|', 0, 0)));
+		remove(lru.key());
+	}
+}
+
+static ccPointCloud* CloneCloud(ccPointCloud* cloud)
+{
+	assert(cloud);
+	ccPointCloud* clone = cloud->cloneThis(nullptr, true);
+	if (!clone)
+	{
+		return nullptr;
+	}
+	clone->setName(cloud->getName());
+
+	//the octree is not cloned by ccPointCloud::cloneThis
+	ccOctree::Shared octree = cloud->getOctree();
+	if (octree)
+	{
+		ccOctree::Shared cloneOctree(new ccOctree(clone));
+		if (cloneOctree->copyStructure(*octree))
+		{
+			clone->setOctree(cloneOctree, false);
+		}
+	}
+
+	return clone;
+}
+
+bool ccCommandLineCache::checkout(	const QString& key,
+									const QString& filename,
+									std::vector<CLCloudDesc>& clouds,
+									std::vector<CLMeshDesc>& meshes)
+{
+	auto it = m_entries.find(key);
+	if (it == m_entries.end())
+	{
+		return false;
+	}
+
+	//the file may have been modified since it was cached
+	if (QFileInfo(filename).lastModified() != it->lastModified)
+	{
+		remove(key);
+		return false;
+	}
+
+	std::vector<CLCloudDesc> clonedClouds;
+	std::vector<CLMeshDesc> clonedMeshes;
+	try
+	{
+		clonedClouds.reserve(it->clouds.size());
+		clonedMeshes.reserve(it->meshes.size());
+	}
+	catch (const std::bad_alloc&)
+	{
+		return false;
+	}
+
+	bool success = true;
+	for (CLMeshDesc& desc : it->meshes)
+	{
+		assert(desc.mesh && desc.mesh->isA(CC_TYPES::MESH));
+		ccMesh* clone = static_cast<ccMesh*>(desc.mesh)->cloneMesh();
+		if (!clone)
+		{
+			success = false;
+			break;
+		}
+		clone->setName(desc.mesh->getName());
+		clonedMeshes.emplace_back(clone, desc.basename, desc.path, desc.indexInFile);
+	}
+
+	if (success)
+	{
+		for (CLCloudDesc& desc : it->clouds)
+		{
+			ccPointCloud* clone = CloneCloud(desc.pc);
+			if (!clone)
+			{
+				success = false;
+				break;
+			}
+			clonedClouds.emplace_back(clone, desc.basename, desc.path, desc.indexInFile);
+		}
+	}
+
+	if (!success)
+	{
+		//not enough memory to clone the entities: the caller will have to load the file again
+		for (CLCloudDesc& desc : clonedClouds)
+			delete desc.pc;
+		for (CLMeshDesc& desc : clonedMeshes)
+			delete desc.mesh;
+		return false;
+	}
+
+	it->lastUsed = ++m_useCounter;
+
+	for (CLMeshDesc& desc : clonedMeshes)
+	{
+		ccLog::Print(QString("Found one mesh with %1 faces and %2 vertices: '%3' (cached)").arg(desc.mesh->size()).arg(desc.mesh->getAssociatedCloud()->size()).arg(desc.mesh->getName()));
+		meshes.push_back(desc);
+	}
+	for (CLCloudDesc& desc : clonedClouds)
+	{
+		ccLog::Print(QString("Found one cloud with %1 points (cached)").arg(desc.pc->size()));
+		clouds.push_back(desc);
+	}
+
+	return true;
+}
+
+bool ccCommandLineCache::store(	const QString& key,
+								const QString& filename,
+								std::vector<CLCloudDesc>& clouds,
+								size_t firstCloud,
+								std::vector<CLMeshDesc>& meshes,
+								size_t firstMesh)
+{
+	//only 'real' meshes can be cloned
+	for (size_t i = firstMesh; i < meshes.size(); ++i)
+	{
+		if (!meshes[i].mesh || !meshes[i].mesh->isA(CC_TYPES::MESH))
+		{
+			return false;
+		}
+	}
+
+	//estimate the required memory (octrees included)
+	size_t memory = 0;
+	for (size_t i = firstCloud; i < clouds.size(); ++i)
+	{
+		memory += EstimateMemory(clouds[i].pc);
+		if (!clouds[i].pc->getOctree())
+		{
+			memory += clouds[i].pc->size() * sizeof(CCLib::DgmOctree::IndexAndCode);
+		}
+	}
+	for (size_t i = firstMesh; i < meshes.size(); ++i)
+	{
+		memory += EstimateMemory(meshes[i].mesh);
+	}
+
+	if (memory > m_maxMemory)
+	{
+		ccLog::Warning(QString("[Cache] File '%1' is too big to be cached (%2 Mb)").arg(filename).arg(memory >> 20));
+		return false;
+	}
+
+	remove(key);
+	makeRoom(memory);
+
+	Entry entry;
+	entry.lastModified = QFileInfo(filename).lastModified();
+	entry.memory = memory;
+	entry.lastUsed = ++m_useCounter;
+
+	bool success = true;
+	for (size_t i = firstMesh; i < meshes.size(); ++i)
+	{
+		const CLMeshDesc& desc = meshes[i];
+		ccMesh* clone = static_cast<ccMesh*>(desc.mesh)->cloneMesh();
+		if (!clone)
+		{
+			success = false;
+			break;
+		}
+		clone->setName(desc.mesh->getName());
+		entry.meshes.emplace_back(clone, desc.basename, desc.path, desc.indexInFile);
+	}
+
+	for (size_t i = firstCloud; success && i < clouds.size(); ++i)
+	{
+		const CLCloudDesc& desc = clouds[i];
+		ccPointCloud* clone = CloneCloud(desc.pc);
+		if (!clone)
+		{
+			success = false;
+			break;
+		}
+		entry.clouds.emplace_back(clone, desc.basename, desc.path, desc.indexInFile);
+
+		//the octree is computed once and for all (it will be copied along with the cloud)
+		if (!clone->getOctree() && !clone->computeOctree(nullptr, false))
+		{
+			ccLog::Warning(QString("[Cache] Failed to compute the octree of cloud '%1'").arg(clone->getName()));
+		}
+	}
+
+	if (!success)
+	{
+		ccLog::Warning(QString("[Cache] Not enough memory to cache file '%1'").arg(filename));
+		Release(entry);
+		return false;
+	}
+
+	m_entries.insert(key, entry);
+	m_memoryUsed += memory;
+
+	return true;
+}
@@ -0,0 +1,120 @@
+#ifndef CC_COMMAND_LINE_CACHE_HEADER
+#define CC_COMMAND_LINE_CACHE_HEADER
+
+//interface
+#include "../plugins/ccCommandLineInterface.h"
+
+//Qt
+#include <QDateTime>
+#include <QMap>
+#include <QString>
+
+//System
+#include <vector>
+
+//! Cache of the entities loaded by the command line (server mode)
+/** Keeps a pristine copy of the clouds and meshes loaded from each file
+	(as well as the clouds octree) so that the next jobs referring to the
+	same file don't have to load it (and structure it) again. Each job gets
+	its own copy of the cached entities, so that commands can freely modify
+	or delete them. The least recently used files are evicted first when the
+	memory budget is exceeded.
+**/
+class ccCommandLineCache
+{
+public:
+
+	//! Default constructor
+	/** \param maxMemory_MB memory budget (in Mb)
+	**/
+	explicit ccCommandLineCache(size_t maxMemory_MB);
+
+	//! Destructor
+	~ccCommandLineCache();
+
+	//! Returns the key corresponding to a file and a set of loading parameters
+	static QString GetKey(	const QString& filename,
+							const ccCommandLineInterface::CLLoadParameters& parameters,
+							FileIOFilter::Shared filter);
+
+	//! Pushes copies of the cached entities (if any) at the end of the input clouds and meshes sets
+	/** \return whether the file was found in the cache (and is still up-to-date) or not
+	**/
+	bool checkout(	const QString& key,
+					const QString& filename,
+					std::vector<CLCloudDesc>& clouds,
+					std::vector<CLMeshDesc>& meshes);
+
+	//! Stores copies of the entities loaded from a file
+	/** \param key file key (see GetKey)
+		\param filename file name
+		\param clouds loaded clouds (only those at the end of the vector and starting at 'firstCloud' are stored)
+		\param firstCloud index of the first cloud loaded from the file
+		\param meshes loaded meshes (only those at the end of the vector and starting at 'firstMesh' are stored)
+		\param firstMesh index of the first mesh loaded from the file
+		\return whether the entities could be stored or not
+	**/
+	bool store(	const QString& key,
+				const QString& filename,
+				std::vector<CLCloudDesc>& clouds,
+				size_t firstCloud,
+				std::vector<CLMeshDesc>& meshes,
+				size_t firstMesh);
+
+	//! Removes all cached entities
+	void clear();
+
+	//! Returns the number of cached files
+	int fileCount() const { return m_entries.size(); }
+
+	//! Returns the (estimated) memory used by the cached entities (in bytes)
+	size_t memoryUsed() const { return m_memoryUsed; }
+
+	//! Returns the memory budget (in bytes)
+	size_t maxMemory() const { return m_maxMemory; }
+
+	//! Estimates the memory used by a cloud (and its octree)
+	static size_t EstimateMemory(const ccPointCloud* cloud);
+	//! Estimates the memory used by a mesh (and its vertices)
+	static size_t EstimateMemory(const ccGenericMesh* mesh);
+
+protected:
+
+	//! Cached file
+	struct Entry
+	{
+		//! File last modification date (when loaded)
+		QDateTime lastModified;
+		//! Cached clouds (pristine copies)
+		std::vector<CLCloudDesc> clouds;
+		//! Cached meshes (pristine copies)
+		std::vector<CLMeshDesc> meshes;
+		//! Estimated memory used (in bytes)
+		size_t memory = 0;
+		//! Last time the entry was used
+		unsigned lastUsed = 0;
+	};
+
+	//! Releases the entities of an entry
+	static void Release(Entry& entry);
+
+	//! Removes an entry (and updates the used memory)
+	void remove(const QString& key);
+
+	//! Evicts the least recently used entries until the required memory is available
+	void makeRoom(size_t memory);
+
+	//! Cached files
+	QMap<QString, Entry> m_entries;
+
+	//! Memory budget (in bytes)
+	size_t m_maxMemory;
+
+	//! Memory used (in bytes)
+	size_t m_memoryUsed;
+
+	//! Use counter (for LRU eviction)
+	unsigned m_useCounter;
+};
+
+#endif //CC_COMMAND_LINE_CACHE_HEADER
@@ -72,6 +72,8 @@ constexpr char COMMAND_BEST_FIT_PLANE_KEEP_LOADED[]		= "KEEP_LOADED";
 constexpr char COMMAND_ORIENT_NORMALS[]					= "ORIENT_NORMS_MST";
 constexpr char COMMAND_SOR_FILTER[]						= "SOR";
 constexpr char COMMAND_SAMPLE_MESH[]					= "SAMPLE_MESH";
+constexpr char COMMAND_SAMPLE_MESH_SEED[]				= "SEED";
+constexpr char COMMAND_SAMPLE_MESH_STRATIFIED[]			= "STRATIFIED";
 constexpr char COMMAND_CROP[]							= "CROP";
 constexpr char COMMAND_CROP_OUTSIDE[]					= "OUTSIDE";
 constexpr char COMMAND_CROP_2D[]						= "CROP2D";
@@ -2411,6 +2413,36 @@ bool CommandSampleMesh::process(ccCommandLineInterface &cmd)
 	if (!conversionOk)
 		return cmd.error(QObject::tr("Invalid parameter: value after sampling mode"));
 	
+	//look for local options
+	CCLib::MeshSamplingTools::SamplingParameters samplingParams;
+	while (!cmd.arguments().empty())
+	{
+		QString argument = cmd.arguments().front();
+		if (ccCommandLineInterface::IsCommand(argument, COMMAND_SAMPLE_MESH_SEED))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			
+			if (cmd.arguments().empty())
+				return cmd.error(QObject::tr("Missing parameter: seed value after '%1'").arg(COMMAND_SAMPLE_MESH_SEED));
+			bool ok;
+			samplingParams.seed = cmd.arguments().takeFirst().toUInt(&ok);
+			if (!ok || samplingParams.seed == 0)
+				return cmd.error(QObject::tr("Invalid seed! (after %1)").arg(COMMAND_SAMPLE_MESH_SEED));
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_SAMPLE_MESH_STRATIFIED))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+			
+			samplingParams.stratified = true;
+		}
+		else
+		{
+			break;
+		}
+	}
+	
 	if (cmd.meshes().empty())
 		return cmd.error(QObject::tr("No mesh available. Be sure to open one first!"));
 	
@@ -2423,7 +2455,7 @@ bool CommandSampleMesh::process(ccCommandLineInterface &cmd)
 	
 	for (size_t i = 0; i < cmd.meshes().size(); ++i)
 	{
-		ccPointCloud* cloud = cmd.meshes()[i].mesh->samplePoints(useDensity, parameter, true, true, true, progressDialog.data());
+		ccPointCloud* cloud = cmd.meshes()[i].mesh->samplePoints(useDensity, parameter, true, true, true, progressDialog.data(), samplingParams);
 		
 		if (!cloud)
 		{
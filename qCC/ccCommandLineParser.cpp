@@ -2,8 +2,12 @@
 
 //Local
 #include "ccCommandCrossSection.h"
+#include "ccCommandLineCache.h"
 #include "ccCommandLineCommands.h"
 #include "ccCommandRaster.h"
+#ifdef USE_STOCKER
+#include "ccCommandBDRLoD2.h"
+#endif
 #include "ccPluginInterface.h"
 
 //qCC_db
@@ -23,13 +27,21 @@
 #include <QDateTime>
 #include <QElapsedTimer>
 #include <QMessageBox>
+#include <QTextStream>
 
 //system
 #include <unordered_set>
 
 //commands
-constexpr char COMMAND_HELP[]			= "HELP";
-constexpr char COMMAND_SILENT_MODE[]	= "SILENT";
+constexpr char COMMAND_HELP[]				= "HELP";
+constexpr char COMMAND_SILENT_MODE[]		= "SILENT";
+constexpr char COMMAND_SERVER_MODE[]		= "SERVER";
+constexpr char COMMAND_SERVER_MAX_MEMORY[]	= "MAX_MEMORY";
+constexpr char COMMAND_SERVER_CLEAR_CACHE[]	= "CLEAR_CACHE";
+constexpr char COMMAND_SERVER_QUIT[]		= "QUIT";
+
+//default memory budget for the server mode cache (in Mb)
+constexpr size_t DEFAULT_SERVER_CACHE_MEMORY_MB = 4096;
 
 /*****************************************************/
 /*************** ccCommandLineParser *****************/
@@ -63,26 +75,24 @@ int ccCommandLineParser::Parse(int nargs, char** args, ccPluginInterfaceList& pl
 	}
 
 	//load arguments
-	QScopedPointer<ccCommandLineParser> parser(new ccCommandLineParser);
-	
-	parser->registerBuiltInCommands();
-	
+	QStringList arguments;
 	for (int i = 1; i < nargs; ++i) //'i=1' because first argument is always program executable file!
 	{
-		parser->arguments().push_back(QString(args[i]));
+		arguments.push_back(QString(args[i]));
 	}
 	
-	assert(!parser->arguments().empty());
+	assert(!arguments.empty());
 
 	//specific command: silent mode (will prevent the console dialog from appearing!
-	if (ccCommandLineInterface::IsCommand(parser->arguments().front(), COMMAND_SILENT_MODE))
+	bool silent = false;
+	if (ccCommandLineInterface::IsCommand(arguments.front(), COMMAND_SILENT_MODE))
 	{
-		parser->arguments().pop_front();
-		parser->toggleSilentMode(true);
+		arguments.pop_front();
+		silent = true;
 	}
 
 	QScopedPointer<QDialog> consoleDlg(nullptr);
-	if (!parser->silentMode())
+	if (!silent)
 	{
 		//show console
 		consoleDlg.reset(new QDialog);
@@ -90,7 +100,6 @@ int ccCommandLineParser::Parse(int nargs, char** args, ccPluginInterfaceList& pl
 		commandLineDlg.setupUi(consoleDlg.data());
 		consoleDlg->show();
 		ccConsole::Init(commandLineDlg.consoleWidget, consoleDlg.data());
-		parser->fileLoadingParams().parentWidget = consoleDlg.data();
 		QApplication::processEvents(); //Get rid of the spinner
 	}
 	else
@@ -100,22 +109,41 @@ int ccCommandLineParser::Parse(int nargs, char** args, ccPluginInterfaceList& pl
 		ccConsole::Init(nullptr, nullptr, nullptr, true); 
 	}
 
-	//load the plugins commands
-	for ( ccPluginInterface *plugin : plugins )
+	//specific command: server mode (jobs are read on the standard input)
+	bool serverMode = false;
+	size_t maxCacheMemory_MB = DEFAULT_SERVER_CACHE_MEMORY_MB;
+	if (!arguments.empty() && ccCommandLineInterface::IsCommand(arguments.front(), COMMAND_SERVER_MODE))
 	{
-		if (!plugin)
+		arguments.pop_front();
+		serverMode = true;
+
+		if (!arguments.empty() && ccCommandLineInterface::IsCommand(arguments.front(), COMMAND_SERVER_MAX_MEMORY))
 		{
-			assert(false);
-			continue;
+			arguments.pop_front();
+			bool ok = false;
+			if (!arguments.empty())
+			{
+				maxCacheMemory_MB = arguments.takeFirst().toUInt(&ok);
+			}
+			if (!ok)
+			{
+				ccConsole::Error(QString("Missing or invalid parameter: memory budget (in Mb) after '%1'").arg(COMMAND_SERVER_MAX_MEMORY));
+				ccConsole::ReleaseInstance();
+				return EXIT_FAILURE;
+			}
 		}
 
-		plugin->registerCommands(parser.data());
+		if (!arguments.empty())
+		{
+			ccConsole::Warning(QString("[Server] Additional arguments ignored (jobs are read on the standard input): %1").arg(arguments.join(' ')));
+		}
 	}
 
 	//parse input
-	int result = parser->start(consoleDlg.data());
+	int result = serverMode	? RunServer(plugins, silent, maxCacheMemory_MB, consoleDlg.data())
+							: RunJob(arguments, plugins, silent, nullptr, consoleDlg.data());
 
-	if (!parser->silentMode())
+	if (!silent)
 	{
 		if (result == EXIT_SUCCESS)
 			QMessageBox::information(consoleDlg.data(), "Processed finished", "Job done");
@@ -123,15 +151,160 @@ int ccCommandLineParser::Parse(int nargs, char** args, ccPluginInterfaceList& pl
 			QMessageBox::warning(consoleDlg.data(), "Processed finished", "An error occurred! Check console");
 	}
 
+	ccConsole::ReleaseInstance();
+
+	return result;
+}
+
+int ccCommandLineParser::RunJob(const QStringList& arguments,
+								ccPluginInterfaceList& plugins,
+								bool silent,
+								ccCommandLineCache* cache,
+								QDialog* parent)
+{
+	QScopedPointer<ccCommandLineParser> parser(new ccCommandLineParser);
+	
+	parser->registerBuiltInCommands();
+	parser->arguments() = arguments;
+	parser->toggleSilentMode(silent);
+	parser->m_cache = cache;
+	if (!silent)
+	{
+		parser->fileLoadingParams().parentWidget = parent;
+	}
+
+	//load the plugins commands
+	for ( ccPluginInterface *plugin : plugins )
+	{
+		if (!plugin)
+		{
+			assert(false);
+			continue;
+		}
+
+		plugin->registerCommands(parser.data());
+	}
+
+	//parse input
+	int result = parser->start(parent);
+
 	//release the parser before the console (as its dialogs may be chidren of the console)
 	parser->cleanup();
 	parser.reset();
 
-	ccConsole::ReleaseInstance();
-
 	return result;
 }
 
+//! Splits a job line into arguments (double quotes can be used for arguments containing spaces)
+static QStringList SplitJobLine(const QString& line)
+{
+	QStringList arguments;
+	QString current;
+	bool inQuotes = false;
+	bool hasArgument = false;
+
+	for (const QChar& c : line)
+	{
+		if (c == '"')
+		{
+			inQuotes = !inQuotes;
+			hasArgument = true;
+		}
+		else if (c.isSpace() && !inQuotes)
+		{
+			if (hasArgument)
+			{
+				arguments.push_back(current);
+				current.clear();
+				hasArgument = false;
+			}
+		}
+		else
+		{
+			current += c;
+			hasArgument = true;
+		}
+	}
+
+	if (hasArgument)
+	{
+		arguments.push_back(current);
+	}
+
+	return arguments;
+}
+
+int ccCommandLineParser::RunServer(	ccPluginInterfaceList& plugins,
+									bool silent,
+									size_t maxCacheMemory_MB,
+									QDialog* parent)
+{
+	ccCommandLineCache cache(maxCacheMemory_MB);
+
+	ccConsole::Print(QString("[Server] Waiting for jobs on the standard input (one per line) - cache: %1 Mb - '%2' to stop").arg(maxCacheMemory_MB).arg(COMMAND_SERVER_QUIT));
+
+	QTextStream input(stdin);
+	unsigned jobIndex = 0;
+	bool success = true;
+	while (true)
+	{
+		QApplication::processEvents();
+
+		QString line = input.readLine();
+		if (line.isNull())
+		{
+			//end of stream
+			break;
+		}
+		line = line.trimmed();
+		if (line.isEmpty())
+		{
+			continue;
+		}
+
+		QString keyword = line.toUpper();
+		if (keyword.startsWith('-'))
+		{
+			keyword = keyword.mid(1);
+		}
+		if (keyword == COMMAND_SERVER_QUIT)
+		{
+			break;
+		}
+		else if (keyword == COMMAND_SERVER_CLEAR_CACHE)
+		{
+			cache.clear();
+			ccConsole::Print("[Server] Cache cleared");
+			continue;
+		}
+
+		++jobIndex;
+		QStringList arguments = SplitJobLine(line);
+		if (arguments.empty())
+		{
+			continue;
+		}
+
+		int result = RunJob(arguments, plugins, silent, &cache, parent);
+		if (result != EXIT_SUCCESS)
+		{
+			success = false;
+		}
+
+		//job completion marker (for the client)
+		ccConsole::Print(QString("[Server] Job #%1 done: %2 (cache: %3 file(s) / %4 Mb)")
+			.arg(jobIndex)
+			.arg(result == EXIT_SUCCESS ? "SUCCESS" : "FAILURE")
+			.arg(cache.fileCount())
+			.arg(cache.memoryUsed() >> 20));
+		fflush(stdout);
+	}
+
+	ccConsole::Print(QString("[Server] Stopped after %1 job(s)").arg(jobIndex));
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 ccCommandLineParser::ccCommandLineParser()
 	: ccCommandLineInterface()
 	, m_cloudExportFormat(BinFilter::GetFileFilter())
@@ -141,6 +314,7 @@ ccCommandLineParser::ccCommandLineParser()
 	, m_orphans("orphans")
 	, m_progressDialog(nullptr)
 	, m_parentWidget(nullptr)
+	, m_cache(nullptr)
 {
 }
 
@@ -349,6 +523,19 @@ bool ccCommandLineParser::importFile(QString filename, FileIOFilter::Shared filt
 {
 	print(QString("Opening file: '%1'").arg(filename));
 
+	//server mode: the file may have already been loaded by a previous job
+	QString cacheKey;
+	if (m_cache)
+	{
+		cacheKey = ccCommandLineCache::GetKey(filename, m_loadingParameters, filter);
+		if (m_cache->checkout(cacheKey, filename, m_clouds, m_meshes))
+		{
+			return true;
+		}
+	}
+	size_t firstCloud = m_clouds.size();
+	size_t firstMesh = m_meshes.size();
+
 	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
 	ccHObject* db = nullptr;
 	if (filter)
@@ -454,6 +641,11 @@ bool ccCommandLineParser::importFile(QString filename, FileIOFilter::Shared filt
 	delete db;
 	db = nullptr;
 
+	if (m_cache)
+	{
+		m_cache->store(cacheKey, filename, m_clouds, firstCloud, m_meshes, firstMesh);
+	}
+
 	return true;
 }
 
@@ -630,6 +822,9 @@ void ccCommandLineParser::registerBuiltInCommands()
 	registerCommand(Command::Shared(new CommandSFConvertToRGB));
 	registerCommand(Command::Shared(new CommandMoment));
 	registerCommand(Command::Shared(new CommandFeature));
+#ifdef USE_STOCKER
+	registerCommand(Command::Shared(new CommandBDRLoD2));
+#endif
 
 }
 
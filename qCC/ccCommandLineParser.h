@@ -7,6 +7,7 @@
 //Local
 #include "ccPluginManager.h"
 
+class ccCommandLineCache;
 class ccProgressDialog;
 class QDialog;
 
@@ -65,6 +66,33 @@ protected: //other methods
 	//! Parses the command line
 	int start(QDialog* parent = nullptr);
 
+	//! Runs a single job (i.e. a sequence of commands)
+	/** \param arguments job commands
+		\param plugins plugins (to register their commands)
+		\param silent whether the job should run in silent mode or not
+		\param cache entities cache (server mode only)
+		\param parent parent widget (if any)
+		\return EXIT_SUCCESS or EXIT_FAILURE
+	**/
+	static int RunJob(	const QStringList& arguments,
+						ccPluginInterfaceList& plugins,
+						bool silent,
+						ccCommandLineCache* cache,
+						QDialog* parent);
+
+	//! Server mode: reads and runs jobs (one per line) from the standard input until 'QUIT' is received
+	/** Loaded entities (and their octree) are kept in cache between jobs.
+		\param plugins plugins (to register their commands)
+		\param silent whether the jobs should run in silent mode or not
+		\param maxCacheMemory_MB cache memory budget (in Mb)
+		\param parent parent widget (if any)
+		\return EXIT_SUCCESS or EXIT_FAILURE
+	**/
+	static int RunServer(	ccPluginInterfaceList& plugins,
+							bool silent,
+							size_t maxCacheMemory_MB,
+							QDialog* parent);
+
 private: //members
 
 	//! Current cloud(s) export format (can be modified with the 'COMMAND_CLOUD_EXPORT_FORMAT' option)
@@ -93,6 +121,9 @@ private: //members
 
 	//! Widget parent
 	QDialog* m_parentWidget;
+
+	//! Loaded entities cache (server mode only)
+	ccCommandLineCache* m_cache;
 };
 
 #endif
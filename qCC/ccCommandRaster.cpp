@@ -37,11 +37,19 @@ constexpr char COMMAND_RASTER_PROJ_MIN[]				= "MIN";
 constexpr char COMMAND_RASTER_PROJ_MAX[]				= "MAX";
 constexpr char COMMAND_RASTER_PROJ_AVG[]				= "AVG";
 constexpr char COMMAND_RASTER_RESAMPLE[]				= "RESAMPLE";
+constexpr char COMMAND_RASTER_TILE_SIZE[]				= "TILE_SIZE";
+constexpr char COMMAND_RASTER_TILE_MARGIN[]				= "TILE_MARGIN";
+
+//default margin around each tile (in cells) in tiled mode
+constexpr unsigned DEFAULT_RASTER_TILE_MARGIN = 64;
 
 //2.5D Volume calculation specific commands
 constexpr char COMMAND_VOLUME[] = "VOLUME";
 constexpr char COMMAND_VOLUME_GROUND_IS_FIRST[]			= "GROUND_IS_FIRST";
 constexpr char COMMAND_VOLUME_CONST_HEIGHT[]			= "CONST_HEIGHT";
+constexpr char COMMAND_VOLUME_GROUND_FILL_EMPTY_CELLS[]	= "GROUND_EMPTY_FILL";
+constexpr char COMMAND_VOLUME_CEIL_FILL_EMPTY_CELLS[]	= "CEIL_EMPTY_FILL";
+constexpr char COMMAND_VOLUME_SERIES[]					= "SERIES";
 
 
 static ccRasterGrid::ProjectionType GetProjectionType(QString option, ccCommandLineInterface &cmd)
@@ -92,6 +100,197 @@ static ccRasterGrid::EmptyCellFillOption GetEmptyCellFillingStrategy(QString opt
 	}
 }
 
+static bool RasterizeByTiles(	ccCommandLineInterface &cmd,
+								CLCloudDesc& cloudDesc,
+								const ccBBox& gridBBox,
+								double gridStep,
+								unsigned char vertDir,
+								ccRasterGrid::ProjectionType projectionType,
+								ccRasterGrid::ProjectionType sfProjectionType,
+								ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy,
+								double customHeight,
+								unsigned tileSize,
+								unsigned tileMargin,
+								bool outputCloud,
+								bool resample,
+								bool outputRasterZ,
+								bool outputRasterRGB)
+{
+	unsigned gridWidth = 0, gridHeight = 0;
+	if (!ccRasterGrid::ComputeGridSize(vertDir, gridBBox, gridStep, gridWidth, gridHeight))
+	{
+		return cmd.error("Failed to compute the grid dimensions (check input cloud(s) bounding-box)");
+	}
+	cmd.print(QString("[Rasterize] Tiled mode: tiles of %1 x %1 cells (margin: %2 cells)").arg(tileSize).arg(tileMargin));
+
+	unsigned sfCount = 0;
+	if (cloudDesc.pc->isA(CC_TYPES::POINT_CLOUD))
+	{
+		sfCount = static_cast<ccPointCloud*>(cloudDesc.pc)->getNumberOfScalarFields();
+	}
+
+	//the raster files are written tile by tile
+	ccRasterizeTool::TiledGeoTiffWriter rasterZWriter;
+	if (outputRasterZ)
+	{
+		ccRasterizeTool::ExportBands bands;
+		{
+			bands.height = true;
+			bands.rgb = false; //not a good idea to mix RGB and height values!
+			bands.allSFs = true;
+		}
+		QString exportFilename = cmd.getExportFilename(cloudDesc, "tif", "RASTER_Z", nullptr, !cmd.addTimestamp());
+		if (exportFilename.isEmpty())
+		{
+			exportFilename = "rasterZ.tif";
+		}
+
+		if (!rasterZWriter.open(exportFilename, bands, gridWidth, gridHeight, sfCount, gridBBox, gridStep, vertDir, cloudDesc.pc))
+		{
+			return cmd.error("Failed to create the raster file");
+		}
+	}
+
+	ccRasterizeTool::TiledGeoTiffWriter rasterRGBWriter;
+	if (outputRasterRGB)
+	{
+		ccRasterizeTool::ExportBands bands;
+		{
+			bands.rgb = true;
+			bands.height = false; //not a good idea to mix RGB and height values!
+			bands.allSFs = false;
+		}
+		QString exportFilename = cmd.getExportFilename(cloudDesc, "tif", "RASTER_RGB", nullptr, !cmd.addTimestamp());
+		if (exportFilename.isEmpty())
+		{
+			exportFilename = "rasterRGB.tif";
+		}
+
+		if (!rasterRGBWriter.open(exportFilename, bands, gridWidth, gridHeight, 0, gridBBox, gridStep, vertDir, cloudDesc.pc))
+		{
+			return cmd.error("Failed to create the raster file");
+		}
+	}
+
+	//each tile is exported as soon as it is generated
+	auto processTile = [&](ccRasterGrid& tile, const ccRasterGrid::TileInfo& info) -> bool
+	{
+		if (rasterZWriter.isOpen() && !rasterZWriter.writeTile(tile, info.x0, info.y0))
+		{
+			return false;
+		}
+		if (rasterRGBWriter.isOpen() && !rasterRGBWriter.writeTile(tile, info.x0, info.y0))
+		{
+			return false;
+		}
+
+		if (outputCloud)
+		{
+			if (tile.validCellCount == 0)
+			{
+				//nothing to export
+				return true;
+			}
+
+			std::vector<ccRasterGrid::ExportableFields> exportedFields;
+			try
+			{
+				//we always compute the default 'height' layer
+				exportedFields.push_back(ccRasterGrid::PER_CELL_HEIGHT);
+			}
+			catch (const std::bad_alloc&)
+			{
+				cmd.warning("Not enough memory");
+				return false;
+			}
+
+			//the tile bounding-box (only its min corner is actually used)
+			CCVector3 tileMinCorner = CCVector3::fromArray(tile.minCorner.u);
+			ccBBox tileBBox(tileMinCorner, tileMinCorner);
+
+			ccPointCloud* tileCloud = tile.convertToCloud(	exportedFields,
+															true,
+															true,
+															resample && info.cloud,
+															resample && info.cloud,
+															info.cloud,
+															vertDir,
+															tileBBox,
+															false,
+															customHeight,
+															true);
+
+			if (!tileCloud)
+			{
+				cmd.warning(QString("Failed to output the raster tile #%1 as a cloud").arg(info.index + 1));
+				return false;
+			}
+
+			tileCloud->showColors(cloudDesc.pc->hasColors());
+			if (tileCloud->hasScalarFields())
+			{
+				tileCloud->showSF(!cloudDesc.pc->hasColors());
+				tileCloud->setCurrentDisplayedScalarField(0);
+			}
+			//don't forget the original shift
+			tileCloud->setGlobalShift(cloudDesc.pc->getGlobalShift());
+			tileCloud->setGlobalScale(cloudDesc.pc->getGlobalScale());
+			tileCloud->setName(QString("%1.raster_tile_%2_%3").arg(cloudDesc.pc->getName()).arg(info.x0 / tileSize).arg(info.y0 / tileSize));
+
+			CLCloudDesc tileDesc(tileCloud, cloudDesc.basename + QString("_RASTER_TILE_%1_%2").arg(info.x0 / tileSize).arg(info.y0 / tileSize), cloudDesc.path);
+			QString errorStr = cmd.exportEntity(tileDesc);
+			delete tileCloud;
+			tileCloud = nullptr;
+
+			if (!errorStr.isEmpty())
+			{
+				cmd.warning(errorStr);
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	//progress dialog
+	QScopedPointer<ccProgressDialog> pDlg(nullptr);
+	if (!cmd.silentMode())
+	{
+		pDlg.reset(new ccProgressDialog(true, cmd.widgetParent()));
+	}
+
+	ccRasterGrid::TiledGridStats stats;
+	if (!ccRasterGrid::GenerateByTiles(	cloudDesc.pc,
+										gridBBox,
+										gridStep,
+										vertDir,
+										projectionType,
+										emptyCellFillStrategy,
+										customHeight,
+										sfProjectionType,
+										tileSize,
+										tileMargin,
+										processTile,
+										&stats,
+										pDlg.data()))
+	{
+		return cmd.error("Rasterize process failed");
+	}
+
+	cmd.print(QString("[Rasterize] Raster grid: size: %1 x %2 / heights: [%3 ; %4]").arg(gridWidth).arg(gridHeight).arg(stats.minHeight).arg(stats.maxHeight));
+
+	if (rasterZWriter.isOpen() && !rasterZWriter.close(emptyCellFillStrategy, stats, customHeight))
+	{
+		return cmd.error("Failed to save the raster file");
+	}
+	if (rasterRGBWriter.isOpen() && !rasterRGBWriter.close(emptyCellFillStrategy, stats, customHeight))
+	{
+		return cmd.error("Failed to save the raster file");
+	}
+
+	return true;
+}
+
 CommandRasterize::CommandRasterize()
     : ccCommandLineInterface::Command("Rasterize", COMMAND_RASTERIZE)
 {}
@@ -112,6 +311,8 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 	ccRasterGrid::ProjectionType projectionType = ccRasterGrid::PROJ_AVERAGE_VALUE;
 	ccRasterGrid::ProjectionType sfProjectionType = ccRasterGrid::PROJ_AVERAGE_VALUE;
 	ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy = ccRasterGrid::LEAVE_EMPTY;
+	unsigned tileSize = 0; //0 = no tiling
+	unsigned tileMargin = DEFAULT_RASTER_TILE_MARGIN;
 
 	while (!cmd.arguments().empty())
 	{
@@ -222,6 +423,30 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 
 			resample = true;
 		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTER_TILE_SIZE))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			bool ok;
+			tileSize = cmd.arguments().takeFirst().toUInt(&ok);
+			if (!ok || tileSize == 0)
+			{
+				return cmd.error(QString("Invalid tile size! (after %1)").arg(COMMAND_RASTER_TILE_SIZE));
+			}
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTER_TILE_MARGIN))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			bool ok;
+			tileMargin = cmd.arguments().takeFirst().toUInt(&ok);
+			if (!ok)
+			{
+				return cmd.error(QString("Invalid tile margin! (after %1)").arg(COMMAND_RASTER_TILE_MARGIN));
+			}
+		}
 		else
 		{
 			break;
@@ -251,6 +476,24 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 		cmd.warning("[Rasterize] The 'resample' option is set while the raster won't be exported as a cloud nor as a mesh");
 	}
 
+	if (tileSize != 0)
+	{
+		if (outputMesh)
+		{
+			cmd.warning("[Rasterize] The grid can't be exported as a mesh in tiled mode");
+			outputMesh = false;
+		}
+		if (	emptyCellFillStrategy == ccRasterGrid::FILL_MINIMUM_HEIGHT
+			||	emptyCellFillStrategy == ccRasterGrid::FILL_MAXIMUM_HEIGHT
+			||	emptyCellFillStrategy == ccRasterGrid::FILL_AVERAGE_HEIGHT)
+		{
+			if (outputCloud)
+			{
+				cmd.warning("[Rasterize] In tiled mode, the empty cells are only filled with the min, max or average height in the raster files (not in the clouds)");
+			}
+		}
+	}
+
 	//we'll get the first two clouds
 	for (CLCloudDesc& cloudDesc : cmd.clouds())
 	{
@@ -270,6 +513,30 @@ bool CommandRasterize::process(ccCommandLineInterface &cmd)
 
 		cmd.print(QString("Grid size: %1 x %2").arg(gridWidth).arg(gridHeight));
 
+		if (tileSize != 0)
+		{
+			//tiled mode: the tiles are generated and exported one after the other
+			if (!RasterizeByTiles(	cmd,
+									cloudDesc,
+									gridBBox,
+									gridStep,
+									static_cast<unsigned char>(vertDir),
+									projectionType,
+									sfProjectionType,
+									emptyCellFillStrategy,
+									customHeight,
+									tileSize,
+									tileMargin,
+									outputCloud,
+									resample,
+									outputRasterZ,
+									outputRasterRGB))
+			{
+				return false;
+			}
+			continue;
+		}
+
 		if (gridWidth * gridHeight > (1 << 26)) //64 million of cells
 		{
 			if (cmd.silentMode())
@@ -489,10 +756,15 @@ bool CommandVolume25D::process(ccCommandLineInterface &cmd)
 
 	//look for local options
 	bool groundIsFirst = false;
+	bool series = false;
 	double gridStep = 0;
 	double constHeight = std::numeric_limits<double>::quiet_NaN();
+	double customHeight = std::numeric_limits<double>::quiet_NaN();
 	bool outputMesh = false;
 	int vertDir = 2;
+	ccRasterGrid::ProjectionType projectionType = ccRasterGrid::PROJ_AVERAGE_VALUE;
+	ccRasterGrid::EmptyCellFillOption groundEmptyCellFillStrategy = ccRasterGrid::LEAVE_EMPTY;
+	ccRasterGrid::EmptyCellFillOption ceilEmptyCellFillStrategy = ccRasterGrid::LEAVE_EMPTY;
 
 	while (!cmd.arguments().empty())
 	{
@@ -504,6 +776,13 @@ bool CommandVolume25D::process(ccCommandLineInterface &cmd)
 
 			groundIsFirst = true;
 		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_VOLUME_SERIES))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			series = true;
+		}
 		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_GRID_OUTPUT_MESH))
 		{
 			//local option confirmed, we can move on
@@ -535,6 +814,39 @@ bool CommandVolume25D::process(ccCommandLineInterface &cmd)
 				return cmd.error(QString("Invalid const. height value! (after %1)").arg(COMMAND_VOLUME_CONST_HEIGHT));
 			}
 		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTER_CUSTOM_HEIGHT))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			bool ok;
+			customHeight = cmd.arguments().takeFirst().toDouble(&ok);
+			if (!ok)
+			{
+				return cmd.error(QString("Invalid custom height value! (after %1)").arg(COMMAND_RASTER_CUSTOM_HEIGHT));
+			}
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_RASTER_PROJ_TYPE))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			projectionType = GetProjectionType(cmd.arguments().takeFirst().toUpper(), cmd);
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_VOLUME_GROUND_FILL_EMPTY_CELLS))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			groundEmptyCellFillStrategy = GetEmptyCellFillingStrategy(cmd.arguments().takeFirst().toUpper(), cmd);
+		}
+		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_VOLUME_CEIL_FILL_EMPTY_CELLS))
+		{
+			//local option confirmed, we can move on
+			cmd.arguments().pop_front();
+
+			ceilEmptyCellFillStrategy = GetEmptyCellFillingStrategy(cmd.arguments().takeFirst().toUpper(), cmd);
+		}
 		else if (ccCommandLineInterface::IsCommand(argument, COMMAND_GRID_VERT_DIR))
 		{
 			//local option confirmed, we can move on
@@ -559,40 +871,79 @@ bool CommandVolume25D::process(ccCommandLineInterface &cmd)
 		return cmd.error(QString("Grid step value not defined (use %1)").arg(COMMAND_GRID_STEP));
 	}
 
-	//we'll get the first two clouds
-	CLCloudDesc *ground = 0, *ceil = 0;
+	if (	std::isnan(customHeight)
+		&&	(groundEmptyCellFillStrategy == ccRasterGrid::FILL_CUSTOM_HEIGHT || ceilEmptyCellFillStrategy == ccRasterGrid::FILL_CUSTOM_HEIGHT))
 	{
-		CLCloudDesc* clouds[2] = { 0, 0 };
-		int index = 0;
-		if (!cmd.clouds().empty())
+		cmd.warning(QString("[Volume] The filling stragety is set to 'fill with custom height' but no custom height was defined (use %1)").arg(COMMAND_RASTER_CUSTOM_HEIGHT));
+		if (groundEmptyCellFillStrategy == ccRasterGrid::FILL_CUSTOM_HEIGHT)
+			groundEmptyCellFillStrategy = ccRasterGrid::LEAVE_EMPTY;
+		if (ceilEmptyCellFillStrategy == ccRasterGrid::FILL_CUSTOM_HEIGHT)
+			ceilEmptyCellFillStrategy = ccRasterGrid::LEAVE_EMPTY;
+	}
+
+	//we'll get the first two clouds (or all of them in 'series' mode)
+	//we work with indexes as new clouds may be added to the set
+	struct Job
+	{
+		int groundIndex = -1;
+		int ceilIndex = -1;
+	};
+	std::vector<Job> jobs;
+	{
+		size_t cloudCount = cmd.clouds().size();
+		if (series)
 		{
-			clouds[index++] = &cmd.clouds()[0];
-			if (std::isnan(constHeight) && cmd.clouds().size() > 1)
+			if (!std::isnan(constHeight))
 			{
-				clouds[index++] = &cmd.clouds()[1];
+				cmd.warning(QString("[Volume] The %1 option is ignored in %2 mode").arg(COMMAND_VOLUME_CONST_HEIGHT).arg(COMMAND_VOLUME_SERIES));
+				constHeight = std::numeric_limits<double>::quiet_NaN();
+			}
+			if (cloudCount < 2)
+			{
+				return cmd.error(QString("Not enough loaded entities (%1 found, at least 2 expected)").arg(cloudCount));
 			}
-		}
 
-		int expectedCount = std::isnan(constHeight) ? 2 : 1;
-		if (index != expectedCount)
-		{
-			return cmd.error(QString("Not enough loaded entities (%1 found, %2 expected)").arg(index).arg(expectedCount));
+			//the first cloud is the common ground (or ceil, if GROUND_IS_FIRST is not set)
+			for (size_t i = 1; i < cloudCount; ++i)
+			{
+				Job job;
+				job.groundIndex = static_cast<int>(groundIsFirst ? 0 : i);
+				job.ceilIndex = static_cast<int>(groundIsFirst ? i : 0);
+				jobs.push_back(job);
+			}
 		}
-
-		if (index == 2 && groundIsFirst)
+		else
 		{
-			//put them in the right order (ground then ceil)
-			std::swap(clouds[0], clouds[1]);
-		}
+			int expectedCount = std::isnan(constHeight) ? 2 : 1;
+			int index = std::min(static_cast<int>(cloudCount), expectedCount);
+			if (index != expectedCount)
+			{
+				return cmd.error(QString("Not enough loaded entities (%1 found, %2 expected)").arg(index).arg(expectedCount));
+			}
 
-		ceil = clouds[0];
-		ground = clouds[1];
+			Job job;
+			job.ceilIndex = 0;
+			if (index == 2)
+			{
+				job.groundIndex = 1;
+				if (groundIsFirst)
+				{
+					//put them in the right order (ground then ceil)
+					std::swap(job.groundIndex, job.ceilIndex);
+				}
+			}
+			jobs.push_back(job);
+		}
 	}
 
-	ccBBox gridBBox = ceil ? ceil->pc->getOwnBB() : ccBBox();
-	if (ground)
+	//the grid bounding-box encompasses all the clouds (so that the common grid can be reused)
+	ccBBox gridBBox;
+	for (const Job& job : jobs)
 	{
-		gridBBox += ground->pc->getOwnBB();
+		if (job.ceilIndex >= 0)
+			gridBBox += cmd.clouds()[job.ceilIndex].pc->getOwnBB();
+		if (job.groundIndex >= 0)
+			gridBBox += cmd.clouds()[job.groundIndex].pc->getOwnBB();
 	}
 
 	//compute the grid size
@@ -621,31 +972,45 @@ bool CommandVolume25D::process(ccCommandLineInterface &cmd)
 		}
 	}
 
-	ccRasterGrid grid;
-	ccVolumeCalcTool::ReportInfo reportInfo;
-	if (ccVolumeCalcTool::ComputeVolume(
-	            grid,
-	            ground ? ground->pc : 0,
-	            ceil ? ceil->pc : 0,
-	            gridBBox,
-	            vertDir,
-	            gridStep,
-	            gridWidth,
-	            gridHeight,
-	            ccRasterGrid::PROJ_AVERAGE_VALUE,
-	            ccRasterGrid::LEAVE_EMPTY,
-	            ccRasterGrid::LEAVE_EMPTY,
-	            reportInfo,
-	            constHeight,
-	            constHeight,
-	            cmd.silentMode() ? 0 : cmd.widgetParent()))
+	//progress dialog
+	QScopedPointer<ccProgressDialog> pDlg(nullptr);
+	if (!cmd.silentMode())
+	{
+		pDlg.reset(new ccProgressDialog(true, cmd.widgetParent()));
+	}
+
+	//the engine keeps the common grid from one job to the other
+	ccVolumeCalcEngine engine;
+	engine.setGridParameters(gridBBox, static_cast<unsigned char>(vertDir), gridStep, projectionType);
+
+	for (const Job& job : jobs)
 	{
+		CLCloudDesc* ground = (job.groundIndex >= 0 ? &cmd.clouds()[job.groundIndex] : nullptr);
+		CLCloudDesc* ceil = (job.ceilIndex >= 0 ? &cmd.clouds()[job.ceilIndex] : nullptr);
+
+		engine.setGround(ground ? ground->pc : nullptr, groundEmptyCellFillStrategy, ground ? customHeight : constHeight);
+		engine.setCeil(ceil ? ceil->pc : nullptr, ceilEmptyCellFillStrategy, ceil ? customHeight : constHeight);
+
+		ccRasterGrid grid;
+		ccVolumeCalcTool::ReportInfo reportInfo;
+		if (!engine.compute(grid, reportInfo, pDlg.data()))
+		{
+			return cmd.error("Failed to compte the volume");
+		}
+
+		//in series mode, the report and the output entity are named after the 'moving' cloud
 		CLCloudDesc* desc = ceil ? ceil : ground;
+		if (series)
+		{
+			desc = groundIsFirst ? ceil : ground;
+		}
 		assert(desc);
 
 		//save repot in a separate text file
 		{
 			QString txtFilename = QString("%1/VolumeCalculationReport").arg(desc->path);
+			if (series)
+				txtFilename += QString("_%1").arg(desc->basename);
 			if (cmd.addTimestamp())
 				txtFilename += QString("_%1").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh'h'mm"));
 			txtFilename += QString(".txt");
@@ -724,7 +1089,7 @@ bool CommandVolume25D::process(ccCommandLineInterface &cmd)
 				cloudDesc.pc = rasterCloud;
 				cloudDesc.basename = desc->basename;
 				cloudDesc.path = desc->path;
-				cmd.clouds().push_back(cloudDesc);
+				cmd.clouds().push_back(cloudDesc); //the input clouds are accessed by index (see above)
 				outputDesc = &cmd.clouds().back();
 			}
 
@@ -738,10 +1103,6 @@ bool CommandVolume25D::process(ccCommandLineInterface &cmd)
 			}
 		}
 	}
-	else
-	{
-		return cmd.error("Failed to compte the volume");
-	}
 
 	return true;
 }
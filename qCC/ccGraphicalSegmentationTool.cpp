@@ -20,6 +20,7 @@
 //Local
 #include "mainwindow.h"
 #include "ccItemSelectionDlg.h"
+#include "ccScreenPolygonSelector.h"
 
 //CCLib
 #include <ManualSegmentationTools.h>
@@ -45,6 +46,7 @@
 #include "stocker_parser.h"
 
 //System
+#include <algorithm>
 #include <assert.h>
 
 static CC_TYPES::DB_SOURCE s_dbSource;
@@ -647,8 +649,7 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 	//viewing parameters
 	ccGLCameraParameters camera;
 	m_associatedWin->getGLCameraParameters(camera);
-	const double half_w = camera.viewport[2] / 2.0;
-	const double half_h = camera.viewport[3] / 2.0;
+	ccScreenPolygonSelector selector(camera, m_segmentationPoly);
 
 	//for each selected entity
 	for (QSet<ccHObject*>::const_iterator p = m_toSegment.constBegin(); p != m_toSegment.constEnd(); ++p)
@@ -659,9 +660,16 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 		ccGenericPointCloud::VisibilityTableType& visibilityArray = cloud->getTheVisibilityArray();
 		assert(!visibilityArray.empty());
 
-		unsigned cloudSize = cloud->size();
+		//we project each (visible) point and we check if it falls inside the segmentation polyline
+		//(by octree cells if possible, see ccScreenPolygonSelector)
+		std::vector<unsigned char> insideFlags;
+		if (!selector.select(*cloud, insideFlags, &visibilityArray, POINT_VISIBLE))
+		{
+			ccLog::Error("Not enough memory!");
+			break;
+		}
 
-		//we project each point and we check if it falls inside the segmentation polyline
+		unsigned cloudSize = cloud->size();
 #if defined(_OPENMP)
 #pragma omp parallel for
 #endif
@@ -669,16 +677,7 @@ void ccGraphicalSegmentationTool::segment(bool keepPointsInside)
 		{
 			if (visibilityArray[i] == POINT_VISIBLE)
 			{
-				const CCVector3* P3D = cloud->getPoint(i);
-
-				CCVector3d Q2D;
-				bool pointInFrustrum = camera.project(*P3D, Q2D, true);
-
-				CCVector2 P2D(	static_cast<PointCoordinateType>(Q2D.x-half_w),
-								static_cast<PointCoordinateType>(Q2D.y-half_h) );
-				
-				bool pointInside = pointInFrustrum && CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_segmentationPoly);
-
+				bool pointInside = (insideFlags[i] != 0);
 				visibilityArray[i] = (keepPointsInside != pointInside ? POINT_HIDDEN : POINT_VISIBLE);
 			}
 		}
@@ -1084,8 +1083,7 @@ void ccGraphicalSegmentationTool::createBuilding()
 	//viewing parameters
 	ccGLCameraParameters camera;
 	m_associatedWin->getGLCameraParameters(camera);
-	const double half_w = camera.viewport[2] / 2.0;
-	const double half_h = camera.viewport[3] / 2.0;
+	ccScreenPolygonSelector selector(camera, m_segmentationPoly);
 
 	//for each selected entity
 	for (QSet<ccHObject*>::const_iterator p = m_toSegment.constBegin(); p != m_toSegment.constEnd(); ++p)
@@ -1097,34 +1095,33 @@ void ccGraphicalSegmentationTool::createBuilding()
 
 		unsigned cloudSize = cloud->size();
 
+		//we project each (visible) point and we check if it falls inside the segmentation polyline
+		std::vector<unsigned char> insideFlags;
+		if (!selector.select(*cloud, insideFlags, visibilityArray.size() == cloudSize ? &visibilityArray : nullptr, POINT_VISIBLE))
+		{
+			ccLog::Error("Not enough memory!");
+			break;
+		}
+		unsigned insideCount = static_cast<unsigned>(std::count(insideFlags.begin(), insideFlags.end(), 1));
+
 		//! create a new point cloud
 		int number = GetMaxNumberExcludeChildPrefix(m_destination, BDDB_BUILDING_PREFIX);
 		ccPointCloud* new_building = new ccPointCloud(BuildingNameByNumber(number + 1));
 		new_building->setGlobalScale(cloud->getGlobalScale());
 		new_building->setGlobalShift(cloud->getGlobalShift());
+		if (!new_building->reserve(insideCount))
+		{
+			ccLog::Error("Not enough memory!");
+			delete new_building;
+			break;
+		}
 
-		//we project each point and we check if it falls inside the segmentation polyline
-// #if defined(_OPENMP)
-// #pragma omp parallel for
-// #endif
-		for (int i = 0; i < static_cast<int>(cloudSize); ++i)
+		for (unsigned i = 0; i < cloudSize; ++i)
 		{
-			if (visibilityArray.size() == cloudSize && visibilityArray[i] != POINT_VISIBLE)	{
-				continue;
+			if (insideFlags[i])
+			{
+				new_building->addPoint(*cloud->getPoint(i));
 			}
-			const CCVector3* P3D = cloud->getPoint(i);
-
-			CCVector3d Q2D;
-			bool pointInFrustrum = camera.project(*P3D, Q2D, true);
-
-			CCVector2 P2D(static_cast<PointCoordinateType>(Q2D.x - half_w),
-				static_cast<PointCoordinateType>(Q2D.y - half_h));
-
-			bool pointInside = pointInFrustrum && CCLib::ManualSegmentationTools::isPointInsidePoly(P2D, m_segmentationPoly);
-
-			if (!pointInside) { continue; }
-			
-			new_building->addPoint(*P3D);
 		}
 				
 		new_building->setDisplay(m_destination->getDisplay());
@@ -62,6 +62,7 @@
 
 //System
 #include <cassert>
+#include <functional>
 
 constexpr char HILLSHADE_FIELD_NAME[] = "Hillshade";
 
@@ -769,7 +770,7 @@ bool ccRasterizeTool::updateGrid(bool interpolateSF/*=false*/)
 		unsigned filledCellCount = 0;
 		for (unsigned j = 0; j < m_grid.height; ++j)
 		{
-			const ccRasterGrid::Row& row = m_grid.rows[j];
+			const ccRasterCell* row = m_grid.row(j);
 			for (unsigned i = 0; i < m_grid.width; ++i)
 			{
 				if (std::isfinite(row[i].h))
@@ -1215,7 +1216,7 @@ bool ccRasterizeTool::ExportGeoTiff(const QString& outputFilename,
 
 			for (unsigned j = 0; j<grid.height; ++j)
 			{
-				const ccRasterGrid::Row& row = grid.rows[grid.height - 1 - j]; //the first row is the northest one (i.e. Ymax)
+				const ccRasterCell* row = grid.row(grid.height - 1 - j); //the first row is the northest one (i.e. Ymax)
 				for (unsigned i = 0; i<grid.width; ++i)
 				{
 					cLine[i] = (std::isfinite(row[i].h) ? static_cast<unsigned char>(std::max(0.0, std::min(255.0, row[i].color.u[k]))) : 0);
@@ -1239,7 +1240,7 @@ bool ccRasterizeTool::ExportGeoTiff(const QString& outputFilename,
 
 			for (unsigned j = 0; j<grid.height; ++j)
 			{
-				const ccRasterGrid::Row& row = grid.rows[grid.height - 1 - j];
+				const ccRasterCell* row = grid.row(grid.height - 1 - j);
 				for (unsigned i = 0; i<grid.width; ++i)
 				{
 					cLine[i] = (std::isfinite(row[i].h) ? 255 : 0);
@@ -1306,7 +1307,7 @@ bool ccRasterizeTool::ExportGeoTiff(const QString& outputFilename,
 
 		for (unsigned j = 0; j < grid.height; ++j)
 		{
-			const ccRasterGrid::Row& row = grid.rows[grid.height - 1 - j];
+			const ccRasterCell* row = grid.row(grid.height - 1 - j);
 			for (unsigned i = 0; i<grid.width; ++i)
 			{
 				scanline[i] = std::isfinite(row[i].h) ? row[i].h + shiftZ : emptyCellHeight;
@@ -1331,7 +1332,7 @@ bool ccRasterizeTool::ExportGeoTiff(const QString& outputFilename,
 		poBand->SetColorInterpretation(GCI_Undefined);
 		for (unsigned j = 0; j < grid.height; ++j)
 		{
-			const ccRasterGrid::Row& row = grid.rows[grid.height - 1 - j];
+			const ccRasterCell* row = grid.row(grid.height - 1 - j);
 			for (unsigned i = 0; i < grid.width; ++i)
 			{
 				scanline[i] = row[i].nbPoints;
@@ -1366,7 +1367,7 @@ bool ccRasterizeTool::ExportGeoTiff(const QString& outputFilename,
 
 				for (unsigned j = 0; j < grid.height; ++j)
 				{
-					const ccRasterGrid::Row& row = grid.rows[grid.height - 1 - j];
+					const ccRasterCell* row = grid.row(grid.height - 1 - j);
 					const double* sfRow = sfGrid + (grid.height - 1 - j) * grid.width;
 					for (unsigned i = 0; i < grid.width; ++i)
 					{
@@ -1410,6 +1411,407 @@ bool ccRasterizeTool::ExportGeoTiff(const QString& outputFilename,
 #endif
 }
 
+ccRasterizeTool::TiledGeoTiffWriter::TiledGeoTiffWriter()
+	: m_dataset(nullptr)
+	, m_sfCount(0)
+	, m_gridHeight(0)
+	, m_shiftZ(0.0)
+{
+}
+
+ccRasterizeTool::TiledGeoTiffWriter::~TiledGeoTiffWriter()
+{
+#ifdef CC_GDAL_SUPPORT
+	if (m_dataset)
+	{
+		GDALClose(m_dataset);
+		m_dataset = nullptr;
+	}
+#endif
+}
+
+bool ccRasterizeTool::TiledGeoTiffWriter::open(	const QString& outputFilename,
+												const ExportBands& exportBands,
+												unsigned gridWidth,
+												unsigned gridHeight,
+												unsigned sfCount,
+												const ccBBox& gridBBox,
+												double gridStep,
+												unsigned char Z,
+												ccGenericPointCloud* originCloud/*=nullptr*/)
+{
+#ifdef CC_GDAL_SUPPORT
+
+	if (m_dataset)
+	{
+		//already opened
+		assert(false);
+		return false;
+	}
+
+	//vertical dimension
+	assert(Z <= 2);
+	const unsigned char X = Z == 2 ? 0 : Z + 1;
+	const unsigned char Y = X == 2 ? 0 : X + 1;
+
+	//global shift
+	assert(gridBBox.isValid());
+	double shiftX = gridBBox.minCorner().u[X];
+	double shiftY = gridBBox.maxCorner().u[Y];
+	double shiftZ = 0.0;
+
+	double stepX = gridStep;
+	double stepY = gridStep;
+	if (originCloud)
+	{
+		const CCVector3d& shift = originCloud->getGlobalShift();
+		shiftX -= shift.u[X];
+		shiftY -= shift.u[Y];
+		shiftZ -= shift.u[Z];
+
+		double scale = originCloud->getGlobalScale();
+		assert(scale != 0);
+		stepX /= scale;
+		stepY /= scale;
+	}
+
+	m_bands = exportBands;
+	m_bands.visibleSF = false;
+	m_sfCount = (exportBands.allSFs ? sfCount : 0);
+
+	int totalBands = 0;
+	if (m_bands.rgb)
+	{
+		//we can't know in advance whether some cells will be empty: we always add the alpha band
+		totalBands += 4;
+	}
+	if (m_bands.height)
+	{
+		++totalBands;
+	}
+	if (m_bands.density)
+	{
+		++totalBands;
+	}
+	totalBands += static_cast<int>(m_sfCount);
+
+	if (totalBands == 0)
+	{
+		ccLog::Error("Can't output a raster with no band! (check export parameters)");
+		return false;
+	}
+	bool onlyRGBA = (totalBands == 4 && m_bands.rgb);
+
+	GDALAllRegister();
+
+	const char pszFormat[] = "GTiff";
+	GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName(pszFormat);
+	if (!poDriver)
+	{
+		ccLog::Error("[GDAL] Driver %s is not supported", pszFormat);
+		return false;
+	}
+
+	//the output file is tiled as well (and may exceed 4Gb)
+	char **papszOptions = nullptr;
+	papszOptions = CSLSetNameValue(papszOptions, "TILED", "YES");
+	papszOptions = CSLSetNameValue(papszOptions, "BIGTIFF", "IF_SAFER");
+	m_dataset = poDriver->Create(	qPrintable(outputFilename),
+									static_cast<int>(gridWidth),
+									static_cast<int>(gridHeight),
+									totalBands,
+									onlyRGBA ? GDT_Byte : GDT_Float64,
+									papszOptions);
+	CSLDestroy(papszOptions);
+
+	if (!m_dataset)
+	{
+		ccLog::Error("[GDAL] Failed to create output raster (not enough memory?)");
+		return false;
+	}
+
+	m_dataset->SetMetadataItem("AREA_OR_POINT", "AREA");
+
+	double adfGeoTransform[6] = {	shiftX,		//top left x
+									stepX,		//w-e pixel resolution (can be negative)
+									0,			//0
+									shiftY,		//top left y
+									0,			//0
+									-stepY		//n-s pixel resolution (can be negative)
+	};
+	m_dataset->SetGeoTransform(adfGeoTransform);
+
+	//bands setup
+	int currentBand = 0;
+	if (m_bands.rgb)
+	{
+		m_dataset->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_RedBand);
+		m_dataset->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_GreenBand);
+		m_dataset->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_BlueBand);
+		m_dataset->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_AlphaBand);
+	}
+	if (m_bands.height)
+	{
+		GDALRasterBand* poBand = m_dataset->GetRasterBand(++currentBand);
+		poBand->SetColorInterpretation(GCI_Undefined);
+		poBand->SetNoDataValue(std::numeric_limits<double>::quiet_NaN()); //should be transparent!
+	}
+	if (m_bands.density)
+	{
+		m_dataset->GetRasterBand(++currentBand)->SetColorInterpretation(GCI_Undefined);
+	}
+	for (unsigned k = 0; k < m_sfCount; ++k)
+	{
+		GDALRasterBand* poBand = m_dataset->GetRasterBand(++currentBand);
+		poBand->SetColorInterpretation(GCI_Undefined);
+		poBand->SetNoDataValue(std::numeric_limits<ccRasterGrid::SF::value_type>::quiet_NaN()); //should be transparent!
+	}
+	assert(currentBand == totalBands);
+
+	m_filename = outputFilename;
+	m_gridHeight = gridHeight;
+	m_shiftZ = shiftZ;
+
+	return true;
+
+#else
+	assert(false);
+	ccLog::Error("[Rasterize] GDAL not supported by this version! Can't generate a raster...");
+	return false;
+#endif
+}
+
+bool ccRasterizeTool::TiledGeoTiffWriter::writeTile(const ccRasterGrid& tile, unsigned x0, unsigned y0)
+{
+#ifdef CC_GDAL_SUPPORT
+
+	if (!m_dataset || tile.width == 0 || tile.height == 0 || y0 + tile.height > m_gridHeight)
+	{
+		assert(false);
+		return false;
+	}
+
+	//the first row is the northest one (i.e. Ymax)
+	const int xOff = static_cast<int>(x0);
+	const int yOff = static_cast<int>(m_gridHeight - y0 - tile.height);
+	const int w = static_cast<int>(tile.width);
+	const int h = static_cast<int>(tile.height);
+
+	const size_t cellCount = static_cast<size_t>(tile.width) * tile.height;
+	std::vector<double> buffer;
+	std::vector<unsigned char> cBuffer;
+	try
+	{
+		buffer.resize(cellCount);
+		if (m_bands.rgb)
+		{
+			cBuffer.resize(cellCount);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		ccLog::Error("[GDAL] Not enough memory");
+		return false;
+	}
+
+	//fills the buffer (north-up) with a given per-cell value
+	auto fillBuffer = [&](std::function<double(const ccRasterCell&, size_t)> valueOf)
+	{
+		double* _buffer = buffer.data();
+		for (unsigned j = 0; j < tile.height; ++j)
+		{
+			const unsigned srcJ = tile.height - 1 - j;
+			const ccRasterCell* row = tile.row(srcJ);
+			size_t pos = static_cast<size_t>(srcJ) * tile.width;
+			for (unsigned i = 0; i < tile.width; ++i, ++pos)
+			{
+				*_buffer++ = valueOf(row[i], pos);
+			}
+		}
+	};
+
+	int currentBand = 0;
+
+	//RGB(A) bands
+	if (m_bands.rgb)
+	{
+		for (unsigned k = 0; k < 4; ++k)
+		{
+			unsigned char* _cBuffer = cBuffer.data();
+			for (unsigned j = 0; j < tile.height; ++j)
+			{
+				const ccRasterCell* row = tile.row(tile.height - 1 - j);
+				for (unsigned i = 0; i < tile.width; ++i)
+				{
+					if (k < 3)
+						*_cBuffer++ = (std::isfinite(row[i].h) ? static_cast<unsigned char>(std::max(0.0, std::min(255.0, row[i].color.u[k]))) : 0);
+					else
+						*_cBuffer++ = (std::isfinite(row[i].h) ? 255 : 0);
+				}
+			}
+
+			GDALRasterBand* poBand = m_dataset->GetRasterBand(++currentBand);
+			if (poBand->RasterIO(GF_Write, xOff, yOff, w, h, cBuffer.data(), w, h, GDT_Byte, 0, 0) != CE_None)
+			{
+				ccLog::Error("[GDAL] An error occurred while writing the color bands!");
+				return false;
+			}
+		}
+	}
+
+	//height band
+	if (m_bands.height)
+	{
+		const double shiftZ = m_shiftZ;
+		fillBuffer([shiftZ](const ccRasterCell& aCell, size_t) { return aCell.h + shiftZ; }); //NaN remains NaN
+		if (m_dataset->GetRasterBand(++currentBand)->RasterIO(GF_Write, xOff, yOff, w, h, buffer.data(), w, h, GDT_Float64, 0, 0) != CE_None)
+		{
+			ccLog::Error("[GDAL] An error occurred while writing the height band!");
+			return false;
+		}
+	}
+
+	//density band
+	if (m_bands.density)
+	{
+		fillBuffer([](const ccRasterCell& aCell, size_t) { return static_cast<double>(aCell.nbPoints); });
+		if (m_dataset->GetRasterBand(++currentBand)->RasterIO(GF_Write, xOff, yOff, w, h, buffer.data(), w, h, GDT_Float64, 0, 0) != CE_None)
+		{
+			ccLog::Error("[GDAL] An error occurred while writing the density band!");
+			return false;
+		}
+	}
+
+	//SF bands
+	for (unsigned k = 0; k < m_sfCount; ++k)
+	{
+		const double sfNanValue = std::numeric_limits<ccRasterGrid::SF::value_type>::quiet_NaN();
+		if (k < tile.scalarFields.size() && !tile.scalarFields[k].empty())
+		{
+			const double* sfGrid = tile.scalarFields[k].data();
+			fillBuffer([sfGrid, sfNanValue](const ccRasterCell& aCell, size_t pos) { return aCell.nbPoints ? sfGrid[pos] : sfNanValue; });
+		}
+		else
+		{
+			std::fill(buffer.begin(), buffer.end(), sfNanValue);
+		}
+
+		if (m_dataset->GetRasterBand(++currentBand)->RasterIO(GF_Write, xOff, yOff, w, h, buffer.data(), w, h, GDT_Float64, 0, 0) != CE_None)
+		{
+			ccLog::Error("[GDAL] An error occurred while writing a scalar field band!");
+			return false;
+		}
+	}
+
+	return true;
+
+#else
+	assert(false);
+	return false;
+#endif
+}
+
+bool ccRasterizeTool::TiledGeoTiffWriter::close(ccRasterGrid::EmptyCellFillOption fillEmptyCellsStrategy,
+												const ccRasterGrid::TiledGridStats& stats,
+												double customHeightForEmptyCells/*=std::numeric_limits<double>::quiet_NaN()*/)
+{
+#ifdef CC_GDAL_SUPPORT
+
+	if (!m_dataset)
+	{
+		return false;
+	}
+
+	bool success = true;
+
+	//the height band may have to be filled now that the global statistics are known
+	if (m_bands.height)
+	{
+		double emptyCellHeight = std::numeric_limits<double>::quiet_NaN();
+		switch (fillEmptyCellsStrategy)
+		{
+		case ccRasterGrid::LEAVE_EMPTY:
+			//the NaN 'no data' value is kept
+			break;
+		case ccRasterGrid::FILL_MINIMUM_HEIGHT:
+			emptyCellHeight = stats.minHeight;
+			break;
+		case ccRasterGrid::FILL_MAXIMUM_HEIGHT:
+			emptyCellHeight = stats.maxHeight;
+			break;
+		case ccRasterGrid::FILL_CUSTOM_HEIGHT:
+		case ccRasterGrid::INTERPOLATE:
+			emptyCellHeight = customHeightForEmptyCells;
+			break;
+		case ccRasterGrid::FILL_AVERAGE_HEIGHT:
+			emptyCellHeight = stats.meanHeight;
+			break;
+		default:
+			assert(false);
+		}
+
+		if (std::isfinite(emptyCellHeight))
+		{
+			emptyCellHeight += m_shiftZ;
+
+			GDALRasterBand* poBand = m_dataset->GetRasterBand(m_bands.rgb ? 5 : 1);
+			const int width = poBand->GetXSize();
+			std::vector<double> scanline;
+			try
+			{
+				scanline.resize(width);
+			}
+			catch (const std::bad_alloc&)
+			{
+				ccLog::Error("[GDAL] Not enough memory");
+				success = false;
+			}
+
+			//we process the file row by row (so as to keep the memory consumption low)
+			for (int j = 0; success && j < static_cast<int>(m_gridHeight); ++j)
+			{
+				if (poBand->RasterIO(GF_Read, 0, j, width, 1, scanline.data(), width, 1, GDT_Float64, 0, 0) != CE_None)
+				{
+					success = false;
+					break;
+				}
+				for (double& h : scanline)
+				{
+					if (!std::isfinite(h))
+					{
+						h = emptyCellHeight;
+					}
+				}
+				if (poBand->RasterIO(GF_Write, 0, j, width, 1, scanline.data(), width, 1, GDT_Float64, 0, 0) != CE_None)
+				{
+					success = false;
+					break;
+				}
+			}
+
+			if (!success)
+			{
+				ccLog::Error("[GDAL] An error occurred while filling the empty cells of the height band!");
+			}
+		}
+	}
+
+	/* Once we're done, close properly the dataset */
+	GDALClose(m_dataset);
+	m_dataset = nullptr;
+
+	if (success)
+	{
+		ccLog::Print(QString("[Rasterize] Raster '%1' successfully saved").arg(m_filename));
+	}
+	return success;
+
+#else
+	assert(false);
+	return false;
+#endif
+}
+
 //See http://edndoc.esri.com/arcobjects/9.2/net/shared/geoprocessing/spatial_analyst_tools/how_hillshade_works.htm
 void ccRasterizeTool::generateHillshade()
 {
@@ -1466,7 +1868,7 @@ void ccRasterizeTool::generateHillshade()
 	unsigned validCellIndex = 0;
 	for (unsigned j = (sparseSF ? 0 : 1); j < m_grid.height - 1; ++j)
 	{
-		const ccRasterGrid::Row& row = m_grid.rows[j];
+		const ccRasterCell* row = m_grid.row(j);
 		
 		for (unsigned i=sparseSF ? 0 : 1; i<m_grid.width; ++i)
 		{
@@ -1484,7 +1886,7 @@ void ccRasterizeTool::generateHillshade()
 					{
 						for (int dj=-1; dj<=1; ++dj)
 						{
-							const ccRasterCell& n = m_grid.rows[j - dj][i + di]; //-dj (instead of + dj) because we scan the grid in the reverse orientation! (from bottom to top)
+							const ccRasterCell& n = m_grid.cell(i + di, j - dj); //-dj (instead of + dj) because we scan the grid in the reverse orientation! (from bottom to top)
 							if (n.h == n.h)
 							{
 								if (di != 0)
@@ -1597,7 +1999,7 @@ static CPLErr ContourWriter(	double dfLevel,
 		{
 			int xi = std::min(std::max(static_cast<int>(padfX[i]), 0), static_cast<int>(params->grid->width) - 1);
 			int yi = std::min(std::max(static_cast<int>(padfY[i]), 0), static_cast<int>(params->grid->height) - 1);
-			double h = params->grid->rows[yi][xi].h;
+			double h = params->grid->cell(xi, yi).h;
 			if (std::isfinite(h))
 			{
 				P.z = static_cast<PointCoordinateType>(h);
@@ -1775,7 +2177,7 @@ void ccRasterizeTool::generateContours()
 
 		for (unsigned j = 0; j < m_grid.height; ++j)
 		{
-			const ccRasterGrid::Row& cellRow = m_grid.rows[j];
+			const ccRasterCell* cellRow = m_grid.row(j);
 			for (unsigned i = 0; i < m_grid.width; ++i)
 			{
 				if (cellRow[i].nbPoints || !sparseLayer)
@@ -1886,7 +2288,7 @@ void ccRasterizeTool::generateContours()
 		unsigned layerIndex = 0;
 		for (unsigned j = 0; j < m_grid.height; ++j)
 		{
-			const ccRasterGrid::Row& cellRow = m_grid.rows[j];
+			const ccRasterCell* cellRow = m_grid.row(j);
 			double* row = &(grid[(j + margin)*xDim + margin]);
 			for (unsigned i = 0; i < m_grid.width; ++i)
 			{
@@ -1971,7 +2373,7 @@ void ccRasterizeTool::generateContours()
 								{
 									int xi = std::min(std::max(static_cast<int>(x), 0), static_cast<int>(m_grid.width) - 1);
 									int yi = std::min(std::max(static_cast<int>(y), 0), static_cast<int>(m_grid.height) - 1);
-									double h = m_grid.rows[yi][xi].h;
+									double h = m_grid.cell(xi, yi).h;
 									if (std::isfinite(h))
 									{
 										/*P.u[Z] = */P.z = static_cast<PointCoordinateType>(h);
@@ -2242,7 +2644,7 @@ void ccRasterizeTool::generateImage() const
 		// Filling the image with grid values
 		for (unsigned j = 0; j < m_grid.height; ++j)
 		{
-			const ccRasterGrid::Row& row = m_grid.rows[j];
+			const ccRasterCell* row = m_grid.row(j);
 			for (unsigned i = 0; i < m_grid.width; ++i)
 			{
 				if (std::isfinite(row[i].h))
@@ -2322,7 +2724,7 @@ void ccRasterizeTool::generateASCIIMatrix() const
 	getFillEmptyCellsStrategyExt(emptyCellsHeight, minHeight, maxHeight);
 	for (unsigned j = 0; j < m_grid.height; ++j)
 	{
-		const ccRasterGrid::Row& row = m_grid.rows[m_grid.height - 1 - j];
+		const ccRasterCell* row = m_grid.row(m_grid.height - 1 - j);
 		for (unsigned i = 0; i < m_grid.width; ++i)
 		{
 			fprintf(pFile, "%.8f ", std::isfinite(row[i].h) ? row[i].h : emptyCellsHeight);
@@ -28,6 +28,7 @@
 class ccGenericPointCloud;
 class ccPointCloud;
 class ccPolyline;
+class GDALDataset;
 
 namespace Ui
 {
@@ -69,6 +70,83 @@ public: //raster export
 								ccGenericPointCloud* originCloud = nullptr,
 								int visibleSfIndex = -1);
 
+	//! Streaming geotiff writer (for grids generated by tiles, see ccRasterGrid::GenerateByTiles)
+	/** The raster file is created once with its final size, then each tile is
+		written in its own window as soon as it is generated (so that the whole
+		grid never has to be held in memory). Empty cells are written as NaN
+		values and are only filled (if necessary) when the file is closed, as the
+		global statistics are not known before.
+	**/
+	class TiledGeoTiffWriter
+	{
+	public:
+
+		//! Default constructor
+		TiledGeoTiffWriter();
+
+		//! Destructor (closes the file if necessary)
+		~TiledGeoTiffWriter();
+
+		//! Creates the output file
+		/** \warning The 'visibleSF' band is not supported.
+			\param outputFilename output filename
+			\param exportBands bands to be exported
+			\param gridWidth global grid width
+			\param gridHeight global grid height
+			\param sfCount number of scalar fields (grids)
+			\param gridBBox global grid bounding-box
+			\param gridStep grid step
+			\param Z vertical dimension
+			\param originCloud origin cloud (to retrieve the global shift and scale)
+			\return success
+		**/
+		bool open(	const QString& outputFilename,
+					const ExportBands& exportBands,
+					unsigned gridWidth,
+					unsigned gridHeight,
+					unsigned sfCount,
+					const ccBBox& gridBBox,
+					double gridStep,
+					unsigned char Z,
+					ccGenericPointCloud* originCloud = nullptr);
+
+		//! Writes a tile
+		/** \param tile tile grid
+			\param x0 position of the tile (first column) in the global grid
+			\param y0 position of the tile (first row) in the global grid
+			\return success
+		**/
+		bool writeTile(const ccRasterGrid& tile, unsigned x0, unsigned y0);
+
+		//! Fills the empty cells (if necessary) and closes the file
+		/** \param fillEmptyCellsStrategy empty cells filling strategy
+			\param stats global statistics of the grid
+			\param customHeightForEmptyCells custom height (for the 'FILL_CUSTOM_HEIGHT' and 'INTERPOLATE' strategies)
+			\return success
+		**/
+		bool close(	ccRasterGrid::EmptyCellFillOption fillEmptyCellsStrategy,
+					const ccRasterGrid::TiledGridStats& stats,
+					double customHeightForEmptyCells = std::numeric_limits<double>::quiet_NaN());
+
+		//! Returns whether the file is opened or not
+		inline bool isOpen() const { return m_dataset != nullptr; }
+
+	protected:
+
+		//! GDAL dataset
+		GDALDataset* m_dataset;
+		//! Output filename
+		QString m_filename;
+		//! Exported bands
+		ExportBands m_bands;
+		//! Number of exported scalar fields
+		unsigned m_sfCount;
+		//! Global grid height
+		unsigned m_gridHeight;
+		//! Vertical shift
+		double m_shiftZ;
+	};
+
 private:
 
 	//! Exports the grid as a cloud
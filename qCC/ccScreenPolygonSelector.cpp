@@ -0,0 +1,403 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccScreenPolygonSelector.h"
+
+//CCLib
+#include <ManualSegmentationTools.h>
+
+//qCC_db
+#include <ccLog.h>
+#include <ccOctree.h>
+#include <ccPolyline.h>
+
+//system
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//! Octree level at which the cells are dispatched between the threads (indicative number of cells)
+static const unsigned c_startCellCount = 4096;
+//! Below this population, the points of a straddling cell are tested individually
+static const unsigned c_minCellPopulation = 64;
+//! Tolerance on the projected cells (in pixels)
+/** Covers the rounding of the projected points (float) and of the point-in-polygon test
+**/
+static const double c_screenTolerance = 0.1;
+//! Relative tolerance on the clip coordinates
+static const double c_relativeClipTolerance = 1.0e-12;
+
+ccScreenPolygonSelector::ccScreenPolygonSelector(const ccGLCameraParameters& camera, const ccPolyline* polygon)
+	: m_camera(camera)
+	, m_halfW(camera.viewport[2] / 2.0)
+	, m_halfH(camera.viewport[3] / 2.0)
+	, m_prepared(false)
+	, m_clipTolerance(0.0)
+{
+	if (polygon)
+	{
+		unsigned vertCount = polygon->size();
+		m_polygon.reserve(vertCount);
+		for (unsigned i = 0; i < vertCount; ++i)
+		{
+			const CCVector3* P = polygon->getPoint(i);
+			m_polygon.emplace_back(P->x, P->y);
+		}
+	}
+
+	init();
+}
+
+ccScreenPolygonSelector::ccScreenPolygonSelector(const ccGLCameraParameters& camera, const std::vector<CCVector2>& polygon)
+	: m_camera(camera)
+	, m_halfW(camera.viewport[2] / 2.0)
+	, m_halfH(camera.viewport[3] / 2.0)
+	, m_polygon(polygon)
+	, m_prepared(false)
+	, m_clipTolerance(0.0)
+{
+	init();
+}
+
+void ccScreenPolygonSelector::init()
+{
+	//the polygon edges are indexed once
+	m_prepared = m_preparedPolygon.init(m_polygon);
+	if (!m_prepared)
+	{
+		ccLog::Warning("[ccScreenPolygonSelector] Not enough memory to prepare the polygon (slower per-edge tests)");
+	}
+
+	//bound on the magnitude of the terms involved in the clip coordinates (for a unit input)
+	double mvNorm = 0.0;
+	double projNorm = 0.0;
+	const double* mv = m_camera.modelViewMat.data();
+	const double* proj = m_camera.projectionMat.data();
+	for (int r = 0; r < 4; ++r)
+	{
+		double mvRow = 0.0;
+		double projRow = 0.0;
+		for (int c = 0; c < 4; ++c)
+		{
+			mvRow += std::abs(mv[c * 4 + r]);
+			projRow += std::abs(proj[c * 4 + r]);
+		}
+		mvNorm = std::max(mvNorm, mvRow);
+		projNorm = std::max(projNorm, projRow);
+	}
+	m_clipTolerance = c_relativeClipTolerance * mvNorm * projNorm;
+}
+
+bool ccScreenPolygonSelector::isInsidePolygon(const CCVector2& P) const
+{
+	return m_prepared ? m_preparedPolygon.isInside(P) : CCLib::ManualSegmentationTools::isPointInsidePoly(P, m_polygon);
+}
+
+bool ccScreenPolygonSelector::isInside(const CCVector3& P) const
+{
+	//same test as the original per-point segmentation
+	CCVector3d Q2D;
+	bool pointInFrustrum = m_camera.project(P, Q2D, true);
+
+	CCVector2 P2D(	static_cast<PointCoordinateType>(Q2D.x - m_halfW),
+					static_cast<PointCoordinateType>(Q2D.y - m_halfH) );
+
+	return pointInFrustrum && isInsidePolygon(P2D);
+}
+
+//! Liang-Barsky segment/box intersection test
+static bool SegmentIntersectsBox(	double x0, double y0, double x1, double y1,
+									double xMin, double yMin, double xMax, double yMax)
+{
+	double t0 = 0.0;
+	double t1 = 1.0;
+	const double dx = x1 - x0;
+	const double dy = y1 - y0;
+	const double p[4] = { -dx, dx, -dy, dy };
+	const double q[4] = { x0 - xMin, xMax - x0, y0 - yMin, yMax - y0 };
+
+	for (int k = 0; k < 4; ++k)
+	{
+		if (p[k] == 0.0)
+		{
+			//parallel to this side of the box
+			if (q[k] < 0.0)
+				return false;
+		}
+		else
+		{
+			double r = q[k] / p[k];
+			if (p[k] < 0.0)
+			{
+				if (r > t1)
+					return false;
+				t0 = std::max(t0, r);
+			}
+			else
+			{
+				if (r < t0)
+					return false;
+				t1 = std::min(t1, r);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool ccScreenPolygonSelector::edgesIntersect(double xMin, double yMin, double xMax, double yMax) const
+{
+	size_t vertCount = m_polygon.size();
+	for (size_t i = 0; i < vertCount; ++i)
+	{
+		const CCVector2& A = m_polygon[i];
+		const CCVector2& B = m_polygon[(i + 1) % vertCount];
+		if (SegmentIntersectsBox(A.x, A.y, B.x, B.y, xMin, yMin, xMax, yMax))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+ccScreenPolygonSelector::CellClass ccScreenPolygonSelector::classify(const CCVector3& bbMin, const CCVector3& bbMax) const
+{
+	const double* mv = m_camera.modelViewMat.data();
+	const double* proj = m_camera.projectionMat.data();
+
+	//signed distances to the 6 frustum planes (in clip coordinates): w-x, w+x, w-y, w+y, w-z, w+z
+	double fMin[6], fMax[6];
+	std::fill(fMin, fMin + 6, std::numeric_limits<double>::max());
+	std::fill(fMax, fMax + 6, -std::numeric_limits<double>::max());
+	double clipX[8], clipY[8], clipW[8];
+
+	for (int c = 0; c < 8; ++c)
+	{
+		const double X = (c & 1) ? bbMax.x : bbMin.x;
+		const double Y = (c & 2) ? bbMax.y : bbMin.y;
+		const double Z = (c & 4) ? bbMax.z : bbMin.z;
+
+		double Pm[4];
+		for (int r = 0; r < 4; ++r)
+		{
+			Pm[r] = mv[r] * X + mv[4 + r] * Y + mv[8 + r] * Z + mv[12 + r];
+		}
+		double Pp[4];
+		for (int r = 0; r < 4; ++r)
+		{
+			Pp[r] = proj[r] * Pm[0] + proj[4 + r] * Pm[1] + proj[8 + r] * Pm[2] + proj[12 + r] * Pm[3];
+		}
+
+		const double f[6] = { Pp[3] - Pp[0], Pp[3] + Pp[0], Pp[3] - Pp[1], Pp[3] + Pp[1], Pp[3] - Pp[2], Pp[3] + Pp[2] };
+		for (int k = 0; k < 6; ++k)
+		{
+			fMin[k] = std::min(fMin[k], f[k]);
+			fMax[k] = std::max(fMax[k], f[k]);
+		}
+		clipX[c] = Pp[0];
+		clipY[c] = Pp[1];
+		clipW[c] = Pp[3];
+	}
+
+	//the clip coordinates are affine functions of the position: the values
+	//inside the cell are between the values at its corners
+	double maxAbsCoord = 1.0;
+	for (unsigned char d = 0; d < 3; ++d)
+	{
+		maxAbsCoord = std::max(maxAbsCoord, std::max(std::abs(static_cast<double>(bbMin.u[d])), std::abs(static_cast<double>(bbMax.u[d]))));
+	}
+	const double clipTolerance = m_clipTolerance * maxAbsCoord;
+
+	for (int k = 0; k < 6; ++k)
+	{
+		if (fMax[k] < -clipTolerance)
+		{
+			//the whole cell is outside of the frustum
+			return CELL_OUTSIDE;
+		}
+	}
+	for (int k = 0; k < 6; ++k)
+	{
+		if (fMin[k] <= clipTolerance)
+		{
+			//the cell crosses (or touches) the frustum
+			return CELL_STRADDLING;
+		}
+	}
+
+	//the whole cell is in the frustum (w > 0): its projection is the convex hull of its projected corners
+	double xMin = std::numeric_limits<double>::max();
+	double yMin = std::numeric_limits<double>::max();
+	double xMax = -std::numeric_limits<double>::max();
+	double yMax = -std::numeric_limits<double>::max();
+	for (int c = 0; c < 8; ++c)
+	{
+		double x = (1.0 + clipX[c] / clipW[c]) / 2 * m_camera.viewport[2] + m_camera.viewport[0] - m_halfW;
+		double y = (1.0 + clipY[c] / clipW[c]) / 2 * m_camera.viewport[3] + m_camera.viewport[1] - m_halfH;
+		xMin = std::min(xMin, x);
+		xMax = std::max(xMax, x);
+		yMin = std::min(yMin, y);
+		yMax = std::max(yMax, y);
+	}
+	xMin -= c_screenTolerance;
+	yMin -= c_screenTolerance;
+	xMax += c_screenTolerance;
+	yMax += c_screenTolerance;
+
+	if (edgesIntersect(xMin, yMin, xMax, yMax))
+	{
+		return CELL_STRADDLING;
+	}
+
+	//no edge crosses the cell projection: all its points are on the same side
+	CCVector2 center(	static_cast<PointCoordinateType>((xMin + xMax) / 2),
+						static_cast<PointCoordinateType>((yMin + yMax) / 2) );
+	return isInsidePolygon(center) ? CELL_INSIDE : CELL_OUTSIDE;
+}
+
+//! Recursively classifies an octree cell (see ccScreenPolygonSelector::select)
+static void ProcessCell(const ccScreenPolygonSelector& selector,
+						const CCLib::DgmOctree& octree,
+						const ccGenericPointCloud& cloud,
+						unsigned begin,
+						unsigned end,
+						unsigned char level,
+						std::vector<unsigned char>& insideFlags,
+						const ccGenericPointCloud::VisibilityTableType* mask,
+						unsigned char maskValue)
+{
+	const CCLib::DgmOctree::cellsContainer& codes = octree.pointsAndTheirCellCodes();
+
+	CCVector3 cellMin, cellMax;
+	octree.computeCellLimits(codes[begin].theCode, level, cellMin, cellMax);
+	{
+		//the points close to the cell borders may be slightly outside (rounding of the cell codes)
+		PointCoordinateType maxAbsCoord = std::max(cellMin.norm(), cellMax.norm());
+		PointCoordinateType margin = (cellMax.x - cellMin.x) * static_cast<PointCoordinateType>(1.0e-4) + maxAbsCoord * static_cast<PointCoordinateType>(1.0e-6);
+		cellMin -= CCVector3(margin, margin, margin);
+		cellMax += CCVector3(margin, margin, margin);
+	}
+
+	ccScreenPolygonSelector::CellClass cellClass = selector.classify(cellMin, cellMax);
+	if (cellClass != ccScreenPolygonSelector::CELL_STRADDLING)
+	{
+		unsigned char flag = (cellClass == ccScreenPolygonSelector::CELL_INSIDE ? 1 : 0);
+		for (unsigned k = begin; k < end; ++k)
+		{
+			unsigned pointIndex = codes[k].theIndex;
+			if (!mask || (*mask)[pointIndex] == maskValue)
+			{
+				insideFlags[pointIndex] = flag;
+			}
+		}
+		return;
+	}
+
+	if (end - begin <= c_minCellPopulation || level >= CCLib::DgmOctree::MAX_OCTREE_LEVEL)
+	{
+		for (unsigned k = begin; k < end; ++k)
+		{
+			unsigned pointIndex = codes[k].theIndex;
+			if (!mask || (*mask)[pointIndex] == maskValue)
+			{
+				insideFlags[pointIndex] = selector.isInside(*cloud.getPoint(pointIndex)) ? 1 : 0;
+			}
+		}
+		return;
+	}
+
+	//process the children (the points of a cell are contiguous, sorted by cell code)
+	unsigned char childLevel = level + 1;
+	unsigned char bitShift = CCLib::DgmOctree::GET_BIT_SHIFT(childLevel);
+	unsigned childBegin = begin;
+	while (childBegin < end)
+	{
+		CCLib::DgmOctree::CellCode childCode = (codes[childBegin].theCode >> bitShift);
+		auto childEndIt = std::upper_bound(	codes.begin() + childBegin,
+											codes.begin() + end,
+											childCode,
+											[bitShift](CCLib::DgmOctree::CellCode code, const CCLib::DgmOctree::IndexAndCode& ic)
+											{
+												return code < (ic.theCode >> bitShift);
+											});
+		unsigned childEnd = static_cast<unsigned>(childEndIt - codes.begin());
+
+		ProcessCell(selector, octree, cloud, childBegin, childEnd, childLevel, insideFlags, mask, maskValue);
+
+		childBegin = childEnd;
+	}
+}
+
+bool ccScreenPolygonSelector::select(	const ccGenericPointCloud& cloud,
+										std::vector<unsigned char>& insideFlags,
+										const ccGenericPointCloud::VisibilityTableType* mask/*=nullptr*/,
+										unsigned char maskValue/*=POINT_VISIBLE*/,
+										bool useOctree/*=true*/) const
+{
+	unsigned cloudSize = cloud.size();
+	if (mask && mask->size() != cloudSize)
+	{
+		mask = nullptr;
+	}
+
+	try
+	{
+		insideFlags.assign(cloudSize, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		//not enough memory
+		return false;
+	}
+
+	//hierarchical mode
+	ccOctree::Shared octree = useOctree ? cloud.getOctree() : ccOctree::Shared(nullptr);
+	if (octree && octree->getNumberOfProjectedPoints() == cloudSize)
+	{
+		unsigned char startLevel = octree->findBestLevelForAGivenCellNumber(c_startCellCount);
+		CCLib::DgmOctree::cellIndexesContainer cellStarts;
+		if (octree->getCellIndexes(startLevel, cellStarts))
+		{
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int c = 0; c < static_cast<int>(cellStarts.size()); ++c)
+			{
+				unsigned begin = cellStarts[c];
+				unsigned end = (c + 1 < static_cast<int>(cellStarts.size()) ? cellStarts[c + 1] : cloudSize);
+				ProcessCell(*this, *octree, cloud, begin, end, startLevel, insideFlags, mask, maskValue);
+			}
+			return true;
+		}
+		//otherwise we fall back to the per-point test
+	}
+
+	//we project each point and we check if it falls inside the polygon
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+	for (int i = 0; i < static_cast<int>(cloudSize); ++i)
+	{
+		if (!mask || (*mask)[i] == maskValue)
+		{
+			insideFlags[i] = isInside(*cloud.getPoint(i)) ? 1 : 0;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,111 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_SCREEN_POLYGON_SELECTOR_HEADER
+#define CC_SCREEN_POLYGON_SELECTOR_HEADER
+
+//CCLib
+#include <PreparedPolygon.h>
+
+//qCC_db
+#include <ccGenericGLDisplay.h>
+#include <ccGenericPointCloud.h>
+
+//system
+#include <vector>
+
+class ccPolyline;
+
+//! Selects the points that project inside a 2D (screen) polygon
+/** The result is exactly the same as projecting each point (see ccGLCameraParameters::project,
+	with the frustum check) and testing it with ManualSegmentationTools::isPointInsidePoly
+	(see CCLib::PreparedPolygon).
+
+	If the cloud has an octree, the octree cells are classified as a whole: a cell
+	is projected (its 8 corners) and if it's completely out of the frustum, or if
+	its projection is far enough from the polygon edges, all its points share the
+	same result. Only the points of the cells straddling the polygon edges (or the
+	frustum planes) are tested individually. The cells are processed in parallel.
+**/
+class ccScreenPolygonSelector
+{
+public:
+
+	//! Default constructor
+	/** \param camera viewing parameters
+		\param polygon 2D polygon (in pixels, relatively to the viewport center)
+	**/
+	ccScreenPolygonSelector(const ccGLCameraParameters& camera, const ccPolyline* polygon);
+
+	//! Constructor from the polygon vertices
+	/** \param camera viewing parameters
+		\param polygon 2D polygon vertices (in pixels, relatively to the viewport center)
+	**/
+	ccScreenPolygonSelector(const ccGLCameraParameters& camera, const std::vector<CCVector2>& polygon);
+
+	//! Returns whether a point projects inside the polygon (per-point test)
+	bool isInside(const CCVector3& P) const;
+
+	//! Flags the points of a cloud that project inside the polygon
+	/** \param cloud point cloud
+		\param insideFlags output flags (one per point: 1 = inside, 0 = outside)
+		\param mask [optional] only the points with a non-zero value (e.g. POINT_VISIBLE) are tested (the others get 0)
+		\param maskValue mask value of the points to test
+		\param useOctree whether to use the cloud octree (if any)
+		\return false if not enough memory
+	**/
+	bool select(const ccGenericPointCloud& cloud,
+				std::vector<unsigned char>& insideFlags,
+				const ccGenericPointCloud::VisibilityTableType* mask = nullptr,
+				unsigned char maskValue = POINT_VISIBLE,
+				bool useOctree = true) const;
+
+	//! Cell classification
+	enum CellClass { CELL_OUTSIDE, CELL_INSIDE, CELL_STRADDLING };
+
+	//! Classifies an axis-aligned box (typically an octree cell)
+	CellClass classify(const CCVector3& bbMin, const CCVector3& bbMax) const;
+
+protected:
+
+	//! Returns whether the polygon edges intersect a 2D box
+	bool edgesIntersect(double xMin, double yMin, double xMax, double yMax) const;
+
+	//! Initializes the structures (once the polygon is set)
+	void init();
+
+	//! Tests if a 2D point is inside the polygon
+	bool isInsidePolygon(const CCVector2& P) const;
+
+	//! Viewing parameters
+	ccGLCameraParameters m_camera;
+	//! Viewport half width
+	double m_halfW;
+	//! Viewport half height
+	double m_halfH;
+
+	//! Polygon vertices
+	std::vector<CCVector2> m_polygon;
+	//! Polygon prepared for the point-in-polygon tests
+	CCLib::PreparedPolygon m_preparedPolygon;
+	//! Whether the polygon could be prepared (otherwise the edges are tested one by one)
+	bool m_prepared;
+	//! Numerical tolerance in clip coordinates (relative to the coordinates magnitude)
+	double m_clipTolerance;
+};
+
+#endif //CC_SCREEN_POLYGON_SELECTOR_HEADER
@@ -0,0 +1,430 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#include "ccVolumeCalcEngine.h"
+
+//qCC_db
+#include <ccGenericPointCloud.h>
+#include <ccLog.h>
+#include <ccProgressDialog.h>
+
+//Qt
+#include <QCoreApplication>
+#include <QLocale>
+#include <QStringList>
+
+//System
+#include <atomic>
+#include <cassert>
+
+static bool SameCorner(const CCVector3& A, const CCVector3& B)
+{
+	return A.x == B.x && A.y == B.y && A.z == B.z;
+}
+
+QString ccVolumeCalcEngine::ReportInfo::toText(int precision) const
+{
+	QLocale locale(QLocale::English);
+
+	QStringList reportText;
+	reportText << QString("Volume: %1").arg(locale.toString(volume, 'f', precision));
+	reportText << QString("Surface: %1").arg(locale.toString(surface, 'f', precision));
+	reportText << QString("----------------------");
+	reportText << QString("Added volume: (+)%1").arg(locale.toString(addedVolume, 'f', precision));
+	reportText << QString("Removed volume: (-)%1").arg(locale.toString(removedVolume, 'f', precision));
+	reportText << QString("----------------------");
+	reportText << QString("Matching cells: %1%").arg(matchingPrecent, 0, 'f', 1);
+	reportText << QString("Non-matching cells:");
+	reportText << QString("    ground = %1%").arg(groundNonMatchingPercent, 0, 'f', 1);
+	reportText << QString("    ceil = %1%").arg(ceilNonMatchingPercent, 0, 'f', 1);
+	reportText << QString("Average neighbors per cell: %1 / 8.0").arg(averageNeighborsPerCell, 0, 'f', 1);
+
+	return reportText.join("\n");
+}
+
+ccVolumeCalcEngine::ccVolumeCalcEngine()
+	: m_groundIndex(0)
+	, m_vertDim(2)
+	, m_gridStep(0)
+	, m_projectionType(ccRasterGrid::PROJ_AVERAGE_VALUE)
+{
+}
+
+void ccVolumeCalcEngine::setGridParameters(	const ccBBox& gridBox,
+											unsigned char vertDim,
+											double gridStep,
+											ccRasterGrid::ProjectionType projectionType)
+{
+	if (	gridBox.isValid() == m_gridBox.isValid()
+		&&	SameCorner(gridBox.minCorner(), m_gridBox.minCorner())
+		&&	SameCorner(gridBox.maxCorner(), m_gridBox.maxCorner())
+		&&	vertDim == m_vertDim
+		&&	gridStep == m_gridStep
+		&&	projectionType == m_projectionType)
+	{
+		//nothing has changed
+		return;
+	}
+
+	m_gridBox = gridBox;
+	m_vertDim = vertDim;
+	m_gridStep = gridStep;
+	m_projectionType = projectionType;
+
+	//both grids must be generated again
+	m_layers[0].rasterIsUpToDate = false;
+	m_layers[1].rasterIsUpToDate = false;
+}
+
+void ccVolumeCalcEngine::SetSource(	Layer& layer,
+									ccGenericPointCloud* cloud,
+									ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy,
+									double height)
+{
+	if (layer.cloud != cloud)
+	{
+		layer.cloud = cloud;
+		layer.rasterIsUpToDate = false;
+	}
+	layer.fillStrategy = emptyCellFillStrategy;
+	layer.height = height;
+}
+
+void ccVolumeCalcEngine::setGround(	ccGenericPointCloud* cloud,
+									ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy,
+									double height)
+{
+	SetSource(ground(), cloud, emptyCellFillStrategy, height);
+}
+
+void ccVolumeCalcEngine::setCeil(	ccGenericPointCloud* cloud,
+									ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy,
+									double height)
+{
+	SetSource(ceil(), cloud, emptyCellFillStrategy, height);
+}
+
+void ccVolumeCalcEngine::swapRoles()
+{
+	m_groundIndex = 1 - m_groundIndex;
+}
+
+void ccVolumeCalcEngine::clear()
+{
+	for (Layer& layer : m_layers)
+	{
+		layer.raster.clear();
+		layer.rasterIsUpToDate = false;
+	}
+}
+
+bool ccVolumeCalcEngine::getGridSize(unsigned& gridWidth, unsigned& gridHeight) const
+{
+	return ccRasterGrid::ComputeGridSize(m_vertDim, m_gridBox, m_gridStep, gridWidth, gridHeight);
+}
+
+bool ccVolumeCalcEngine::updateLayer(Layer& layer, const char* layerName, ccProgressDialog* progressDialog)
+{
+	if (!layer.cloud)
+	{
+		//constant height: no grid required
+		return true;
+	}
+
+	bool interpolate = (layer.fillStrategy == ccRasterGrid::INTERPOLATE);
+
+	if (!layer.rasterIsUpToDate || layer.rasterIsInterpolated != interpolate)
+	{
+		unsigned gridWidth = 0, gridHeight = 0;
+		if (!getGridSize(gridWidth, gridHeight))
+		{
+			return false;
+		}
+
+		CCVector3d minCorner = CCVector3d::fromArray(m_gridBox.minCorner().u);
+		if (!layer.raster.init(gridWidth, gridHeight, m_gridStep, minCorner))
+		{
+			ccLog::Warning("[Volume] Not enough memory");
+			return false;
+		}
+
+		if (!layer.raster.fillWith(	layer.cloud,
+									m_vertDim,
+									m_projectionType,
+									interpolate,
+									ccRasterGrid::INVALID_PROJECTION_TYPE,
+									progressDialog))
+		{
+			layer.raster.clear();
+			layer.rasterIsUpToDate = false;
+			return false;
+		}
+
+		layer.rasterIsUpToDate = true;
+		layer.rasterIsInterpolated = interpolate;
+		layer.appliedFillStrategy = (interpolate ? ccRasterGrid::INTERPOLATE : ccRasterGrid::LEAVE_EMPTY);
+		layer.appliedHeight = std::numeric_limits<double>::quiet_NaN();
+
+		ccLog::Print(QString("[Volume] %1 raster grid: size: %2 x %3 / heights: [%4 ; %5]").arg(layerName).arg(layer.raster.width).arg(layer.raster.height).arg(layer.raster.minHeight).arg(layer.raster.maxHeight));
+	}
+
+	if (	layer.appliedFillStrategy != layer.fillStrategy
+		||	(layer.fillStrategy == ccRasterGrid::FILL_CUSTOM_HEIGHT && layer.appliedHeight != layer.height))
+	{
+		//only the empty cells have to be updated
+		if (	layer.appliedFillStrategy != ccRasterGrid::LEAVE_EMPTY
+			&&	layer.appliedFillStrategy != ccRasterGrid::INTERPOLATE)
+		{
+			ccRasterGrid& raster = layer.raster;
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+			for (int j = 0; j < static_cast<int>(raster.height); ++j)
+			{
+				ccRasterCell* row = raster.row(j);
+				for (unsigned i = 0; i < raster.width; ++i)
+				{
+					if (row[i].nbPoints == 0)
+					{
+						row[i].h = std::numeric_limits<double>::quiet_NaN();
+					}
+				}
+			}
+		}
+
+		//the grid statistics are still the ones of the non-empty cells
+		layer.raster.fillEmptyCells(layer.fillStrategy, layer.height);
+		layer.appliedFillStrategy = layer.fillStrategy;
+		layer.appliedHeight = layer.height;
+	}
+
+	return true;
+}
+
+bool ccVolumeCalcEngine::compute(	ccRasterGrid& grid,
+									ReportInfo& reportInfo,
+									ccProgressDialog* progressDialog/*=nullptr*/)
+{
+	if (m_gridStep <= 1.0e-8 || m_vertDim > 2)
+	{
+		assert(false);
+		ccLog::Warning("[Volume] Invalid input parameters");
+		return false;
+	}
+
+	if (!ground().cloud && !ceil().cloud)
+	{
+		assert(false);
+		ccLog::Warning("[Volume] No valid input cloud");
+		return false;
+	}
+
+	if (!m_gridBox.isValid())
+	{
+		ccLog::Warning("[Volume] Invalid bounding-box");
+		return false;
+	}
+
+	unsigned gridWidth = 0, gridHeight = 0;
+	if (!getGridSize(gridWidth, gridHeight))
+	{
+		return false;
+	}
+
+	//update the ground and ceil grids (if necessary)
+	if (	!updateLayer(ground(), "Ground", progressDialog)
+		||	!updateLayer(ceil(), "Ceil", progressDialog))
+	{
+		return false;
+	}
+
+	//memory allocation
+	CCVector3d minCorner = CCVector3d::fromArray(m_gridBox.minCorner().u);
+	if (!grid.init(gridWidth, gridHeight, m_gridStep, minCorner))
+	{
+		//not enough memory
+		ccLog::Warning("[Volume] Not enough memory");
+		return false;
+	}
+
+	const ccRasterGrid* groundRaster = (ground().cloud ? &ground().raster : nullptr);
+	const ccRasterGrid* ceilRaster = (ceil().cloud ? &ceil().raster : nullptr);
+	const double groundHeight = ground().height;
+	const double ceilHeight = ceil().height;
+
+	//update grid and compute volume
+	double volume = 0;
+	double addedVolume = 0;
+	double removedVolume = 0;
+	size_t matchingCount = 0;
+	size_t ceilNonMatchingCount = 0;
+	size_t groundNonMatchingCount = 0;
+	size_t cellCount = 0;
+
+	if (progressDialog)
+	{
+		progressDialog->setMethodTitle(QObject::tr("Volume computation"));
+		progressDialog->setInfo(QObject::tr("Cells: %L1 x %L2").arg(grid.width).arg(grid.height));
+		progressDialog->start();
+		progressDialog->show();
+		QCoreApplication::processEvents();
+	}
+	//one step per row (the progress counter is atomic)
+	CCLib::NormalizedProgress nProgress(progressDialog, grid.height);
+	std::atomic<bool> cancelled(false);
+
+#if defined(_OPENMP)
+#pragma omp parallel for reduction(+:volume, addedVolume, removedVolume, matchingCount, ceilNonMatchingCount, groundNonMatchingCount, cellCount)
+#endif
+	for (int j = 0; j < static_cast<int>(grid.height); ++j)
+	{
+		if (cancelled)
+		{
+			//we can't break an OpenMP loop
+			continue;
+		}
+
+		ccRasterCell* row = grid.row(j);
+		const ccRasterCell* groundRow = (groundRaster ? groundRaster->row(j) : nullptr);
+		const ccRasterCell* ceilRow = (ceilRaster ? ceilRaster->row(j) : nullptr);
+
+		for (unsigned i = 0; i < grid.width; ++i)
+		{
+			ccRasterCell& cell = row[i];
+
+			bool validGround = true;
+			cell.minHeight = groundHeight;
+			if (groundRow)
+			{
+				cell.minHeight = groundRow[i].h;
+				validGround = std::isfinite(cell.minHeight);
+			}
+
+			bool validCeil = true;
+			cell.maxHeight = ceilHeight;
+			if (ceilRow)
+			{
+				cell.maxHeight = ceilRow[i].h;
+				validCeil = std::isfinite(cell.maxHeight);
+			}
+
+			if (validGround && validCeil)
+			{
+				cell.h = cell.maxHeight - cell.minHeight;
+				cell.nbPoints = 1;
+
+				volume += cell.h;
+				if (cell.h < 0)
+				{
+					removedVolume -= cell.h;
+				}
+				else if (cell.h > 0)
+				{
+					addedVolume += cell.h;
+				}
+				++matchingCount;
+				++cellCount;
+			}
+			else
+			{
+				if (validGround)
+				{
+					++cellCount;
+					++groundNonMatchingCount;
+				}
+				else if (validCeil)
+				{
+					++cellCount;
+					++ceilNonMatchingCount;
+				}
+				cell.h = std::numeric_limits<double>::quiet_NaN();
+				cell.nbPoints = 0;
+			}
+
+			cell.avgHeight = (groundHeight + ceilHeight) / 2;
+			cell.stdDevHeight = 0;
+		}
+
+		if (progressDialog && !nProgress.oneStep())
+		{
+			//process cancelled by the user
+			cancelled = true;
+		}
+	}
+
+	if (cancelled)
+	{
+		ccLog::Warning("[Volume] Process cancelled by the user");
+		return false;
+	}
+
+	grid.nonEmptyCellCount = static_cast<unsigned>(matchingCount);
+	grid.validCellCount = grid.nonEmptyCellCount;
+
+	//count the average number of valid neighbors
+	{
+		size_t validNeighborsCount = 0;
+		size_t count = 0;
+
+#if defined(_OPENMP)
+#pragma omp parallel for reduction(+:validNeighborsCount, count)
+#endif
+		for (int j = 1; j < static_cast<int>(grid.height) - 1; ++j)
+		{
+			for (unsigned i = 1; i + 1 < grid.width; ++i)
+			{
+				if (std::isfinite(grid.cell(i, j).h))
+				{
+					for (unsigned l = j - 1; l <= static_cast<unsigned>(j) + 1; ++l)
+					{
+						const ccRasterCell* row = grid.row(l);
+						for (unsigned k = i - 1; k <= i + 1; ++k)
+						{
+							if ((k != i || l != static_cast<unsigned>(j)) && std::isfinite(row[k].h))
+							{
+								++validNeighborsCount;
+							}
+						}
+					}
+
+					++count;
+				}
+			}
+		}
+
+		if (count)
+		{
+			reportInfo.averageNeighborsPerCell = static_cast<double>(validNeighborsCount) / count;
+		}
+	}
+
+	if (cellCount)
+	{
+		reportInfo.matchingPrecent = static_cast<float>(matchingCount * 100) / cellCount;
+		reportInfo.groundNonMatchingPercent = static_cast<float>(groundNonMatchingCount * 100) / cellCount;
+		reportInfo.ceilNonMatchingPercent = static_cast<float>(ceilNonMatchingCount * 100) / cellCount;
+	}
+	float cellArea = static_cast<float>(grid.gridStep * grid.gridStep);
+	reportInfo.volume = volume * cellArea;
+	reportInfo.addedVolume = addedVolume * cellArea;
+	reportInfo.removedVolume = removedVolume * cellArea;
+	reportInfo.surface = matchingCount * cellArea;
+
+	grid.setValid(true);
+
+	return true;
+}
@@ -0,0 +1,170 @@
+//##########################################################################
+//#                                                                        #
+//#                              CLOUDCOMPARE                              #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 or later of the License.      #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the          #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#          COPYRIGHT: EDF R&D / TELECOM ParisTech (ENST-TSI)             #
+//#                                                                        #
+//##########################################################################
+
+#ifndef CC_VOLUME_CALC_ENGINE_HEADER
+#define CC_VOLUME_CALC_ENGINE_HEADER
+
+//qCC_db
+#include <ccBBox.h>
+#include <ccRasterGrid.h>
+
+//Qt
+#include <QString>
+
+class ccGenericPointCloud;
+class ccProgressDialog;
+
+//! 2.5D volume calculation engine
+/** The ground and ceil grids are kept between two calls to 'compute':
+	- they are only regenerated if the grid parameters or their own source changes
+	- changing the empty cells filling strategy (or height) only updates the empty cells
+	  (apart from the 'INTERPOLATE' strategy that requires the grid to be generated again)
+	- a constant ground or ceil doesn't require any grid
+	The height difference and the report values are then computed in parallel.
+**/
+class ccVolumeCalcEngine
+{
+public:
+
+	//! Report info
+	struct ReportInfo
+	{
+		ReportInfo()
+			: volume(0)
+			, addedVolume(0)
+			, removedVolume(0)
+			, surface(0)
+			, matchingPrecent(0)
+			, ceilNonMatchingPercent(0)
+			, groundNonMatchingPercent(0)
+			, averageNeighborsPerCell(0)
+		{}
+
+		QString toText(int precision = 6) const;
+
+		double volume;
+		double addedVolume;
+		double removedVolume;
+		double surface;
+		float matchingPrecent;
+		float ceilNonMatchingPercent;
+		float groundNonMatchingPercent;
+		double averageNeighborsPerCell;
+	};
+
+	//! Default constructor
+	ccVolumeCalcEngine();
+
+	//! Sets the grid parameters
+	/** Both the ground and ceil grids will be regenerated if any parameter changes.
+	**/
+	void setGridParameters(	const ccBBox& gridBox,
+							unsigned char vertDim,
+							double gridStep,
+							ccRasterGrid::ProjectionType projectionType);
+
+	//! Sets the ground source
+	/** \param cloud ground cloud (or null for a constant ground)
+		\param emptyCellFillStrategy empty cells filling strategy (ignored for a constant ground)
+		\param height constant ground height (if no cloud) or custom height for the empty cells
+	**/
+	void setGround(	ccGenericPointCloud* cloud,
+					ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy,
+					double height);
+
+	//! Sets the ceil source
+	/** \param cloud ceil cloud (or null for a constant ceil)
+		\param emptyCellFillStrategy empty cells filling strategy (ignored for a constant ceil)
+		\param height constant ceil height (if no cloud) or custom height for the empty cells
+	**/
+	void setCeil(	ccGenericPointCloud* cloud,
+					ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy,
+					double height);
+
+	//! Swaps the ground and ceil sources (and their grids)
+	void swapRoles();
+
+	//! Releases the cached ground and ceil grids
+	void clear();
+
+	//! Computes the height difference grid and the corresponding volume
+	/** \param grid output (height difference) grid
+		\param reportInfo output report
+		\param progressDialog progress dialog (optional)
+		\return success
+	**/
+	bool compute(	ccRasterGrid& grid,
+					ReportInfo& reportInfo,
+					ccProgressDialog* progressDialog = nullptr);
+
+	//! Returns the grid size
+	bool getGridSize(unsigned& gridWidth, unsigned& gridHeight) const;
+
+protected:
+
+	//! Ground or ceil source (and its cached grid)
+	struct Layer
+	{
+		//! Source cloud (if any)
+		ccGenericPointCloud* cloud = nullptr;
+		//! Empty cells filling strategy
+		ccRasterGrid::EmptyCellFillOption fillStrategy = ccRasterGrid::LEAVE_EMPTY;
+		//! Constant height (if no cloud) or custom height for the empty cells
+		double height = std::numeric_limits<double>::quiet_NaN();
+
+		//! Cached grid
+		ccRasterGrid raster;
+		//! Whether the cached grid is up-to-date
+		bool rasterIsUpToDate = false;
+		//! Whether the cached grid was generated with the 'INTERPOLATE' strategy
+		bool rasterIsInterpolated = false;
+		//! Strategy currently applied to the empty cells of the cached grid
+		ccRasterGrid::EmptyCellFillOption appliedFillStrategy = ccRasterGrid::LEAVE_EMPTY;
+		//! Height currently applied to the empty cells of the cached grid (custom strategy only)
+		double appliedHeight = std::numeric_limits<double>::quiet_NaN();
+	};
+
+	//! Updates the source of a layer
+	static void SetSource(	Layer& layer,
+							ccGenericPointCloud* cloud,
+							ccRasterGrid::EmptyCellFillOption emptyCellFillStrategy,
+							double height);
+
+	//! Updates the cached grid of a layer (if necessary)
+	bool updateLayer(Layer& layer, const char* layerName, ccProgressDialog* progressDialog);
+
+	//! Returns the ground layer
+	inline Layer& ground() { return m_layers[m_groundIndex]; }
+	//! Returns the ceil layer
+	inline Layer& ceil() { return m_layers[1 - m_groundIndex]; }
+
+	//! Ground and ceil layers (see m_groundIndex)
+	Layer m_layers[2];
+	//! Index of the ground layer (the other one is the ceil)
+	int m_groundIndex;
+
+	//! Grid bounding-box
+	ccBBox m_gridBox;
+	//! Vertical dimension
+	unsigned char m_vertDim;
+	//! Grid step
+	double m_gridStep;
+	//! Projection type
+	ccRasterGrid::ProjectionType m_projectionType;
+};
+
+#endif //CC_VOLUME_CALC_ENGINE_HEADER
@@ -46,7 +46,6 @@
 #include <QComboBox>
 #include <QClipboard>
 #include <QApplication>
-#include <QLocale>
 
 //System
 #include <assert.h>
@@ -181,6 +180,9 @@ void ccVolumeCalcTool::swapRoles()
 	groundComboBox->setCurrentIndex(sourceIndex);
 	fillGroundEmptyCellsComboBox->setCurrentIndex(emptyCellStrat);
 	groundEmptyValueDoubleSpinBox->setValue(emptyCellValue);
+
+	//the cached grids are swapped as well
+	m_engine.swapRoles();
 	
 	gridIsUpToDate(false);
 }
@@ -456,26 +458,6 @@ void ccVolumeCalcTool::updateGridAndDisplay()
 	gridIsUpToDate(success);
 }
 
-QString ccVolumeCalcTool::ReportInfo::toText(int precision) const
-{
-	QLocale locale(QLocale::English);
-
-	QStringList reportText;
-	reportText << QString("Volume: %1").arg(locale.toString(volume, 'f', precision));
-	reportText << QString("Surface: %1").arg(locale.toString(surface, 'f', precision));
-	reportText << QString("----------------------");
-	reportText << QString("Added volume: (+)%1").arg(locale.toString(addedVolume, 'f', precision));
-	reportText << QString("Removed volume: (-)%1").arg(locale.toString(removedVolume, 'f', precision));
-	reportText << QString("----------------------");
-	reportText << QString("Matching cells: %1%").arg(matchingPrecent, 0, 'f', 1);
-	reportText << QString("Non-matching cells:");
-	reportText << QString("    ground = %1%").arg(groundNonMatchingPercent, 0, 'f', 1);
-	reportText << QString("    ceil = %1%").arg(ceilNonMatchingPercent, 0, 'f', 1);
-	reportText << QString("Average neighbors per cell: %1 / 8.0").arg(averageNeighborsPerCell, 0, 'f', 1);
-	
-	return reportText.join("\n");
-}
-
 void ccVolumeCalcTool::outputReport(const ReportInfo& info)
 {
 	int precision = precisionSpinBox->value();
@@ -489,17 +471,20 @@ void ccVolumeCalcTool::outputReport(const ReportInfo& info)
 	clipboardPushButton->setEnabled(true);
 }
 
-bool SendError(const QString& message, QWidget* parentWidget)
+static bool CheckGridSize(unsigned gridTotalSize, QWidget* parentWidget)
 {
-	if (parentWidget)
+	if (gridTotalSize == 1)
 	{
-		ccLog::Error(message);
+		if (parentWidget && QMessageBox::question(parentWidget, "Unexpected grid size", "The generated grid will only have 1 cell! Do you want to proceed anyway?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+			return false;
 	}
-	else
+	else if (gridTotalSize > 10000000)
 	{
-		ccLog::Warning("[Volume] " + message);
+		if (parentWidget && QMessageBox::question(parentWidget, "Big grid size", "The generated grid will have more than 10.000.000 cells! Do you want to proceed anyway?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+			return false;
 	}
-	return false;
+
+	return true;
 }
 
 bool ccVolumeCalcTool::ComputeVolume(	ccRasterGrid& grid,
@@ -543,23 +528,9 @@ bool ccVolumeCalcTool::ComputeVolume(	ccRasterGrid& grid,
 
 	//grid size
 	unsigned gridTotalSize = gridWidth * gridHeight;
-	if (gridTotalSize == 1)
+	if (!CheckGridSize(gridTotalSize, parentWidget))
 	{
-		if (parentWidget && QMessageBox::question(parentWidget, "Unexpected grid size", "The generated grid will only have 1 cell! Do you want to proceed anyway?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
-			return false;
-	}
-	else if (gridTotalSize > 10000000)
-	{
-		if (parentWidget && QMessageBox::question(parentWidget, "Big grid size", "The generated grid will have more than 10.000.000 cells! Do you want to proceed anyway?", QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
-			return false;
-	}
-
-	//memory allocation
-	CCVector3d minCorner = CCVector3d::fromArray(gridBox.minCorner().u);
-	if (!grid.init(gridWidth, gridHeight, gridStep, minCorner))
-	{
-		//not enough memory
-		return SendError("Not enough memory", parentWidget);
+		return false;
 	}
 
 	//progress dialog
@@ -569,193 +540,12 @@ bool ccVolumeCalcTool::ComputeVolume(	ccRasterGrid& grid,
 		pDlg.reset(new ccProgressDialog(true, parentWidget));
 	}
 
-	ccRasterGrid groundRaster;
-	if (ground)
-	{
-		if (!groundRaster.init(gridWidth, gridHeight, gridStep, minCorner))
-		{
-			//not enough memory
-			return SendError("Not enough memory", parentWidget);
-		}
-
-		if (groundRaster.fillWith(	ground,
-									vertDim,
-									projectionType,
-									groundEmptyCellFillStrategy == ccRasterGrid::INTERPOLATE,
-									ccRasterGrid::INVALID_PROJECTION_TYPE,
-									pDlg.data()))
-		{
-			groundRaster.fillEmptyCells(groundEmptyCellFillStrategy, groundHeight);
-			ccLog::Print(QString("[Volume] Ground raster grid: size: %1 x %2 / heights: [%3 ; %4]").arg(groundRaster.width).arg(groundRaster.height).arg(groundRaster.minHeight).arg(groundRaster.maxHeight));
-		}
-		else
-		{
-			return false;
-		}
-	}
-
-	//ceil
-	ccRasterGrid ceilRaster;
-	if (ceil)
-	{
-		if (!ceilRaster.init(gridWidth, gridHeight, gridStep, minCorner))
-		{
-			//not enough memory
-			return SendError("Not enough memory", parentWidget);
-		}
-
-		if (ceilRaster.fillWith(ceil,
-								vertDim,
-								projectionType,
-								ceilEmptyCellFillStrategy == ccRasterGrid::INTERPOLATE,
-								ccRasterGrid::INVALID_PROJECTION_TYPE,
-								pDlg.data()))
-		{
-			ceilRaster.fillEmptyCells(ceilEmptyCellFillStrategy, ceilHeight);
-			ccLog::Print(QString("[Volume] Ceil raster grid: size: %1 x %2 / heights: [%3 ; %4]").arg(ceilRaster.width).arg(ceilRaster.height).arg(ceilRaster.minHeight).arg(ceilRaster.maxHeight));
-		}
-		else
-		{
-			return false;
-		}
-	}
-
-	//update grid and compute volume
-	{
-		if (pDlg)
-		{
-			pDlg->setMethodTitle(QObject::tr("Volume computation"));
-			pDlg->setInfo(QObject::tr("Cells: %1 x %2").arg(grid.width).arg(grid.height));
-			pDlg->start();
-			pDlg->show();
-			QCoreApplication::processEvents();
-		}
-		CCLib::NormalizedProgress nProgress(pDlg.data(), grid.width * grid.height);
-		
-		size_t ceilNonMatchingCount = 0;
-		size_t groundNonMatchingCount = 0;
-		size_t cellCount = 0;
-
-		//at least one of the grid is based on a cloud
-		grid.nonEmptyCellCount = 0;
-		for (unsigned i = 0; i < grid.height; ++i)
-		{
-			for (unsigned j = 0; j < grid.width; ++j)
-			{
-				ccRasterCell& cell = grid.rows[i][j];
-
-				bool validGround = true;
-				cell.minHeight = groundHeight;
-				if (ground)
-				{
-					cell.minHeight = groundRaster.rows[i][j].h;
-					validGround = std::isfinite(cell.minHeight);
-				}
-
-				bool validCeil = true;
-				cell.maxHeight = ceilHeight;
-				if (ceil)
-				{
-					cell.maxHeight = ceilRaster.rows[i][j].h;
-					validCeil = std::isfinite(cell.maxHeight);
-				}
-
-				if (validGround && validCeil)
-				{
-					cell.h = cell.maxHeight - cell.minHeight;
-					cell.nbPoints = 1;
-
-					reportInfo.volume += cell.h;
-					if (cell.h < 0)
-					{
-						reportInfo.removedVolume -= cell.h;
-					}
-					else if (cell.h > 0)
-					{
-						reportInfo.addedVolume += cell.h;
-					}
-					reportInfo.surface += 1.0;
-					++grid.nonEmptyCellCount; // matching count
-					++cellCount;
-				}
-				else
-				{
-					if (validGround)
-					{
-						++cellCount;
-						++groundNonMatchingCount;
-					}
-					else if (validCeil)
-					{
-						++cellCount;
-						++ceilNonMatchingCount;
-					}
-					cell.h = std::numeric_limits<double>::quiet_NaN();
-					cell.nbPoints = 0;
-				}
-
-				cell.avgHeight = (groundHeight + ceilHeight) / 2;
-				cell.stdDevHeight = 0;
-
-				if (pDlg && !nProgress.oneStep())
-				{
-					ccLog::Warning("[Volume] Process cancelled by the user");
-					return false;
-				}
-			}
-		}
-		grid.validCellCount = grid.nonEmptyCellCount;
+	ccVolumeCalcEngine engine;
+	engine.setGridParameters(gridBox, vertDim, gridStep, projectionType);
+	engine.setGround(ground, groundEmptyCellFillStrategy, groundHeight);
+	engine.setCeil(ceil, ceilEmptyCellFillStrategy, ceilHeight);
 
-		//count the average number of valid neighbors
-		{
-			size_t validNeighborsCount = 0;
-			size_t count = 0;
-			for (unsigned i = 1; i < grid.height - 1; ++i)
-			{
-				for (unsigned j = 1; j < grid.width - 1; ++j)
-				{
-					ccRasterCell& cell = grid.rows[i][j];
-					if (cell.h == cell.h)
-					{
-						for (unsigned k = i - 1; k <= i + 1; ++k)
-						{
-							for (unsigned l = j - 1; l <= j + 1; ++l)
-							{
-								if (k != i || l != j)
-								{
-									ccRasterCell& otherCell = grid.rows[k][l];
-									if (std::isfinite(otherCell.h))
-									{
-										++validNeighborsCount;
-									}
-								}
-							}
-						}
-
-						++count;
-					}
-				}
-			}
-
-			if (count)
-			{
-				reportInfo.averageNeighborsPerCell = static_cast<double>(validNeighborsCount) / count;
-			}
-		}
-
-		reportInfo.matchingPrecent = static_cast<float>(grid.validCellCount * 100) / cellCount;
-		reportInfo.groundNonMatchingPercent = static_cast<float>(groundNonMatchingCount * 100) / cellCount;
-		reportInfo.ceilNonMatchingPercent = static_cast<float>(ceilNonMatchingCount * 100) / cellCount;
-		float cellArea = static_cast<float>(grid.gridStep * grid.gridStep);
-		reportInfo.volume *= cellArea;
-		reportInfo.addedVolume *= cellArea;
-		reportInfo.removedVolume *= cellArea;
-		reportInfo.surface *= cellArea;
-	}
-
-	grid.setValid(true);
-
-	return true;
+	return engine.compute(grid, reportInfo, pDlg.data());
 }
 
 bool ccVolumeCalcTool::updateGrid()
@@ -785,11 +575,9 @@ bool ccVolumeCalcTool::updateGrid()
 
 	//ground
 	ccGenericPointCloud* groundCloud = 0;
-	double groundHeight = 0;
 	switch (groundComboBox->currentIndex())
 	{
 	case 0:
-		groundHeight = groundEmptyValueDoubleSpinBox->value();
 		break;
 	case 1:
 		groundCloud = m_cloud1 ? m_cloud1 : m_cloud2;
@@ -801,14 +589,14 @@ bool ccVolumeCalcTool::updateGrid()
 		assert(false);
 		return false;
 	}
+	//constant height or custom height for the empty cells
+	double groundHeight = groundEmptyValueDoubleSpinBox->value();
 
 	//ceil
 	ccGenericPointCloud* ceilCloud = 0;
-	double ceilHeight = 0;
 	switch (ceilComboBox->currentIndex())
 	{
 	case 0:
-		ceilHeight = ceilEmptyValueDoubleSpinBox->value();
 		break;
 	case 1:
 		ceilCloud = m_cloud1 ? m_cloud1 : m_cloud2;
@@ -820,25 +608,31 @@ bool ccVolumeCalcTool::updateGrid()
 		assert(false);
 		return false;
 	}
+	//constant height or custom height for the empty cells
+	double ceilHeight = ceilEmptyValueDoubleSpinBox->value();
 
-	ccVolumeCalcTool::ReportInfo reportInfo;
+	if (!groundCloud && !ceilCloud)
+	{
+		ccLog::Error("At least the ground or the ceil should be a cloud!");
+		return false;
+	}
 
-	if (ComputeVolume(	m_grid,
-						groundCloud,
-						ceilCloud,
-						box,
-						getProjectionDimension(),
-						gridStep,
-						gridWidth,
-						gridHeight,
-						getTypeOfProjection(),
-						getFillEmptyCellsStrategy(fillGroundEmptyCellsComboBox),
-						getFillEmptyCellsStrategy(fillCeilEmptyCellsComboBox),
-						reportInfo,
-						groundHeight,
-						ceilHeight,
-						this))
-	{	
+	if (!CheckGridSize(gridWidth * gridHeight, this))
+	{
+		return false;
+	}
+
+	//the engine only regenerates the ground and ceil grids if necessary
+	m_engine.setGridParameters(box, getProjectionDimension(), gridStep, getTypeOfProjection());
+	m_engine.setGround(groundCloud, getFillEmptyCellsStrategy(fillGroundEmptyCellsComboBox), groundHeight);
+	m_engine.setCeil(ceilCloud, getFillEmptyCellsStrategy(fillCeilEmptyCellsComboBox), ceilHeight);
+
+	//progress dialog
+	ccProgressDialog pDlg(true, this);
+
+	ccVolumeCalcTool::ReportInfo reportInfo;
+	if (m_engine.compute(m_grid, reportInfo, &pDlg))
+	{
 		outputReport(reportInfo);
 		return true;
 	}
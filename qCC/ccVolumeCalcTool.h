@@ -22,6 +22,7 @@
 
 //Local
 #include "cc2.5DimEditor.h"
+#include "ccVolumeCalcEngine.h"
 
 //Qt
 #include <QDialog>
@@ -49,30 +50,7 @@ public:
 	virtual ccRasterGrid::ProjectionType getTypeOfProjection() const override;
 
 	//! Report info
-	struct ReportInfo
-	{
-		ReportInfo()
-			: volume(0)
-			, addedVolume(0)
-			, removedVolume(0)
-			, surface(0)
-			, matchingPrecent(0)
-			, ceilNonMatchingPercent(0)
-			, groundNonMatchingPercent(0)
-			, averageNeighborsPerCell(0)
-		{}
-
-		QString toText(int precision = 6) const;
-
-		double volume;
-		double addedVolume;
-		double removedVolume;
-		double surface;
-		float matchingPrecent;
-		float ceilNonMatchingPercent;
-		float groundNonMatchingPercent;
-		double averageNeighborsPerCell;
-	};
+	using ReportInfo = ccVolumeCalcEngine::ReportInfo;
 
 	//! Static accessor
 	static bool ComputeVolume(	ccRasterGrid& grid,
@@ -174,6 +152,9 @@ protected: //members
 	/** Only valid if clipboardPushButton is enabled
 	**/
 	ReportInfo m_lastReport;
+
+	//! Volume calculation engine (keeps the ground and ceil grids between two updates)
+	ccVolumeCalcEngine m_engine;
 };
 
 #endif //CC_VOLUME_CALC_TOOL_HEADER
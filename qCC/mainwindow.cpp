@@ -170,6 +170,7 @@
 #include "bdr2.5DimEditor.h"
 #include "bdrImageEditorPanel.h"
 #include "bdrPlaneEditorDlg.h"
+#include "bdrLoD2BatchEngine.h"
 
 #include "stocker_parser.h"
 #include "builderlod2/lod2parser.h"
@@ -4472,7 +4473,15 @@ void MainWindow::doActionMeasureMeshVolume()
 				{
 					if (stats.edgesNotShared != 0)
 					{
-						ccConsole::Warning(QString("[Mesh Volume] The above volume might be invalid (mesh has holes)"));
+						std::vector< std::vector<unsigned> > boundaryLoops;
+						if (CCLib::MeshSamplingTools::extractBoundaryLoops(mesh, boundaryLoops))
+						{
+							ccConsole::Warning(QString("[Mesh Volume] The above volume might be invalid (mesh has %1 hole(s) or open border(s))").arg(boundaryLoops.size()));
+						}
+						else
+						{
+							ccConsole::Warning(QString("[Mesh Volume] The above volume might be invalid (mesh has holes)"));
+						}
 					}
 					else if (stats.edgesSharedByMore != 0)
 					{
@@ -4924,28 +4933,23 @@ void MainWindow::doActionComputePointsVisibility()
 
 		//progress bar
 		ccProgressDialog pdlg(true);
-		CCLib::NormalizedProgress nprogress(&pdlg, pointCloud->size());
-		pdlg.setMethodTitle(tr("Compute visibility"));
-		pdlg.setInfo(tr("Points: %L1").arg(pointCloud->size()));
-		pdlg.start();
-		QApplication::processEvents();
 
-		for (unsigned i = 0; i < pointCloud->size(); i++)
+		//the whole cloud is processed at once (in parallel)
+		std::vector<unsigned char> visibility;
+		if (sensor->checkCloudVisibility(pointCloud, visibility, &pdlg))
 		{
-			const CCVector3* P = pointCloud->getPoint(i);
-			unsigned char visibility = sensor->checkVisibility(*P);
-			ScalarType visValue = static_cast<ScalarType>(visibility);
-
-			sf->setValue(i, visValue);
-
-			if (!nprogress.oneStep())
+			for (unsigned i = 0; i < pointCloud->size(); i++)
 			{
-				//cancelled by user
-				pointCloud->deleteScalarField(sfIdx);
-				sf = nullptr;
-				break;
+				sf->setValue(i, static_cast<ScalarType>(visibility[i]));
 			}
 		}
+		else
+		{
+			//not enough memory or cancelled by user
+			ccConsole::Warning("Visibility computation failed (not enough memory or process cancelled)");
+			pointCloud->deleteScalarField(sfIdx);
+			sf = nullptr;
+		}
 
 		if (sf)
 		{
@@ -12674,59 +12678,11 @@ ccHObject* MainWindow::LoadBDReconProject(QString Filename)
 	}
 	//! prepare buildings now
 	if (bd_grp) {
-		bool has_global_shift = bd_grp->hasMetaData("global_shift");
-		bool has_global_scale = bd_grp->hasMetaData("global_scale");
-		if (has_global_shift) {
-			QString str = bd_grp->getMetaData("global_shift").toString();
-			char char_str[256]; sprintf(char_str, "%s", str.toStdString().c_str());
-			QStringList vecs = _splitStringQ(char_str, ";");
-			has_global_shift = vecs.size() == 3;
-			for (size_t i = 0; i < 3; i++) {
-				if (has_global_shift)
-					bd_grp->global_shift[i] = vecs[i].toDouble(&has_global_shift);
-				else break;
-			}
-		}
-		if (!has_global_shift) has_global_scale = false;
-		if (has_global_scale) {
-			bd_grp->global_scale = bd_grp->getMetaData("global_scale").toDouble(&has_global_scale);
-		}
-
-		bd_grp->m_options = options;
-		bd_grp->build_data = build_data;
-		bd_grp->image_data = image_data;
-
-		if (bd_grp->getPath().isEmpty()) {
-			bd_grp->setPath(QString::fromStdString(options.prj_file.root_dir));
-		}
-		if (!bd_grp->updateBuildUnits(true)) {
+		if (!PrepareBDReconProject(bd_grp, options, build_data, image_data)) {
 			delete bd_grp;
 			bd_grp = nullptr;
 			return nullptr;
 		}
-				
-		if (!has_global_shift || !has_global_scale) {
-			ccHObject::Container point_clouds;
-			bd_grp->filterChildren(point_clouds, true, CC_TYPES::POINT_CLOUD, true);
-			if (!point_clouds.empty()) {
-				ccPointCloud* cloud = ccHObjectCaster::ToPointCloud(point_clouds.front());
-				if (cloud) {
-					bd_grp->global_shift = stocker::parse_xyz(cloud->getGlobalShift());
-					bd_grp->global_scale = cloud->getGlobalScale();
-					has_global_shift = true;
-					has_global_scale = true;
-					QVariantMap var_map;
-					QString global_shift_str;
-					global_shift_str.append(QString::number(bd_grp->global_shift.X())); global_shift_str.append(";");
-					global_shift_str.append(QString::number(bd_grp->global_shift.Y())); global_shift_str.append(";");
-					global_shift_str.append(QString::number(bd_grp->global_shift.Z())); global_shift_str.append(";");
-
-					var_map.insert("global_shift", QVariant(global_shift_str));
-					var_map.insert("global_scale", QVariant(bd_grp->global_scale));
-					bd_grp->setMetaData(var_map, true);
-				}
-			}
-		}
 		std::cout << "building project prepared!" << std::endl;
 	}
 	
@@ -15243,9 +15199,11 @@ void MainWindow::doActionBDFootPrintPack()
 		}
 		catch (const std::exception& e) {
 			dispToConsole(e.what(), ERR_CONSOLE_MESSAGE);
+			ReleaseCloudXYIndexes();
 			return;
 		}
 		ProgEnd
+		ReleaseCloudXYIndexes();
 	}
 	else if (pack_type == "polyline") {
 		bool ok = true;
@@ -15384,11 +15342,13 @@ void MainWindow::doActionBDLoD1Generation()
 		catch (std::runtime_error& e) {
 			dispToConsole("[BDRecon] cannot build lod1 model", ERR_CONSOLE_MESSAGE);
 			dispToConsole(e.what(), ERR_CONSOLE_MESSAGE);
+			ReleaseCloudXYIndexes();
 			return;
 		}
 		ProgStepBreak
 	}
 	ProgEnd
+	ReleaseCloudXYIndexes();
 // 	if (entity->isA(CC_TYPES::ST_FOOTPRINT)) {
 // 
 // 	}
@@ -15468,9 +15428,43 @@ void MainWindow::doActionBDLoD2Generation()
 		return;
 	}
 
+	//! the CDT roofs are reconstructed in parallel (see bdrLoD2BatchEngine)
+	bool batch_lod2 = m_pbdrSettingLoD2Dlg->roofTopologyGroupBox->isChecked() && m_pbdrSettingLoD2Dlg->roofCDTRadioButton->isChecked();
+	std::vector<bdrLoD2BatchEngine::Task> lod2_tasks;
+
+	auto saveModel = [&](ccHObject* bd_entity, ccHObject* bd_model_obj) {
+		BDBaseHObject* baseObj = GetRootBDBase(bd_entity);
+		SetGlobalShiftAndScale(bd_model_obj);
+		bd_model_obj->setDisplay_recursive(bd_entity->getDisplay());
+		addToDB(bd_model_obj, baseObj->getDBSourceType());
+
+		//////////////////////////////////////////////////////////////////////////
+		if (bd_entity->isA(CC_TYPES::ST_BUILDING)) {
+			QString building_name = GetBaseName(bd_entity->getName());
+			//! check for footprints
+			StBlockGroup* blockGroup = baseObj->GetBlockGroup(building_name);
+			stocker::BuildUnit* sp = baseObj->GetBuildingSp(building_name.toStdString());
+
+			if (sp) {
+				
+				QString path = QString::fromStdString(ExcludeExt(sp->file_path.ori_points) + ".bin");
+				
+				FileIOFilter::SaveParameters parameters;
+				{
+					parameters.alwaysDisplaySaveDialog = false;
+					parameters.parentWidget = MainWindow::TheInstance();
+				}
+
+				//specific case: BIN format			
+				CC_FILE_ERROR result = FileIOFilter::SaveToFile(bd_model_obj, path, parameters, BinFilter::GetFileFilter());
+			}
+		}
+	};
+
 	ProgStartNorm("LoD2 generation", building_entites.size())
 	for (ccHObject* bd_entity : building_entites) {
 		BDBaseHObject* baseObj = GetRootBDBase(bd_entity);
+		bool pack_footprints = false;
 
 		if (bd_entity->isA(CC_TYPES::ST_BUILDING)) {
 			QString building_name = GetBaseName(bd_entity->getName());
@@ -15574,7 +15568,11 @@ void MainWindow::doActionBDLoD2Generation()
 				}
 				if (m_pbdrSettingLoD2Dlg->footprintPolygonPartitionGroupBox->isChecked()) {
 					//TODO: 
-					if (!PackFootprints_PPP(bd_entity,
+					if (batch_lod2) {
+						//! packed by the batch engine
+						pack_footprints = true;
+					}
+					else if (!PackFootprints_PPP(bd_entity,
 						-1, true,
 						m_pbdrSettingLoD2Dlg->fpDataPtsRatioDoubleSpinBox->value(),
 						m_pbdrSettingLoD2Dlg->fpDataRatioDoubleSpinBox->value(),
@@ -15586,6 +15584,15 @@ void MainWindow::doActionBDLoD2Generation()
 		
 		
 
+		if (batch_lod2) {
+			bdrLoD2BatchEngine::Task task;
+			task.entity = bd_entity;
+			task.packFootprints = pack_footprints;
+			lod2_tasks.push_back(task);
+			ProgStepBreak
+			continue;
+		}
+
 		try {
 			ccHObject* bd_model_obj = nullptr;
 			if (m_pbdrSettingLoD2Dlg->roofTopologyGroupBox->isChecked()) {
@@ -15611,31 +15618,7 @@ void MainWindow::doActionBDLoD2Generation()
 			else bd_model_obj = baseObj->GetBlockGroup(GetBaseName(bd_entity->getName()));
 			
 			if (bd_model_obj) {
-				SetGlobalShiftAndScale(bd_model_obj);
-				bd_model_obj->setDisplay_recursive(bd_entity->getDisplay());
-				addToDB(bd_model_obj, baseObj->getDBSourceType());
-
-				//////////////////////////////////////////////////////////////////////////
-				if (bd_entity->isA(CC_TYPES::ST_BUILDING)) {
-					QString building_name = GetBaseName(bd_entity->getName());
-					//! check for footprints
-					StBlockGroup* blockGroup = baseObj->GetBlockGroup(building_name);
-					stocker::BuildUnit* sp = baseObj->GetBuildingSp(building_name.toStdString());
-
-					if (sp) {
-						
-						QString path = QString::fromStdString(ExcludeExt(sp->file_path.ori_points) + ".bin");
-						
-						FileIOFilter::SaveParameters parameters;
-						{
-							parameters.alwaysDisplaySaveDialog = false;
-							parameters.parentWidget = MainWindow::TheInstance();
-						}
-
-						//specific case: BIN format			
-						CC_FILE_ERROR result = FileIOFilter::SaveToFile(bd_model_obj, path, parameters, BinFilter::GetFileFilter());
-					}
-				}
+				saveModel(bd_entity, bd_model_obj);
 			}
 		}
 		catch (const std::exception& e) {
@@ -15657,6 +15640,58 @@ void MainWindow::doActionBDLoD2Generation()
 		ProgStepBreak
 	}
 	ProgEnd
+
+	if (!lod2_tasks.empty()) {
+		bdrLoD2BatchEngine::Parameters params;
+		params.fpDataPtsRatio = m_pbdrSettingLoD2Dlg->fpDataPtsRatioDoubleSpinBox->value();
+		params.fpDataRatio = m_pbdrSettingLoD2Dlg->fpDataRatioDoubleSpinBox->value();
+		params.fpSharpWeight = m_pbdrSettingLoD2Dlg->fpSmoothSharpSpinBox->value();
+		params.maxIter = m_pbdrSettingLoD2Dlg->cdtMaxIterCheckBox->isChecked() ? m_pbdrSettingLoD2Dlg->cdtMaxIterSpinBox->value() : -1;
+		params.capHole = m_pbdrSettingLoD2Dlg->cdtHoleFillingCheckBox->isChecked();
+		params.fitFootprint = m_pbdrSettingLoD2Dlg->cdtFitFootprintCheckBox->isChecked();
+		params.dataPtsRatio = m_pbdrSettingLoD2Dlg->cdtDataPtsRatioDoubleSpinBox->value();
+		params.dataRatio = m_pbdrSettingLoD2Dlg->cdtDataRatioDoubleSpinBox->value();
+		params.intsThreshold = m_pbdrSettingLoD2Dlg->cdtHOffsetDoubleSpinBox->value();
+		params.alpha = m_pbdrSettingLoD2Dlg->alphaDoubleSpinBox->value();
+		params.minArea = m_pbdrSettingLoD2Dlg->simplifyMinAreaDoubleSpinBox->value();
+		params.maxIntersection = m_pbdrSettingLoD2Dlg->simplifyIntersectionDoubleSpinBox->value();
+
+		//! the buildings are processed by the workers behind a modal progress dialog: the
+		//! main window is neither refreshed nor accessible in the meantime
+		ccProgressDialog batchDlg(true, this);
+		batchDlg.setWindowModality(Qt::ApplicationModal);
+		batchDlg.setAutoClose(false);
+		batchDlg.setMethodTitle("lod2 generation");
+		batchDlg.setInfo(QString("Reconstructing %1 building(s)...please wait").arg(lod2_tasks.size()));
+		batchDlg.start();
+		freezeUI(true);
+		setUpdatesEnabled(false);
+
+		bdrLoD2BatchEngine engine(params);
+		engine.run(lod2_tasks, &batchDlg);
+
+		setUpdatesEnabled(true);
+		freezeUI(false);
+		batchDlg.stop();
+
+		engine.finalize(this);
+
+		for (const bdrLoD2BatchEngine::Result& result : engine.results()) {
+			if (result.status != bdrLoD2BatchEngine::SUCCESS || !result.model) {
+				continue;
+			}
+			try {
+				saveModel(result.entity, result.model);
+			}
+			catch (const std::exception& e) {
+				std::cout << "[BDRecon] cannot save lod2 model - ";
+				std::cout << e.what() << std::endl;
+			}
+		}
+		dispToConsole("[BDRecon] LoD2 generation: " + engine.summary());
+	}
+	ReleaseCloudXYIndexes();
+
 	refreshAll();
 	UpdateUI();
 }
@@ -10,6 +10,7 @@
 #include <QImageReader>
 #include <QFileDialog>
 #include "FileIOFilter.h"
+#include "ccLog.h"
 #include <QDir>
 #include <QStringLiteral>
 
@@ -88,9 +89,11 @@ BDImageBaseHObject* GetRootImageBase(StHObject* obj) {
 StHObject* getChildGroupByName(StHObject* group, QString name, bool auto_create, bool add_to_db, bool keep_dir_hier)
 {
 	StHObject* find_obj = nullptr;
-	for (size_t i = 0; i < group->getChildrenNumber(); i++) {
-		StHObject* child = group->getChild(i);
-		if (child->isGroup() && child->getName() == name) {
+	//the (last) child group with this name (indexed lookup, see ccHObject::filterChildrenByName)
+	StHObject::Container children;
+	group->filterChildrenByName(children, false, name, true);
+	for (StHObject* child : children) {
+		if (child->isGroup()) {
 			find_obj = child;
 		}
 	}
@@ -774,6 +777,113 @@ bool BDBaseHObject::updateBuildUnits(bool use_existing_info)
 	return true;
 }
 
+bool PrepareBDReconProject(BDBaseHObject* bd_grp,
+	const stocker::BuilderOption& options,
+	const std::vector<stocker::BuildUnit>& build_data,
+	const std::vector<stocker::ImageUnit>& image_data)
+{
+	if (!bd_grp) return false;
+
+	bool has_global_shift = bd_grp->hasMetaData("global_shift");
+	bool has_global_scale = bd_grp->hasMetaData("global_scale");
+	if (has_global_shift) {
+		QString str = bd_grp->getMetaData("global_shift").toString();
+		char char_str[256]; sprintf(char_str, "%s", str.toStdString().c_str());
+		QStringList vecs = _splitStringQ(char_str, ";");
+		has_global_shift = vecs.size() == 3;
+		for (size_t i = 0; i < 3; i++) {
+			if (has_global_shift)
+				bd_grp->global_shift[i] = vecs[i].toDouble(&has_global_shift);
+			else break;
+		}
+	}
+	if (!has_global_shift) has_global_scale = false;
+	if (has_global_scale) {
+		bd_grp->global_scale = bd_grp->getMetaData("global_scale").toDouble(&has_global_scale);
+	}
+
+	bd_grp->m_options = options;
+	bd_grp->build_data = build_data;
+	bd_grp->image_data = image_data;
+
+	if (bd_grp->getPath().isEmpty()) {
+		bd_grp->setPath(QString::fromStdString(options.prj_file.root_dir));
+	}
+	if (!bd_grp->updateBuildUnits(true)) {
+		return false;
+	}
+			
+	if (!has_global_shift || !has_global_scale) {
+		ccHObject::Container point_clouds;
+		bd_grp->filterChildren(point_clouds, true, CC_TYPES::POINT_CLOUD, true);
+		if (!point_clouds.empty()) {
+			ccPointCloud* cloud = ccHObjectCaster::ToPointCloud(point_clouds.front());
+			if (cloud) {
+				bd_grp->global_shift = stocker::parse_xyz(cloud->getGlobalShift());
+				bd_grp->global_scale = cloud->getGlobalScale();
+				has_global_shift = true;
+				has_global_scale = true;
+				QVariantMap var_map;
+				QString global_shift_str;
+				global_shift_str.append(QString::number(bd_grp->global_shift.X())); global_shift_str.append(";");
+				global_shift_str.append(QString::number(bd_grp->global_shift.Y())); global_shift_str.append(";");
+				global_shift_str.append(QString::number(bd_grp->global_shift.Z())); global_shift_str.append(";");
+
+				var_map.insert("global_shift", QVariant(global_shift_str));
+				var_map.insert("global_scale", QVariant(bd_grp->global_scale));
+				bd_grp->setMetaData(var_map, true);
+			}
+		}
+	}
+
+	return true;
+}
+
+BDBaseHObject* LoadBDReconProjectBin(QString Filename)
+{
+	QFileInfo prj_file(Filename);
+	QString prj_name = prj_file.completeBaseName();
+	QString bin_file = prj_file.absolutePath() + "/" + prj_name + ".bin";
+	if (!QFileInfo(bin_file).exists()) {
+		ccLog::Warning("[BDRecon] project bin file not found: " + bin_file);
+		return nullptr;
+	}
+
+	std::string error_info; stocker::BuilderOption options;
+	if (!stocker::LoadProjectIni(Filename.toStdString(), options, error_info)) {
+		ccLog::Warning("[BDRecon] cannot load the project file: " + QString::fromStdString(error_info));
+		return nullptr;
+	}
+	std::vector<stocker::ImageUnit> image_data;
+	options.with_image = stocker::LoadBundleFiles(options.prj_file.image_list, options.prj_file.sfm_out, image_data);
+	std::vector<stocker::BuildUnit> build_data;
+	stocker::LoadBuildingListFile(build_data, options.prj_file.building_list);
+
+	FileIOFilter::LoadParameters parameters;
+	{
+		parameters.alwaysDisplayLoadDialog = false;
+		parameters.shiftHandlingMode = ccGlobalShiftManager::NO_DIALOG;
+		parameters.parentWidget = nullptr;
+	}
+	CC_FILE_ERROR result = CC_FERR_NO_ERROR;
+	ccHObject* newGroup = FileIOFilter::LoadFromFile(bin_file, parameters, result);
+	if (!newGroup) {
+		return nullptr;
+	}
+
+	BDBaseHObject* bd_grp = new BDBaseHObject(prj_name);
+	bd_grp->setMetaData(newGroup->metaData());
+	newGroup->transferChildren(*bd_grp);
+	delete newGroup;
+	newGroup = nullptr;
+
+	if (!PrepareBDReconProject(bd_grp, options, build_data, image_data)) {
+		delete bd_grp;
+		return nullptr;
+	}
+	return bd_grp;
+}
+
 StHObject* findChildByName(StHObject* parent,
 	bool recursive,
 	QString filter,
@@ -816,18 +926,8 @@ int GetNumberExcludePrefix(StHObject * obj, QString prefix, CC_CLASS_ENUM type)
 int GetMaxNumberExcludeChildPrefix(StHObject * obj, QString prefix, CC_CLASS_ENUM type)
 {
 	if (!obj) { return -1; }
-	set<int> name_numbers;
-	for (size_t i = 0; i < obj->getChildrenNumber(); i++) {
-		QString name = obj->getChild(i)->getName();
-		int number = GetNumberExcludePrefix(obj->getChild(i), prefix, type);
-		if (number >= 0) {
-			name_numbers.insert(number);
-		}
-	}
-	if (!name_numbers.empty()) {
-		return *name_numbers.rbegin();
-	}
-	return -1;
+	//the numbers are cached per prefix (see ccHObject::getMaxChildNumber)
+	return obj->getMaxChildNumber(prefix, type);
 }
 
 QString GetNextChildName(StHObject * parent, QString prefix, CC_CLASS_ENUM type)
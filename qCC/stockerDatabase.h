@@ -269,6 +269,14 @@ QString getBlockPathByCloudPath(QString cloud_path);
 
 DataBaseHObject* GetRootDataBase(StHObject* obj);
 BDBaseHObject* GetRootBDBase(StHObject* obj);
+
+//! Prepares a building project (global shift and scale, building units, etc.)
+bool PrepareBDReconProject(BDBaseHObject* bd_grp,
+	const stocker::BuilderOption& options,
+	const std::vector<stocker::BuildUnit>& build_data,
+	const std::vector<stocker::ImageUnit>& image_data);
+//! Loads a building project from its saved BIN file (without GUI, see MainWindow::LoadBDReconProject)
+BDBaseHObject* LoadBDReconProjectBin(QString Filename);
 BDImageBaseHObject* GetRootImageBase(StHObject* obj);
 
 StHObject* getChildGroupByName(StHObject* group, QString name, bool auto_create = false, bool add_to_db = false, bool keep_dir_hier = false);
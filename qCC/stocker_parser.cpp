@@ -12,8 +12,20 @@
 #include "QFileInfo"
 #include <QImageReader>
 #include <QFileDialog>
+#include <QMutex>
 #include "FileIOFilter.h"
 
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 #ifdef USE_STOCKER
 #include "builderlod2/lod2parser.h"
 #include "builderpoly/builderpoly.h"
@@ -170,6 +182,445 @@ double GetPointsAverageSpacing(ccHObject * pc)
 	return points_local.size() >= 3 ? stocker::ComputeAverageSpacing3f(points_local, true) : 0.0f;
 }
 
+//! 2D grid index of a point cloud XY footprint (to speed up the point-in-polygon queries)
+/** The point indexes are sorted by cell (CSR layout). **/
+struct CloudXYIndex
+{
+	//! Number of points of the indexed cloud (to detect changes)
+	unsigned pointCount = 0;
+	//! Bounding-box of the indexed cloud (to detect changes)
+	CCVector3 bbMin, bbMax;
+	//! Grid origin (X)
+	double minX = 0;
+	//! Grid origin (Y)
+	double minY = 0;
+	//! Cell size
+	double cellSize = 1.0;
+	//! Grid width
+	unsigned width = 0;
+	//! Grid height
+	unsigned height = 0;
+	//! Index of the first point of each cell in 'pointIndexes' (width * height + 1 values)
+	std::vector<unsigned> cellStart;
+	//! Point indexes (sorted by cell)
+	std::vector<unsigned> pointIndexes;
+
+	//! Returns the column of a given X coordinate (clamped)
+	inline unsigned col(double x) const
+	{
+		double i = floor((x - minX) / cellSize);
+		return (i <= 0 ? 0 : std::min(static_cast<unsigned>(i), width - 1));
+	}
+	//! Returns the row of a given Y coordinate (clamped)
+	inline unsigned row(double y) const
+	{
+		double j = floor((y - minY) / cellSize);
+		return (j <= 0 ? 0 : std::min(static_cast<unsigned>(j), height - 1));
+	}
+
+	//! Returns whether the index is still valid for a given cloud (same size and bounding-box)
+	bool isValidFor(ccPointCloud& cloud) const
+	{
+		if (cloud.size() != pointCount)
+		{
+			return false;
+		}
+		ccBBox box = cloud.getOwnBB();
+		if (!box.isValid())
+		{
+			return false;
+		}
+		const CCVector3& minCorner = box.minCorner();
+		const CCVector3& maxCorner = box.maxCorner();
+		return	minCorner.x == bbMin.x && minCorner.y == bbMin.y && minCorner.z == bbMin.z
+			&&	maxCorner.x == bbMax.x && maxCorner.y == bbMax.y && maxCorner.z == bbMax.z;
+	}
+
+	//! Builds the index
+	bool build(ccPointCloud& cloud)
+	{
+		pointCount = cloud.size();
+		ccBBox box = cloud.getOwnBB();
+		if (pointCount == 0 || !box.isValid())
+		{
+			return false;
+		}
+		bbMin = box.minCorner();
+		bbMax = box.maxCorner();
+
+		//~32 points per cell (with a maximum of 8192 x 8192 cells)
+		static const unsigned s_targetPointsPerCell = 32;
+		static const unsigned s_maxGridSize = 8192;
+		double dx = std::max(static_cast<double>(bbMax.x - bbMin.x), 1.0e-6);
+		double dy = std::max(static_cast<double>(bbMax.y - bbMin.y), 1.0e-6);
+		double targetCellCount = std::max(1.0, static_cast<double>(pointCount) / s_targetPointsPerCell);
+		cellSize = std::sqrt(dx * dy / targetCellCount);
+		cellSize = std::max(cellSize, std::max(dx, dy) / s_maxGridSize);
+		minX = bbMin.x;
+		minY = bbMin.y;
+		width = std::max(1u, std::min(s_maxGridSize, static_cast<unsigned>(ceil(dx / cellSize))));
+		height = std::max(1u, std::min(s_maxGridSize, static_cast<unsigned>(ceil(dy / cellSize))));
+
+		try
+		{
+			cellStart.clear();
+			cellStart.resize(static_cast<size_t>(width) * height + 1, 0);
+			pointIndexes.resize(pointCount);
+		}
+		catch (const std::bad_alloc&)
+		{
+			cellStart.clear();
+			pointIndexes.clear();
+			return false;
+		}
+
+		//count the points per cell
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			const CCVector3* P = cloud.getPoint(i);
+			++cellStart[static_cast<size_t>(row(P->y)) * width + col(P->x) + 1];
+		}
+		for (size_t c = 1; c < cellStart.size(); ++c)
+		{
+			cellStart[c] += cellStart[c - 1];
+		}
+
+		//sort the point indexes by cell
+		std::vector<unsigned> fillPos(cellStart.begin(), cellStart.end() - 1);
+		for (unsigned i = 0; i < pointCount; ++i)
+		{
+			const CCVector3* P = cloud.getPoint(i);
+			pointIndexes[fillPos[static_cast<size_t>(row(P->y)) * width + col(P->x)]++] = i;
+		}
+
+		return true;
+	}
+
+	//! Returns the memory used by the index (in bytes)
+	inline size_t memSize() const
+	{
+		return (cellStart.capacity() + pointIndexes.capacity()) * sizeof(unsigned);
+	}
+};
+
+//! Watches an indexed cloud (see GetCloudXYIndex)
+/** The cloud notifies its updates and its deletion to this object (thanks to the
+	ccHObject dependency mechanism) so that its cached XY index can be invalidated.
+**/
+class CloudXYIndexWatcher : public ccHObject
+{
+public:
+	//! Default constructor
+	explicit CloudXYIndexWatcher(ccPointCloud* cloud)
+		: ccHObject("XY index watcher")
+		, m_cloud(cloud)
+		, m_cloudID(cloud->getUniqueID())
+		, m_updateCount(0)
+	{
+		m_cloud->addDependency(this, DP_NOTIFY_OTHER_ON_DELETE | DP_NOTIFY_OTHER_ON_UPDATE);
+	}
+
+	//! Destructor
+	~CloudXYIndexWatcher() override
+	{
+		if (m_cloud)
+		{
+			m_cloud->removeDependencyWith(this);
+		}
+	}
+
+	//! Returns the number of updates of the cloud since this watcher creation
+	inline unsigned updateCount() const { return m_updateCount; }
+
+	//inherited from ccHObject
+	void onUpdateOf(ccHObject* obj) override
+	{
+		if (obj == m_cloud)
+		{
+			++m_updateCount;
+		}
+	}
+	void onDeletionOf(const ccHObject* obj) override;
+
+protected:
+	//! Watched cloud (or null if it has been deleted)
+	ccHObject* m_cloud;
+	//! Unique ID of the watched cloud
+	unsigned m_cloudID;
+	//! Number of updates of the cloud
+	std::atomic<unsigned> m_updateCount;
+};
+
+//! Cached XY index
+struct CloudXYIndexEntry
+{
+	//! Index (or null if the cloud has been deleted)
+	std::shared_ptr<const CloudXYIndex> index;
+	//! Watcher of the indexed cloud
+	std::unique_ptr<CloudXYIndexWatcher> watcher;
+	//! Number of updates of the cloud when the index was built
+	unsigned updateCount = 0;
+	//! Position in the LRU list
+	std::list<unsigned>::iterator lruPos;
+};
+
+//! Cached XY indexes (by cloud unique ID)
+static std::map<unsigned, CloudXYIndexEntry> s_cloudXYIndexes;
+//! Cached XY indexes unique IDs (least recently used first)
+static std::list<unsigned> s_cloudXYIndexesLRU;
+//! Memory used by the cached XY indexes (in bytes)
+static size_t s_cloudXYIndexesMemory = 0;
+//! Max memory used by the cached XY indexes (in bytes)
+static const size_t s_maxCloudXYIndexesMemory = (static_cast<size_t>(256) << 20);
+//! Min number of points to index a cloud (below, testing all the points is as fast)
+static const unsigned s_minCloudXYIndexSize = 16384;
+//! Mutex for concurrent access to the cached XY indexes
+static QMutex s_cloudXYIndexesMutex;
+
+//! Removes a cached XY index (the mutex must be locked)
+static void EraseCloudXYIndex(std::map<unsigned, CloudXYIndexEntry>::iterator it)
+{
+	if (it->second.index)
+	{
+		s_cloudXYIndexesMemory -= it->second.index->memSize();
+	}
+	s_cloudXYIndexesLRU.erase(it->second.lruPos);
+	//deletes the watcher as well (which removes its dependency with the cloud)
+	s_cloudXYIndexes.erase(it);
+}
+
+void CloudXYIndexWatcher::onDeletionOf(const ccHObject* obj)
+{
+	ccHObject::onDeletionOf(obj);
+
+	if (obj == m_cloud)
+	{
+		//we release the index right away, but we can't delete the watcher
+		//here as the cloud is still iterating over its dependencies
+		QMutexLocker locker(&s_cloudXYIndexesMutex);
+		m_cloud = nullptr;
+		auto it = s_cloudXYIndexes.find(m_cloudID);
+		if (it != s_cloudXYIndexes.end() && it->second.index)
+		{
+			s_cloudXYIndexesMemory -= it->second.index->memSize();
+			it->second.index.reset();
+		}
+	}
+}
+
+//! Returns the (cached) XY index of a cloud (or builds it if necessary)
+/** Returns null if the cloud is too small to be worth indexing (or if there's not
+	enough memory). The least recently used indexes are released when the cache
+	exceeds its memory budget.
+**/
+static std::shared_ptr<const CloudXYIndex> GetCloudXYIndex(ccPointCloud* cloud)
+{
+	if (cloud->size() < s_minCloudXYIndexSize)
+	{
+		return nullptr;
+	}
+
+	QMutexLocker locker(&s_cloudXYIndexesMutex);
+
+	auto it = s_cloudXYIndexes.find(cloud->getUniqueID());
+	if (it != s_cloudXYIndexes.end())
+	{
+		const CloudXYIndexEntry& entry = it->second;
+		if (	entry.index
+			&&	entry.updateCount == entry.watcher->updateCount()
+			&&	entry.index->isValidFor(*cloud))
+		{
+			//most recently used
+			s_cloudXYIndexesLRU.splice(s_cloudXYIndexesLRU.end(), s_cloudXYIndexesLRU, entry.lruPos);
+			return entry.index;
+		}
+		//the cloud has changed
+		EraseCloudXYIndex(it);
+	}
+
+	//remove the entries of the deleted clouds
+	for (it = s_cloudXYIndexes.begin(); it != s_cloudXYIndexes.end();)
+	{
+		if (it->second.index)
+		{
+			++it;
+		}
+		else
+		{
+			EraseCloudXYIndex(it++);
+		}
+	}
+
+	std::shared_ptr<CloudXYIndex> index;
+	std::unique_ptr<CloudXYIndexWatcher> watcher;
+	try
+	{
+		index = std::make_shared<CloudXYIndex>();
+		watcher.reset(new CloudXYIndexWatcher(cloud));
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+	if (!index->build(*cloud))
+	{
+		return nullptr;
+	}
+
+	//release the least recently used indexes to stay below the memory budget
+	size_t memSize = index->memSize();
+	while (!s_cloudXYIndexesLRU.empty() && s_cloudXYIndexesMemory + memSize > s_maxCloudXYIndexesMemory)
+	{
+		EraseCloudXYIndex(s_cloudXYIndexes.find(s_cloudXYIndexesLRU.front()));
+	}
+
+	CloudXYIndexEntry& entry = s_cloudXYIndexes[cloud->getUniqueID()];
+	entry.index = index;
+	entry.updateCount = watcher->updateCount();
+	entry.watcher = std::move(watcher);
+	entry.lruPos = s_cloudXYIndexesLRU.insert(s_cloudXYIndexesLRU.end(), cloud->getUniqueID());
+	s_cloudXYIndexesMemory += memSize;
+
+	return index;
+}
+
+void ReleaseCloudXYIndexes()
+{
+	QMutexLocker locker(&s_cloudXYIndexesMutex);
+	//deletes the watchers as well
+	s_cloudXYIndexes.clear();
+	s_cloudXYIndexesLRU.clear();
+	s_cloudXYIndexesMemory = 0;
+}
+
+//! Extracts the points of a cloud inside a 2D polygon thanks to its XY index
+/** Only the cells intersecting the polygon bounding-box are visited. The cell rows are
+	processed in parallel (if allowed) and the points are returned in the cells order.
+**/
+static stocker::Contour3d GetPointsInsidePolygonXY(	const ccPointCloud& cloud,
+													const CloudXYIndex& index,
+													const std::vector<vcg::Segment2d>& polygon_2d,
+													bool filterHeight,
+													double min_height,
+													double max_height,
+													bool parallel)
+{
+	stocker::Contour3d points;
+	if (polygon_2d.empty())
+	{
+		return points;
+	}
+
+	//polygon bounding-box
+	double polyMinX = DBL_MAX, polyMinY = DBL_MAX, polyMaxX = -DBL_MAX, polyMaxY = -DBL_MAX;
+	for (const vcg::Segment2d& seg : polygon_2d)
+	{
+		polyMinX = std::min(polyMinX, std::min(seg.P0().X(), seg.P1().X()));
+		polyMaxX = std::max(polyMaxX, std::max(seg.P0().X(), seg.P1().X()));
+		polyMinY = std::min(polyMinY, std::min(seg.P0().Y(), seg.P1().Y()));
+		polyMaxY = std::max(polyMaxY, std::max(seg.P0().Y(), seg.P1().Y()));
+	}
+	if (	polyMaxX < index.bbMin.x || polyMinX > index.bbMax.x
+		||	polyMaxY < index.bbMin.y || polyMinY > index.bbMax.y)
+	{
+		//no intersection
+		return points;
+	}
+
+	unsigned col0 = index.col(polyMinX), col1 = index.col(polyMaxX);
+	unsigned row0 = index.row(polyMinY), row1 = index.row(polyMaxY);
+
+	std::vector<stocker::Contour3d> rowPoints(row1 - row0 + 1);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic) if(parallel)
+#endif
+	for (int r = static_cast<int>(row0); r <= static_cast<int>(row1); ++r)
+	{
+		stocker::Contour3d& currentPoints = rowPoints[r - row0];
+		size_t firstCell = static_cast<size_t>(r) * index.width + col0;
+		size_t lastCell = static_cast<size_t>(r) * index.width + col1;
+		for (unsigned k = index.cellStart[firstCell]; k < index.cellStart[lastCell + 1]; ++k)
+		{
+			const CCVector3* pt = cloud.getPoint(index.pointIndexes[k]);
+			if (pt->x < polyMinX || pt->x > polyMaxX || pt->y < polyMinY || pt->y > polyMaxY)
+			{
+				continue;
+			}
+			if (filterHeight && (pt->z >= max_height || pt->z <= min_height))
+			{
+				continue;
+			}
+			if (vcg::PointInsidePolygon({ pt->x, pt->y }, polygon_2d))
+			{
+				currentPoints.push_back({ pt->x, pt->y, pt->z });
+			}
+		}
+	}
+
+	size_t count = 0;
+	for (const stocker::Contour3d& pts : rowPoints)
+	{
+		count += pts.size();
+	}
+	points.reserve(count);
+	for (const stocker::Contour3d& pts : rowPoints)
+	{
+		points.insert(points.end(), pts.begin(), pts.end());
+	}
+
+	return points;
+}
+
+//! Extracts the points of a cloud inside a 2D polygon by testing all the points
+/** Used for the clouds without XY index. The points are returned in the cloud order. **/
+static stocker::Contour3d GetPointsInsidePolygonXY(	const ccPointCloud& cloud,
+													const std::vector<vcg::Segment2d>& polygon_2d,
+													bool filterHeight,
+													double min_height,
+													double max_height,
+													bool parallel)
+{
+	std::vector<stocker::Contour3d> threadPoints(1);
+#if defined(_OPENMP)
+	if (parallel) {
+		threadPoints.resize(omp_get_max_threads());
+	}
+#pragma omp parallel for schedule(static) if(parallel)
+#endif
+	for (int i = 0; i < static_cast<int>(cloud.size()); ++i) {
+		const CCVector3* pt = cloud.getPoint(i);
+		if (filterHeight && (pt->z >= max_height || pt->z <= min_height)) {
+			continue;
+		}
+		if (vcg::PointInsidePolygon({ pt->x, pt->y }, polygon_2d)) {
+#if defined(_OPENMP)
+			threadPoints[parallel ? omp_get_thread_num() : 0].push_back({ pt->x, pt->y, pt->z });
+#else
+			threadPoints[0].push_back({ pt->x, pt->y, pt->z });
+#endif
+		}
+	}
+
+	stocker::Contour3d points;
+	for (const stocker::Contour3d& pts : threadPoints) {
+		points.insert(points.end(), pts.begin(), pts.end());
+	}
+	return points;
+}
+
+//! Converts a 3D polygon to 2D segments (and returns its min height)
+static std::vector<vcg::Segment2d> ToPolygon2d(const stocker::Polyline3d& polygon, double& min_polygon_height)
+{
+	std::vector<vcg::Segment2d> polygon_2d;
+	min_polygon_height = DBL_MAX;
+	for (auto & seg : polygon) {
+		polygon_2d.push_back(vcg::Segment2d(ToVec2d(seg.P0()), ToVec2d(seg.P1())));
+		if (seg.P0().Z() < min_polygon_height) { min_polygon_height = seg.P0().Z(); }
+		if (seg.P1().Z() < min_polygon_height) { min_polygon_height = seg.P1().Z(); }
+	}
+	return polygon_2d;
+}
+
 stocker::Contour3d GetPointsFromCloudInsidePolygonXY(ccHObject* entity, stocker::Polyline3d polygon, double height)
 {	
 	stocker::Contour3d points;
@@ -196,34 +647,55 @@ stocker::Contour3d GetPointsFromCloudInsidePolygonXY(ccHObject* entity, stocker:
 	ccPointCloud* cloud = ccHObjectCaster::ToPointCloud(entity);
 	if (!cloud) return points;	
 
-	std::vector<vcg::Segment2d> polygon_2d;
 	double min_polygon_height = DBL_MAX;
-	for (auto & seg : polygon) {
-		polygon_2d.push_back(vcg::Segment2d(ToVec2d(seg.P0()), ToVec2d(seg.P1())));
-		if (seg.P0().Z() < min_polygon_height) { min_polygon_height = seg.P0().Z(); }
-		if (seg.P1().Z() < min_polygon_height) { min_polygon_height = seg.P1().Z(); }
+	std::vector<vcg::Segment2d> polygon_2d = ToPolygon2d(polygon, min_polygon_height);
+
+	//only the cells of the (cached) XY index that intersect the polygon are visited
+	std::shared_ptr<const CloudXYIndex> index = GetCloudXYIndex(cloud);
+	if (index) {
+		return GetPointsInsidePolygonXY(*cloud, *index, polygon_2d, height > min_polygon_height, min_polygon_height, height, true);
 	}
-	
-	Concurrency::concurrent_vector<Vec3d> points_parallel;
-	if (height > min_polygon_height) {
-		Concurrency::parallel_for((size_t)0, (size_t)cloud->size(), [&](size_t i) {
-			CCVector3 pt = *cloud->getPoint(i);
-			if (vcg::PointInsidePolygon({ pt.x,pt.y }, polygon_2d) && pt.z < height && pt.z > min_polygon_height) {
-				points_parallel.push_back({ pt.x, pt.y, pt.z });
-			}
-		});
+
+	//small cloud (or not enough memory to build the index): we test all the points
+	return GetPointsInsidePolygonXY(*cloud, polygon_2d, height > min_polygon_height, min_polygon_height, height, cloud->size() >= s_minCloudXYIndexSize);
+}
+
+std::vector<stocker::Contour3d> GetPointsFromCloudInsideEachPolygonXY(ccHObject* entity, const std::vector<stocker::Polyline3d>& polygons, double height)
+{
+	std::vector<stocker::Contour3d> all_points(polygons.size());
+
+	ccPointCloud* cloud = entity && entity->isA(CC_TYPES::POINT_CLOUD) ? ccHObjectCaster::ToPointCloud(entity) : nullptr;
+	if (!cloud) {
+		//not a single cloud
+		for (size_t i = 0; i < polygons.size(); ++i) {
+			all_points[i] = GetPointsFromCloudInsidePolygonXY(entity, polygons[i], height);
+		}
+		return all_points;
 	}
-	else {
-		Concurrency::parallel_for((size_t)0, (size_t)cloud->size(), [&](size_t i) {
-			CCVector3 pt = *cloud->getPoint(i);
-			if (vcg::PointInsidePolygon({ pt.x,pt.y }, polygon_2d)) {
-				points_parallel.push_back({ pt.x, pt.y, pt.z });
-			}
-		});
+	std::shared_ptr<const CloudXYIndex> index = GetCloudXYIndex(cloud);
+
+	//the polygons are processed in parallel
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int i = 0; i < static_cast<int>(polygons.size()); ++i) {
+		if (polygons[i].empty()) {
+			continue;
+		}
+		double min_polygon_height = DBL_MAX;
+		std::vector<vcg::Segment2d> polygon_2d = ToPolygon2d(polygons[i], min_polygon_height);
+		all_points[i] = index	? GetPointsInsidePolygonXY(*cloud, *index, polygon_2d, height > min_polygon_height, min_polygon_height, height, false)
+								: GetPointsInsidePolygonXY(*cloud, polygon_2d, height > min_polygon_height, min_polygon_height, height, false);
 	}
-	
-	points.assign(points_parallel.begin(), points_parallel.end());
-	return points;
+
+	//empty polygons = all points
+	for (size_t i = 0; i < polygons.size(); ++i) {
+		if (polygons[i].empty()) {
+			all_points[i] = GetPointsFromCloud3d(entity);
+		}
+	}
+
+	return all_points;
 }
 
 std::vector<stocker::Contour3d> GetPointsFromCloudInsidePolygonsXY(ccHObject::Container entities, stocker::Polyline3d polygon, double height, bool skip_empty)
@@ -1166,6 +1638,9 @@ ccHObject::Container CalcPlaneIntersections(ccHObject::Container entity_planes,
 {
 #ifdef USE_STOCKER
 	stocker::PlaneData plane_units;
+	//bounding-box of each plane points (inflated by the distance threshold)
+	std::vector<ccBBox> plane_boxes;
+	CCVector3 margin = CCVector3(1, 1, 1) * static_cast<PointCoordinateType>(std::max(distance, 0.0) + 1.0e-6);
 	for (size_t i = 0; i < entity_planes.size(); i++) {
 		if (!entity_planes[i]->isEnabled()) continue;
 
@@ -1174,20 +1649,66 @@ ccHObject::Container CalcPlaneIntersections(ccHObject::Container entity_planes,
 
 		char name[32]; sprintf(name, "%d", i);
 		plane_units.push_back(FormPlaneUnit(cur_plane_points, name, true));
+
+		ccBBox box;
+		for (auto & pt : cur_plane_points) {
+			box.add(CCVector3(static_cast<PointCoordinateType>(pt.X()), static_cast<PointCoordinateType>(pt.Y()), static_cast<PointCoordinateType>(pt.Z())));
+		}
+		box.minCorner() -= margin;
+		box.maxCorner() += margin;
+		plane_boxes.push_back(box);
 	}
 	//////////////////////////////////////////////////////////////////////////
+	//candidate pairs: the (strict) intersection of two planes can only exist if their
+	//bounding-boxes overlap (sweep and prune along X)
+	std::vector<std::pair<size_t, size_t>> candidate_pairs;
+	{
+		std::vector<size_t> sorted_planes(plane_units.size());
+		for (size_t i = 0; i < sorted_planes.size(); i++) {
+			sorted_planes[i] = i;
+		}
+		std::sort(sorted_planes.begin(), sorted_planes.end(), [&](size_t l, size_t r) {
+			return plane_boxes[l].minCorner().x < plane_boxes[r].minCorner().x;
+		});
+		for (size_t a = 0; a < sorted_planes.size(); a++) {
+			const ccBBox& box_a = plane_boxes[sorted_planes[a]];
+			for (size_t b = a + 1; b < sorted_planes.size(); b++) {
+				const ccBBox& box_b = plane_boxes[sorted_planes[b]];
+				if (box_b.minCorner().x > box_a.maxCorner().x) {
+					break; //no other box can overlap along X
+				}
+				if (	box_b.minCorner().y > box_a.maxCorner().y || box_b.maxCorner().y < box_a.minCorner().y
+					||	box_b.minCorner().z > box_a.maxCorner().z || box_b.maxCorner().z < box_a.minCorner().z) {
+					continue;
+				}
+				candidate_pairs.emplace_back(std::min(sorted_planes[a], sorted_planes[b]), std::max(sorted_planes[a], sorted_planes[b]));
+			}
+		}
+		//same order as the exhaustive search
+		std::sort(candidate_pairs.begin(), candidate_pairs.end());
+	}
+
+	//the candidate pairs are processed in parallel
+	std::vector<stocker::Seg3d> pair_ints(candidate_pairs.size());
+	std::vector<char> pair_valid(candidate_pairs.size(), 0);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int k = 0; k < static_cast<int>(candidate_pairs.size()); k++) {
+		const std::pair<size_t, size_t>& pair = candidate_pairs[k];
+		pair_valid[k] = stocker::IntersectionPlanePlaneStrict(plane_units[pair.first], plane_units[pair.second], pair_ints[k], distance) ? 1 : 0;
+	}
+
 	stocker::Polyline3d ints_all; vector<stocker::Polyline3d> ints_per_plane;
 	ints_per_plane.resize(plane_units.size());
-	for (size_t i = 0; i < plane_units.size() - 1; i++) {
-		for (size_t j = i + 1; j < plane_units.size(); j++) {
-			stocker::Seg3d cur_ints;
-			if (!stocker::IntersectionPlanePlaneStrict(plane_units[i], plane_units[j], cur_ints, distance))
-				continue;
+	for (size_t k = 0; k < candidate_pairs.size(); k++) {
+		if (!pair_valid[k])
+			continue;
 
-			ints_per_plane[i].push_back(cur_ints);
-			ints_per_plane[j].push_back(cur_ints);
-			ints_all.push_back(cur_ints);
-		}
+		const stocker::Seg3d& cur_ints = pair_ints[k];
+		ints_per_plane[candidate_pairs[k].first].push_back(cur_ints);
+		ints_per_plane[candidate_pairs[k].second].push_back(cur_ints);
+		ints_all.push_back(cur_ints);
 	}
 	//////////////////////////////////////////////////////////////////////////
 	ccHObject::Container segs_add;
@@ -1615,6 +2136,30 @@ bool FastPlanarTextureMapping(ccHObject* planeObj)
 	return true;
 }
 
+//! Returns the indices of the images seen by a building
+static IndexVector GetVisibleImageIndices(const BuildUnit* build_unit, const std::unordered_map<std::string, size_t>& image_indices)
+{
+	IndexVector visImageIndice;
+	for (const std::string& img_name : build_unit->image_list) {
+		auto img_iter = image_indices.find(img_name);
+		if (img_iter != image_indices.end()) {
+			visImageIndice.push_back(img_iter->second);
+		}
+	}
+	return visImageIndice;
+}
+
+//! Indexes the images by name (the first image wins if several images share the same name)
+static std::unordered_map<std::string, size_t> IndexImagesByName(const std::vector<stocker::ImageUnit>& image_units)
+{
+	std::unordered_map<std::string, size_t> image_indices;
+	image_indices.reserve(image_units.size());
+	for (size_t i = 0; i < image_units.size(); ++i) {
+		image_indices.emplace(image_units[i].GetName().Str(), i);
+	}
+	return image_indices;
+}
+
 bool TextureMappingBuildings(ccHObject::Container buildings, ccHObject::Container cameras,
 	stocker::IndexVector* task_indices, double refine_length, double sampling_grid, int max_view, bool skip_nonexist)
 {
@@ -1627,65 +2172,101 @@ bool TextureMappingBuildings(ccHObject::Container buildings, ccHObject::Containe
 	
 	std::vector<stocker::ImageUnit> image_units_temp = baseObj->GetImageData();
 
-	std::vector<stocker::ImageUnit> image_units;
-	
-	for (stocker::ImageUnit & image_unit : image_units_temp) {
-		if (!cameras.empty()) {
-			auto cam_find = std::find_if(cameras.begin(), cameras.end(), [=](ccHObject* cam) {
-				return cam->getName().toStdString() == image_unit.GetName().Str();
-			});
-			if (cam_find == cameras.end()) {
-				continue;
+	//! filter the images (selected cameras, existing files)
+	std::unordered_set<std::string> camera_names;
+	for (ccHObject* cam : cameras) {
+		camera_names.insert(cam->getName().toStdString());
+	}
+	std::vector<char> image_valid(image_units_temp.size(), 1);
+	if (!camera_names.empty()) {
+		for (size_t i = 0; i < image_units_temp.size(); ++i) {
+			if (camera_names.find(image_units_temp[i].GetName().Str()) == camera_names.end()) {
+				image_valid[i] = 0;
+			}
+		}
+	}
+	if (skip_nonexist) {
+		//the file system checks are the slow part (network drives, etc.)
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int i = 0; i < static_cast<int>(image_units_temp.size()); ++i) {
+			if (image_valid[i] && !IsExist(image_units_temp[i].m_path.c_str())) {
+				image_valid[i] = 0;
 			}
 		}
+	}
 
-		if (skip_nonexist && !IsExist(image_unit.m_path.c_str())) {
+	std::vector<stocker::ImageUnit> image_units;
+	for (size_t i = 0; i < image_units_temp.size(); ++i) {
+		if (!image_valid[i]) {
 			continue;
 		}
+		stocker::ImageUnit& image_unit = image_units_temp[i];
 		Vec3d view_pos = image_unit.GetViewPos();
 		image_unit.m_camera.SetViewPoint((view_pos + baseObj->global_shift)*baseObj->global_scale);
 
 		image_units.push_back(image_unit);
 	}
 	texture_mapping.setImages(image_units);
-	//! collect polygons, roof and facade
+	std::unordered_map<std::string, size_t> image_indices = IndexImagesByName(image_units);
+
+	//! collect the blocks (the DB tree is only accessed here)
+	std::vector<BuildUnit*> build_units;
+	std::vector<ccHObject::Container> building_blocks;
 	for (ccHObject* entity : buildings) {
 		StBuilding* bdObj = ccHObjectCaster::ToStBuilding(entity);
 		if (!bdObj) continue;
 
 		BuildUnit* build_unit = baseObj->GetBuildingSp(bdObj->getName().toStdString());
 		if (!build_unit) { continue; }
-		StBlockGroup* bdGroup = baseObj->GetBlockGroup(bdObj->getName());
+
+		//the block group is a direct child of the building (no need to search the whole project)
+		StBlockGroup* bdGroup = nullptr;
+		QString groupName = bdObj->getName() + BDDB_BLOCKGROUP_SUFFIX;
+		for (unsigned ci = 0; ci < bdObj->getChildrenNumber(); ++ci) {
+			ccHObject* child = bdObj->getChild(ci);
+			if (child->isA(CC_TYPES::ST_BLOCKGROUP) && child->getName() == groupName) {
+				bdGroup = ccHObjectCaster::ToStBlockGroup(child);
+				break;
+			}
+		}
+		if (!bdGroup) bdGroup = baseObj->GetBlockGroup(bdObj->getName());
 		if (!bdGroup) continue;
 		ccHObject::Container blocks = GetEnabledObjFromGroup(bdGroup, CC_TYPES::ST_BLOCK, true, true);
 		if (blocks.empty()) { continue; }
 
+		build_units.push_back(build_unit);
+		building_blocks.push_back(blocks);
+	}
+
+	//! collect polygons, roof and facade (the buildings are independent)
+	std::vector<std::vector<stocker::Polygon3d>> building_walls(build_units.size());
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int bi = 0; bi < static_cast<int>(build_units.size()); ++bi) {
 		/// walls
-		std::vector<stocker::Polygon3d> wall_polygons;
-		for (ccHObject* blockEnt : blocks) {
+		std::vector<stocker::Polygon3d>& wall_polygons = building_walls[bi];
+		for (ccHObject* blockEnt : building_blocks[bi]) {
 			StBlock* blockObj = ccHObjectCaster::ToStBlock(blockEnt); assert(blockObj);
 			std::vector<std::vector<CCVector3>> cur_wall_polys;
 			if (!blockObj->getWallPolygons(cur_wall_polys)) continue;
 			assert(cur_wall_polys.size() >= 5);
 						
-			for (auto poly : cur_wall_polys) {
+			for (const auto& poly : cur_wall_polys) {
 				stocker::Contour3d poly_points = ccToPoints3<CCVector3, stocker::Vec3d>(poly);
 				stocker::Polygon3d polygon = MakeLoopPolylinefromContour(poly_points);
 				wall_polygons.push_back(polygon);
 			}
 		}
+	}
 
+	//! the meshes are added in the same order as before (see task_indices)
+	for (size_t bi = 0; bi < build_units.size(); ++bi) {
 		/// vis images
-		IndexVector visImageIndice;
-		for (auto img_name : build_unit->image_list) {
-			auto img_iter = std::find_if(image_units.begin(), image_units.end(), [=](ImageUnit img) {
-				return img_name == img.GetName().Str();
-			});
-			if (img_iter != image_units.end()) {
-				visImageIndice.push_back(std::distance(image_units.begin(), img_iter));
-			}
-		}
-		texture_mapping.addMesh(wall_polygons, visImageIndice, build_unit->file_path.model_dir);
+		IndexVector visImageIndice = GetVisibleImageIndices(build_units[bi], image_indices);
+		texture_mapping.addMesh(building_walls[bi], visImageIndice, build_units[bi]->file_path.model_dir);
 	}
 
 	if (task_indices) {
@@ -1724,39 +2305,47 @@ bool TextureMappingPlanes(ccHObject::Container primObjs, stocker::IndexVector *
 		image_unit.m_camera.SetViewPoint(view_pos + baseObj->global_shift);
 	}
 	texture_mapping.setImages(image_units);
+	std::unordered_map<std::string, size_t> image_indices = IndexImagesByName(image_units);
+
+	//! resolve the buildings (the DB tree is only accessed here)
+	std::vector<BuildUnit*> prim_build_units(primObjs.size(), nullptr);
+	for (size_t pi = 0; pi < primObjs.size(); ++pi) {
+		StBuilding* bdObj = GetParentBuilding(primObjs[pi]);
+		if (!bdObj) continue;
+		prim_build_units[pi] = baseObj->GetBuildingSp(bdObj->getName().toStdString());
+	}
+
+	//! the outlines of the primitives are independent
+	std::vector<std::vector<stocker::Outline3d>> prim_outlines(primObjs.size());
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int pi = 0; pi < static_cast<int>(primObjs.size()); ++pi) {
+		if (prim_build_units[pi]) {
+			prim_outlines[pi] = GetPlanarOutlines(primObjs[pi], BDDB_PLANEFRAME_PREFIX);
+		}
+	}
 
 	//! should parse the task indices
-	stocker::IndexVector ori_task_indices;
-	if (task_indices) ori_task_indices = *task_indices;
+	std::unordered_set<size_t> ori_task_indices;
+	if (task_indices) ori_task_indices.insert(task_indices->begin(), task_indices->end());
 	stocker::IndexVector parse_task_indices;
 	size_t task_count(0);
 	for (size_t pi = 0; pi < primObjs.size(); ++pi) {
 		ccHObject* prim_entity = primObjs[pi];
-		
-
-	 	StBuilding* bdObj = GetParentBuilding(prim_entity);
-		if (!bdObj) continue;
-		BuildUnit* build_unit = baseObj->GetBuildingSp(bdObj->getName().toStdString());
+		BuildUnit* build_unit = prim_build_units[pi];
 		if (!build_unit) continue;
 		/// vis images
-		IndexVector visImageIndice;
-		for (auto img_name : build_unit->image_list) {
-			auto img_iter = std::find_if(image_units.begin(), image_units.end(), [=](ImageUnit img) {
-				return img_name == img.GetName().Str();
-			});
-			if (img_iter != image_units.end()) {
-				visImageIndice.push_back(std::distance(image_units.begin(), img_iter));
-			}
-		}
+		IndexVector visImageIndice = GetVisibleImageIndices(build_unit, image_indices);
 		
-		std::vector<stocker::Outline3d> prim_outlines = GetPlanarOutlines(prim_entity, BDDB_PLANEFRAME_PREFIX);
+		bool is_task = ori_task_indices.find(pi) != ori_task_indices.end();
 		std::string model_dir = build_unit->file_path.model_dir + prim_entity->getName().toStdString() + "/";
-		for (size_t i = 0; i < prim_outlines.size(); i++) {
-			stocker::Outline3d outline = prim_outlines[i];
+		for (size_t i = 0; i < prim_outlines[pi].size(); i++) {
+			const stocker::Outline3d& outline = prim_outlines[pi][i];
 			std::string outline_output_dir = model_dir + to_string(i);
 			texture_mapping.addPlane(outline, visImageIndice, outline_output_dir);
 			
-			if (std::find(ori_task_indices.begin(), ori_task_indices.end(), pi) != ori_task_indices.end()) {
+			if (is_task) {
 				parse_task_indices.push_back(task_count);
 			}
 			task_count++;
@@ -1895,20 +2484,9 @@ ccHObject* ConstrainedMesh(ccHObject* planeObj, int rare_pts)
 	return mesh;
 }
 
-bool DeduceFootPrintHeight(ccHObject* point_cloud, ccHObject* primitive, ccHObject* footprint, Contour3d & point_inside, double & height)
+//! deduce the footprint height from the points inside (the points are sorted by height)
+bool DeduceFootPrintHeight(Contour3d & points, double & height)
 {
-	if (!point_cloud && !primitive) return false;
-	StFootPrint* polyObj = ccHObjectCaster::ToStFootPrint(footprint);
-	assert(polyObj);
-	Polyline3d polygon = GetPolygonFromPolyline(polyObj);
-	
-	Contour3d points;
-	if (point_cloud) {
-		points = GetPointsFromCloudInsidePolygonXY(point_cloud, polygon, -DBL_MAX);
-	}
-	else if (primitive) {
-		points = GetPointsFromCloudInsidePolygonXY(primitive, polygon, -DBL_MAX);
-	}
 	if (points.empty()) {
 		return false;
 	}
@@ -1934,16 +2512,11 @@ bool DeduceFootPrintHeight(ccHObject* point_cloud, ccHObject* primitive, ccHObje
 			break;
 		}
 	}
-	ccPlane* cc_plane = nullptr;
 	for (auto layer : layer_count) {
 		if (layer.second > 0.8*points.size()) {
 			height = layer.first*step + min_height;
 		}			
 	}
-	//! check if there is a close one
-	if (primitive) {
-
-	}	
 	return true;
 }
 
@@ -2280,18 +2853,36 @@ ccHObject* LoD1FromFootPrint(ccHObject* buildingObj, bool flat)
 	StBlockGroup* blockgroup_obj = baseObj->GetBlockGroup(building_name);
 	ccHObject::Container footprintObjs = blockgroup_obj->getValidFootPrints();
 
+	//! the points inside the footprints without height are extracted at once
+	ccHObject* height_source = cloudObj ? cloudObj : prim_group_obj;
+	std::vector<Polyline3d> deduce_polygons;
+	std::vector<int> deduce_index(footprintObjs.size(), -1);
+	if (height_source) {
+		for (size_t i = 0; i < footprintObjs.size(); i++) {
+			StFootPrint* foot_print = ccHObjectCaster::ToStFootPrint(footprintObjs[i]);
+			if (!foot_print || !foot_print->isEnabled()) continue;
+			if (fabs(foot_print->getHeight() - foot_print->getBottom()) < 1e-6) {
+				deduce_index[i] = static_cast<int>(deduce_polygons.size());
+				deduce_polygons.push_back(GetPolygonFromPolyline(foot_print));
+			}
+		}
+	}
+	std::vector<Contour3d> deduce_points;
+	if (!deduce_polygons.empty()) {
+		deduce_points = GetPointsFromCloudInsideEachPolygonXY(height_source, deduce_polygons, -DBL_MAX);
+	}
+
 	int biggest = GetMaxNumberExcludeChildPrefix(blockgroup_obj, BDDB_BLOCK_PREFIX);
 	for (size_t i = 0; i < footprintObjs.size(); i++) {
 		StFootPrint* foot_print = ccHObjectCaster::ToStFootPrint(footprintObjs[i]);
 		if (!foot_print || !foot_print->isEnabled()) continue;
 		
 		//! get height
-		Contour3d points_inside;
 		double height = foot_print->getHeight();
 		double ground = foot_print->getBottom();
 
 		if (fabs(height - ground) < 1e-6) {
-			if (!DeduceFootPrintHeight(cloudObj, prim_group_obj, footprintObjs[i], points_inside, height)) {
+			if (deduce_index[i] < 0 || !DeduceFootPrintHeight(deduce_points[deduce_index[i]], height)) {
 				std::cout << "cannot deduce height from footprint " << foot_print->getName().toStdString() << std::endl;
 				continue;
 			}			
@@ -2673,17 +3264,54 @@ ccHObject::Container PackPolygons(ccHObject::Container polygonEntites, int sampl
 	return output_polygons;
 }
 
+bool ResolveBuildingContext(ccHObject* buildingObj, BDBuildingContext& context, bool createMissingGroups/*=false*/)
+{
+	if (!buildingObj) return false;
+	context.buildingObj = GetParentBuilding(buildingObj);
+	if (!context.buildingObj) return false;
+	context.baseObj = GetRootBDBase(context.buildingObj);
+	if (!context.baseObj) return false;
+
+	QString building_name = context.buildingObj->getName();
+	context.buildUnit = context.baseObj->GetBuildingSp(building_name.toStdString());
+
+	if (createMissingGroups && MainWindow::TheInstance()) {
+		context.primGroup = context.baseObj->GetPrimitiveGroup(building_name);
+		context.blockGroup = context.baseObj->GetBlockGroup(building_name);
+	}
+	else {
+		//! lookup only: GetPrimitiveGroup and GetBlockGroup would create the missing groups in the DB tree
+		ccHObject* prim_group = context.baseObj->GetHObj(CC_TYPES::ST_PRIMGROUP, BDDB_PRIMITIVE_SUFFIX, building_name, false);
+		context.primGroup = prim_group ? static_cast<StPrimGroup*>(prim_group) : nullptr;
+		ccHObject* block_group = context.baseObj->GetHObj(CC_TYPES::ST_BLOCKGROUP, BDDB_BLOCKGROUP_SUFFIX, building_name, false);
+		context.blockGroup = block_group ? static_cast<StBlockGroup*>(block_group) : nullptr;
+	}
+
+	return context.buildUnit != nullptr;
+}
+
 bool PackPlaneFrames(ccHObject* buildingObj, int max_iter, bool cap_hole, double ptsnum_ratio, double data_ratio,
 	double ints_thre, double cluster_hori, double cluster_verti)
 {
 	MainWindow* win = MainWindow::TheInstance(); if (!win) return false;
+	BDBuildingContext context;
+	if (!ResolveBuildingContext(buildingObj, context, true)) return false;
+
+	bool ret = PackPlaneFrames(context, max_iter, cap_hole, ptsnum_ratio, data_ratio, ints_thre, cluster_hori, cluster_verti);
+	for (ccHObject* del : context.removedEntities) {
+		win->removeFromDB(del);
+	}
+	return ret;
+}
+
+bool PackPlaneFrames(BDBuildingContext& context, int max_iter, bool cap_hole, double ptsnum_ratio, double data_ratio,
+	double ints_thre, double cluster_hori, double cluster_verti)
+{
 	try {
-		BDBaseHObject* baseObj = GetRootBDBase(buildingObj); if (!baseObj) return false;
-		QString building_name = buildingObj->getName();
-		BuildUnit* build_unit = baseObj->GetBuildingSp(building_name.toStdString());
-		if (!build_unit) return false;
-		StPrimGroup* prim_group_obj = baseObj->GetPrimitiveGroup(building_name);
-		if (!prim_group_obj) return false;
+		ccHObject* buildingObj = context.buildingObj;
+		BuildUnit* build_unit = context.buildUnit;
+		StPrimGroup* prim_group_obj = context.primGroup;
+		if (!buildingObj || !build_unit || !prim_group_obj) return false;
 
 		ccHObject::Container horizontal_planes, vertical_planes;
 		horizontal_planes = GetNonVerticalPlaneClouds(prim_group_obj, 15, &vertical_planes);
@@ -2789,16 +3417,18 @@ bool PackPlaneFrames(ccHObject* buildingObj, int max_iter, bool cap_hole, double
 			size_t origin_index = result_planes_index[i];
 			ccHObject* plane_entity = horizontal_planes[origin_index];
 
-			/// clear all the old frames
+			/// clear all the old frames (they are removed from the DB tree by the caller)
 			ccHObject::Container container_find;
 			plane_entity->filterChildrenByName(container_find, false, BDDB_PLANEFRAME_PREFIX, true);
 			for (ccHObject* del : container_find) {
-				win->removeFromDB(del);
+				del->setEnabled(false);
+				context.removedEntities.push_back(del);
 			}
 			vector<vector<Contour3d>> frames_to_add(1);
 			frames_to_add.back().push_back(result_planes_frames[i]);
 
 			ccHObject* plane_frame = AddOutlinesAsChild(frames_to_add, BDDB_PLANEFRAME_PREFIX, plane_entity);
+			if (plane_frame) context.addedEntities.push_back(plane_frame);
 		}
 	}
 	catch (const std::exception&e) {
@@ -2818,15 +3448,25 @@ bool PackFootprints_PPP(ccHObject* buildingObj, int max_iter, bool cap_hole,
 {
 	MainWindow* win = MainWindow::TheInstance();
 	if (!win) return false;
-		
+	BDBuildingContext context;
+	if (!ResolveBuildingContext(buildingObj, context, true)) return false;
+
+	bool ret = PackFootprints_PPP(context, max_iter, cap_hole, ptsnum_ratio, data_ratio, sharp_weight);
+	for (ccHObject* del : context.removedEntities) {
+		win->removeFromDB(del);
+	}
+	return ret;
+}
+
+bool PackFootprints_PPP(BDBuildingContext& context, int max_iter, bool cap_hole,
+	double ptsnum_ratio, double data_ratio, double sharp_weight)
+{
 	try {
-		BDBaseHObject* baseObj = GetRootBDBase(buildingObj); if (!baseObj) return false;
-		QString building_name = buildingObj->getName();
-		BuildUnit* build_unit = baseObj->GetBuildingSp(building_name.toStdString());
-		if (!build_unit) return false;
-		StPrimGroup* prim_group_obj = baseObj->GetPrimitiveGroup(building_name);
-		StBlockGroup* blockgroup_obj = baseObj->GetBlockGroup(buildingObj->getName());
-		if (!prim_group_obj || !blockgroup_obj) { return false; }
+		ccHObject* buildingObj = context.buildingObj;
+		BuildUnit* build_unit = context.buildUnit;
+		StPrimGroup* prim_group_obj = context.primGroup;
+		StBlockGroup* blockgroup_obj = context.blockGroup;
+		if (!buildingObj || !build_unit || !prim_group_obj || !blockgroup_obj) { return false; }
 
 		//! get footprints
 		ccHObject::Container footprints = blockgroup_obj->getValidFootPrints(BDDB_FOOTPRINT_PREFIX);
@@ -2858,6 +3498,10 @@ bool PackFootprints_PPP(ccHObject* buildingObj, int max_iter, bool cap_hole,
 		ccHObject::Container horizon_planes, vertical_planes;
 		horizon_planes = GetNonVerticalPlaneClouds(prim_group_obj, 15, &vertical_planes);
 		
+		//! the footprints without plane names are extracted from all the horizontal planes at once
+		std::vector<Polyline3d> horizon_polygons;
+		std::vector<size_t> horizon_polygons_layer;
+
 		stocker::Outline2d holes;
 		for (size_t i = 0; i < footprints.size(); ++i) {
 			StFootPrint* ftObj = ccHObjectCaster::ToStFootPrint(footprints[i]); if (!ftObj) continue;
@@ -2877,8 +3521,8 @@ bool PackFootprints_PPP(ccHObject* buildingObj, int max_iter, bool cap_hole,
 			QStringList plane_names = ftObj->getPlaneNames();
 			std::vector<Contour3d> planes_points;
 			if (plane_names.empty()) {
-				planes_points = GetPointsFromCloudInsidePolygonsXY(horizon_planes, 
-					MakeLoopPolylinefromContour(ft_pts), DBL_MAX, true);
+				horizon_polygons.push_back(MakeLoopPolylinefromContour(ft_pts));
+				horizon_polygons_layer.push_back(layers_planes_points.size());
 			}
 			else {
 				for (auto & pl_name : plane_names) {
@@ -2895,6 +3539,16 @@ bool PackFootprints_PPP(ccHObject* buildingObj, int max_iter, bool cap_hole,
 			footprints_points.push_back(ft_pts);
 			footprints_original_index.push_back(i);
 		}
+		if (!horizon_polygons.empty()) {
+			for (ccHObject* plane_cloud : horizon_planes) {
+				std::vector<Contour3d> polygons_points = GetPointsFromCloudInsideEachPolygonXY(plane_cloud, horizon_polygons, DBL_MAX);
+				for (size_t k = 0; k < polygons_points.size(); ++k) {
+					if (!polygons_points[k].empty()) {
+						layers_planes_points[horizon_polygons_layer[k]].push_back(std::move(polygons_points[k]));
+					}
+				}
+			}
+		}
 
 		std::vector<stocker::Seg2d> facade_projected;
 		ccHObject::Container all_planes = prim_group_obj->getValidPlanes();
@@ -2952,11 +3606,9 @@ bool PackFootprints_PPP(ccHObject* buildingObj, int max_iter, bool cap_hole,
 			//TODO: should give outlines rather than polygons //! yes give polygons ok, if need holes support, use setFootprint
 			poly_partition.setPolygon(polygons, polygons_points, true, true);
 
-			stocker::SimpleSaveToPly("d:/projected.ply", Contour3d(), ToPolyline3d(facade_projected));
 			stocker::Polyline2d facade_clustered = stocker::ClusterSegments(facade_projected, 1, 0.1);
 
 			facade_clustered = stocker::collectCloseSegmentsAroundPolygons(polygons_2d, facade_clustered, 2);
-			stocker::SimpleSaveToPly("d:/clustered.ply", Contour3d(), ToPolyline3d(facade_clustered));
 					
 			poly_partition.setFacades(facade_clustered);
 
@@ -2974,10 +3626,10 @@ bool PackFootprints_PPP(ccHObject* buildingObj, int max_iter, bool cap_hole,
 
 		if (footprints_points_pp.empty() || footprints_points_pp.size() != footprints_pp_index.size()) return false;
 
+		//! the old footprints are removed from the DB tree by the caller
 		for (size_t i = 0; i < footprints.size(); i++) {
-			win->removeFromDB(footprints[i]);
-// 			footprints[i]->setEnabled(false);
-// 			footprints[i]->setName("del-" + footprints[i]->getName());
+			footprints[i]->setEnabled(false);
+			context.removedEntities.push_back(footprints[i]);
 		}
 		int biggest = GetMaxNumberExcludeChildPrefix(blockgroup_obj, BDDB_FOOTPRINT_PREFIX);
 		for (size_t i = 0; i < footprints_points_pp.size(); i++) {
@@ -3004,6 +3656,7 @@ bool PackFootprints_PPP(ccHObject* buildingObj, int max_iter, bool cap_hole,
 				footptObj->setGlobalScale(ftOriObj->getGlobalScale());
 			}
 			blockgroup_obj->addChild(footptObj);
+			context.addedEntities.push_back(footptObj);
 		}
 	}
 	catch (const std::exception&e) {
@@ -3023,27 +3676,38 @@ ccHObject* LoD2FromFootPrint_PPP(ccHObject* entity,
 	double alpha, double min_area, double max_intersection,
 	double cluster_hori, double cluster_verti)
 {
-	BDBaseHObject* baseObj = GetRootBDBase(entity); if (!baseObj) return false;
-	ccHObject* buildingObj = nullptr;
-	if (entity->isA(CC_TYPES::ST_FOOTPRINT)) {
-		buildingObj = GetParentBuilding(entity);
-	}
-	else if (entity->isA(CC_TYPES::ST_BUILDING)) {
-		buildingObj = entity;
+	if (!entity || !(entity->isA(CC_TYPES::ST_FOOTPRINT) || entity->isA(CC_TYPES::ST_BUILDING))) {
+		return nullptr;
 	}
-	else return nullptr;
-	
-	QString building_name = buildingObj->getName();
-	BuildUnit* build_unit = baseObj->GetBuildingSp(building_name.toStdString());
-	if (!build_unit) return nullptr;
-	StPrimGroup* prim_group_obj = baseObj->GetPrimitiveGroup(building_name);
-	StBlockGroup* blockgroup_obj = baseObj->GetBlockGroup(buildingObj->getName());
-	if (!prim_group_obj || !blockgroup_obj) { return false; }
+	BDBuildingContext context;
+	if (!ResolveBuildingContext(entity, context, true)) return nullptr;
+
+	return LoD2FromFootPrint_PPP(context,
+		entity->isA(CC_TYPES::ST_FOOTPRINT) ? entity : nullptr,
+		max_iter, cap_hole, fit_footprint, ptsnum_ratio, data_ratio,
+		ints_thre, alpha, min_area, max_intersection, cluster_hori, cluster_verti);
+}
+
+ccHObject* LoD2FromFootPrint_PPP(BDBuildingContext& context,
+	ccHObject* footprintObj,
+	int max_iter,
+	bool cap_hole,
+	bool fit_footprint,
+	double ptsnum_ratio, double data_ratio,
+	double ints_thre,
+	double alpha, double min_area, double max_intersection,
+	double cluster_hori, double cluster_verti)
+{
+	ccHObject* buildingObj = context.buildingObj;
+	BuildUnit* build_unit = context.buildUnit;
+	StPrimGroup* prim_group_obj = context.primGroup;
+	StBlockGroup* blockgroup_obj = context.blockGroup;
+	if (!buildingObj || !build_unit || !prim_group_obj || !blockgroup_obj) { return nullptr; }
 
 	//! get footprints
 	ccHObject::Container footprints;
-	if (entity->isA(CC_TYPES::ST_FOOTPRINT)) {
-		footprints.push_back(entity);
+	if (footprintObj) {
+		footprints.push_back(footprintObj);
 	}
 	else footprints = blockgroup_obj->getValidFootPrints();
 
@@ -3067,6 +3731,9 @@ ccHObject* LoD2FromFootPrint_PPP(ccHObject* entity,
 	facade_projected = stocker::ClusterSegments(facade_projected, cluster_hori, cluster_verti);
 
 	for (ccHObject* fpEntity : footprints) {
+		if (context.timedOut() || context.canceled()) {
+			return nullptr;
+		}
 		StFootPrint* ftObj = ccHObjectCaster::ToStFootPrint(fpEntity);
 		if (!ftObj) { continue; }
 		std::cout << "LoD2 - " << ftObj->getName().toStdString() << std::endl;
@@ -3134,6 +3801,7 @@ ccHObject* LoD2FromFootPrint_PPP(ccHObject* entity,
 			int block_number = GetMaxNumberExcludeChildPrefix(ftObj, BDDB_BLOCK_PREFIX) + 1;
 			block_entity->setName(BDDB_BLOCK_PREFIX + QString::number(block_number++));
 			ftObj->addChild(block_entity);
+			context.addedEntities.push_back(block_entity);
 			continue;
 		}
 		
@@ -3178,7 +3846,7 @@ ccHObject* LoD2FromFootPrint_PPP(ccHObject* entity,
 			poly_partition.setFacades(facade_valid);
 
 			if (!poly_partition.runBP()) {
-				return false;
+				return nullptr;
 			}
 
 			std::vector<std::pair<size_t, Outline3d>> results = poly_partition.getResultPolygon();
@@ -3215,6 +3883,7 @@ ccHObject* LoD2FromFootPrint_PPP(ccHObject* entity,
 				block_entity->setName(BDDB_BLOCK_PREFIX + QString::number(block_number));
 				block_entity->setMetaData("plane", planes_used_for_ppp[roof_plane_index]->getName());
 				ftObj->addChild(block_entity);
+				context.addedEntities.push_back(block_entity);
 			}
 		}
 	}
@@ -23,6 +23,10 @@
 
 #include "stockerDatabase.h"
 
+#include <QElapsedTimer>
+
+#include <atomic>
+
 #ifdef USE_STOCKER
 #include "builderlod3/builderlod3.h"
 #include "builderlod2/builderlod2.h"
@@ -54,6 +58,10 @@ double GetPointsAverageSpacing(ccHObject* pc);
 stocker::Contour3d GetPointsFromCloudInsidePolygonXY(ccHObject * entity, stocker::Polyline3d polygon, double height);
 std::vector<stocker::Contour3d> GetPointsFromCloudInsidePolygonsXY(ccHObject::Container entities, stocker::Polyline3d polygon, double height, bool skip_empty = true);
 std::vector<stocker::Contour3d> GetPointsFromCloudInsidePolygonsXY(ccHObject* entity, stocker::Polyline3d polygon, double height, bool skip_empty = true);
+//! Extracts the points of a cloud inside each polygon (XY) at once (the polygons are processed in parallel)
+std::vector<stocker::Contour3d> GetPointsFromCloudInsideEachPolygonXY(ccHObject* entity, const std::vector<stocker::Polyline3d>& polygons, double height);
+//! Releases the cached XY indexes of the point clouds (see GetPointsFromCloudInsidePolygonXY). To be called at the end of each batch.
+void ReleaseCloudXYIndexes();
 stocker::Contour3d GetPointsFromCloudInsidePolygon3d(ccHObject * entity, stocker::Polyline3d polygon, stocker::Contour3d & remained, double distance_threshold);
 stocker::Polyline3d GetPolygonFromPolyline(ccHObject * entity);
 stocker::Polyline3d GetPolylineFromEntities(ccHObject::Container entities);
@@ -150,6 +158,52 @@ ccHObject* LoD2FromFootPrint_PPP(ccHObject * entity, int max_iter, bool cap_hole
 
 bool PackFootprints_PPRepair(ccHObject * buildingObj);
 
+//! Entities of a building, resolved beforehand (see ResolveBuildingContext)
+/** The functions working on a context only access the building sub-tree (and never
+	the DB tree), so that several buildings can be processed concurrently.
+**/
+struct BDBuildingContext
+{
+	BDBaseHObject* baseObj = nullptr;
+	StBuilding* buildingObj = nullptr;
+	stocker::BuildUnit* buildUnit = nullptr;
+	StPrimGroup* primGroup = nullptr;
+	StBlockGroup* blockGroup = nullptr;
+
+	//! Entities disabled by the processing (to be removed from the DB tree afterwards)
+	ccHObject::Container removedEntities;
+	//! Entities added by the processing
+	ccHObject::Container addedEntities;
+
+	//! Time budget in ms (0 = unlimited)
+	qint64 timeout_ms = 0;
+	//! Started when the processing starts
+	QElapsedTimer timer;
+	//! Cancel flag (optional)
+	const std::atomic<bool>* cancelRequested = nullptr;
+
+	bool timedOut() const { return timeout_ms > 0 && timer.isValid() && timer.elapsed() > timeout_ms; }
+	bool canceled() const { return cancelRequested && *cancelRequested; }
+};
+
+//! Resolves the entities of a building
+/** \param createMissingGroups whether to create the missing primitive and block groups
+	(in the DB tree: main thread only, see BDBaseHObject::GetPrimitiveGroup)
+**/
+bool ResolveBuildingContext(ccHObject * buildingObj, BDBuildingContext & context, bool createMissingGroups = false);
+
+bool PackPlaneFrames(BDBuildingContext & context, int max_iter, bool cap_hole, double ptsnum_ratio, double data_ratio,
+	double ints_thre, double cluster_hori, double cluster_verti);
+
+bool PackFootprints_PPP(BDBuildingContext & context, int max_iter, bool cap_hole, double ptsnum_ratio, double data_ratio, double sharp_weight);
+
+//! Reconstructs the LoD2 blocks of all the valid footprints of the building (or of 'footprintObj' only)
+/** Stops (and returns null) if the context time budget is exceeded.
+**/
+ccHObject* LoD2FromFootPrint_PPP(BDBuildingContext & context, ccHObject * footprintObj, int max_iter, bool cap_hole, bool fit_footprint, double ptsnum_ratio, double data_ratio,
+	double ints_thre, double alpha, double min_area, double max_intersection,
+	double cluster_hori, double cluster_verti);
+
 //! settings.x - xybias, y - zbias, z - minPts
 void GetPlanesInsideFootPrint(ccHObject * footprint, ccHObject * prim_group, CCVector3 settings, bool bVertical, bool clearExisting);
 